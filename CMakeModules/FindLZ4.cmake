@@ -0,0 +1,41 @@
+# Locate the LZ4 compression library
+# This module defines
+# LZ4_FOUND, if false, do not try to link to liblz4
+# LZ4_INCLUDE_DIR, where to find lz4.h
+# LZ4_LIBRARIES
+#
+# $LZ4_DIR is an environment variable that would
+# correspond to the ./configure --prefix=$LZ4_DIR
+# used in building liblz4.
+
+FIND_PATH(LZ4_INCLUDE_DIR lz4.h
+    PATHS
+    $ENV{LZ4_DIR}
+    ${3rdPartyRoot}
+    /usr/local
+    /usr
+    /sw # Fink
+    /opt/local # DarwinPorts
+    /opt/csw # Blastwave
+    /opt
+    PATH_SUFFIXES include
+)
+
+FIND_LIBRARY(LZ4_LIBRARIES
+    NAMES lz4 liblz4
+    PATHS
+    $ENV{LZ4_DIR}
+    ${3rdPartyRoot}
+    /usr/local
+    /usr
+    /sw
+    /opt/local
+    /opt/csw
+    /opt
+    PATH_SUFFIXES lib64 lib
+)
+
+SET(LZ4_FOUND "NO")
+IF(LZ4_LIBRARIES AND LZ4_INCLUDE_DIR)
+    SET(LZ4_FOUND "YES")
+ENDIF(LZ4_LIBRARIES AND LZ4_INCLUDE_DIR)
@@ -0,0 +1,41 @@
+# Locate the Zstandard compression library
+# This module defines
+# ZSTD_FOUND, if false, do not try to link to libzstd
+# ZSTD_INCLUDE_DIR, where to find zstd.h
+# ZSTD_LIBRARIES
+#
+# $ZSTD_DIR is an environment variable that would
+# correspond to the ./configure --prefix=$ZSTD_DIR
+# used in building libzstd.
+
+FIND_PATH(ZSTD_INCLUDE_DIR zstd.h
+    PATHS
+    $ENV{ZSTD_DIR}
+    ${3rdPartyRoot}
+    /usr/local
+    /usr
+    /sw # Fink
+    /opt/local # DarwinPorts
+    /opt/csw # Blastwave
+    /opt
+    PATH_SUFFIXES include
+)
+
+FIND_LIBRARY(ZSTD_LIBRARIES
+    NAMES zstd libzstd
+    PATHS
+    $ENV{ZSTD_DIR}
+    ${3rdPartyRoot}
+    /usr/local
+    /usr
+    /sw
+    /opt/local
+    /opt/csw
+    /opt
+    PATH_SUFFIXES lib64 lib
+)
+
+SET(ZSTD_FOUND "NO")
+IF(ZSTD_LIBRARIES AND ZSTD_INCLUDE_DIR)
+    SET(ZSTD_FOUND "YES")
+ENDIF(ZSTD_LIBRARIES AND ZSTD_INCLUDE_DIR)
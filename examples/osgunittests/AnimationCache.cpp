@@ -0,0 +1,135 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/Timer>
+
+#include <osgAnimation/AnimationCache>
+#include <osgAnimation/BasicAnimationManager>
+#include <osgAnimation/Channel>
+
+#include <iostream>
+#include <math.h>
+#include <vector>
+
+// Benchmark of osgAnimation::AnimationCache, updates a crowd of instances of a skeleton whose BasicAnimationManager
+// play copies of the same animation, started in a few groups, without a cache, with a cache sharing the poses sampled
+// at exactly the same time, with a cache quantizing the time and with a pose pool of the whole animation, reporting the
+// update time, the cache hit ratio and the largest difference of the animated values from the update without a cache.
+
+static osgAnimation::Animation* createCrowdAnimation(unsigned int numBones, unsigned int numKeys)
+{
+    osgAnimation::Animation* animation = new osgAnimation::Animation;
+    animation->setPlayMode(osgAnimation::Animation::LOOP);
+    for(unsigned int b=0; b<numBones; ++b)
+    {
+        osgAnimation::Vec3LinearChannel* translate = new osgAnimation::Vec3LinearChannel;
+        osgAnimation::QuatSphericalLinearChannel* rotate = new osgAnimation::QuatSphericalLinearChannel;
+        osgAnimation::Vec3KeyframeContainer* translateKeys = translate->getOrCreateSampler()->getOrCreateKeyframeContainer();
+        osgAnimation::QuatKeyframeContainer* rotateKeys = rotate->getOrCreateSampler()->getOrCreateKeyframeContainer();
+        for(unsigned int k=0; k<numKeys; ++k)
+        {
+            double time = double(k)/30.0;
+            float angle = sinf(float(k)*0.2f+float(b))*0.5f;
+            translateKeys->push_back(osgAnimation::Vec3Keyframe(time, osg::Vec3(0.0f, 1.0f+0.1f*angle, 0.0f)));
+            rotateKeys->push_back(osgAnimation::QuatKeyframe(time, osg::Quat(angle, osg::Vec3(1.0f, 0.0f, 0.0f))));
+        }
+        animation->addChannel(translate);
+        animation->addChannel(rotate);
+    }
+    return animation;
+}
+
+static float getMaximumDifference(osgAnimation::BasicAnimationManager* lhs, osgAnimation::BasicAnimationManager* rhs)
+{
+    const osgAnimation::ChannelList& lhsChannels = lhs->getAnimationList()[0]->getChannels();
+    const osgAnimation::ChannelList& rhsChannels = rhs->getAnimationList()[0]->getChannels();
+    float difference = 0.0f;
+    for(unsigned int c=0; c<lhsChannels.size(); c+=2)
+    {
+        osg::Vec3 translation = static_cast<osgAnimation::Vec3LinearChannel*>(lhsChannels[c].get())->getTargetTyped()->getValue()-
+                                static_cast<osgAnimation::Vec3LinearChannel*>(rhsChannels[c].get())->getTargetTyped()->getValue();
+        osg::Quat rotation = static_cast<osgAnimation::QuatSphericalLinearChannel*>(lhsChannels[c+1].get())->getTargetTyped()->getValue()-
+                             static_cast<osgAnimation::QuatSphericalLinearChannel*>(rhsChannels[c+1].get())->getTargetTyped()->getValue();
+        difference = osg::maximum(difference, osg::maximum(translation.length(), float(rotation.length())));
+    }
+    return difference;
+}
+
+void runAnimationCacheBenchmark(unsigned int numInstances, unsigned int numBones, unsigned int numFrames)
+{
+    const unsigned int numGroups = 8;
+    std::cout<<"animation cache benchmark, "<<numInstances<<" instances of "<<numBones<<" bones started in "<<numGroups<<" groups, "<<numFrames<<" frames"<<std::endl;
+
+    osg::ref_ptr<osgAnimation::Animation> animation = createCrowdAnimation(numBones, 300);
+
+    const char* names[] = { "no cache", "cache", "cache, quantized time", "pose pool" };
+    std::vector< osg::ref_ptr<osgAnimation::BasicAnimationManager> > reference;
+    double referenceTime = 0.0;
+    for(unsigned int m=0; m<4; ++m)
+    {
+        osg::ref_ptr<osgAnimation::AnimationCache> cache;
+        if (m>0)
+        {
+            cache = new osgAnimation::AnimationCache;
+            cache->setTimeQuantum(m==1 ? 0.0 : 1.0/120.0);
+            if (m==3) cache->createPosePool(*animation);
+        }
+
+        // each instance gets its own copy of the animation and of its targets, sharing the keyframes.
+        std::vector< osg::ref_ptr<osgAnimation::BasicAnimationManager> > managers(numInstances);
+        for(unsigned int i=0; i<numInstances; ++i)
+        {
+            osgAnimation::Animation* copy = new osgAnimation::Animation(*animation, osg::CopyOp::SHALLOW_COPY);
+            managers[i] = new osgAnimation::BasicAnimationManager;
+            managers[i]->registerAnimation(copy);
+            managers[i]->setAnimationCache(cache.get());
+            managers[i]->playAnimation(copy);
+            // the instances of a group start at the same time.
+            copy->setStartTime(double(i%numGroups)*0.37);
+        }
+
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        for(unsigned int f=0; f<numFrames; ++f)
+        {
+            double time = 1.0+double(f)/60.0;
+            for(unsigned int i=0; i<numInstances; ++i) managers[i]->update(time);
+        }
+        double time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+        std::cout<<"  "<<names[m]<<": "<<time*1000.0/double(numFrames)<<" ms per frame";
+        if (cache.valid())
+        {
+            double lookups = double(cache->getNumHits()+cache->getNumMisses());
+            std::cout<<", hit ratio "<<(lookups>0.0 ? double(cache->getNumHits())/lookups : 0.0)<<", "<<cache->getNumPoses()<<" poses";
+        }
+
+        if (m==0)
+        {
+            reference.swap(managers);
+            referenceTime = time;
+        }
+        else
+        {
+            float difference = 0.0f;
+            for(unsigned int i=0; i<numInstances; ++i) difference = osg::maximum(difference, getMaximumDifference(reference[i].get(), managers[i].get()));
+            std::cout<<", speed up "<<referenceTime/time<<", max difference "<<difference;
+            if (m==1 && difference!=0.0f) std::cout<<", ERROR values differ from the update without cache";
+        }
+        std::cout<<std::endl;
+    }
+}
@@ -0,0 +1,264 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/PagedLOD>
+#include <osg/Stats>
+#include <osg/Timer>
+
+#include <osgDB/DatabasePager>
+#include <osgDB/Registry>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+#include <sstream>
+#include <math.h>
+#include <stdio.h>
+
+// Headless benchmark of the osgDB::DatabasePager request queues, a camera flies along a long row of PagedLOD tiles
+// requesting the tiles within range ahead of it each frame, as the CullVisitor would, while the database threads read them
+// using an osgDB::ReadFileCallback that generates the tiles after a short sleep to emulate file access. Reports the time
+// spent issuing the requests, the proportion of tiles already loaded when they first come into range, and the queue latency,
+// cancellation and prefetch statistics the DatabasePager records into osg::Stats. With a memory budget the tiles left behind
+// the camera are only expired to keep the resident bytes within the budget, which is checked every frame.
+
+static const char* s_pagerTileExtension = "synthetic_pager_tile";
+
+class PagerTileReadFileCallback : public osgDB::ReadFileCallback
+{
+    public:
+
+        virtual osgDB::ReaderWriter::ReadResult readNode(const std::string& filename, const osgDB::Options* options)
+        {
+            unsigned int index;
+            if (sscanf(filename.c_str(), "pager_tile_%u", &index)!=1 || filename.find(s_pagerTileExtension)==std::string::npos)
+            {
+                return osgDB::ReadFileCallback::readNode(filename, options);
+            }
+
+            // emulate the latency of reading a file.
+            OpenThreads::Thread::microSleep(500);
+
+            osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+            for(unsigned int r=0; r<16; ++r)
+            {
+                for(unsigned int c=0; c<16; ++c)
+                {
+                    vertices->push_back(osg::Vec3(float(index)+float(c)/15.0f, float(r)/15.0f, 0.0f));
+                }
+            }
+
+            osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+            geometry->setVertexArray(vertices.get());
+            geometry->addPrimitiveSet(new osg::DrawArrays(GL_POINTS, 0, vertices->size()));
+
+            osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+            geode->addDrawable(geometry.get());
+            return geode.get();
+        }
+
+    protected:
+
+        virtual ~PagerTileReadFileCallback() {}
+};
+
+static double sumAttribute(osg::Stats* stats, const std::string& name)
+{
+    double total = 0.0;
+    for(unsigned int i=stats->getEarliestFrameNumber(); i<=stats->getLatestFrameNumber(); ++i)
+    {
+        double value;
+        if (stats->getAttribute(i, name, value)) total += value;
+    }
+    return total;
+}
+
+void runDatabasePagerBenchmark(unsigned int numTiles, unsigned int numFrames, unsigned int numThreads, double prefetchTime, double memoryBudget)
+{
+    if (numTiles<1) numTiles = 1;
+    if (numThreads<1) numThreads = 1;
+
+    osg::ref_ptr<osgDB::ReadFileCallback> previousReadFileCallback = osgDB::Registry::instance()->getReadFileCallback();
+    osgDB::Registry::instance()->setReadFileCallback(new PagerTileReadFileCallback);
+
+    // the camera covers the row of tiles over the frames, requesting all the tiles within range ahead of it.
+    const float range = 200.0f;
+    float speed = float(numTiles)/float(numFrames);
+
+    osg::ref_ptr<osg::Group> root = new osg::Group;
+    std::vector< osg::ref_ptr<osg::PagedLOD> > tiles;
+    std::vector<std::string> filenames;
+    for(unsigned int i=0; i<numTiles; ++i)
+    {
+        std::ostringstream filename;
+        filename<<"pager_tile_"<<i<<"."<<s_pagerTileExtension;
+
+        osg::ref_ptr<osg::PagedLOD> plod = new osg::PagedLOD;
+        plod->setCenterMode(osg::LOD::USER_DEFINED_CENTER);
+        plod->setCenter(osg::Vec3(float(i)+0.5f, 0.5f, 0.0f));
+        plod->setRadius(1.0f);
+        plod->setFileName(0, filename.str());
+        plod->setRange(0, 0.0f, range);
+        root->addChild(plod.get());
+
+        tiles.push_back(plod);
+        filenames.push_back(filename.str());
+    }
+
+    osg::ref_ptr<osg::Stats> stats = new osg::Stats("DatabasePager", numFrames+1);
+    stats->collectStats("database_pager", true);
+
+    osg::ref_ptr<osgDB::DatabasePager> pager = new osgDB::DatabasePager;
+    pager->setUpThreads(numThreads, 0);
+    pager->setTargetMaximumNumberOfPageLOD(numTiles);
+    pager->setDoPreCompile(false);
+    pager->setStats(stats.get());
+    pager->setPrefetchTime(prefetchTime);
+    pager->setTargetMaximumResidentBytes(memoryBudget*1024.0*1024.0);
+
+    // the camera looks along the row of tiles, the prefetch traversal culling the tiles behind it.
+    osg::ref_ptr<osg::Camera> camera = new osg::Camera;
+    camera->setViewport(0, 0, 1024, 1024);
+    camera->setProjectionMatrixAsPerspective(90.0, 1.0, 1.0, 10000.0);
+
+    std::vector<bool> inRange(numTiles, false);
+    unsigned int numReadyWhenInRange = 0;
+
+    double maximumResidentBytes = 0.0;
+    unsigned int numFramesOverBudget = 0;
+
+    std::cout<<"DatabasePager benchmark, "<<numTiles<<" tiles, "<<numFrames<<" frames, "<<numThreads<<" database threads, camera speed "<<speed<<" tiles per frame, prefetch time "<<prefetchTime<<" s"<<std::endl;
+
+    osg::ref_ptr<osg::FrameStamp> frameStamp = new osg::FrameStamp;
+    double requestTime = 0.0;
+    unsigned int numRequests = 0;
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+    for(unsigned int frameNumber=1; frameNumber<=numFrames; ++frameNumber)
+    {
+        frameStamp->setFrameNumber(frameNumber);
+        frameStamp->setReferenceTime(double(frameNumber)/60.0);
+
+        pager->signalBeginFrame(frameStamp.get());
+
+        float x = float(frameNumber)*speed;
+        int first = osg::maximum(static_cast<int>(x), 0);
+        int last = osg::minimum(static_cast<int>(x+range), static_cast<int>(numTiles)-1);
+
+        osg::Timer_t requestStartTick = osg::Timer::instance()->tick();
+        for(int i=first; i<=last; ++i)
+        {
+            osg::PagedLOD* plod = tiles[i].get();
+
+            if (!inRange[i])
+            {
+                inRange[i] = true;
+                if (plod->getNumChildren()>0) ++numReadyWhenInRange;
+            }
+
+            if (plod->getNumChildren()>0)
+            {
+                // mark the tile as traversed, as PagedLOD::traverse(..) does for the CullVisitor.
+                plod->setFrameNumber(0, frameNumber);
+                continue;
+            }
+
+            osg::NodePath nodePath;
+            nodePath.push_back(root.get());
+            nodePath.push_back(plod);
+
+            // closer tiles have higher priority, as the PagedLOD's range based priority.
+            float priority = 1.0f - fabsf(float(i)+0.5f-x)/range;
+            pager->requestNodeFile(filenames[i], nodePath, priority, frameStamp.get(), plod->getDatabaseRequest(0), 0);
+            ++numRequests;
+        }
+        requestTime += osg::Timer::instance()->delta_m(requestStartTick, osg::Timer::instance()->tick());
+
+        pager->signalEndFrame();
+
+        // give the database threads time to read, as the draw traversal would.
+        OpenThreads::Thread::microSleep(2000);
+
+        pager->updateSceneGraph(*frameStamp);
+
+        double residentBytes = pager->getResidentBytes();
+        if (residentBytes>maximumResidentBytes) maximumResidentBytes = residentBytes;
+        if (memoryBudget>0.0 && residentBytes>memoryBudget*1024.0*1024.0) ++numFramesOverBudget;
+
+        camera->setViewMatrixAsLookAt(osg::Vec3d(x, 0.5, 10.0), osg::Vec3d(x+1.0, 0.5, 10.0), osg::Vec3d(0.0, 0.0, 1.0));
+        pager->prefetch(root.get(), camera.get(), *frameStamp);
+    }
+
+    double totalTime = osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick());
+
+    pager->cancel();
+
+    unsigned int numLoaded = 0;
+    for(unsigned int i=0; i<numTiles; ++i)
+    {
+        if (tiles[i]->getNumChildren()>0) ++numLoaded;
+    }
+
+    unsigned int numInRange = 0;
+    for(unsigned int i=0; i<numTiles; ++i)
+    {
+        if (inRange[i]) ++numInRange;
+    }
+
+    std::cout<<"  "<<totalTime<<" ms total, "<<numRequests<<" requests taking "<<requestTime<<" ms, "<<numLoaded<<" tiles merged"<<std::endl;
+    std::cout<<"  "<<numReadyWhenInRange<<" of "<<numInRange<<" tiles loaded when they first came into range"<<std::endl;
+    if (prefetchTime>0.0)
+    {
+        std::cout<<"  prefetch: "<<pager->getNumPrefetchRequests()<<" requests, "<<pager->getNumPrefetchHits()<<" hits, "<<pager->getNumPrefetchWasted()<<" wasted"<<std::endl;
+    }
+
+    std::cout<<"  resident bytes: maximum "<<maximumResidentBytes<<", final "<<pager->getResidentBytes()<<" ("<<pager->getResidentCPUBytes()<<" CPU, "<<pager->getResidentGPUBytes()<<" GPU)"<<std::endl;
+    if (memoryBudget>0.0)
+    {
+        // the pager only exceeds the budget when the tiles traversed in the last frame alone do.
+        std::cout<<"  memory budget "<<memoryBudget<<" MB: "<<pager->getNumMemoryBudgetExpiries()<<" tiles expired, "<<numFramesOverBudget<<" frames over budget"<<std::endl;
+    }
+
+    const std::string name("fileRequestQueue");
+    double numTaken = sumAttribute(stats.get(), name+" taken");
+    double numCancelled = sumAttribute(stats.get(), name+" cancelled");
+    double maximumLatency = 0.0;
+    for(unsigned int i=stats->getEarliestFrameNumber(); i<=stats->getLatestFrameNumber(); ++i)
+    {
+        double value;
+        if (stats->getAttribute(i, name+" latency maximum", value) && value>maximumLatency) maximumLatency = value;
+    }
+
+    std::cout<<"  "<<name<<": "<<numTaken<<" taken, "<<numCancelled<<" cancelled, maximum latency "<<maximumLatency<<" ms"<<std::endl;
+    std::cout<<"  latency histogram:";
+    unsigned int bound = 1;
+    for(unsigned int i=0; i<14; ++i, bound *= 2)
+    {
+        std::ostringstream attributeName;
+        if (i<13) attributeName<<name<<" latency <"<<bound<<"ms";
+        else attributeName<<name<<" latency >="<<bound/2<<"ms";
+
+        double count = sumAttribute(stats.get(), attributeName.str());
+        if (count>0.0) std::cout<<" "<<attributeName.str().substr(name.size()+9)<<" "<<count;
+    }
+    std::cout<<std::endl;
+
+    osgDB::Registry::instance()->setReadFileCallback(previousReadFileCallback.get());
+}
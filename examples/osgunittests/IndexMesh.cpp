@@ -0,0 +1,251 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/Geometry>
+#include <osg/Timer>
+#include <osg/TriangleIndexFunctor>
+
+#include <osgUtil/MeshOptimizers>
+
+#include <OpenThreads/Thread>
+
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+#include <string.h>
+
+// Benchmark of osgUtil::IndexMeshVisitor on an unindexed triangle grid with per vertex normals and texture
+// coordinates, as exported from CAD packages, comparing the hash based deduplication on one and several threads
+// with the sort based deduplication IndexMeshVisitor previously used, whose result it must match exactly. The
+// welding is tested by jittering each copy of the vertices by less than the weld tolerance, which must weld them
+// back into the vertices of the grid.
+
+// A grid of gridSize by gridSize quads drawn as unindexed triangles, the positions jittered by up to jitter.
+static osg::Geometry* createUnindexedGrid(unsigned int gridSize, float jitter)
+{
+    osg::Vec3Array* vertices = new osg::Vec3Array;
+    osg::Vec3Array* normals = new osg::Vec3Array;
+    osg::Vec2Array* texCoords = new osg::Vec2Array;
+    vertices->reserve(gridSize*gridSize*6);
+    normals->reserve(gridSize*gridSize*6);
+    texCoords->reserve(gridSize*gridSize*6);
+
+    unsigned int seed = 12345;
+    for(unsigned int y=0; y<gridSize; ++y)
+    {
+        for(unsigned int x=0; x<gridSize; ++x)
+        {
+            unsigned int corners[6][2] = { {x, y}, {x+1, y}, {x+1, y+1}, {x, y}, {x+1, y+1}, {x, y+1} };
+            for(unsigned int i=0; i<6; ++i)
+            {
+                float cx = float(corners[i][0]), cy = float(corners[i][1]);
+                osg::Vec3 offset;
+                for(unsigned int c=0; c<3; ++c)
+                {
+                    seed = seed*1664525u+1013904223u;
+                    offset[c] = jitter*(float(seed>>8)/float(1<<24)*2.0f-1.0f);
+                }
+                vertices->push_back(osg::Vec3(cx, cy, 10.0f*sinf(cx*0.05f)*cosf(cy*0.05f))+offset);
+                normals->push_back(osg::Vec3(-0.5f*cosf(cx*0.05f)*cosf(cy*0.05f), 0.5f*sinf(cx*0.05f)*sinf(cy*0.05f), 1.0f));
+                texCoords->push_back(osg::Vec2(cx/float(gridSize), cy/float(gridSize)));
+            }
+        }
+    }
+
+    osg::Geometry* geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices);
+    geometry->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
+    geometry->setTexCoordArray(0, texCoords, osg::Array::BIND_PER_VERTEX);
+    geometry->addPrimitiveSet(new osg::DrawArrays(GL_TRIANGLES, 0, vertices->size()));
+    return geometry;
+}
+
+// The vertex ordering by all attributes IndexMeshVisitor previously sorted the vertices with.
+struct CompareVertexAttributes
+{
+    std::vector<osg::Array*> arrays;
+
+    bool operator() (unsigned int lhs, unsigned int rhs) const
+    {
+        for(std::vector<osg::Array*>::const_iterator itr=arrays.begin(); itr!=arrays.end(); ++itr)
+        {
+            int compare = (*itr)->compare(lhs, rhs);
+            if (compare!=0) return compare<0;
+        }
+        return false;
+    }
+
+    bool equal(unsigned int lhs, unsigned int rhs) const { return !(*this)(lhs, rhs) && !(*this)(rhs, lhs); }
+};
+
+struct CollectIndicesOperator
+{
+    std::vector<unsigned int>* triangleIndices;
+
+    CollectIndicesOperator() : triangleIndices(0) {}
+
+    void operator() (unsigned int p1, unsigned int p2, unsigned int p3)
+    {
+        triangleIndices->push_back(p1);
+        triangleIndices->push_back(p2);
+        triangleIndices->push_back(p3);
+    }
+};
+
+template<class ArrayType>
+static void copyVertices(osg::Geometry& geometry, ArrayType* array, const std::vector<unsigned int>& copyMapping)
+{
+    ArrayType* result = new ArrayType;
+    result->reserve(copyMapping.size());
+    for(std::vector<unsigned int>::const_iterator itr=copyMapping.begin(); itr!=copyMapping.end(); ++itr)
+    {
+        result->push_back((*array)[*itr]);
+    }
+    if (array==geometry.getVertexArray()) geometry.setVertexArray(result);
+    else if (array==geometry.getNormalArray()) geometry.setNormalArray(result, osg::Array::BIND_PER_VERTEX);
+    else geometry.setTexCoordArray(0, result, osg::Array::BIND_PER_VERTEX);
+}
+
+// The sort based deduplication of IndexMeshVisitor::makeMesh before it hashed the vertices, each vertex mapped to the
+// first of the vertices identical to it.
+static void sortIndexMesh(osg::Geometry& geometry)
+{
+    CompareVertexAttributes compare;
+    compare.arrays.push_back(geometry.getVertexArray());
+    compare.arrays.push_back(geometry.getNormalArray());
+    compare.arrays.push_back(geometry.getTexCoordArray(0));
+
+    unsigned int numVertices = geometry.getVertexArray()->getNumElements();
+    std::vector<unsigned int> order(numVertices);
+    for(unsigned int i=0; i<numVertices; ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), compare);
+
+    std::vector<unsigned int> remapDuplicatesToOriginals(numVertices);
+    for(unsigned int first=0; first<numVertices;)
+    {
+        unsigned int last = first+1;
+        while(last<numVertices && compare.equal(order[first], order[last])) ++last;
+
+        unsigned int minIndex = *std::min_element(order.begin()+first, order.begin()+last);
+        for(unsigned int i=first; i<last; ++i) remapDuplicatesToOriginals[order[i]] = minIndex;
+        first = last;
+    }
+
+    std::vector<unsigned int> finalMapping(numVertices);
+    std::vector<unsigned int> copyMapping;
+    for(unsigned int i=0; i<numVertices; ++i)
+    {
+        if (remapDuplicatesToOriginals[i]==i)
+        {
+            finalMapping[i] = copyMapping.size();
+            copyMapping.push_back(i);
+        }
+        else
+        {
+            finalMapping[i] = finalMapping[remapDuplicatesToOriginals[i]];
+        }
+    }
+
+    osg::TriangleIndexFunctor<CollectIndicesOperator> collector;
+    std::vector<unsigned int> indices;
+    collector.triangleIndices = &indices;
+    geometry.getPrimitiveSet(0)->accept(collector);
+
+    osg::DrawElementsUInt* elements = new osg::DrawElementsUInt(GL_TRIANGLES);
+    elements->reserve(indices.size());
+    for(std::vector<unsigned int>::iterator itr=indices.begin(); itr!=indices.end(); ++itr)
+    {
+        elements->push_back(finalMapping[*itr]);
+    }
+
+    copyVertices(geometry, static_cast<osg::Vec3Array*>(geometry.getVertexArray()), copyMapping);
+    copyVertices(geometry, static_cast<osg::Vec3Array*>(geometry.getNormalArray()), copyMapping);
+    copyVertices(geometry, static_cast<osg::Vec2Array*>(geometry.getTexCoordArray(0)), copyMapping);
+    geometry.setPrimitiveSet(0, elements);
+}
+
+static bool compareArrays(const osg::Array* lhs, const osg::Array* rhs)
+{
+    return lhs->getNumElements()==rhs->getNumElements() && lhs->getElementSize()==rhs->getElementSize() &&
+           memcmp(lhs->getDataPointer(), rhs->getDataPointer(), lhs->getTotalDataSize())==0;
+}
+
+static bool compareIndexedMeshes(osg::Geometry& lhs, osg::Geometry& rhs)
+{
+    if (!compareArrays(lhs.getVertexArray(), rhs.getVertexArray()) ||
+        !compareArrays(lhs.getNormalArray(), rhs.getNormalArray()) ||
+        !compareArrays(lhs.getTexCoordArray(0), rhs.getTexCoordArray(0)) ||
+        lhs.getNumPrimitiveSets()!=1 || rhs.getNumPrimitiveSets()!=1)
+    {
+        return false;
+    }
+
+    const osg::PrimitiveSet* lhsElements = lhs.getPrimitiveSet(0);
+    const osg::PrimitiveSet* rhsElements = rhs.getPrimitiveSet(0);
+    if (lhsElements->getNumIndices()!=rhsElements->getNumIndices()) return false;
+    for(unsigned int i=0; i<lhsElements->getNumIndices(); ++i)
+    {
+        if (lhsElements->index(i)!=rhsElements->index(i)) return false;
+    }
+    return true;
+}
+
+void runIndexMeshBenchmark(unsigned int gridSize)
+{
+    unsigned int numVertices = gridSize*gridSize*6;
+    std::cout<<"index mesh benchmark, "<<numVertices<<" unindexed vertices"<<std::endl;
+
+    osg::ref_ptr<osg::Geometry> reference = createUnindexedGrid(gridSize, 0.0f);
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    sortIndexMesh(*reference);
+    double time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+    std::cout<<"  sort based: "<<time*1000.0<<" ms, "<<double(numVertices)/(time*1.0e6)<<" million vertices/s, "
+             <<reference->getVertexArray()->getNumElements()<<" vertices"<<std::endl;
+
+    unsigned int numThreads[] = { 1, static_cast<unsigned int>(osg::maximum(2, OpenThreads::GetNumberOfProcessors())) };
+    for(unsigned int t=0; t<2; ++t)
+    {
+        osg::ref_ptr<osg::Geometry> geometry = createUnindexedGrid(gridSize, 0.0f);
+
+        osgUtil::IndexMeshVisitor imv;
+        imv.setNumThreads(numThreads[t]);
+        imv.setParallelMinimumNumVertices(0);
+
+        startTick = osg::Timer::instance()->tick();
+        imv.makeMesh(*geometry);
+        time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+        std::cout<<"  hash based, "<<numThreads[t]<<(numThreads[t]==1 ? " thread: " : " threads: ")<<time*1000.0<<" ms, "
+                 <<double(numVertices)/(time*1.0e6)<<" million vertices/s, "<<geometry->getVertexArray()->getNumElements()<<" vertices"
+                 <<(compareIndexedMeshes(*reference, *geometry) ? "" : ", ERROR mesh differs from the sort based deduplication")<<std::endl;
+    }
+
+    // every copy of a grid vertex lies within 2*sqrt(3)*0.0001 of the others and 1 from the other grid vertices.
+    osg::ref_ptr<osg::Geometry> jittered = createUnindexedGrid(gridSize, 0.0001f);
+
+    osgUtil::IndexMeshVisitor imv;
+    imv.setWeldTolerance(0.001);
+
+    startTick = osg::Timer::instance()->tick();
+    imv.makeMesh(*jittered);
+    time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+    unsigned int numWelded = jittered->getVertexArray()->getNumElements();
+    std::cout<<"  hash based, welding jittered vertices: "<<time*1000.0<<" ms, "<<double(numVertices)/(time*1.0e6)<<" million vertices/s, "
+             <<numWelded<<" vertices"<<(numWelded==(gridSize+1)*(gridSize+1) ? "" : ", ERROR vertices not welded into the grid")<<std::endl;
+}
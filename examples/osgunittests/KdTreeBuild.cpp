@@ -0,0 +1,236 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/KdTree>
+#include <osg/Timer>
+
+#include <osgUtil/LineSegmentIntersector>
+#include <osgUtil/IntersectionVisitor>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Benchmark of osg::KdTreeBuilder build times using the mid point and surface area heuristic splits, serially and using
+// multiple threads, for a single large terrain mesh and for the same terrain split into tiles, along with the time
+// taken by osgUtil::LineSegmentIntersector to intersect the built KdTree's one segment at a time and as a single packet
+// of segments passed in an osgUtil::IntersectorGroup, checking all produce the same intersections.
+
+static osg::Geometry* createTerrainGeometry(unsigned int numColumns, unsigned int numRows, const osg::Vec3& origin, float spacing)
+{
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    vertices->reserve(numColumns*numRows);
+    for(unsigned int r=0; r<numRows; ++r)
+    {
+        for(unsigned int c=0; c<numColumns; ++c)
+        {
+            float x = origin.x()+float(c)*spacing;
+            float y = origin.y()+float(r)*spacing;
+            float z = 20.0f*sinf(x*0.05f)*cosf(y*0.03f) + 3.0f*sinf(x*0.7f+y*0.4f);
+            vertices->push_back(osg::Vec3(x, y, z));
+        }
+    }
+
+    osg::ref_ptr<osg::DrawElementsUInt> triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+    triangles->reserve((numColumns-1)*(numRows-1)*6);
+    for(unsigned int r=0; r<numRows-1; ++r)
+    {
+        for(unsigned int c=0; c<numColumns-1; ++c)
+        {
+            unsigned int i = c+r*numColumns;
+            triangles->push_back(i);
+            triangles->push_back(i+1);
+            triangles->push_back(i+numColumns+1);
+            triangles->push_back(i);
+            triangles->push_back(i+numColumns+1);
+            triangles->push_back(i+numColumns);
+        }
+    }
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+    geometry->addPrimitiveSet(triangles.get());
+    return geometry.release();
+}
+
+static osg::Geode* createTerrain(unsigned int size, unsigned int numTiles)
+{
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    unsigned int tileSize = (size-1)/numTiles;
+    for(unsigned int ty=0; ty<numTiles; ++ty)
+    {
+        for(unsigned int tx=0; tx<numTiles; ++tx)
+        {
+            osg::Vec3 origin(float(tx*tileSize), float(ty*tileSize), 0.0f);
+            geode->addDrawable(createTerrainGeometry(tileSize+1, tileSize+1, origin, 1.0f));
+        }
+    }
+    return geode.release();
+}
+
+static double buildKdTrees(osg::Geode* geode, const osg::KdTree::BuildOptions& options)
+{
+    for(unsigned int i=0; i<geode->getNumDrawables(); ++i)
+    {
+        geode->getDrawable(i)->setShape(0);
+    }
+
+    osg::ref_ptr<osg::KdTreeBuilder> builder = new osg::KdTreeBuilder;
+    builder->_buildOptions = options;
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    geode->accept(*builder);
+    osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+    return osg::Timer::instance()->delta_m(startTick, endTick);
+}
+
+static double intersect(osg::Geode* geode, const std::vector<osg::Vec3>& rays, bool useKdTrees, std::vector<float>& heights)
+{
+    heights.clear();
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    for(std::vector<osg::Vec3>::const_iterator itr = rays.begin();
+        itr != rays.end();
+        ++itr)
+    {
+        osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector(*itr+osg::Vec3(0.0f,0.0f,100.0f), *itr-osg::Vec3(0.0f,0.0f,100.0f));
+        osgUtil::IntersectionVisitor iv(intersector.get());
+        iv.setUseKdTreeWhenAvailable(useKdTrees);
+        geode->accept(iv);
+
+        heights.push_back(intersector->containsIntersections() ? intersector->getFirstIntersection().getWorldIntersectPoint().z() : -FLT_MAX);
+    }
+    osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+    return osg::Timer::instance()->delta_m(startTick, endTick);
+}
+
+static double intersectPacket(osg::Geode* geode, const std::vector<osg::Vec3>& rays, std::vector<float>& heights)
+{
+    heights.clear();
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+    osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::IntersectorGroup;
+    for(std::vector<osg::Vec3>::const_iterator itr = rays.begin();
+        itr != rays.end();
+        ++itr)
+    {
+        intersectorGroup->addIntersector(new osgUtil::LineSegmentIntersector(*itr+osg::Vec3(0.0f,0.0f,100.0f), *itr-osg::Vec3(0.0f,0.0f,100.0f)));
+    }
+
+    osgUtil::IntersectionVisitor iv(intersectorGroup.get());
+    geode->accept(iv);
+
+    osgUtil::IntersectorGroup::Intersectors& intersectors = intersectorGroup->getIntersectors();
+    for(osgUtil::IntersectorGroup::Intersectors::iterator itr = intersectors.begin();
+        itr != intersectors.end();
+        ++itr)
+    {
+        osgUtil::LineSegmentIntersector* intersector = static_cast<osgUtil::LineSegmentIntersector*>(itr->get());
+        heights.push_back(intersector->containsIntersections() ? intersector->getFirstIntersection().getWorldIntersectPoint().z() : -FLT_MAX);
+    }
+
+    osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+    return osg::Timer::instance()->delta_m(startTick, endTick);
+}
+
+static bool sameHeights(const std::vector<float>& lhs, const std::vector<float>& rhs)
+{
+    if (lhs.size()!=rhs.size()) return false;
+    for(unsigned int i=0; i<lhs.size(); ++i)
+    {
+        if (fabsf(lhs[i]-rhs[i])>1e-3f) return false;
+    }
+    return true;
+}
+
+void runKdTreeBenchmark(unsigned int size, unsigned int numRays)
+{
+    if (size<16) size = 16;
+
+    unsigned int numProcessors = OpenThreads::GetNumberOfProcessors();
+
+    std::cout<<"KdTree benchmark, "<<size<<" x "<<size<<" vertex terrain, "<<numRays<<" line segment intersections, "<<numProcessors<<" processors"<<std::endl;
+
+    std::vector<osg::Vec3> rays;
+    srand(1);
+    for(unsigned int i=0; i<numRays; ++i)
+    {
+        rays.push_back(osg::Vec3(float(size-1)*float(rand())/float(RAND_MAX), float(size-1)*float(rand())/float(RAND_MAX), 0.0f));
+    }
+
+    // reference intersections computed without KdTree's on a subset of the rays.
+    std::vector<osg::Vec3> referenceRays(rays.begin(), rays.begin()+osg::minimum(numRays, 100u));
+    std::vector<float> referenceHeights;
+    {
+        osg::ref_ptr<osg::Geode> geode = createTerrain(size, 1);
+        intersect(geode.get(), referenceRays, false, referenceHeights);
+    }
+
+    const char* splitNames[] = { "mid point split", "surface area heuristic split" };
+    osg::KdTree::SplitMethod splitMethods[] = { osg::KdTree::MIDPOINT_SPLIT, osg::KdTree::SURFACE_AREA_HEURISTIC_SPLIT };
+
+    unsigned int tileCounts[] = { 1, 8 };
+    for(unsigned int t=0; t<2; ++t)
+    {
+        osg::ref_ptr<osg::Geode> geode = createTerrain(size, tileCounts[t]);
+        std::cout<<"  "<<geode->getNumDrawables()<<" Geometry"<<std::endl;
+
+        std::vector<float> firstHeights;
+
+        for(unsigned int s=0; s<2; ++s)
+        {
+            std::vector<unsigned int> threadCounts;
+            threadCounts.push_back(1);
+            if (splitMethods[s]==osg::KdTree::SURFACE_AREA_HEURISTIC_SPLIT && numProcessors>1) threadCounts.push_back(numProcessors);
+
+            for(std::vector<unsigned int>::iterator itr = threadCounts.begin();
+                itr != threadCounts.end();
+                ++itr)
+            {
+                osg::KdTree::BuildOptions options;
+                options._splitMethod = splitMethods[s];
+                options._numThreads = *itr;
+
+                double buildTime = buildKdTrees(geode.get(), options);
+
+                std::vector<float> heights;
+                double intersectTime = intersect(geode.get(), rays, true, heights);
+
+                std::vector<float> subsetHeights(heights.begin(), heights.begin()+referenceHeights.size());
+                if (firstHeights.empty()) firstHeights = heights;
+
+                std::vector<float> packetHeights;
+                double packetIntersectTime = intersectPacket(geode.get(), rays, packetHeights);
+
+                bool valid = sameHeights(subsetHeights, referenceHeights) && sameHeights(heights, firstHeights) && sameHeights(packetHeights, heights);
+
+                std::cout<<"    "<<splitNames[s]<<", "<<*itr<<" threads\tbuild "<<buildTime<<" ms, intersect "<<intersectTime<<" ms, packet intersect "<<packetIntersectTime<<" ms"
+                         <<(valid ? "" : ", ERROR intersections differ")<<std::endl;
+            }
+        }
+    }
+}
@@ -0,0 +1,205 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/NodeVisitor>
+#include <osg/Timer>
+
+#include <osgDB/ReadFile>
+#include <osgDB/fstream>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+
+// Benchmark of the .obj plugin's read throughput, writes a grid of quads with texture coordinates and normals to a
+// temporary file, mixing the number formats, white space, line endings, negative indices, line continuations and
+// groups found in exported files, then reads it back a line at a time and with the block parser using one thread
+// and a thread per processor, checking the block parser creates the same scene graph as the line by line parser.
+
+static void writeObjBenchmarkFile(const std::string& fileName, unsigned int gridSize)
+{
+    osgDB::ofstream fout(fileName.c_str(), std::ios::out | std::ios::binary);
+    fout<<"# osgunittests obj read benchmark"<<std::endl;
+    fout<<"o benchmark"<<std::endl;
+
+    char line[256];
+    unsigned int numRows = gridSize+1;
+    for(unsigned int r=0; r<numRows; ++r)
+    {
+        for(unsigned int c=0; c<numRows; ++c)
+        {
+            float x = float(c)*0.731f-100.0f, y = float(r)*1.379f, z = float((c*7+r*13)%101)*0.0137f;
+            const char* format = "v %.6f %.6f %.6f\n";
+            switch((r*numRows+c)%5)
+            {
+                case 1: format = "v %.9g %.9g %.9g\r\n"; break;
+                case 2: format = "v\t%e\t%e\t%e  \n"; break;
+                case 3: format = "  v %.3f %.12f %g\n"; break;
+                default: break;
+            }
+            sprintf(line, format, x, y, z);
+            fout<<line;
+
+            sprintf(line, "vt %.6f %.6f\n", float(c)/float(gridSize), float(r)/float(gridSize));
+            fout<<line;
+
+            sprintf(line, "vn %.4f %.4f %.4f\n", 0.1f*float(c%3), 0.1f*float(r%3), 1.0f);
+            fout<<line;
+        }
+    }
+
+    for(unsigned int r=0; r<gridSize; ++r)
+    {
+        if (r==gridSize/2) fout<<"g upper_half\nusemtl second\ns 1\n";
+
+        for(unsigned int c=0; c<gridSize; ++c)
+        {
+            unsigned int i = r*numRows+c+1;
+            switch((r*gridSize+c)%7)
+            {
+                case 1: sprintf(line, "f %u//%u %u//%u %u//%u %u//%u\n", i, i, i+1, i+1, i+numRows+1, i+numRows+1, i+numRows, i+numRows); break;
+                case 2: sprintf(line, "f %u/%u %u/%u %u/%u\r\n", i, i, i+1, i+1, i+numRows, i+numRows); break;
+                case 3: sprintf(line, "f %u/%u/%u %u/%u/%u \\\n  %u/%u/%u\n", i, i, i, i+1, i+1, i+1, i+numRows+1, i+numRows+1, i+numRows+1); break;
+                case 4: sprintf(line, "f %u %u %u\t\n", i, i+1, i+numRows+1); break;
+                default: sprintf(line, "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", i, i, i, i+1, i+1, i+1, i+numRows+1, i+numRows+1, i+numRows+1, i+numRows, i+numRows, i+numRows); break;
+            }
+            fout<<line;
+        }
+    }
+
+    // faces using negative indices relative to the last vertex, texcoord and normal.
+    fout<<"g relative\nf -1/-1/-1 -2/-2/-2 -3/-3/-3\nf -4//-4 -5//-5 -6//-6"<<std::endl;
+}
+
+class CollectGeometriesVisitor : public osg::NodeVisitor
+{
+    public:
+
+        CollectGeometriesVisitor() : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN) {}
+
+        virtual void apply(osg::Geode& geode)
+        {
+            for(unsigned int i=0; i<geode.getNumDrawables(); ++i)
+            {
+                osg::Geometry* geometry = geode.getDrawable(i)->asGeometry();
+                if (geometry) _geometries.push_back(std::make_pair(geode.getName(), geometry));
+            }
+        }
+
+        std::vector< std::pair<std::string, osg::Geometry*> > _geometries;
+};
+
+static bool compareArrays(const osg::Array* lhs, const osg::Array* rhs)
+{
+    if (!lhs || !rhs) return lhs==rhs;
+    return lhs->getType()==rhs->getType() &&
+           lhs->getTotalDataSize()==rhs->getTotalDataSize() &&
+           memcmp(lhs->getDataPointer(), rhs->getDataPointer(), lhs->getTotalDataSize())==0;
+}
+
+bool compareScenes(osg::Node* lhs, osg::Node* rhs)
+{
+    if (!lhs || !rhs) return false;
+
+    CollectGeometriesVisitor lhsGeometries, rhsGeometries;
+    lhs->accept(lhsGeometries);
+    rhs->accept(rhsGeometries);
+    if (lhsGeometries._geometries.size()!=rhsGeometries._geometries.size()) return false;
+
+    for(unsigned int i=0; i<lhsGeometries._geometries.size(); ++i)
+    {
+        if (lhsGeometries._geometries[i].first!=rhsGeometries._geometries[i].first) return false;
+
+        const osg::Geometry* lhsGeometry = lhsGeometries._geometries[i].second;
+        const osg::Geometry* rhsGeometry = rhsGeometries._geometries[i].second;
+        if (!compareArrays(lhsGeometry->getVertexArray(), rhsGeometry->getVertexArray()) ||
+            !compareArrays(lhsGeometry->getNormalArray(), rhsGeometry->getNormalArray()) ||
+            !compareArrays(lhsGeometry->getColorArray(), rhsGeometry->getColorArray()) ||
+            !compareArrays(lhsGeometry->getTexCoordArray(0), rhsGeometry->getTexCoordArray(0)) ||
+            lhsGeometry->getNumPrimitiveSets()!=rhsGeometry->getNumPrimitiveSets())
+        {
+            return false;
+        }
+
+        for(unsigned int p=0; p<lhsGeometry->getNumPrimitiveSets(); ++p)
+        {
+            const osg::PrimitiveSet* lhsPrimitives = lhsGeometry->getPrimitiveSet(p);
+            const osg::PrimitiveSet* rhsPrimitives = rhsGeometry->getPrimitiveSet(p);
+            if (lhsPrimitives->getType()!=rhsPrimitives->getType() ||
+                lhsPrimitives->getMode()!=rhsPrimitives->getMode() ||
+                lhsPrimitives->getNumIndices()!=rhsPrimitives->getNumIndices())
+            {
+                return false;
+            }
+
+            for(unsigned int j=0; j<lhsPrimitives->getNumIndices(); ++j)
+            {
+                if (lhsPrimitives->index(j)!=rhsPrimitives->index(j)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+void runObjReadBenchmark(unsigned int gridSize, unsigned int numReads)
+{
+    const std::string fileName("osgunittests_read_benchmark.obj");
+    writeObjBenchmarkFile(fileName, gridSize);
+
+    osgDB::ifstream fin(fileName.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    double fileSize = static_cast<double>(fin.tellg());
+    fin.close();
+
+    std::cout<<"obj read benchmark, "<<gridSize*gridSize<<" faces, "<<fileSize/(1024.0*1024.0)<<" MB file"<<std::endl;
+
+    std::ostringstream allThreads;
+    allThreads<<"parseThreads="<<OpenThreads::GetNumberOfProcessors();
+
+    // the reads skip the tri stripping so the timings are dominated by the parsing.
+    std::string optionStrings[] = { "lineByLineParse", "parseThreads=1", allThreads.str() };
+    const char* names[] = { "line by line", "blocks, 1 thread", "blocks, thread per processor" };
+
+    osg::ref_ptr<osg::Node> lineByLineScene;
+    for(unsigned int o=0; o<3; ++o)
+    {
+        osg::ref_ptr<osgDB::Options> options = new osgDB::Options(optionStrings[o]+" noTriStripPolygons noTesselateLargePolygons");
+        options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+
+        osg::ref_ptr<osg::Node> node;
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        for(unsigned int i=0; i<numReads; ++i)
+        {
+            node = osgDB::readRefNodeFile(fileName, options.get());
+        }
+        double time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+        bool matches = true;
+        if (o==0) lineByLineScene = node;
+        else matches = compareScenes(lineByLineScene.get(), node.get());
+
+        std::cout<<"  "<<names[o]<<": "<<time*1000.0/double(numReads)<<" ms per read, "
+                 <<fileSize*double(numReads)/(time*1024.0*1024.0)<<" MB/s"<<(matches ? "" : ", ERROR scene graph differs from the line by line read")<<std::endl;
+    }
+
+    remove(fileName.c_str());
+}
@@ -0,0 +1,153 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Group>
+#include <osg/Timer>
+
+#include <osgUtil/Optimizer>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+#include <math.h>
+#include <sstream>
+
+// Test of the parallel per Geometry passes of osgUtil::Optimizer, optimizes two copies of a scene of unindexed
+// triangle grids, every other one sharing its arrays with the previous grid, once serially and once on several
+// threads, and checks the optimized scenes are identical, including the sharing of arrays and buffer objects.
+
+extern bool compareScenes(osg::Node* lhs, osg::Node* rhs);
+
+static osg::Node* createOptimizerScene(unsigned int numGeometries, unsigned int gridSize)
+{
+    osg::Group* group = new osg::Group;
+
+    osg::ref_ptr<osg::Vec3Array> vertices;
+    osg::ref_ptr<osg::Vec3Array> normals;
+    for(unsigned int g=0; g<numGeometries; ++g)
+    {
+        if (g%2==0)
+        {
+            vertices = new osg::Vec3Array;
+            normals = new osg::Vec3Array;
+
+            // the triangles of a grid with the vertices of each triangle duplicated, in a shuffled order.
+            float offset = float(g)*float(gridSize);
+            unsigned int seed = g*7919+1;
+            for(unsigned int i=0; i<gridSize*gridSize; ++i)
+            {
+                seed = seed*1664525u+1013904223u;
+                unsigned int cell = (seed>>8)%(gridSize*gridSize);
+                float x = offset+float(cell%gridSize), y = float(cell/gridSize);
+                osg::Vec3 corners[4] = { osg::Vec3(x, y, sinf(x*0.1f)), osg::Vec3(x+1.0f, y, sinf((x+1.0f)*0.1f)),
+                                         osg::Vec3(x+1.0f, y+1.0f, sinf((x+1.0f)*0.1f)), osg::Vec3(x, y+1.0f, sinf(x*0.1f)) };
+                unsigned int triangles[6] = { 0, 1, 2, 0, 2, 3 };
+                for(unsigned int t=0; t<6; ++t)
+                {
+                    vertices->push_back(corners[triangles[t]]);
+                    normals->push_back(osg::Vec3(-0.1f*cosf(corners[triangles[t]].x()*0.1f), 0.0f, 1.0f));
+                }
+            }
+        }
+
+        osg::Geometry* geometry = new osg::Geometry;
+        geometry->setVertexArray(vertices.get());
+        geometry->setNormalArray(normals.get(), osg::Array::BIND_PER_VERTEX);
+        geometry->addPrimitiveSet(new osg::DrawArrays(GL_TRIANGLES, 0, (g%2==0) ? vertices->size() : vertices->size()/2));
+
+        std::ostringstream name;
+        name<<"geometry "<<g;
+
+        osg::Geode* geode = new osg::Geode;
+        geode->setName(name.str());
+        geode->addDrawable(geometry);
+        group->addChild(geode);
+    }
+
+    return group;
+}
+
+// Check the sharing of arrays and buffer objects between neighbouring geometries and the buffer object settings match.
+static bool compareSharing(osg::Group* lhs, osg::Group* rhs)
+{
+    if (lhs->getNumChildren()!=rhs->getNumChildren()) return false;
+
+    osg::Geometry* lhsPrevious = 0;
+    osg::Geometry* rhsPrevious = 0;
+    for(unsigned int i=0; i<lhs->getNumChildren(); ++i)
+    {
+        osg::Geometry* lhsGeometry = lhs->getChild(i)->asGeode()->getDrawable(0)->asGeometry();
+        osg::Geometry* rhsGeometry = rhs->getChild(i)->asGeode()->getDrawable(0)->asGeometry();
+        if (lhsGeometry->getUseVertexBufferObjects()!=rhsGeometry->getUseVertexBufferObjects() ||
+            lhsGeometry->getUseDisplayList()!=rhsGeometry->getUseDisplayList() ||
+            (lhsGeometry->getVertexArray()->getBufferObject()==lhsGeometry->getNormalArray()->getBufferObject())!=
+            (rhsGeometry->getVertexArray()->getBufferObject()==rhsGeometry->getNormalArray()->getBufferObject()))
+        {
+            return false;
+        }
+
+        if (lhsPrevious &&
+            ((lhsGeometry->getVertexArray()==lhsPrevious->getVertexArray())!=(rhsGeometry->getVertexArray()==rhsPrevious->getVertexArray()) ||
+             (lhsGeometry->getVertexArray()->getBufferObject()==lhsPrevious->getVertexArray()->getBufferObject())!=
+             (rhsGeometry->getVertexArray()->getBufferObject()==rhsPrevious->getVertexArray()->getBufferObject())))
+        {
+            return false;
+        }
+
+        lhsPrevious = lhsGeometry;
+        rhsPrevious = rhsGeometry;
+    }
+    return true;
+}
+
+void runOptimizerParallelTest(unsigned int numGeometries, unsigned int gridSize)
+{
+    const unsigned int options = osgUtil::Optimizer::MAKE_FAST_GEOMETRY |
+                                 osgUtil::Optimizer::INDEX_MESH |
+                                 osgUtil::Optimizer::VERTEX_POSTTRANSFORM |
+                                 osgUtil::Optimizer::VERTEX_PRETRANSFORM |
+                                 osgUtil::Optimizer::BUFFER_OBJECT_SETTINGS;
+
+    std::cout<<"optimizer parallel test, "<<numGeometries<<" geometries of "<<gridSize*gridSize*2<<" triangles"<<std::endl;
+
+    unsigned int numThreads[] = { 1, static_cast<unsigned int>(osg::maximum(2, OpenThreads::GetNumberOfProcessors())) };
+    osg::ref_ptr<osg::Group> scenes[2];
+    for(unsigned int t=0; t<2; ++t)
+    {
+        scenes[t] = createOptimizerScene(numGeometries, gridSize)->asGroup();
+
+        osgUtil::Optimizer optimizer;
+        optimizer.setNumThreads(numThreads[t]);
+
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        optimizer.optimize(scenes[t].get(), options);
+        double time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+        std::cout<<"  "<<numThreads[t]<<(numThreads[t]==1 ? " thread: " : " threads: ")<<time*1000.0<<" ms";
+        const osgUtil::Optimizer::PassTimes& passTimes = optimizer.getPassTimes();
+        for(osgUtil::Optimizer::PassTimes::const_iterator itr = passTimes.begin(); itr != passTimes.end(); ++itr)
+        {
+            std::cout<<", "<<itr->first<<" "<<itr->second*1000.0<<" ms";
+        }
+        if (t>0 && !compareScenes(scenes[0].get(), scenes[t].get())) std::cout<<", ERROR geometry differs from the serial run";
+        if (t>0 && !compareSharing(scenes[0].get(), scenes[t].get())) std::cout<<", ERROR sharing differs from the serial run";
+        std::cout<<std::endl;
+    }
+}
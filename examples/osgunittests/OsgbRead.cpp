@@ -0,0 +1,189 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Texture2D>
+#include <osg/Timer>
+
+#include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
+#include <osgDB/fstream>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Benchmark of the .osgb read throughput, writes a scene of large vertex and index arrays and inline image data to a
+// temporary file then reads it back repeatedly through the default file stream and through the MemoryMapped option,
+// optionally with a compressor, checking both read paths load the same amount of data. Block compressors such as
+// zlib-blocks compress and decompress their blocks using a thread per processor. With a compressor the reads are
+// also done with the DecompressWholeStream option, and on Linux the memory high water mark of each read path is
+// reported, as the streaming decompression avoids holding the whole decompressed stream in memory.
+
+// Reset the peak resident set size of the process, returning false where this isn't supported.
+bool resetPeakResidentMemory()
+{
+#if defined(__linux__)
+    std::ofstream fout("/proc/self/clear_refs");
+    fout<<"5";
+    fout.close();
+    return !fout.fail();
+#else
+    return false;
+#endif
+}
+
+// Return the peak resident set size of the process in MB since it was last reset.
+double getPeakResidentMemory()
+{
+#if defined(__linux__)
+    std::ifstream fin("/proc/self/status");
+    std::string line;
+    while (std::getline(fin, line))
+    {
+        if (line.compare(0, 6, "VmHWM:")==0) return atof(line.c_str()+6)/1024.0;
+    }
+#endif
+    return 0.0;
+}
+
+static osg::Node* createReadBenchmarkScene(unsigned int numGeometries, unsigned int gridSize)
+{
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    for(unsigned int g=0; g<numGeometries; ++g)
+    {
+        osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+        osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array;
+        osg::ref_ptr<osg::Vec2Array> texcoords = new osg::Vec2Array;
+        for(unsigned int r=0; r<gridSize; ++r)
+        {
+            for(unsigned int c=0; c<gridSize; ++c)
+            {
+                vertices->push_back(osg::Vec3(float(g*gridSize+c), float(r), float((c*r)%7)));
+                normals->push_back(osg::Vec3(0.0f, 0.0f, 1.0f));
+                texcoords->push_back(osg::Vec2(float(c)/float(gridSize), float(r)/float(gridSize)));
+            }
+        }
+
+        osg::ref_ptr<osg::DrawElementsUInt> indices = new osg::DrawElementsUInt(GL_TRIANGLES);
+        for(unsigned int r=0; r+1<gridSize; ++r)
+        {
+            for(unsigned int c=0; c+1<gridSize; ++c)
+            {
+                unsigned int i = r*gridSize+c;
+                indices->push_back(i); indices->push_back(i+1); indices->push_back(i+gridSize);
+                indices->push_back(i+1); indices->push_back(i+gridSize+1); indices->push_back(i+gridSize);
+            }
+        }
+
+        osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+        geometry->setVertexArray(vertices.get());
+        geometry->setNormalArray(normals.get(), osg::Array::BIND_PER_VERTEX);
+        geometry->setTexCoordArray(0, texcoords.get(), osg::Array::BIND_PER_VERTEX);
+        geometry->addPrimitiveSet(indices.get());
+
+        osg::ref_ptr<osg::Image> image = new osg::Image;
+        image->allocateImage(256, 256, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        for(unsigned int i=0; i<image->getTotalSizeInBytes(); ++i) image->data()[i] = static_cast<unsigned char>(i*g);
+        geometry->getOrCreateStateSet()->setTextureAttributeAndModes(0, new osg::Texture2D(image.get()));
+
+        geode->addDrawable(geometry.get());
+    }
+    return geode.release();
+}
+
+static unsigned int countVertices(osg::Node* node)
+{
+    osg::Geode* geode = node ? node->asGeode() : 0;
+    if (!geode) return 0;
+
+    unsigned int numVertices = 0;
+    for(unsigned int i=0; i<geode->getNumDrawables(); ++i)
+    {
+        osg::Geometry* geometry = geode->getDrawable(i)->asGeometry();
+        if (geometry && geometry->getVertexArray()) numVertices += geometry->getVertexArray()->getNumElements();
+    }
+    return numVertices;
+}
+
+void runOsgbReadBenchmark(unsigned int numGeometries, unsigned int gridSize, unsigned int numReads, const std::string& compressor)
+{
+    const std::string fileName("osgunittests_read_benchmark.osgb");
+
+    std::string writeOptionString("WriteImageHint=IncludeData");
+    if (!compressor.empty()) writeOptionString += " Compressor="+compressor+" CompressionThreads=0";
+
+    osg::ref_ptr<osg::Node> scene = createReadBenchmarkScene(numGeometries, gridSize);
+    if (!osgDB::writeNodeFile(*scene, fileName, new osgDB::Options(writeOptionString)))
+    {
+        std::cout<<"osgb read benchmark, unable to write "<<fileName<<std::endl;
+        return;
+    }
+
+    osgDB::ifstream fin(fileName.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    double fileSize = static_cast<double>(fin.tellg());
+    fin.close();
+    unsigned int expectedVertices = countVertices(scene.get());
+    scene = 0;
+
+    std::cout<<"osgb read benchmark, "<<numGeometries<<" geometries of "<<gridSize*gridSize<<" vertices, "<<fileSize/(1024.0*1024.0)<<" MB file";
+    if (!compressor.empty()) std::cout<<" using the "<<compressor<<" compressor";
+    std::cout<<std::endl;
+
+    const char* optionStrings[] = { "", "MemoryMapped", "DecompressWholeStream" };
+    const char* names[] = { "file stream", "memory mapped", "whole stream decompression" };
+    unsigned int numPaths = compressor.empty() ? 2 : 3;
+    double peakMemory[3];
+    for(unsigned int o=0; o<numPaths; ++o)
+    {
+        // block compressors decompress their blocks using a thread per processor.
+        std::string optionString(optionStrings[o]);
+        if (!compressor.empty()) optionString += " DecompressionThreads=0";
+
+        osg::ref_ptr<osgDB::Options> options = new osgDB::Options(optionString);
+        options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+
+        bool matches = true;
+        bool measureMemory = resetPeakResidentMemory();
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        for(unsigned int i=0; i<numReads; ++i)
+        {
+            osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile(fileName, options.get());
+            if (countVertices(node.get())!=expectedVertices) matches = false;
+        }
+        double time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+        peakMemory[o] = measureMemory ? getPeakResidentMemory() : 0.0;
+
+        std::cout<<"  "<<names[o]<<": "<<time*1000.0/double(numReads)<<" ms per read, "
+                 <<fileSize*double(numReads)/(time*1024.0*1024.0)<<" MB/s";
+        if (measureMemory) std::cout<<", peak resident memory "<<peakMemory[o]<<" MB";
+        std::cout<<(matches ? "" : ", ERROR loaded data differs")<<std::endl;
+    }
+
+    if (numPaths>2 && peakMemory[2]>0.0)
+    {
+        std::cout<<"  streaming decompression peak resident memory is "<<peakMemory[2]-peakMemory[0]<<" MB lower than the whole stream decompression"
+                 <<(peakMemory[0]>peakMemory[2] ? ", ERROR streaming decompression uses more memory" : "")<<std::endl;
+    }
+
+    remove(fileName.c_str());
+}
@@ -0,0 +1,211 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osg/Timer>
+#include <osg/io_utils>
+
+#include <osgUtil/CullVisitor>
+
+#include <iostream>
+
+// Headless benchmark of osgUtil::CullVisitor culling a large flat scene graph, reporting
+// cull time with per node culling and against the number of cull threads using batched culling,
+// and checking that these produce the same RenderBin contents as the serial per node cull.
+
+static osg::Node* createTiledScene(unsigned int numTilesX, unsigned int numTilesY)
+{
+    const unsigned int numGeometries = 16;
+    const unsigned int numStateSets = 8;
+
+    std::vector< osg::ref_ptr<osg::Geometry> > geometries;
+    for(unsigned int i=0; i<numGeometries; ++i)
+    {
+        osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+        osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+        float offset = float(i)/float(numGeometries);
+        vertices->push_back(osg::Vec3(offset, offset, 0.0f));
+        vertices->push_back(osg::Vec3(offset+0.25f, offset, 0.0f));
+        vertices->push_back(osg::Vec3(offset+0.25f, offset+0.25f, 0.1f));
+        vertices->push_back(osg::Vec3(offset, offset+0.25f, 0.1f));
+        geometry->setVertexArray(vertices.get());
+        geometry->addPrimitiveSet(new osg::DrawArrays(GL_QUADS, 0, 4));
+        geometries.push_back(geometry);
+    }
+
+    std::vector< osg::ref_ptr<osg::StateSet> > stateSets;
+    for(unsigned int i=0; i<numStateSets; ++i)
+    {
+        osg::ref_ptr<osg::StateSet> stateset = new osg::StateSet;
+        stateset->setMode(GL_LIGHTING, (i%2)==0 ? osg::StateAttribute::ON : osg::StateAttribute::OFF);
+        if (i==numStateSets-1) stateset->setRenderBinDetails(10, "DepthSortedBin");
+        stateSets.push_back(stateset);
+    }
+
+    osg::ref_ptr<osg::Group> root = new osg::Group;
+    for(unsigned int y=0; y<numTilesY; ++y)
+    {
+        for(unsigned int x=0; x<numTilesX; ++x)
+        {
+            unsigned int tileIndex = x+y*numTilesX;
+
+            osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform;
+            transform->setMatrix(osg::Matrix::translate(float(x), float(y), 0.0f));
+
+            osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+            geode->setStateSet(stateSets[tileIndex%numStateSets].get());
+            for(unsigned int i=0; i<8; ++i)
+            {
+                geode->addDrawable(geometries[(tileIndex+i*3)%numGeometries].get());
+            }
+
+            transform->addChild(geode.get());
+            root->addChild(transform.get());
+        }
+    }
+
+    return root.release();
+}
+
+typedef std::vector< std::pair<const osg::Drawable*, float> > LeafList;
+
+static void collectLeaves(osgUtil::RenderBin* bin, LeafList& leaves)
+{
+    osgUtil::RenderBin::RenderBinList& bins = bin->getRenderBinList();
+    osgUtil::RenderBin::RenderBinList::iterator bitr = bins.begin();
+    for(; bitr!=bins.end() && bitr->first<0; ++bitr)
+    {
+        collectLeaves(bitr->second.get(), leaves);
+    }
+
+    osgUtil::RenderBin::StateGraphList& stateGraphs = bin->getStateGraphList();
+    for(osgUtil::RenderBin::StateGraphList::iterator sitr = stateGraphs.begin();
+        sitr != stateGraphs.end();
+        ++sitr)
+    {
+        for(osgUtil::StateGraph::LeafList::iterator litr = (*sitr)->_leaves.begin();
+            litr != (*sitr)->_leaves.end();
+            ++litr)
+        {
+            leaves.push_back(LeafList::value_type((*litr)->getDrawable(), (*litr)->_depth));
+        }
+    }
+
+    for(; bitr!=bins.end(); ++bitr)
+    {
+        collectLeaves(bitr->second.get(), leaves);
+    }
+}
+
+struct CullFrame
+{
+    CullFrame(unsigned int numCullThreads, unsigned int batchCullMinimumNumChildren):
+        _cullVisitor(new osgUtil::CullVisitor),
+        _stateGraph(new osgUtil::StateGraph),
+        _renderStage(new osgUtil::RenderStage),
+        _viewport(new osg::Viewport(0,0,1920,1080)),
+        _frameNumber(0)
+    {
+        _cullVisitor->setNumCullThreads(numCullThreads);
+        _cullVisitor->setBatchCullMinimumNumChildren(batchCullMinimumNumChildren);
+        _renderStage->setViewport(_viewport.get());
+    }
+
+    void cull(osg::Node* scene, const osg::Matrixd& projection, const osg::Matrixd& view)
+    {
+        _cullVisitor->reset();
+        _cullVisitor->setTraversalNumber(_frameNumber++);
+        _cullVisitor->setStateGraph(_stateGraph.get());
+        _cullVisitor->setRenderStage(_renderStage.get());
+
+        _renderStage->reset();
+        _stateGraph->clean();
+
+        osg::ref_ptr<osg::RefMatrix> proj = new osg::RefMatrix(projection);
+        osg::ref_ptr<osg::RefMatrix> mv = new osg::RefMatrix(view);
+
+        _cullVisitor->pushViewport(_viewport.get());
+        _cullVisitor->pushProjectionMatrix(proj.get());
+        _cullVisitor->pushModelViewMatrix(mv.get(), osg::Transform::ABSOLUTE_RF);
+
+        scene->accept(*_cullVisitor);
+
+        _cullVisitor->popModelViewMatrix();
+        _cullVisitor->popProjectionMatrix();
+        _cullVisitor->popViewport();
+
+        _stateGraph->prune();
+    }
+
+    osg::ref_ptr<osgUtil::CullVisitor>  _cullVisitor;
+    osg::ref_ptr<osgUtil::StateGraph>   _stateGraph;
+    osg::ref_ptr<osgUtil::RenderStage>  _renderStage;
+    osg::ref_ptr<osg::Viewport>         _viewport;
+    unsigned int                        _frameNumber;
+};
+
+void runParallelCullBenchmark(unsigned int numTiles, unsigned int numFrames, unsigned int maxNumThreads)
+{
+    if (maxNumThreads<1) maxNumThreads = 1;
+
+    osg::ref_ptr<osg::Node> scene = createTiledScene(numTiles, numTiles);
+
+    const osg::BoundingSphere& bs = scene->getBound();
+    osg::Matrixd projection = osg::Matrixd::perspective(60.0, 1920.0/1080.0, 1.0, 10000.0);
+    osg::Matrixd view = osg::Matrixd::lookAt(bs.center()-osg::Vec3(0.0f, bs.radius()*0.5f, -bs.radius()*0.5f), bs.center(), osg::Vec3(0.0f,0.0f,1.0f));
+
+    std::cout<<"Parallel cull benchmark, "<<numTiles*numTiles<<" tiles, "<<numFrames<<" frames"<<std::endl;
+
+    std::vector<unsigned int> threadCounts;
+    threadCounts.push_back(0); // per node culling
+    for(unsigned int numThreads=1; numThreads<maxNumThreads; numThreads*=2) threadCounts.push_back(numThreads);
+    threadCounts.push_back(maxNumThreads);
+
+    LeafList serialLeaves;
+
+    for(std::vector<unsigned int>::iterator itr = threadCounts.begin();
+        itr != threadCounts.end();
+        ++itr)
+    {
+        unsigned int numThreads = *itr;
+        CullFrame frame(osg::maximum(numThreads, 1u), numThreads==0 ? 0 : 8);
+
+        // warm up to allocate the reused RenderLeaf's and thread pool.
+        frame.cull(scene.get(), projection, view);
+
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        for(unsigned int i=0; i<numFrames; ++i)
+        {
+            frame.cull(scene.get(), projection, view);
+        }
+        osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+        LeafList leaves;
+        collectLeaves(frame._renderStage.get(), leaves);
+
+        if (numThreads==0) serialLeaves = leaves;
+
+        if (numThreads==0) std::cout<<"  per node culling";
+        else std::cout<<"  cull threads "<<numThreads;
+
+        std::cout<<"\t"<<osg::Timer::instance()->delta_m(startTick, endTick)/double(numFrames)<<" ms per cull, "
+                 <<leaves.size()<<" leaves"<<(leaves==serialLeaves ? "" : ", ERROR results differ from serial cull")<<std::endl;
+    }
+}
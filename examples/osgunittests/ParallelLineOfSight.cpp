@@ -0,0 +1,234 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/KdTree>
+#include <osg/PagedLOD>
+#include <osg/Timer>
+
+#include <osgDB/Registry>
+
+#include <osgSim/LineOfSight>
+#include <osgSim/HeightAboveTerrain>
+
+#include <iostream>
+#include <sstream>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Throughput benchmark of osgSim::HeightAboveTerrain and osgSim::LineOfSight against the number of intersection threads,
+// over a synthetic paged terrain whose highest resolution tiles are generated on demand by an osgDB::ReadFileCallback,
+// checking that the threaded results match those computed on the calling thread.
+
+static const float s_tileSize = 64.0f;
+static const char* s_tileExtension = "synthetic_tile";
+
+static float terrainHeight(float x, float y)
+{
+    return 20.0f*sinf(x*0.05f)*cosf(y*0.03f) + 3.0f*sinf(x*0.7f+y*0.4f);
+}
+
+static osg::Geode* createTile(unsigned int tx, unsigned int ty, unsigned int numVerticesPerSide)
+{
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    float spacing = s_tileSize/float(numVerticesPerSide-1);
+    for(unsigned int r=0; r<numVerticesPerSide; ++r)
+    {
+        for(unsigned int c=0; c<numVerticesPerSide; ++c)
+        {
+            float x = float(tx)*s_tileSize + float(c)*spacing;
+            float y = float(ty)*s_tileSize + float(r)*spacing;
+            vertices->push_back(osg::Vec3(x, y, terrainHeight(x, y)));
+        }
+    }
+
+    osg::ref_ptr<osg::DrawElementsUInt> triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+    for(unsigned int r=0; r<numVerticesPerSide-1; ++r)
+    {
+        for(unsigned int c=0; c<numVerticesPerSide-1; ++c)
+        {
+            unsigned int i = c+r*numVerticesPerSide;
+            triangles->push_back(i);
+            triangles->push_back(i+1);
+            triangles->push_back(i+numVerticesPerSide+1);
+            triangles->push_back(i);
+            triangles->push_back(i+numVerticesPerSide+1);
+            triangles->push_back(i+numVerticesPerSide);
+        }
+    }
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+    geometry->addPrimitiveSet(triangles.get());
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(geometry.get());
+    return geode.release();
+}
+
+/** Generates the highest resolution tiles from their file names rather than reading them from disk.*/
+class SyntheticTileReadFileCallback : public osgDB::ReadFileCallback
+{
+    public:
+
+        SyntheticTileReadFileCallback():
+            _numTilesGenerated(0) {}
+
+        virtual osgDB::ReaderWriter::ReadResult readNode(const std::string& filename, const osgDB::Options* options)
+        {
+            unsigned int tx, ty;
+            if (sscanf(filename.c_str(), "tile_%u_%u", &tx, &ty)!=2 || filename.find(s_tileExtension)==std::string::npos)
+            {
+                return osgDB::ReadFileCallback::readNode(filename, options);
+            }
+
+            osg::ref_ptr<osg::Geode> tile = createTile(tx, ty, 65);
+
+            osg::ref_ptr<osg::KdTreeBuilder> builder = new osg::KdTreeBuilder;
+            tile->accept(*builder);
+
+            ++_numTilesGenerated;
+
+            return tile.get();
+        }
+
+        OpenThreads::Atomic _numTilesGenerated;
+
+    protected:
+
+        virtual ~SyntheticTileReadFileCallback() {}
+};
+
+static osg::Node* createPagedTerrain(unsigned int numTiles)
+{
+    osg::ref_ptr<osg::Group> group = new osg::Group;
+    for(unsigned int ty=0; ty<numTiles; ++ty)
+    {
+        for(unsigned int tx=0; tx<numTiles; ++tx)
+        {
+            std::ostringstream filename;
+            filename<<"tile_"<<tx<<"_"<<ty<<"."<<s_tileExtension;
+
+            osg::ref_ptr<osg::PagedLOD> plod = new osg::PagedLOD;
+            plod->addChild(createTile(tx, ty, 5), 1000.0f, 1e7f);
+            plod->setFileName(1, filename.str());
+            plod->setRange(1, 0.0f, 1000.0f);
+            group->addChild(plod.get());
+        }
+    }
+    return group.release();
+}
+
+static bool sameValues(const std::vector<double>& lhs, const std::vector<double>& rhs)
+{
+    if (lhs.size()!=rhs.size()) return false;
+    for(unsigned int i=0; i<lhs.size(); ++i)
+    {
+        if (fabs(lhs[i]-rhs[i])>1e-6) return false;
+    }
+    return true;
+}
+
+void runParallelLineOfSightBenchmark(unsigned int numTiles, unsigned int numPoints, unsigned int maxNumThreads)
+{
+    if (numTiles<1) numTiles = 1;
+    if (maxNumThreads<1) maxNumThreads = 1;
+
+    osg::ref_ptr<SyntheticTileReadFileCallback> readFileCallback = new SyntheticTileReadFileCallback;
+    osg::ref_ptr<osgDB::ReadFileCallback> previousReadFileCallback = osgDB::Registry::instance()->getReadFileCallback();
+    osgDB::Registry::instance()->setReadFileCallback(readFileCallback.get());
+
+    osg::ref_ptr<osg::Node> scene = createPagedTerrain(numTiles);
+
+    std::cout<<"Parallel line of sight benchmark, "<<numTiles*numTiles<<" paged tiles, "<<numPoints<<" height above terrain and line of sight tests"<<std::endl;
+
+    float extent = float(numTiles)*s_tileSize;
+    std::vector<osg::Vec3d> points;
+    srand(1);
+    for(unsigned int i=0; i<numPoints; ++i)
+    {
+        points.push_back(osg::Vec3d(extent*float(rand())/float(RAND_MAX), extent*float(rand())/float(RAND_MAX), 100.0));
+    }
+
+    std::vector<unsigned int> threadCounts;
+    for(unsigned int numThreads=1; numThreads<maxNumThreads; numThreads*=2) threadCounts.push_back(numThreads);
+    threadCounts.push_back(maxNumThreads);
+
+    std::vector<double> serialHeights;
+    std::vector<double> serialNumIntersections;
+
+    for(std::vector<unsigned int>::iterator itr = threadCounts.begin();
+        itr != threadCounts.end();
+        ++itr)
+    {
+        unsigned int numThreads = *itr;
+        osg::ref_ptr<osgSim::IntersectionThreadPool> threadPool = numThreads>1 ? new osgSim::IntersectionThreadPool(numThreads) : 0;
+        osg::ref_ptr<osgSim::DatabaseCacheReadCallback> dcrc = new osgSim::DatabaseCacheReadCallback;
+
+        osgSim::HeightAboveTerrain hat;
+        hat.setDatabaseCacheReadCallback(dcrc.get());
+        hat.setIntersectionThreadPool(threadPool.get());
+
+        osgSim::LineOfSight los;
+        los.setDatabaseCacheReadCallback(dcrc.get());
+        los.setIntersectionThreadPool(threadPool.get());
+
+        for(unsigned int i=0; i<numPoints; ++i)
+        {
+            hat.addPoint(points[i]);
+            los.addLOS(points[i], points[(i+1)%numPoints]-osg::Vec3d(0.0, 0.0, 100.0));
+        }
+
+        // the first run loads the tiles into the database cache, the second runs entirely from the cache.
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        hat.computeIntersections(scene.get());
+        osg::Timer_t coldTick = osg::Timer::instance()->tick();
+        hat.computeIntersections(scene.get());
+        osg::Timer_t warmTick = osg::Timer::instance()->tick();
+        los.computeIntersections(scene.get());
+        osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+        std::vector<double> heights;
+        std::vector<double> numIntersections;
+        for(unsigned int i=0; i<numPoints; ++i)
+        {
+            heights.push_back(hat.getHeightAboveTerrain(i));
+            numIntersections.push_back(los.getIntersections(i).size());
+        }
+
+        if (serialHeights.empty())
+        {
+            serialHeights = heights;
+            serialNumIntersections = numIntersections;
+        }
+
+        bool valid = sameValues(heights, serialHeights) && sameValues(numIntersections, serialNumIntersections);
+
+        std::cout<<"  "<<numThreads<<" threads\tHAT cold "<<osg::Timer::instance()->delta_m(startTick, coldTick)<<" ms"
+                 <<", HAT warm "<<osg::Timer::instance()->delta_m(coldTick, warmTick)<<" ms"
+                 <<", LOS "<<osg::Timer::instance()->delta_m(warmTick, endTick)<<" ms"
+                 <<", "<<dcrc->getNumFilesCached()<<" tiles cached"
+                 <<(valid ? "" : ", ERROR intersections differ from 1 thread")<<std::endl;
+    }
+
+    std::cout<<"  "<<readFileCallback->_numTilesGenerated<<" tiles generated"<<std::endl;
+
+    osgDB::Registry::instance()->setReadFileCallback(previousReadFileCallback.get());
+}
@@ -0,0 +1,323 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/Geometry>
+#include <osg/PointCloudNode>
+#include <osg/Timer>
+
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/PointCloudBuilder>
+#include <osgDB/ReadFile>
+
+#include <osgUtil/CullVisitor>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+
+// Headless test of the osg::PointCloudNode cull traversal, builds an octree of a synthetic terrain point cloud in
+// memory and as paged tiles with osgDB::PointCloudBuilder, then culls it from cameras far from and close to the
+// terrain under several point budgets. The points selected are checked to stay within the budget, with each selected
+// cell's parent cell selected and refined, and the points drawn are checked not to exceed the points selected, which
+// can only differ where the CullVisitor culls a selected cell's drawables against their tighter bounding boxes. The paged tiles are loaded in the order
+// they are requested until no more are requested, and are checked to draw the same points as the in memory octree.
+
+class TerrainPointSource : public osgDB::PointCloudBuilder::PointSource
+{
+    public:
+
+        TerrainPointSource(unsigned int numPoints) : _numPoints(numPoints), _numRead(0), _seed(12345) {}
+
+        virtual bool readChunk(osgDB::PointCloudBuilder::Points& points, unsigned int maxNumPoints)
+        {
+            for(unsigned int i=0; i<maxNumPoints; ++i)
+            {
+                if (_numRead==_numPoints) return false;
+                ++_numRead;
+
+                float x = nextRandom()*1000.0f, y = nextRandom()*1000.0f;
+                float z = 50.0f*sinf(x*0.01f)*cosf(y*0.013f)+nextRandom()*2.0f;
+                points.push_back(osgDB::PointCloudBuilder::Point(osg::Vec3(x, y, z), osg::Vec4ub(255, 255, 255, 255)));
+            }
+            return true;
+        }
+
+        virtual bool reset()
+        {
+            _numRead = 0;
+            _seed = 12345;
+            return true;
+        }
+
+    protected:
+
+        float nextRandom()
+        {
+            _seed = _seed*1664525u+1013904223u;
+            return float(_seed>>8)/float(1<<24);
+        }
+
+        unsigned int _numPoints;
+        unsigned int _numRead;
+        unsigned int _seed;
+};
+
+// Queues the database requests of the cull traversal so that they can be loaded after the cull, highest priority first.
+class QueueDatabaseRequestHandler : public osg::NodeVisitor::DatabaseRequestHandler
+{
+    public:
+
+        struct Request
+        {
+            Request() : _priority(0.0f) {}
+
+            std::string                 _fileName;
+            osg::ref_ptr<osg::Group>    _group;
+            float                       _priority;
+        };
+        typedef std::map<std::string, Request> Requests;
+
+        virtual void requestNodeFile(const std::string& fileName, osg::NodePath& nodePath, float priority, const osg::FrameStamp*, osg::ref_ptr<osg::Referenced>&, const osg::Referenced*)
+        {
+            Request& request = _requests[fileName];
+            request._fileName = fileName;
+            request._group = nodePath.back()->asGroup();
+            request._priority = priority;
+        }
+
+        // Load up to maxNumRequests of the requests highest priority first, returning the number loaded or 0 if a request fails to load.
+        unsigned int load(unsigned int maxNumRequests)
+        {
+            std::vector< std::pair<float, Request*> > requests;
+            for(Requests::iterator itr=_requests.begin(); itr!=_requests.end(); ++itr) requests.push_back(std::make_pair(itr->second._priority, &(itr->second)));
+            std::sort(requests.begin(), requests.end());
+
+            unsigned int numLoaded = 0;
+            for(std::vector< std::pair<float, Request*> >::reverse_iterator itr=requests.rbegin(); itr!=requests.rend() && numLoaded<maxNumRequests; ++itr, ++numLoaded)
+            {
+                osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile(itr->second->_fileName);
+                if (!node || !itr->second->_group) return 0;
+                itr->second->_group->addChild(node.get());
+            }
+            _requests.clear();
+            return numLoaded;
+        }
+
+        Requests _requests;
+
+    protected:
+
+        virtual ~QueueDatabaseRequestHandler() {}
+};
+
+static unsigned int countPointsDrawn(osgUtil::RenderBin* bin)
+{
+    unsigned int numPoints = 0;
+
+    osgUtil::RenderBin::RenderBinList& bins = bin->getRenderBinList();
+    for(osgUtil::RenderBin::RenderBinList::iterator bitr = bins.begin(); bitr!=bins.end(); ++bitr)
+    {
+        numPoints += countPointsDrawn(bitr->second.get());
+    }
+
+    osgUtil::RenderBin::StateGraphList& stateGraphs = bin->getStateGraphList();
+    for(osgUtil::RenderBin::StateGraphList::iterator sitr = stateGraphs.begin(); sitr != stateGraphs.end(); ++sitr)
+    {
+        for(osgUtil::StateGraph::LeafList::iterator litr = (*sitr)->_leaves.begin(); litr != (*sitr)->_leaves.end(); ++litr)
+        {
+            const osg::Geometry* geometry = (*litr)->getDrawable()->asGeometry();
+            if (geometry && geometry->getVertexArray()) numPoints += geometry->getVertexArray()->getNumElements();
+        }
+    }
+
+    return numPoints;
+}
+
+struct PointCloudCuller
+{
+    PointCloudCuller():
+        _cullVisitor(new osgUtil::CullVisitor),
+        _stateGraph(new osgUtil::StateGraph),
+        _renderStage(new osgUtil::RenderStage),
+        _viewport(new osg::Viewport(0,0,1920,1080)),
+        _frameNumber(0)
+    {
+        _renderStage->setViewport(_viewport.get());
+    }
+
+    void push(const osg::Matrixd& projection, const osg::Matrixd& view)
+    {
+        _cullVisitor->reset();
+        _cullVisitor->setTraversalNumber(_frameNumber++);
+        _cullVisitor->setStateGraph(_stateGraph.get());
+        _cullVisitor->setRenderStage(_renderStage.get());
+
+        _renderStage->reset();
+        _stateGraph->clean();
+
+        _cullVisitor->pushViewport(_viewport.get());
+        _cullVisitor->pushProjectionMatrix(new osg::RefMatrix(projection));
+        _cullVisitor->pushModelViewMatrix(new osg::RefMatrix(view), osg::Transform::ABSOLUTE_RF);
+    }
+
+    void pop()
+    {
+        _cullVisitor->popModelViewMatrix();
+        _cullVisitor->popProjectionMatrix();
+        _cullVisitor->popViewport();
+    }
+
+    // Cull the octree, returning the number of points drawn.
+    unsigned int cull(osg::Node* scene, const osg::Matrixd& projection, const osg::Matrixd& view)
+    {
+        push(projection, view);
+        scene->accept(*_cullVisitor);
+        pop();
+
+        _stateGraph->prune();
+        return countPointsDrawn(_renderStage.get());
+    }
+
+    // Select the cells of the octree, returning false if a selected cell's parent cell isn't selected and refined.
+    bool select(osg::PointCloudNode* root, const osg::Matrixd& projection, const osg::Matrixd& view, osg::PointCloudNode::Selection& selection)
+    {
+        push(projection, view);
+        root->select(*_cullVisitor, selection);
+        pop();
+
+        for(osg::PointCloudNode::Selection::Cells::iterator itr = selection._cells.begin(); itr!=selection._cells.end(); ++itr)
+        {
+            if (*itr==root) continue;
+
+            const osg::Group* childCells = (*itr)->getNumParents()>0 ? (*itr)->getParent(0) : 0;
+            const osg::PointCloudNode* parent = childCells && childCells->getNumParents()>0 ? dynamic_cast<const osg::PointCloudNode*>(childCells->getParent(0)) : 0;
+            if (!parent || selection._cells.count(parent)==0 || selection._refinements.count(parent)==0) return false;
+        }
+        return true;
+    }
+
+    osg::ref_ptr<osgUtil::CullVisitor>  _cullVisitor;
+    osg::ref_ptr<osgUtil::StateGraph>   _stateGraph;
+    osg::ref_ptr<osgUtil::RenderStage>  _renderStage;
+    osg::ref_ptr<osg::Viewport>         _viewport;
+    unsigned int                        _frameNumber;
+};
+
+void runPointCloudCullTest(unsigned int numPoints)
+{
+    const std::string tileDirectory("osgunittests_point_cloud_cull_tiles");
+
+    osg::ref_ptr<osgDB::PointCloudBuilder> builder = new osgDB::PointCloudBuilder;
+    builder->setMaxNumPointsPerTile(8192);
+    builder->setNumThreads(0);
+
+    TerrainPointSource source(numPoints);
+    osg::ref_ptr<osg::PointCloudNode> root = dynamic_cast<osg::PointCloudNode*>(builder->build(source, "terrain").get());
+
+    builder->setTileDirectory(tileDirectory);
+    source.reset();
+    osg::ref_ptr<osg::PointCloudNode> pagedRoot = dynamic_cast<osg::PointCloudNode*>(builder->build(source, "terrain").get());
+
+    if (!root || !pagedRoot)
+    {
+        std::cout<<"point cloud cull test, ERROR unable to build the octree"<<std::endl;
+        return;
+    }
+
+    std::cout<<"point cloud cull test, "<<numPoints<<" points, "<<builder->getNumTiles()<<" paged tiles"<<std::endl;
+
+    const osg::BoundingSphere& bs = root->getBound();
+    osg::Matrixd projection = osg::Matrixd::perspective(60.0, 1920.0/1080.0, 1.0, 10000.0);
+    osg::Matrixd views[] =
+    {
+        osg::Matrixd::lookAt(bs.center()+osg::Vec3(0.0f, -bs.radius()*2.0f, bs.radius()*2.0f), bs.center(), osg::Vec3(0.0f, 0.0f, 1.0f)),
+        osg::Matrixd::lookAt(bs.center()+osg::Vec3(0.0f, -bs.radius()*0.5f, bs.radius()*0.5f), bs.center(), osg::Vec3(0.0f, 0.0f, 1.0f)),
+        osg::Matrixd::lookAt(bs.center()+osg::Vec3(0.0f, 0.0f, 80.0f), bs.center()+osg::Vec3(0.0f, 200.0f, 0.0f), osg::Vec3(0.0f, 0.0f, 1.0f))
+    };
+    const char* viewNames[] = { "far", "mid", "near" };
+    unsigned int budgets[] = { numPoints, numPoints/4, numPoints/16 };
+
+    PointCloudCuller culler;
+    for(unsigned int v=0; v<3; ++v)
+    {
+        for(unsigned int b=0; b<3; ++b)
+        {
+            root->setPointBudget(budgets[b]);
+
+            osg::PointCloudNode::Selection selection;
+            bool consistent = culler.select(root.get(), projection, views[v], selection);
+
+            osg::Timer_t startTick = osg::Timer::instance()->tick();
+            unsigned int numPointsDrawn = culler.cull(root.get(), projection, views[v]);
+            double time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+            std::cout<<"  "<<viewNames[v]<<" view, budget "<<budgets[b]<<": "<<selection._cells.size()<<" cells, "
+                     <<numPointsDrawn<<" of "<<selection._numPoints<<" selected points drawn, cull "<<time*1000.0<<" ms";
+            if (root->getNumPointsSelected()!=selection._numPoints) std::cout<<", ERROR cull traversal selected "<<root->getNumPointsSelected()<<" points";
+            if (numPointsDrawn>selection._numPoints) std::cout<<", ERROR more points drawn than selected";
+            if (numPointsDrawn>budgets[b]) std::cout<<", ERROR exceeds budget";
+            if (!consistent) std::cout<<", ERROR cell selected without its parent";
+            std::cout<<std::endl;
+        }
+    }
+
+    // with no spacing limit and a budget of all the points the whole point cloud is drawn.
+    root->setPointBudget(numPoints);
+    root->setPointSpacing(0.0f);
+    unsigned int numPointsDrawn = culler.cull(root.get(), projection, views[0]);
+    std::cout<<"  far view, no spacing limit: "<<numPointsDrawn<<" points drawn"<<(numPointsDrawn!=numPoints ? ", ERROR not all points drawn" : "")<<std::endl;
+    root->setPointSpacing(2.0f);
+
+    // load the paged tiles requested by each cull, a few at a time highest priority first, until no more are requested.
+    root->setPointBudget(numPoints/4);
+    pagedRoot->setPointBudget(numPoints/4);
+    osg::ref_ptr<QueueDatabaseRequestHandler> requestHandler = new QueueDatabaseRequestHandler;
+    culler._cullVisitor->setDatabaseRequestHandler(requestHandler.get());
+    for(unsigned int v=0; v<3; ++v)
+    {
+        unsigned int numFrames = 0, numLoaded = 0;
+        bool loadFailed = false;
+        for(;;)
+        {
+            culler.cull(pagedRoot.get(), projection, views[v]);
+            ++numFrames;
+            if (requestHandler->_requests.empty()) break;
+
+            unsigned int numToLoad = osg::minimum(static_cast<unsigned int>(requestHandler->_requests.size()), 4u);
+            if (requestHandler->load(numToLoad)!=numToLoad) { loadFailed = true; break; }
+            numLoaded += numToLoad;
+        }
+
+        unsigned int numPagedPointsDrawn = culler.cull(pagedRoot.get(), projection, views[v]);
+        unsigned int numPointsDrawn = culler.cull(root.get(), projection, views[v]);
+        std::cout<<"  "<<viewNames[v]<<" view, paged tiles: "<<numLoaded<<" tiles loaded over "<<numFrames<<" frames, "<<numPagedPointsDrawn<<" points drawn";
+        if (loadFailed) std::cout<<", ERROR unable to load a tile";
+        if (numPagedPointsDrawn!=numPointsDrawn) std::cout<<", ERROR in memory octree draws "<<numPointsDrawn<<" points";
+        std::cout<<std::endl;
+    }
+
+    osgDB::DirectoryContents contents = osgDB::getDirectoryContents(tileDirectory);
+    for(osgDB::DirectoryContents::iterator itr = contents.begin(); itr!=contents.end(); ++itr)
+    {
+        if (*itr!="." && *itr!="..") remove(osgDB::concatPaths(tileDirectory, *itr).c_str());
+    }
+    remove(tileDirectory.c_str());
+}
@@ -0,0 +1,195 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/Endian>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/NodeVisitor>
+#include <osg/PagedLOD>
+#include <osg/Timer>
+
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/ReadFile>
+#include <osgDB/Registry>
+
+#include <iostream>
+#include <math.h>
+#include <sstream>
+#include <stdio.h>
+
+// Test of the out of core point cloud loading of the .ply plugin, writes a synthetic binary point cloud of a noisy
+// terrain to a temporary file, then streams it into an octree of paged tiles with the pointCloudTiles option under a
+// memory budget and into an in memory octree with the pointCloudStream option. On Linux the peak resident memory of
+// the tile build is checked against the memory budget, and both octrees are checked to contain every point once
+// with no tile holding more than the maximum number of points per tile.
+
+extern bool resetPeakResidentMemory();
+extern double getPeakResidentMemory();
+
+static bool writePointCloudFile(const std::string& fileName, unsigned int numPoints)
+{
+    FILE* file = fopen(fileName.c_str(), "wb");
+    if (!file) return false;
+
+    fprintf(file, "ply\nformat %s 1.0\nelement vertex %u\nproperty float x\nproperty float y\nproperty float z\n"
+                  "property uchar red\nproperty uchar green\nproperty uchar blue\nend_header\n",
+                  osg::getCpuByteOrder()==osg::LittleEndian ? "binary_little_endian" : "binary_big_endian", numPoints);
+
+    const unsigned int recordSize = 3*sizeof(float)+3;
+    std::vector<unsigned char> buffer;
+    buffer.reserve(65536*recordSize);
+
+    unsigned int seed = 12345;
+    for(unsigned int i=0; i<numPoints; ++i)
+    {
+        seed = seed*1664525u+1013904223u;
+        float x = float(seed>>8)/float(1<<24)*1000.0f;
+        seed = seed*1664525u+1013904223u;
+        float y = float(seed>>8)/float(1<<24)*1000.0f;
+        seed = seed*1664525u+1013904223u;
+        float z = 50.0f*sinf(x*0.01f)*cosf(y*0.013f)+float(seed>>24)*0.02f;
+
+        float position[3] = { x, y, z };
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(position);
+        buffer.insert(buffer.end(), bytes, bytes+sizeof(position));
+        buffer.push_back(static_cast<unsigned char>(x*0.25f));
+        buffer.push_back(static_cast<unsigned char>(y*0.25f));
+        buffer.push_back(static_cast<unsigned char>(z+100.0f));
+
+        if (buffer.size()>=65536*recordSize || i+1==numPoints)
+        {
+            if (fwrite(&buffer.front(), 1, buffer.size(), file)!=buffer.size()) { fclose(file); return false; }
+            buffer.clear();
+        }
+    }
+    return fclose(file)==0;
+}
+
+// Count the points of the octree, reading the paged tiles from the tile directory as they are found.
+class CountPointsVisitor : public osg::NodeVisitor
+{
+    public:
+
+        CountPointsVisitor(const std::string& tileDirectory) :
+            osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+            _tileDirectory(tileDirectory),
+            _numPoints(0),
+            _numTiles(0),
+            _maxNumPointsPerGeode(0),
+            _numMissingTiles(0) {}
+
+        virtual void apply(osg::PagedLOD& plod)
+        {
+            traverse(plod);
+
+            for(unsigned int i=plod.getNumChildren(); i<plod.getNumFileNames(); ++i)
+            {
+                if (plod.getFileName(i).empty()) continue;
+
+                osg::ref_ptr<osg::Node> tile = osgDB::readRefNodeFile(osgDB::concatPaths(_tileDirectory, plod.getFileName(i)));
+                if (!tile) { ++_numMissingTiles; continue; }
+
+                ++_numTiles;
+                tile->accept(*this);
+            }
+        }
+
+        virtual void apply(osg::Geode& geode)
+        {
+            for(unsigned int i=0; i<geode.getNumDrawables(); ++i)
+            {
+                osg::Geometry* geometry = geode.getDrawable(i)->asGeometry();
+                if (!geometry || !geometry->getVertexArray()) continue;
+
+                unsigned int numPoints = geometry->getVertexArray()->getNumElements();
+                _numPoints += numPoints;
+                _maxNumPointsPerGeode = osg::maximum(_maxNumPointsPerGeode, numPoints);
+            }
+        }
+
+        std::string         _tileDirectory;
+        unsigned long long  _numPoints;
+        unsigned int        _numTiles;
+        unsigned int        _maxNumPointsPerGeode;
+        unsigned int        _numMissingTiles;
+};
+
+void runPointCloudReadBenchmark(unsigned int numPoints, double memoryBudget)
+{
+    const std::string fileName("osgunittests_point_cloud.ply");
+    const std::string tileDirectory("osgunittests_point_cloud_tiles");
+    const unsigned int pointsPerTile = 32768;
+
+    if (!writePointCloudFile(fileName, numPoints))
+    {
+        std::cout<<"point cloud read test, unable to write "<<fileName<<std::endl;
+        return;
+    }
+
+    std::cout<<"point cloud read test, "<<numPoints<<" points, "<<memoryBudget<<" MB memory budget"<<std::endl;
+
+    // load the plugins before measuring the memory of the build.
+    osgDB::Registry::instance()->loadLibrary(osgDB::Registry::instance()->createLibraryNameForExtension("ply"));
+    osgDB::Registry::instance()->loadLibrary(osgDB::Registry::instance()->createLibraryNameForExtension("osgb"));
+
+    std::ostringstream tileOptions;
+    tileOptions<<"pointCloudTiles="<<tileDirectory<<" pointCloudMemoryBudget="<<memoryBudget<<" pointCloudPointsPerTile="<<pointsPerTile;
+
+    const char* names[] = { "paged tiles", "in memory" };
+    std::string optionStrings[] = { tileOptions.str(), "pointCloudStream" };
+    for(unsigned int o=0; o<2; ++o)
+    {
+        osg::ref_ptr<osgDB::Options> options = new osgDB::Options(optionStrings[o]);
+        options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+
+        bool measureMemory = (o==0) && resetPeakResidentMemory();
+        double baselineMemory = measureMemory ? getPeakResidentMemory() : 0.0;
+
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile(fileName, options.get());
+        double time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+        double peakMemory = measureMemory ? getPeakResidentMemory()-baselineMemory : 0.0;
+
+        if (!node)
+        {
+            std::cout<<"  "<<names[o]<<": ERROR unable to read "<<fileName<<std::endl;
+            continue;
+        }
+
+        CountPointsVisitor countPoints(tileDirectory);
+        node->accept(countPoints);
+
+        std::cout<<"  "<<names[o]<<": "<<time*1000.0<<" ms, "<<double(numPoints)/(time*1.0e6)<<" million points/s";
+        if (o==0) std::cout<<", "<<countPoints._numTiles<<" tiles";
+        if (measureMemory) std::cout<<", peak resident memory "<<peakMemory<<" MB";
+        if (countPoints._numPoints!=numPoints) std::cout<<", ERROR octree holds "<<countPoints._numPoints<<" points";
+        if (countPoints._numMissingTiles>0) std::cout<<", ERROR "<<countPoints._numMissingTiles<<" tiles missing";
+        if (countPoints._maxNumPointsPerGeode>pointsPerTile) std::cout<<", ERROR tile of "<<countPoints._maxNumPointsPerGeode<<" points";
+        if (peakMemory>memoryBudget) std::cout<<", ERROR exceeds memory budget";
+        std::cout<<std::endl;
+    }
+
+    osgDB::DirectoryContents contents = osgDB::getDirectoryContents(tileDirectory);
+    for(osgDB::DirectoryContents::iterator itr = contents.begin(); itr!=contents.end(); ++itr)
+    {
+        if (*itr!="." && *itr!="..") remove(osgDB::concatPaths(tileDirectory, *itr).c_str());
+    }
+    remove(tileDirectory.c_str());
+    remove(fileName.c_str());
+}
@@ -0,0 +1,95 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/Geometry>
+#include <osg/Timer>
+
+#include <osgUtil/RenderBin>
+
+#include <iostream>
+#include <stdlib.h>
+
+// Microbenchmark of the osgUtil::RenderBin depth and traversal order sorts, comparing the
+// std::sort path against the radix sort path, and checking that both produce the same order.
+
+static double timeSort(osgUtil::RenderBin* bin, osgUtil::StateGraph* sg, unsigned int numIterations, std::vector<float>& sortedValues)
+{
+    double totalTime = 0.0;
+    for(unsigned int i=0; i<numIterations; ++i)
+    {
+        bin->reset();
+        bin->addStateGraph(sg);
+
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        bin->sort();
+        osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+        totalTime += osg::Timer::instance()->delta_m(startTick, endTick);
+    }
+
+    sortedValues.clear();
+    osgUtil::RenderBin::RenderLeafList& leaves = bin->getRenderLeafList();
+    for(osgUtil::RenderBin::RenderLeafList::iterator itr = leaves.begin();
+        itr != leaves.end();
+        ++itr)
+    {
+        sortedValues.push_back(bin->getSortMode()==osgUtil::RenderBin::TRAVERSAL_ORDER ? float((*itr)->_traversalOrderNumber) : (*itr)->_depth);
+    }
+
+    return totalTime/double(numIterations);
+}
+
+void runRenderBinSortBenchmark(unsigned int numLeaves, unsigned int numIterations)
+{
+    std::cout<<"RenderBin sort benchmark, "<<numLeaves<<" leaves, "<<numIterations<<" iterations"<<std::endl;
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    osg::ref_ptr<osg::RefMatrix> matrix = new osg::RefMatrix;
+
+    osg::ref_ptr<osgUtil::StateGraph> sg = new osgUtil::StateGraph;
+    srand(1);
+    for(unsigned int i=0; i<numLeaves; ++i)
+    {
+        float depth = 1.0f+1000.0f*float(rand())/float(RAND_MAX);
+        unsigned int traversalOrderNumber = rand();
+        sg->addLeaf(new osgUtil::RenderLeaf(geometry.get(), matrix.get(), matrix.get(), depth, traversalOrderNumber));
+    }
+
+    const char* modeNames[] = { "SORT_FRONT_TO_BACK", "SORT_BACK_TO_FRONT", "TRAVERSAL_ORDER" };
+    osgUtil::RenderBin::SortMode modes[] = { osgUtil::RenderBin::SORT_FRONT_TO_BACK, osgUtil::RenderBin::SORT_BACK_TO_FRONT, osgUtil::RenderBin::TRAVERSAL_ORDER };
+
+    unsigned int radixSortMinimumNumLeaves = osgUtil::RenderBin::getRadixSortMinimumNumLeaves();
+
+    for(unsigned int m=0; m<3; ++m)
+    {
+        osg::ref_ptr<osgUtil::RenderBin> bin = new osgUtil::RenderBin(modes[m]);
+
+        std::vector<float> stdSortValues;
+        osgUtil::RenderBin::setRadixSortMinimumNumLeaves(0);
+        double stdSortTime = timeSort(bin.get(), sg.get(), numIterations, stdSortValues);
+
+        std::vector<float> radixSortValues;
+        osgUtil::RenderBin::setRadixSortMinimumNumLeaves(1);
+        double radixSortTime = timeSort(bin.get(), sg.get(), numIterations, radixSortValues);
+
+        std::cout<<"  "<<modeNames[m]<<"\tstd::sort "<<stdSortTime<<" ms, radix sort "<<radixSortTime<<" ms"
+                 <<(stdSortValues==radixSortValues ? "" : ", ERROR sort orders differ")<<std::endl;
+    }
+
+    osgUtil::RenderBin::setRadixSortMinimumNumLeaves(radixSortMinimumNumLeaves);
+}
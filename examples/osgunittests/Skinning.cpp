@@ -0,0 +1,275 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/Geode>
+#include <osg/Group>
+#include <osg/Timer>
+
+#include <osgAnimation/Bone>
+#include <osgAnimation/RigGeometry>
+#include <osgAnimation/RigTransformSoftware>
+#include <osgAnimation/Skeleton>
+
+#include <osgUtil/UpdateVisitor>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+#include <math.h>
+#include <sstream>
+#include <vector>
+
+// Headless benchmark of the osgAnimation software skinning of a crowd of characters, each a skeleton of a chain of
+// bending bones skinning a cylinder, reporting the vertices skinned per second by the previous scalar per vertex
+// group code, by RigTransformSoftware and by update traversals with and without a ParallelUpdateRigGeometry callback
+// on the crowd. The skinned vertices are checked against the scalar code, and the parallel update against the serial.
+
+namespace
+{
+
+const float boneLength = 1.0f;
+
+// Bend the bone around the x axis by an angle varying with the simulation time.
+class AnimateBoneCallback : public osg::NodeCallback
+{
+public:
+    AnimateBoneCallback(unsigned int index): _index(index) {}
+
+    virtual void operator()(osg::Node* node, osg::NodeVisitor* nv)
+    {
+        osgAnimation::Bone* bone = static_cast<osgAnimation::Bone*>(node);
+        double time = nv->getFrameStamp() ? nv->getFrameStamp()->getSimulationTime() : 0.0;
+        double angle = 0.2*sin(time*2.0 + double(_index)*0.5);
+
+        osg::Matrix matrix = osg::Matrix::rotate(angle, osg::X_AXIS);
+        if (_index>0) matrix = matrix * osg::Matrix::translate(0.0, 0.0, boneLength);
+        bone->setMatrix(matrix);
+
+        osgAnimation::Bone* parent = bone->getBoneParent();
+        bone->setMatrixInSkeletonSpace(parent ? matrix * parent->getMatrixInSkeletonSpace() : matrix);
+
+        traverse(node, nv);
+    }
+
+protected:
+    unsigned int _index;
+};
+
+}
+
+// A cylinder along the chain of bones, each ring of vertices skinned to the two nearest bones and a little to the next.
+static osgAnimation::RigGeometry* createSkinnedCylinder(unsigned int numBones, unsigned int numRings, unsigned int numSegments)
+{
+    osg::Vec3Array* vertices = new osg::Vec3Array;
+    osg::Vec3Array* normals = new osg::Vec3Array;
+    osg::DrawElementsUInt* elements = new osg::DrawElementsUInt(GL_TRIANGLES);
+    osg::ref_ptr<osgAnimation::VertexInfluenceMap> influenceMap = new osgAnimation::VertexInfluenceMap;
+
+    float height = float(numBones)*boneLength;
+    for(unsigned int r=0; r<numRings; ++r)
+    {
+        float z = height*float(r)/float(numRings-1);
+        float position = osg::clampBelow(z/boneLength, float(numBones)-1.001f);
+        unsigned int bone = static_cast<unsigned int>(position);
+        float blend = position-float(bone);
+
+        for(unsigned int s=0; s<numSegments; ++s)
+        {
+            float angle = 2.0f*osg::PIf*float(s)/float(numSegments);
+            unsigned int index = vertices->size();
+            vertices->push_back(osg::Vec3(cosf(angle)*0.3f, sinf(angle)*0.3f, z));
+            normals->push_back(osg::Vec3(cosf(angle), sinf(angle), 0.0f));
+
+            unsigned int bones[3] = { bone, bone+1, osg::minimum(bone+2, numBones-1) };
+            float weights[3] = { (1.0f-blend)*0.9f, blend*0.9f, 0.1f };
+            for(unsigned int b=0; b<3; ++b)
+            {
+                std::ostringstream name;
+                name<<"bone"<<bones[b];
+                (*influenceMap)[name.str()].push_back(osgAnimation::VertexIndexWeight(index, weights[b]));
+            }
+
+            if (r>0)
+            {
+                unsigned int previous = index-numSegments, next = (s+1)%numSegments;
+                unsigned int quad[6] = { previous, previous-s+next, index, previous-s+next, index-s+next, index };
+                elements->insert(elements->end(), quad, quad+6);
+            }
+        }
+    }
+
+    osg::Geometry* source = new osg::Geometry;
+    source->setVertexArray(vertices);
+    source->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
+    source->addPrimitiveSet(elements);
+
+    osgAnimation::RigGeometry* rig = new osgAnimation::RigGeometry;
+    rig->setSourceGeometry(source);
+    rig->setInfluenceMap(influenceMap.get());
+    return rig;
+}
+
+typedef std::vector< osg::ref_ptr<osgAnimation::RigGeometry> > RigGeometryList;
+
+static osgAnimation::Skeleton* createCharacter(unsigned int numBones, unsigned int numRings, unsigned int numSegments, RigGeometryList& rigGeometries)
+{
+    osgAnimation::Skeleton* skeleton = new osgAnimation::Skeleton;
+    skeleton->setDefaultUpdateCallback();
+
+    osg::Group* parent = skeleton;
+    for(unsigned int b=0; b<numBones; ++b)
+    {
+        std::ostringstream name;
+        name<<"bone"<<b;
+        osgAnimation::Bone* bone = new osgAnimation::Bone(name.str());
+        bone->setInvBindMatrixInSkeletonSpace(osg::Matrix::translate(0.0, 0.0, -double(b)*boneLength));
+        bone->setUpdateCallback(new AnimateBoneCallback(b));
+        parent->addChild(bone);
+        parent = bone;
+    }
+
+    osgAnimation::RigGeometry* rig = createSkinnedCylinder(numBones, numRings, numSegments);
+    osg::Geode* geode = new osg::Geode;
+    geode->addDrawable(rig);
+    skeleton->addChild(geode);
+    rigGeometries.push_back(rig);
+    return skeleton;
+}
+
+static void updateFrame(osg::Node* scene, unsigned int frameNumber)
+{
+    osg::ref_ptr<osg::FrameStamp> frameStamp = new osg::FrameStamp;
+    frameStamp->setFrameNumber(frameNumber);
+    frameStamp->setSimulationTime(double(frameNumber)/60.0);
+
+    osgUtil::UpdateVisitor uv;
+    uv.setFrameStamp(frameStamp.get());
+    scene->accept(uv);
+}
+
+static float compareVertices(const osg::Vec3Array& lhs, const osg::Vec3Array& rhs)
+{
+    float maxDifference = 0.0f;
+    for(unsigned int i=0; i<lhs.size(); ++i)
+    {
+        maxDifference = osg::maximum(maxDifference, (lhs[i]-rhs[i]).length());
+    }
+    return maxDifference;
+}
+
+void runSkinningBenchmark(unsigned int numCharacters, unsigned int numBones, unsigned int numVertices, unsigned int numFrames)
+{
+    unsigned int numSegments = 32;
+    unsigned int numRings = osg::maximum(numVertices/numSegments, 2u);
+    unsigned int numCharacterVertices = numRings*numSegments;
+    double numFrameVertices = double(numCharacters)*double(numCharacterVertices);
+
+    std::cout<<"skinning benchmark, "<<numCharacters<<" characters of "<<numBones<<" bones and "<<numCharacterVertices<<" vertices"<<std::endl;
+
+    osg::ref_ptr<osg::Group> scenes[2];
+    RigGeometryList rigGeometries[2];
+    for(unsigned int s=0; s<2; ++s)
+    {
+        scenes[s] = new osg::Group;
+        for(unsigned int c=0; c<numCharacters; ++c)
+        {
+            scenes[s]->addChild(createCharacter(numBones, numRings, numSegments, rigGeometries[s]));
+        }
+
+        // the first updates find the skeletons and prepare the RigTransformSoftware.
+        for(unsigned int f=0; f<3; ++f) updateFrame(scenes[s].get(), f);
+    }
+
+    // the skinning alone, by the scalar per vertex group code and by RigTransformSoftware.
+    std::vector< osg::ref_ptr<osg::Vec3Array> > scalarPositions, scalarNormals;
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    for(unsigned int f=0; f<numFrames; ++f)
+    {
+        scalarPositions.clear();
+        scalarNormals.clear();
+        for(unsigned int c=0; c<numCharacters; ++c)
+        {
+            osgAnimation::RigGeometry* rig = rigGeometries[0][c].get();
+            osgAnimation::RigTransformSoftware* rts = static_cast<osgAnimation::RigTransformSoftware*>(rig->getRigTransformImplementation());
+            osg::Vec3Array* sourcePositions = static_cast<osg::Vec3Array*>(rig->getSourceGeometry()->getVertexArray());
+            osg::Vec3Array* sourceNormals = static_cast<osg::Vec3Array*>(rig->getSourceGeometry()->getNormalArray());
+            osg::ref_ptr<osg::Vec3Array> positions = new osg::Vec3Array(sourcePositions->size());
+            osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array(sourceNormals->size());
+            rts->compute<osg::Vec3>(rig->getMatrixFromSkeletonToGeometry(), rig->getInvMatrixFromSkeletonToGeometry(), &sourcePositions->front(), &positions->front());
+            rts->computeNormal<osg::Vec3>(rig->getMatrixFromSkeletonToGeometry(), rig->getInvMatrixFromSkeletonToGeometry(), &sourceNormals->front(), &normals->front());
+            scalarPositions.push_back(positions);
+            scalarNormals.push_back(normals);
+        }
+    }
+    double time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick())/double(numFrames);
+    std::cout<<"  scalar vertex groups: "<<time*1000.0<<" ms per frame, "<<numFrameVertices/(time*1.0e6)<<" million vertices/s"<<std::endl;
+
+    startTick = osg::Timer::instance()->tick();
+    for(unsigned int f=0; f<numFrames; ++f)
+    {
+        for(unsigned int c=0; c<numCharacters; ++c)
+        {
+            rigGeometries[0][c].get()->update();
+        }
+    }
+    time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick())/double(numFrames);
+
+    float maxDifference = 0.0f;
+    for(unsigned int c=0; c<numCharacters; ++c)
+    {
+        osgAnimation::RigGeometry* rig = rigGeometries[0][c].get();
+        maxDifference = osg::maximum(maxDifference, compareVertices(*scalarPositions[c], *static_cast<osg::Vec3Array*>(rig->getVertexArray())));
+        maxDifference = osg::maximum(maxDifference, compareVertices(*scalarNormals[c], *static_cast<osg::Vec3Array*>(rig->getNormalArray())));
+    }
+    std::cout<<"  RigTransformSoftware: "<<time*1000.0<<" ms per frame, "<<numFrameVertices/(time*1.0e6)<<" million vertices/s, "
+             <<"max difference "<<maxDifference<<(maxDifference<1.0e-4f*float(numBones) ? "" : ", ERROR vertices differ from the scalar code")<<std::endl;
+
+    // whole update traversals, serially and with the RigGeometry skinned in parallel.
+    unsigned int numThreads = static_cast<unsigned int>(osg::maximum(2, OpenThreads::GetNumberOfProcessors()));
+    scenes[1]->setUpdateCallback(new osgAnimation::ParallelUpdateRigGeometry(numThreads));
+    for(unsigned int s=0; s<2; ++s)
+    {
+        startTick = osg::Timer::instance()->tick();
+        for(unsigned int f=0; f<numFrames; ++f)
+        {
+            updateFrame(scenes[s].get(), 3+f);
+        }
+        time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick())/double(numFrames);
+
+        std::cout<<"  update traversal, ";
+        if (s==0) std::cout<<"serial: ";
+        else std::cout<<"ParallelUpdateRigGeometry with "<<numThreads<<" threads: ";
+        std::cout<<time*1000.0<<" ms per frame, "<<numFrameVertices/(time*1.0e6)<<" million vertices/s";
+        if (s>0)
+        {
+            bool identical = true;
+            for(unsigned int c=0; c<numCharacters; ++c)
+            {
+                osgAnimation::RigGeometry* serial = rigGeometries[0][c].get();
+                osgAnimation::RigGeometry* parallel = rigGeometries[1][c].get();
+                if (compareVertices(*static_cast<osg::Vec3Array*>(serial->getVertexArray()), *static_cast<osg::Vec3Array*>(parallel->getVertexArray()))!=0.0f ||
+                    compareVertices(*static_cast<osg::Vec3Array*>(serial->getNormalArray()), *static_cast<osg::Vec3Array*>(parallel->getNormalArray()))!=0.0f)
+                {
+                    identical = false;
+                }
+            }
+            if (!identical) std::cout<<", ERROR vertices differ from the serial update";
+        }
+        std::cout<<std::endl;
+    }
+}
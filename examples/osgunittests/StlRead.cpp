@@ -0,0 +1,239 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/NodeVisitor>
+#include <osg/Timer>
+
+#include <osgDB/ReadFile>
+#include <osgDB/fstream>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+
+// Benchmark of the .stl plugin's read throughput, writes a terraced grid as an ASCII file of several solids, mixing
+// the number formats, white space and line endings found in exported files, and as a binary file with per facet
+// colours, then reads them back a facet or line at a time and in blocks, checking the block reads create the same
+// scene graph as the per facet reads. The reads with the weldVertices option are checked to index vertices equal
+// to the triangles of the non welded read.
+
+extern bool compareScenes(osg::Node* lhs, osg::Node* rhs);
+
+static osg::Vec3 getGridVertex(unsigned int c, unsigned int r)
+{
+    return osg::Vec3(float(c)*0.731f-100.0f, float(r)*1.379f, float(((c/16)*7+(r/16)*3)%5)*2.5f);
+}
+
+static void writeStlBenchmarkFiles(const std::string& asciiFileName, const std::string& binaryFileName, unsigned int gridSize)
+{
+    osgDB::ofstream ascii(asciiFileName.c_str(), std::ios::out | std::ios::binary);
+    osgDB::ofstream binary(binaryFileName.c_str(), std::ios::out | std::ios::binary);
+
+    char header[80];
+    memset(header, 0, sizeof(header));
+    strcpy(header, "osgunittests stl read benchmark");
+    binary.write(header, sizeof(header));
+    unsigned int numFacets = gridSize*gridSize*2;
+    binary.write(reinterpret_cast<const char*>(&numFacets), 4);
+
+    char line[256];
+    for(unsigned int r=0; r<gridSize; ++r)
+    {
+        if (r%(gridSize/4+1)==0)
+        {
+            if (r>0) ascii<<"endsolid\n";
+            ascii<<"solid rows_"<<r<<"\r\n";
+        }
+
+        for(unsigned int c=0; c<gridSize; ++c)
+        {
+            osg::Vec3 triangles[2][3] =
+            {
+                { getGridVertex(c, r), getGridVertex(c+1, r), getGridVertex(c+1, r+1) },
+                { getGridVertex(c, r), getGridVertex(c+1, r+1), getGridVertex(c, r+1) }
+            };
+
+            for(unsigned int t=0; t<2; ++t)
+            {
+                osg::Vec3* v = triangles[t];
+                osg::Vec3 normal = (v[1]-v[0])^(v[2]-v[0]);
+
+                const char* format = "vertex %.6f %.6f %.6f\n";
+                switch((r*gridSize+c)%4)
+                {
+                    case 1: format = "      vertex %.9g %.9g %.9g\r\n"; break;
+                    case 2: format = "\tvertex\t%e\t%e\t%e  \n"; break;
+                    case 3: format = "vertex %.3f %.7E %g\n"; break;
+                    default: break;
+                }
+
+                sprintf(line, "facet normal %g %g %g\n  outer loop\n", normal.x(), normal.y(), normal.z());
+                ascii<<line;
+                for(unsigned int i=0; i<3; ++i)
+                {
+                    sprintf(line, format, v[i].x(), v[i].y(), v[i].z());
+                    ascii<<line;
+                }
+                ascii<<"  endloop\nendfacet\n";
+
+                float facet[12] = { normal.x(), normal.y(), normal.z(), v[0].x(), v[0].y(), v[0].z(), v[1].x(), v[1].y(), v[1].z(), v[2].x(), v[2].y(), v[2].z() };
+                unsigned short colour = 0x8000 | static_cast<unsigned short>(((c/16)%32)<<10 | ((r/16)%32)<<5 | 31);
+                binary.write(reinterpret_cast<const char*>(facet), sizeof(facet));
+                binary.write(reinterpret_cast<const char*>(&colour), 2);
+            }
+        }
+    }
+    ascii<<"endsolid";
+}
+
+static double getFileSize(const std::string& fileName)
+{
+    osgDB::ifstream fin(fileName.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    return static_cast<double>(fin.tellg());
+}
+
+static osg::Geometry* getGeometry(osg::Node* node, unsigned int childIndex)
+{
+    osg::Group* group = node ? node->asGroup() : 0;
+    osg::Geode* geode = (group && childIndex<group->getNumChildren()) ? group->getChild(childIndex)->asGeode() : 0;
+    return (geode && geode->getNumDrawables()>0) ? geode->getDrawable(0)->asGeometry() : 0;
+}
+
+template<class ArrayType>
+static bool compareWeldedArray(const osg::Array* triangles, const osg::Array* welded, const osg::PrimitiveSet* indices)
+{
+    if (!triangles || !welded) return triangles==welded;
+
+    const ArrayType* triangleArray = dynamic_cast<const ArrayType*>(triangles);
+    const ArrayType* weldedArray = dynamic_cast<const ArrayType*>(welded);
+    if (!triangleArray || !weldedArray || triangleArray->size()!=indices->getNumIndices()) return false;
+
+    for(unsigned int i=0; i<indices->getNumIndices(); ++i)
+    {
+        if (memcmp(&(*triangleArray)[i], &(*weldedArray)[indices->index(i)], sizeof(typename ArrayType::ElementDataType))!=0) return false;
+    }
+    return true;
+}
+
+// Check the welded scene indexes the vertices of the non welded triangles, returning the number of welded vertices or 0.
+static unsigned int checkWeldedScene(osg::Node* triangles, osg::Node* welded, bool positionsOnly)
+{
+    unsigned int numVertices = 0;
+    for(unsigned int i=0; getGeometry(triangles, i); ++i)
+    {
+        osg::Geometry* triangleGeometry = getGeometry(triangles, i);
+        osg::Geometry* weldedGeometry = getGeometry(welded, i);
+        if (!weldedGeometry || weldedGeometry->getNumPrimitiveSets()!=1) return 0;
+
+        const osg::PrimitiveSet* indices = weldedGeometry->getPrimitiveSet(0);
+        if (indices->getType()!=osg::PrimitiveSet::DrawElementsUIntPrimitiveType ||
+            !compareWeldedArray<osg::Vec3Array>(triangleGeometry->getVertexArray(), weldedGeometry->getVertexArray(), indices) ||
+            !compareWeldedArray<osg::Vec4Array>(triangleGeometry->getColorArray(), weldedGeometry->getColorArray(), indices) ||
+            !(positionsOnly || compareWeldedArray<osg::Vec3Array>(triangleGeometry->getNormalArray(), weldedGeometry->getNormalArray(), indices)))
+        {
+            return 0;
+        }
+        numVertices += weldedGeometry->getVertexArray()->getNumElements();
+    }
+    return numVertices;
+}
+
+static unsigned int countVertices(osg::Node* node)
+{
+    unsigned int numVertices = 0;
+    for(unsigned int i=0; getGeometry(node, i); ++i)
+    {
+        numVertices += getGeometry(node, i)->getVertexArray()->getNumElements();
+    }
+    return numVertices;
+}
+
+static osg::ref_ptr<osg::Node> readStlFile(const std::string& fileName, const std::string& optionString, unsigned int numReads, double& time)
+{
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options(optionString);
+    options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+
+    osg::ref_ptr<osg::Node> node;
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    for(unsigned int i=0; i<numReads; ++i)
+    {
+        node = osgDB::readRefNodeFile(fileName, options.get());
+    }
+    time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+    return node;
+}
+
+void runStlReadBenchmark(unsigned int gridSize, unsigned int numReads)
+{
+    const std::string asciiFileName("osgunittests_read_benchmark_ascii.stl");
+    const std::string binaryFileName("osgunittests_read_benchmark_binary.stl");
+    writeStlBenchmarkFiles(asciiFileName, binaryFileName, gridSize);
+
+    std::ostringstream allThreads;
+    allThreads<<"parseThreads="<<OpenThreads::GetNumberOfProcessors();
+
+    // the reads skip the tri stripping so the timings are dominated by the parsing and welding.
+    const std::string fileNames[] = { asciiFileName, binaryFileName };
+    const char* fileTypes[] = { "ascii", "binary" };
+    std::string optionStrings[] = { "perFacetRead", "parseThreads=1", allThreads.str(), allThreads.str()+" weldVertices", allThreads.str()+" weldVertices smooth" };
+    const char* names[] = { "per facet", "blocks, 1 thread", "blocks, thread per processor", "blocks, welded", "blocks, welded positions and smoothed" };
+
+    for(unsigned int f=0; f<2; ++f)
+    {
+        double fileSize = getFileSize(fileNames[f]);
+        std::cout<<"stl read benchmark, "<<fileTypes[f]<<", "<<gridSize*gridSize*2<<" facets, "<<fileSize/(1024.0*1024.0)<<" MB file"<<std::endl;
+
+        osg::ref_ptr<osg::Node> perFacetScene;
+        for(unsigned int o=0; o<5; ++o)
+        {
+            // the binary reads don't use parse threads.
+            if (f==1 && o==1) continue;
+
+            double time = 0.0;
+            osg::ref_ptr<osg::Node> node = readStlFile(fileNames[f], optionStrings[o]+" noTriStripPolygons", numReads, time);
+
+            std::cout<<"  "<<names[o]<<": "<<time*1000.0/double(numReads)<<" ms per read, "
+                     <<fileSize*double(numReads)/(time*1024.0*1024.0)<<" MB/s";
+
+            if (o==0)
+            {
+                perFacetScene = node;
+                std::cout<<", "<<countVertices(node.get())<<" vertices";
+            }
+            else if (o<3)
+            {
+                if (!compareScenes(perFacetScene.get(), node.get())) std::cout<<", ERROR scene graph differs from the per facet read";
+            }
+            else
+            {
+                unsigned int numWelded = checkWeldedScene(perFacetScene.get(), node.get(), o==4);
+                if (numWelded>0) std::cout<<", "<<numWelded<<" vertices";
+                else std::cout<<", ERROR welded vertices differ from the per facet read";
+            }
+            std::cout<<std::endl;
+        }
+    }
+
+    remove(asciiFileName.c_str());
+    remove(binaryFileName.c_str());
+}
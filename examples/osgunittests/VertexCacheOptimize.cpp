@@ -0,0 +1,155 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/Geometry>
+#include <osg/Timer>
+#include <osg/TriangleIndexFunctor>
+
+#include <osgUtil/MeshOptimizers>
+
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+
+// Benchmark of osgUtil::VertexCacheVisitor, optimizes the triangle order of a height field grid and of a grid made of
+// many small disconnected patches, whose triangles are in a random order, reporting the time taken and the average
+// cache miss ratio (ACMR) of the triangles measured with osgUtil::VertexCacheMissVisitor for FIFO caches of 16 and 32
+// vertices, with and without the overdraw reordering. The optimized meshes are checked to contain the same triangles
+// with the same winding as the original mesh.
+
+// A grid of gridSize by gridSize quads made of separate patches of patchSize by patchSize quads.
+static osg::Geometry* createShuffledGrid(unsigned int gridSize, unsigned int patchSize)
+{
+    osg::Vec3Array* vertices = new osg::Vec3Array;
+    osg::DrawElementsUInt* elements = new osg::DrawElementsUInt(GL_TRIANGLES);
+    elements->reserve(gridSize*gridSize*6);
+    for(unsigned int py=0; py<gridSize; py+=patchSize)
+    {
+        for(unsigned int px=0; px<gridSize; px+=patchSize)
+        {
+            unsigned int sizeX = osg::minimum(patchSize, gridSize-px), sizeY = osg::minimum(patchSize, gridSize-py);
+            unsigned int first = vertices->size();
+            for(unsigned int y=py; y<=py+sizeY; ++y)
+            {
+                for(unsigned int x=px; x<=px+sizeX; ++x)
+                {
+                    vertices->push_back(osg::Vec3(float(x), float(y), 10.0f*sinf(float(x)*0.05f)*cosf(float(y)*0.05f)));
+                }
+            }
+
+            for(unsigned int y=0; y<sizeY; ++y)
+            {
+                for(unsigned int x=0; x<sizeX; ++x)
+                {
+                    unsigned int i = first+y*(sizeX+1)+x;
+                    unsigned int quad[6] = { i, i+1, i+sizeX+2, i, i+sizeX+2, i+sizeX+1 };
+                    elements->insert(elements->end(), quad, quad+6);
+                }
+            }
+        }
+    }
+
+    // shuffle the triangles.
+    unsigned int numTriangles = elements->size()/3;
+    unsigned int seed = 12345;
+    for(unsigned int t=numTriangles-1; t>0; --t)
+    {
+        seed = seed*1664525u+1013904223u;
+        unsigned int swapTriangle = (seed>>8)%(t+1);
+        for(unsigned int i=0; i<3; ++i) std::swap((*elements)[t*3+i], (*elements)[swapTriangle*3+i]);
+    }
+
+    osg::Geometry* geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices);
+    geometry->addPrimitiveSet(elements);
+    return geometry;
+}
+
+struct CollectTriangleOperator
+{
+    std::vector< std::vector<unsigned int> >* triangles;
+
+    CollectTriangleOperator() : triangles(0) {}
+
+    // rotate the triangle so its smallest index is first, keeping its winding.
+    void operator() (unsigned int p1, unsigned int p2, unsigned int p3)
+    {
+        std::vector<unsigned int> triangle(3);
+        if (p1<p2 && p1<p3) { triangle[0] = p1; triangle[1] = p2; triangle[2] = p3; }
+        else if (p2<p3) { triangle[0] = p2; triangle[1] = p3; triangle[2] = p1; }
+        else { triangle[0] = p3; triangle[1] = p1; triangle[2] = p2; }
+        triangles->push_back(triangle);
+    }
+};
+
+static void collectTriangles(osg::Geometry& geometry, std::vector< std::vector<unsigned int> >& triangles)
+{
+    osg::TriangleIndexFunctor<CollectTriangleOperator> collector;
+    collector.triangles = &triangles;
+    for(unsigned int i=0; i<geometry.getNumPrimitiveSets(); ++i)
+    {
+        geometry.getPrimitiveSet(i)->accept(collector);
+    }
+    std::sort(triangles.begin(), triangles.end());
+}
+
+static double getACMR(osg::Geometry& geometry, unsigned int cacheSize)
+{
+    osgUtil::VertexCacheMissVisitor missVisitor(cacheSize);
+    missVisitor.doGeometry(geometry);
+    return missVisitor.triangles>0 ? double(missVisitor.misses)/double(missVisitor.triangles) : 0.0;
+}
+
+void runVertexCacheBenchmark(unsigned int gridSize)
+{
+    std::cout<<"vertex cache optimize benchmark, "<<gridSize*gridSize*2<<" triangles"<<std::endl;
+
+    const char* meshNames[] = { "grid", "grid of 4x4 quad patches" };
+    unsigned int patchSizes[] = { gridSize, 4 };
+    for(unsigned int m=0; m<2; ++m)
+    {
+        osg::ref_ptr<osg::Geometry> original = createShuffledGrid(gridSize, patchSizes[m]);
+        unsigned int numTriangles = gridSize*gridSize*2;
+
+        std::vector< std::vector<unsigned int> > originalTriangles;
+        collectTriangles(*original, originalTriangles);
+
+        std::cout<<"  "<<meshNames[m]<<", shuffled: ACMR "<<getACMR(*original, 16)<<" (16 vertices), "<<getACMR(*original, 32)<<" (32 vertices)"<<std::endl;
+
+        const char* names[] = { "optimized", "optimized for overdraw" };
+        float overdrawThresholds[] = { 0.0f, 0.8f };
+        for(unsigned int o=0; o<2; ++o)
+        {
+            osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry(*original, osg::CopyOp::DEEP_COPY_PRIMITIVES);
+
+            osgUtil::VertexCacheVisitor vcv;
+            vcv.setOverdrawThreshold(overdrawThresholds[o]);
+
+            osg::Timer_t startTick = osg::Timer::instance()->tick();
+            vcv.optimizeVertices(*geometry);
+            double time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+            std::vector< std::vector<unsigned int> > triangles;
+            collectTriangles(*geometry, triangles);
+
+            std::cout<<"  "<<meshNames[m]<<", "<<names[o]<<": "<<time*1000.0<<" ms, "<<double(numTriangles)/(time*1.0e6)<<" million triangles/s, ACMR "
+                     <<getACMR(*geometry, 16)<<" (16 vertices), "<<getACMR(*geometry, 32)<<" (32 vertices)"
+                     <<(triangles==originalTriangles ? "" : ", ERROR triangles differ from the original mesh")<<std::endl;
+        }
+    }
+}
@@ -34,6 +34,21 @@
 #include <iostream>
 
 extern void runFileNameUtilsTest(osg::ArgumentParser& arguments);
+extern void runParallelCullBenchmark(unsigned int numTiles, unsigned int numFrames, unsigned int maxNumThreads);
+extern void runRenderBinSortBenchmark(unsigned int numLeaves, unsigned int numIterations);
+extern void runKdTreeBenchmark(unsigned int size, unsigned int numRays);
+extern void runParallelLineOfSightBenchmark(unsigned int numTiles, unsigned int numPoints, unsigned int maxNumThreads);
+extern void runDatabasePagerBenchmark(unsigned int numTiles, unsigned int numFrames, unsigned int numThreads, double prefetchTime, double memoryBudget);
+extern void runOsgbReadBenchmark(unsigned int numGeometries, unsigned int gridSize, unsigned int numReads, const std::string& compressor);
+extern void runObjReadBenchmark(unsigned int gridSize, unsigned int numReads);
+extern void runStlReadBenchmark(unsigned int gridSize, unsigned int numReads);
+extern void runPointCloudReadBenchmark(unsigned int numPoints, double memoryBudget);
+extern void runPointCloudCullTest(unsigned int numPoints);
+extern void runOptimizerParallelTest(unsigned int numGeometries, unsigned int gridSize);
+extern void runVertexCacheBenchmark(unsigned int gridSize);
+extern void runIndexMeshBenchmark(unsigned int gridSize);
+extern void runSkinningBenchmark(unsigned int numCharacters, unsigned int numBones, unsigned int numVertices, unsigned int numFrames);
+extern void runAnimationCacheBenchmark(unsigned int numInstances, unsigned int numBones, unsigned int numFrames);
 
 void testFrustum(double left,double right,double bottom,double top,double zNear,double zFar)
 {
@@ -572,6 +587,21 @@ int main( int argc, char** argv )
     arguments.getApplicationUsage()->addCommandLineOption("matrix","Display qualified tests.");
     arguments.getApplicationUsage()->addCommandLineOption("performance","Display qualified tests.");
     arguments.getApplicationUsage()->addCommandLineOption("read-threads <numthreads>","Run multi-thread reading test.");
+    arguments.getApplicationUsage()->addCommandLineOption("parallel-cull [--tiles <num>] [--frames <num>] [--max-cull-threads <num>]","Run the headless cull time versus number of cull threads benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("renderbin-sort [--leaves <num>]","Run the RenderBin std::sort versus radix sort benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("kdtree [--terrain-size <num>] [--rays <num>]","Run the KdTree build and LineSegmentIntersector query benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("line-of-sight [--paged-tiles <num>] [--points <num>] [--max-intersection-threads <num>]","Run the osgSim HeightAboveTerrain and LineOfSight throughput versus number of intersection threads benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("database-pager [--pager-tiles <num>] [--pager-frames <num>] [--database-threads <num>] [--prefetch <seconds>] [--memory-budget <megabytes>]","Run the headless DatabasePager request queue latency, prefetch and memory budget benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("osgb-read [--osgb-geometries <num>] [--osgb-grid <num>] [--osgb-reads <num>] [--osgb-compressor <name>]","Run the .osgb file stream versus memory mapped read throughput benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("obj-read [--obj-grid <num>] [--obj-reads <num>]","Run the .obj line by line versus block parser read throughput benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("stl-read [--stl-grid <num>] [--stl-reads <num>]","Run the ASCII and binary .stl per facet versus block read and vertex welding throughput benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("point-cloud [--point-cloud-points <num>] [--point-cloud-budget <megabytes>]","Run the streamed .ply point cloud octree build memory budget test.");
+    arguments.getApplicationUsage()->addCommandLineOption("point-cloud-cull [--point-cloud-cull-points <num>]","Run the headless osg::PointCloudNode point budget selection and paging test.");
+    arguments.getApplicationUsage()->addCommandLineOption("optimizer-parallel [--optimizer-geometries <num>] [--optimizer-grid <size>]","Run the serial vs parallel osgUtil::Optimizer per Geometry pass comparison.");
+    arguments.getApplicationUsage()->addCommandLineOption("vertex-cache [--vertex-cache-grid <size>]","Run the osgUtil::VertexCacheVisitor triangle reordering benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("index-mesh [--index-mesh-grid <size>]","Run the osgUtil::IndexMeshVisitor hash versus sort based vertex deduplication and welding benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("skinning [--skinning-characters <num>] [--skinning-bones <num>] [--skinning-vertices <num>] [--skinning-frames <num>]","Run the headless osgAnimation software skinning benchmark of a crowd of characters, serially and in parallel.");
+    arguments.getApplicationUsage()->addCommandLineOption("animation-cache [--animation-cache-instances <num>] [--animation-cache-bones <num>] [--animation-cache-frames <num>]","Run the osgAnimation::AnimationCache benchmark of a crowd of instances playing the same animation.");
 
 
     if (arguments.argc()<=1)
@@ -604,6 +634,159 @@ int main( int argc, char** argv )
     bool doTestThreadInitAndExit = false;
     while (arguments.read("thread")) doTestThreadInitAndExit = true;
 
+    bool doParallelCullBenchmark = false;
+    while (arguments.read("parallel-cull")) doParallelCullBenchmark = true;
+
+    unsigned int parallelCullNumTiles = 500;
+    while (arguments.read("--tiles", parallelCullNumTiles)) {}
+
+    unsigned int parallelCullNumFrames = 20;
+    while (arguments.read("--frames", parallelCullNumFrames)) {}
+
+    unsigned int parallelCullMaxNumThreads = OpenThreads::GetNumberOfProcessors();
+    while (arguments.read("--max-cull-threads", parallelCullMaxNumThreads)) {}
+
+    bool doRenderBinSortBenchmark = false;
+    while (arguments.read("renderbin-sort")) doRenderBinSortBenchmark = true;
+
+    unsigned int renderBinSortNumLeaves = 100000;
+    while (arguments.read("--leaves", renderBinSortNumLeaves)) {}
+
+    bool doKdTreeBenchmark = false;
+    while (arguments.read("kdtree")) doKdTreeBenchmark = true;
+
+    unsigned int kdTreeTerrainSize = 1025;
+    while (arguments.read("--terrain-size", kdTreeTerrainSize)) {}
+
+    unsigned int kdTreeNumRays = 10000;
+    while (arguments.read("--rays", kdTreeNumRays)) {}
+
+    bool doLineOfSightBenchmark = false;
+    while (arguments.read("line-of-sight")) doLineOfSightBenchmark = true;
+
+    unsigned int lineOfSightNumTiles = 16;
+    while (arguments.read("--paged-tiles", lineOfSightNumTiles)) {}
+
+    unsigned int lineOfSightNumPoints = 10000;
+    while (arguments.read("--points", lineOfSightNumPoints)) {}
+
+    unsigned int lineOfSightMaxNumThreads = OpenThreads::GetNumberOfProcessors();
+    while (arguments.read("--max-intersection-threads", lineOfSightMaxNumThreads)) {}
+
+    bool doDatabasePagerBenchmark = false;
+    while (arguments.read("database-pager")) doDatabasePagerBenchmark = true;
+
+    unsigned int pagerNumTiles = 20000;
+    while (arguments.read("--pager-tiles", pagerNumTiles)) {}
+
+    unsigned int pagerNumFrames = 600;
+    while (arguments.read("--pager-frames", pagerNumFrames)) {}
+
+    unsigned int pagerNumThreads = 2;
+    while (arguments.read("--database-threads", pagerNumThreads)) {}
+
+    double pagerPrefetchTime = 0.0;
+    while (arguments.read("--prefetch", pagerPrefetchTime)) {}
+
+    double pagerMemoryBudget = 0.0;
+    while (arguments.read("--memory-budget", pagerMemoryBudget)) {}
+
+    bool doOsgbReadBenchmark = false;
+    while (arguments.read("osgb-read")) doOsgbReadBenchmark = true;
+
+    unsigned int osgbNumGeometries = 64;
+    while (arguments.read("--osgb-geometries", osgbNumGeometries)) {}
+
+    unsigned int osgbGridSize = 256;
+    while (arguments.read("--osgb-grid", osgbGridSize)) {}
+
+    unsigned int osgbNumReads = 10;
+    while (arguments.read("--osgb-reads", osgbNumReads)) {}
+
+    std::string osgbCompressor;
+    while (arguments.read("--osgb-compressor", osgbCompressor)) {}
+
+    bool doObjReadBenchmark = false;
+    while (arguments.read("obj-read")) doObjReadBenchmark = true;
+
+    unsigned int objGridSize = 1000;
+    while (arguments.read("--obj-grid", objGridSize)) {}
+
+    unsigned int objNumReads = 3;
+    while (arguments.read("--obj-reads", objNumReads)) {}
+
+    bool doStlReadBenchmark = false;
+    while (arguments.read("stl-read")) doStlReadBenchmark = true;
+
+    unsigned int stlGridSize = 500;
+    while (arguments.read("--stl-grid", stlGridSize)) {}
+
+    unsigned int stlNumReads = 3;
+    while (arguments.read("--stl-reads", stlNumReads)) {}
+
+    bool doPointCloudReadBenchmark = false;
+    while (arguments.read("point-cloud")) doPointCloudReadBenchmark = true;
+
+    unsigned int pointCloudNumPoints = 4000000;
+    while (arguments.read("--point-cloud-points", pointCloudNumPoints)) {}
+
+    double pointCloudMemoryBudget = 32.0;
+    while (arguments.read("--point-cloud-budget", pointCloudMemoryBudget)) {}
+
+    bool doPointCloudCullTest = false;
+    while (arguments.read("point-cloud-cull")) doPointCloudCullTest = true;
+
+    unsigned int pointCloudCullNumPoints = 1000000;
+    while (arguments.read("--point-cloud-cull-points", pointCloudCullNumPoints)) {}
+
+    bool doOptimizerParallelTest = false;
+    while (arguments.read("optimizer-parallel")) doOptimizerParallelTest = true;
+
+    unsigned int optimizerNumGeometries = 400;
+    while (arguments.read("--optimizer-geometries", optimizerNumGeometries)) {}
+
+    unsigned int optimizerGridSize = 32;
+    while (arguments.read("--optimizer-grid", optimizerGridSize)) {}
+
+    bool doVertexCacheBenchmark = false;
+    while (arguments.read("vertex-cache")) doVertexCacheBenchmark = true;
+
+    unsigned int vertexCacheGridSize = 1000;
+    while (arguments.read("--vertex-cache-grid", vertexCacheGridSize)) {}
+
+    bool doIndexMeshBenchmark = false;
+    while (arguments.read("index-mesh")) doIndexMeshBenchmark = true;
+
+    unsigned int indexMeshGridSize = 1300;
+    while (arguments.read("--index-mesh-grid", indexMeshGridSize)) {}
+
+    bool doSkinningBenchmark = false;
+    while (arguments.read("skinning")) doSkinningBenchmark = true;
+
+    unsigned int skinningNumCharacters = 500;
+    while (arguments.read("--skinning-characters", skinningNumCharacters)) {}
+
+    unsigned int skinningNumBones = 32;
+    while (arguments.read("--skinning-bones", skinningNumBones)) {}
+
+    unsigned int skinningNumVertices = 4096;
+    while (arguments.read("--skinning-vertices", skinningNumVertices)) {}
+
+    unsigned int skinningNumFrames = 10;
+    while (arguments.read("--skinning-frames", skinningNumFrames)) {}
+
+    bool doAnimationCacheBenchmark = false;
+    while (arguments.read("animation-cache")) doAnimationCacheBenchmark = true;
+
+    unsigned int animationCacheNumInstances = 500;
+    while (arguments.read("--animation-cache-instances", animationCacheNumInstances)) {}
+
+    unsigned int animationCacheNumBones = 50;
+    while (arguments.read("--animation-cache-bones", animationCacheNumBones)) {}
+
+    unsigned int animationCacheNumFrames = 60;
+    while (arguments.read("--animation-cache-frames", animationCacheNumFrames)) {}
+
     osg::Vec3d quat_scale(1.0,1.0,1.0);
     while (arguments.read("quat_scaled", quat_scale.x(), quat_scale.y(), quat_scale.z() )) printQuatTest = true;
 
@@ -713,6 +896,81 @@ int main( int argc, char** argv )
         testThreadInitAndExit();
     }
 
+    if (doParallelCullBenchmark)
+    {
+        runParallelCullBenchmark(parallelCullNumTiles, parallelCullNumFrames, parallelCullMaxNumThreads);
+    }
+
+    if (doRenderBinSortBenchmark)
+    {
+        runRenderBinSortBenchmark(renderBinSortNumLeaves, 20);
+    }
+
+    if (doKdTreeBenchmark)
+    {
+        runKdTreeBenchmark(kdTreeTerrainSize, kdTreeNumRays);
+    }
+
+    if (doLineOfSightBenchmark)
+    {
+        runParallelLineOfSightBenchmark(lineOfSightNumTiles, lineOfSightNumPoints, lineOfSightMaxNumThreads);
+    }
+
+    if (doDatabasePagerBenchmark)
+    {
+        runDatabasePagerBenchmark(pagerNumTiles, pagerNumFrames, pagerNumThreads, pagerPrefetchTime, pagerMemoryBudget);
+    }
+
+    if (doOsgbReadBenchmark)
+    {
+        runOsgbReadBenchmark(osgbNumGeometries, osgbGridSize, osgbNumReads, osgbCompressor);
+    }
+
+    if (doObjReadBenchmark)
+    {
+        runObjReadBenchmark(objGridSize, objNumReads);
+    }
+
+    if (doStlReadBenchmark)
+    {
+        runStlReadBenchmark(stlGridSize, stlNumReads);
+    }
+
+    if (doPointCloudReadBenchmark)
+    {
+        runPointCloudReadBenchmark(pointCloudNumPoints, pointCloudMemoryBudget);
+    }
+
+    if (doPointCloudCullTest)
+    {
+        runPointCloudCullTest(pointCloudCullNumPoints);
+    }
+
+    if (doOptimizerParallelTest)
+    {
+        runOptimizerParallelTest(optimizerNumGeometries, optimizerGridSize);
+    }
+
+    if (doVertexCacheBenchmark)
+    {
+        runVertexCacheBenchmark(vertexCacheGridSize);
+    }
+
+    if (doIndexMeshBenchmark)
+    {
+        runIndexMeshBenchmark(indexMeshGridSize);
+    }
+
+    if (doSkinningBenchmark)
+    {
+        runSkinningBenchmark(skinningNumCharacters, skinningNumBones, skinningNumVertices, skinningNumFrames);
+    }
+
+    if (doAnimationCacheBenchmark)
+    {
+        runAnimationCacheBenchmark(animationCacheNumInstances, animationCacheNumBones, animationCacheNumFrames);
+    }
+
     std::cout<<"******   Running tests   ******"<<std::endl;
 
     // Global Data or Context
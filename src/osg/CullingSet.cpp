@@ -25,6 +25,63 @@ CullingSet::~CullingSet()
 {
 }
 
+bool CullingSet::isCulled(const std::vector<BoundingSphere>& spheres, std::vector<bool>& culled, std::vector<Polytope::ClippingMask>& resultMasks)
+{
+    if ((_mask&SHADOW_OCCLUSION_CULLING) && !_occluderList.empty()) return false;
+
+    const unsigned int base = culled.size();
+
+    if (_mask&VIEW_FRUSTUM_CULLING)
+    {
+        // is it outside the view frustum...
+        _frustum.contains(spheres, culled, resultMasks);
+        for(unsigned int i=base; i<culled.size(); ++i)
+        {
+            culled[i] = !culled[i];
+        }
+    }
+    else
+    {
+        culled.resize(base+spheres.size(), false);
+        resultMasks.resize(base+spheres.size(), _frustum.getResultMask());
+    }
+
+    if (_mask&SMALL_FEATURE_CULLING)
+    {
+        for(unsigned int i=0; i<spheres.size(); ++i)
+        {
+            const BoundingSphere& bs = spheres[i];
+            if (!culled[base+i] && ((bs.center()*_pixelSizeVector)*_smallFeatureCullingPixelSize)>bs.radius()) culled[base+i] = true;
+        }
+    }
+
+    return true;
+}
+
+bool CullingSet::isCulled(const std::vector<BoundingBox>& boxes, std::vector<bool>& culled, std::vector<Polytope::ClippingMask>& resultMasks)
+{
+    if ((_mask&SHADOW_OCCLUSION_CULLING) && !_occluderList.empty()) return false;
+
+    const unsigned int base = culled.size();
+
+    if (_mask&VIEW_FRUSTUM_CULLING)
+    {
+        // is it outside the view frustum...
+        _frustum.contains(boxes, culled, resultMasks);
+        for(unsigned int i=base; i<culled.size(); ++i)
+        {
+            culled[i] = !culled[i];
+        }
+    }
+    else
+    {
+        culled.resize(base+boxes.size(), false);
+        resultMasks.resize(base+boxes.size(), _frustum.getResultMask());
+    }
+
+    return true;
+}
+
 void CullingSet::disableAndPushOccludersCurrentMask(NodePath& nodePath)
 {
     for(OccluderList::iterator itr=_occluderList.begin();
@@ -16,13 +16,90 @@
 #include <osg/TriangleIndexFunctor>
 #include <osg/TemplatePrimitiveIndexFunctor>
 #include <osg/Timer>
+#include <osg/ApplicationUsage>
 
 #include <osg/io_utils>
 
+#include <OpenThreads/Thread>
+#include <OpenThreads/Atomic>
+
+#include <algorithm>
+#include <float.h>
+#include <stdlib.h>
+
 using namespace osg;
 
+static ApplicationUsageProxy ApplicationUsageProxyKdTree_e0(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_KDTREE_BUILD_THREADS <int>","Set the number of threads used to build KdTree's, 0 uses the number of processors.");
+
 //#define VERBOSE_OUTPUT
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// parallelFor - run a functor on a range of task indices using several threads,
+// the calling thread being one of them.
+
+namespace
+{
+
+static unsigned int getNumBuildThreads(const KdTree::BuildOptions& options)
+{
+    return options._numThreads>0 ? options._numThreads : static_cast<unsigned int>(OpenThreads::GetNumberOfProcessors());
+}
+
+template<class Functor>
+void runTasks(Functor& functor, OpenThreads::Atomic& nextTask, unsigned int numTasks)
+{
+    for(unsigned int i=(++nextTask)-1; i<numTasks; i=(++nextTask)-1)
+    {
+        functor(i);
+    }
+}
+
+template<class Functor>
+class TaskThread : public OpenThreads::Thread
+{
+    public:
+
+        TaskThread(Functor& functor, OpenThreads::Atomic& nextTask, unsigned int numTasks):
+            _functor(functor),
+            _nextTask(nextTask),
+            _numTasks(numTasks) {}
+
+        virtual void run() { runTasks(_functor, _nextTask, _numTasks); }
+
+    protected:
+
+        Functor&                _functor;
+        OpenThreads::Atomic&    _nextTask;
+        unsigned int            _numTasks;
+};
+
+template<class Functor>
+void parallelFor(Functor& functor, unsigned int numTasks, unsigned int numThreads)
+{
+    OpenThreads::Atomic nextTask(0);
+
+    std::vector< TaskThread<Functor>* > threads;
+    for(unsigned int i=1; i<numThreads && i<numTasks; ++i)
+    {
+        TaskThread<Functor>* thread = new TaskThread<Functor>(functor, nextTask, numTasks);
+        threads.push_back(thread);
+        thread->start();
+    }
+
+    runTasks(functor, nextTask, numTasks);
+
+    for(typename std::vector< TaskThread<Functor>* >::iterator itr = threads.begin();
+        itr != threads.end();
+        ++itr)
+    {
+        (*itr)->join();
+        delete *itr;
+    }
+}
+
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // BuildKdTree Declarartion - class used for building an single KdTree
@@ -34,21 +111,88 @@ struct BuildKdTree
         _kdTree(kdTree) {}
 
     typedef std::vector< osg::Vec3 >            CenterList;
+    typedef std::vector< osg::BoundingBox >     BoundList;
     typedef std::vector< unsigned int >           Indices;
     typedef std::vector< unsigned int >         AxisStack;
 
+    /** Bound and index of a primitive, stored by value so the surface area heuristic build
+      * partitions the primitives themselves and so accesses them sequentially.*/
+    struct Primitive
+    {
+        Primitive(const osg::BoundingBox& bb, unsigned int index):
+            _bb(bb),
+            _index(index) {}
+
+        float center(int axis) const { return (_bb._min[axis]+_bb._max[axis])*0.5f; }
+
+        osg::BoundingBox    _bb;
+        unsigned int        _index;
+    };
+    typedef std::vector< Primitive >            PrimitiveList;
+
+    /** Subtree whose construction has been deferred so that it can be built in parallel with the others,
+      * into its own node list which is then merged into the KdTree.*/
+    struct SubTree
+    {
+        SubTree(int nodeIndex, unsigned int level):
+            _nodeIndex(nodeIndex),
+            _level(level) {}
+
+        int                 _nodeIndex;
+        unsigned int        _level;
+        KdTree::KdNodeList  _nodes;
+    };
+    typedef std::vector< SubTree > SubTreeList;
+
+    struct BuildSubTrees
+    {
+        BuildSubTrees(BuildKdTree& buildKdTree, const KdTree::BuildOptions& options, SubTreeList& subTrees):
+            _buildKdTree(buildKdTree),
+            _options(options),
+            _subTrees(subTrees) {}
+
+        void operator () (unsigned int i)
+        {
+            SubTree& subTree = _subTrees[i];
+            subTree._nodes.push_back(_buildKdTree._kdTree.getNode(subTree._nodeIndex));
+            _buildKdTree.divideSAH(_options, subTree._nodes, 0, subTree._level, 0, 0);
+        }
+
+        BuildKdTree&                    _buildKdTree;
+        const KdTree::BuildOptions&     _options;
+        SubTreeList&                    _subTrees;
+
+    protected:
+
+        BuildSubTrees& operator = (const BuildSubTrees&) { return *this; }
+    };
+
     bool build(KdTree::BuildOptions& options, osg::Geometry* geometry);
 
     void computeDivisions(KdTree::BuildOptions& options);
 
     int divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int nodeIndex, unsigned int level);
 
+    void buildSAH(const KdTree::BuildOptions& options);
+
+    int divideSAH(const KdTree::BuildOptions& options, KdTree::KdNodeList& nodes, int nodeIndex, unsigned int level, SubTreeList* subTrees, unsigned int subTreeMaximumNumPrimitives);
+
+    bool findSAHSplit(const KdTree::BuildOptions& options, int istart, int iend, int& splitAxis, float& splitMin, float& splitScale, unsigned int& splitBin);
+
+    void computeLeafBound(KdTree::KdNode& node) const;
+
+    void mergeSubTrees(SubTreeList& subTrees);
+
+    void compactVertexIndices();
+
     KdTree&             _kdTree;
 
     osg::BoundingBox    _bb;
     AxisStack           _axisStack;
     Indices             _primitiveIndices;
     CenterList          _centers;
+    BoundList           _bounds;
+    PrimitiveList       _primitives;
 
 protected:
 
@@ -74,6 +218,7 @@ struct PrimitiveIndicesCollector
 
         _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
         _buildKdTree->_centers.push_back(bb.center());
+        _buildKdTree->_bounds.push_back(bb);
     }
 
     inline void operator () (unsigned int p0, unsigned int p1)
@@ -98,6 +243,7 @@ struct PrimitiveIndicesCollector
 
         _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
         _buildKdTree->_centers.push_back(bb.center());
+        _buildKdTree->_bounds.push_back(bb);
     }
 
     inline void operator () (unsigned int p0, unsigned int p1, unsigned int p2)
@@ -125,6 +271,7 @@ struct PrimitiveIndicesCollector
 
         _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
         _buildKdTree->_centers.push_back(bb.center());
+        _buildKdTree->_bounds.push_back(bb);
     }
 
     inline void operator () (unsigned int p0, unsigned int p1, unsigned int p2, unsigned int p3)
@@ -154,6 +301,7 @@ struct PrimitiveIndicesCollector
 
         _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
         _buildKdTree->_centers.push_back(bb.center());
+        _buildKdTree->_bounds.push_back(bb);
     }
 
     BuildKdTree* _buildKdTree;
@@ -195,6 +343,7 @@ bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
     unsigned int estimatedNumTriangles = vertices->size()*2;
     _primitiveIndices.reserve(estimatedNumTriangles);
     _centers.reserve(estimatedNumTriangles);
+    _bounds.reserve(estimatedNumTriangles);
 
     osg::TemplatePrimitiveIndexFunctor<PrimitiveIndicesCollector> collectIndices;
     collectIndices._buildKdTree = this;
@@ -207,8 +356,15 @@ bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
 
     int nodeNum = _kdTree.addNode(node);
 
-    osg::BoundingBox bb = _bb;
-    nodeNum = divide(options, bb, nodeNum, 0);
+    if (options._splitMethod==KdTree::SURFACE_AREA_HEURISTIC_SPLIT)
+    {
+        buildSAH(options);
+    }
+    else
+    {
+        osg::BoundingBox bb = _bb;
+        nodeNum = divide(options, bb, nodeNum, 0);
+    }
 
     osg::KdTree::Indices& primitiveIndices = _kdTree.getPrimitiveIndices();
 
@@ -222,6 +378,8 @@ bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
     }
     primitiveIndices.swap(new_indices);
 
+    compactVertexIndices();
+
 
 #ifdef VERBOSE_OUTPUT
     OSG_NOTICE<<"Root nodeNum="<<nodeNum<<std::endl;
@@ -469,6 +627,368 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
 
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// BuildKdTree surface area heuristic implementation
+
+namespace
+{
+
+const unsigned int MAXIMUM_NUM_SAH_BINS = 64;
+
+inline float halfSurfaceArea(const osg::BoundingBox& bb)
+{
+    if (!bb.valid()) return 0.0f;
+
+    float dx = bb.xMax()-bb.xMin();
+    float dy = bb.yMax()-bb.yMin();
+    float dz = bb.zMax()-bb.zMin();
+    return dx*dy + dy*dz + dz*dx;
+}
+
+// expand bb by rhs, without the validity checks and branches of BoundingBox::expandBy().
+inline void expandBound(osg::BoundingBox& bb, const osg::BoundingBox& rhs)
+{
+    bb._min.set(osg::minimum(bb._min.x(), rhs._min.x()), osg::minimum(bb._min.y(), rhs._min.y()), osg::minimum(bb._min.z(), rhs._min.z()));
+    bb._max.set(osg::maximum(bb._max.x(), rhs._max.x()), osg::maximum(bb._max.y(), rhs._max.y()), osg::maximum(bb._max.z(), rhs._max.z()));
+}
+
+// small nodes use fewer bins, as there is little to gain from more bins than primitives.
+inline unsigned int computeNumBins(const KdTree::BuildOptions& options, int numPrimitives)
+{
+    return osg::clampBetween(osg::minimum(options._numSurfaceAreaHeuristicBins, static_cast<unsigned int>(numPrimitives)), 2u, MAXIMUM_NUM_SAH_BINS);
+}
+
+inline unsigned int computeBin(float value, float minValue, float scale, unsigned int numBins)
+{
+    unsigned int bin = static_cast<unsigned int>((value-minValue)*scale);
+    return bin<numBins ? bin : numBins-1;
+}
+
+struct LessEqualBin
+{
+    LessEqualBin(int axis, float minValue, float scale, unsigned int numBins, unsigned int bin):
+        _axis(axis),
+        _minValue(minValue),
+        _scale(scale),
+        _numBins(numBins),
+        _bin(bin) {}
+
+    bool operator () (const BuildKdTree::Primitive& primitive) const { return computeBin(primitive.center(_axis), _minValue, _scale, _numBins)<=_bin; }
+
+    int                             _axis;
+    float                           _minValue;
+    float                           _scale;
+    unsigned int                    _numBins;
+    unsigned int                    _bin;
+};
+
+}
+
+void BuildKdTree::buildSAH(const KdTree::BuildOptions& options)
+{
+    unsigned int numPrimitives = _primitiveIndices.size();
+    unsigned int numThreads = getNumBuildThreads(options);
+
+    _primitives.reserve(numPrimitives);
+    for(Indices::iterator itr = _primitiveIndices.begin();
+        itr != _primitiveIndices.end();
+        ++itr)
+    {
+        _primitives.push_back(Primitive(_bounds[*itr], *itr));
+    }
+    BoundList().swap(_bounds);
+
+    if (numThreads<=1 || numPrimitives<options._parallelBuildMinimumNumPrimitives)
+    {
+        divideSAH(options, _kdTree.getNodes(), 0, 0, 0, 0);
+    }
+    else
+    {
+        // split the top of the tree serially until there are enough subtrees to keep all the threads busy,
+        // then build the subtrees in parallel.
+        unsigned int subTreeMaximumNumPrimitives = osg::maximum(numPrimitives/(numThreads*8), options._targetNumTrianglesPerLeaf+1);
+
+        SubTreeList subTrees;
+        divideSAH(options, _kdTree.getNodes(), 0, 0, &subTrees, subTreeMaximumNumPrimitives);
+
+        BuildSubTrees buildSubTrees(*this, options, subTrees);
+        parallelFor(buildSubTrees, subTrees.size(), numThreads);
+
+        mergeSubTrees(subTrees);
+    }
+
+    for(unsigned int i=0; i<numPrimitives; ++i)
+    {
+        _primitiveIndices[i] = _primitives[i]._index;
+    }
+    PrimitiveList().swap(_primitives);
+}
+
+void BuildKdTree::computeLeafBound(KdTree::KdNode& node) const
+{
+    int istart = -node.first-1;
+    int iend = istart+node.second;
+
+    node.bb.init();
+    for(int i=istart; i<iend; ++i)
+    {
+        node.bb.expandBy(_primitives[i]._bb);
+    }
+
+    if (node.bb.valid())
+    {
+        float epsilon = 1e-6f;
+        node.bb._min.x() -= epsilon;
+        node.bb._min.y() -= epsilon;
+        node.bb._min.z() -= epsilon;
+        node.bb._max.x() += epsilon;
+        node.bb._max.y() += epsilon;
+        node.bb._max.z() += epsilon;
+    }
+}
+
+bool BuildKdTree::findSAHSplit(const KdTree::BuildOptions& options, int istart, int iend, int& splitAxis, float& splitMin, float& splitScale, unsigned int& splitBin)
+{
+    int numPrimitives = iend-istart;
+
+    osg::BoundingBox bb;
+    osg::BoundingBox centerBB;
+    for(int i=istart; i<iend; ++i)
+    {
+        const Primitive& primitive = _primitives[i];
+        osg::BoundingBox center(primitive.center(0), primitive.center(1), primitive.center(2),
+                                primitive.center(0), primitive.center(1), primitive.center(2));
+        expandBound(bb, primitive._bb);
+        expandBound(centerBB, center);
+    }
+
+    unsigned int numBins = computeNumBins(options, numPrimitives);
+
+    // bin the primitives along all three axes in a single pass over them.
+    osg::BoundingBox binBounds[3][MAXIMUM_NUM_SAH_BINS];
+    int binCounts[3][MAXIMUM_NUM_SAH_BINS];
+    float minValues[3];
+    float scales[3];
+
+    for(int axis=0; axis<3; ++axis)
+    {
+        minValues[axis] = centerBB._min[axis];
+        float extent = centerBB._max[axis]-minValues[axis];
+        scales[axis] = extent>0.0f ? float(numBins)/extent : 0.0f;
+
+        for(unsigned int b=0; b<numBins; ++b)
+        {
+            binBounds[axis][b].init();
+            binCounts[axis][b] = 0;
+        }
+    }
+
+    for(int i=istart; i<iend; ++i)
+    {
+        const Primitive& primitive = _primitives[i];
+        for(int axis=0; axis<3; ++axis)
+        {
+            unsigned int b = computeBin(primitive.center(axis), minValues[axis], scales[axis], numBins);
+            expandBound(binBounds[axis][b], primitive._bb);
+            ++binCounts[axis][b];
+        }
+    }
+
+    float rightCosts[MAXIMUM_NUM_SAH_BINS];
+    float bestCost = FLT_MAX;
+    splitAxis = -1;
+
+    for(int axis=0; axis<3; ++axis)
+    {
+        if (scales[axis]==0.0f) continue;
+
+        // sweep from the right to accumulate the cost of the right hand side of each candidate split,
+        // then from the left to find the split with the lowest combined cost.
+        osg::BoundingBox rightBB;
+        int rightCount = 0;
+        for(unsigned int b=numBins-1; b>0; --b)
+        {
+            expandBound(rightBB, binBounds[axis][b]);
+            rightCount += binCounts[axis][b];
+            rightCosts[b] = halfSurfaceArea(rightBB)*float(rightCount);
+        }
+
+        osg::BoundingBox leftBB;
+        int leftCount = 0;
+        for(unsigned int b=0; b<numBins-1; ++b)
+        {
+            expandBound(leftBB, binBounds[axis][b]);
+            leftCount += binCounts[axis][b];
+            if (leftCount==0 || leftCount==numPrimitives) continue;
+
+            float cost = halfSurfaceArea(leftBB)*float(leftCount) + rightCosts[b+1];
+            if (cost<bestCost)
+            {
+                bestCost = cost;
+                splitAxis = axis;
+                splitMin = minValues[axis];
+                splitScale = scales[axis];
+                splitBin = b;
+            }
+        }
+    }
+
+    if (splitAxis<0) return false;
+
+    // compare against the cost of intersecting all the primitives in a leaf, taking the cost of
+    // traversing a node as the same as intersecting a primitive, but never let leaves grow much
+    // beyond the target size.
+    if (numPrimitives<=static_cast<int>(options._targetNumTrianglesPerLeaf*4))
+    {
+        float area = halfSurfaceArea(bb);
+        if (area>0.0f && 1.0f+bestCost/area>=float(numPrimitives)) return false;
+    }
+
+    return true;
+}
+
+int BuildKdTree::divideSAH(const KdTree::BuildOptions& options, KdTree::KdNodeList& nodes, int nodeIndex, unsigned int level, SubTreeList* subTrees, unsigned int subTreeMaximumNumPrimitives)
+{
+    int istart = -nodes[nodeIndex].first-1;
+    int numPrimitives = nodes[nodeIndex].second;
+    int iend = istart+numPrimitives;
+
+    if (subTrees && static_cast<unsigned int>(numPrimitives)<=subTreeMaximumNumPrimitives)
+    {
+        // the bound of the subtree is the bound of its primitives so can be computed now for the parents to use.
+        computeLeafBound(nodes[nodeIndex]);
+        subTrees->push_back(SubTree(nodeIndex, level));
+        return nodeIndex;
+    }
+
+    int axis = -1;
+    float minValue = 0.0f;
+    float scale = 0.0f;
+    unsigned int bin = 0;
+
+    if (level>=options._maxNumLevels ||
+        static_cast<unsigned int>(numPrimitives)<=options._targetNumTrianglesPerLeaf ||
+        !findSAHSplit(options, istart, iend, axis, minValue, scale, bin))
+    {
+        computeLeafBound(nodes[nodeIndex]);
+        return nodeIndex;
+    }
+
+    unsigned int numBins = computeNumBins(options, numPrimitives);
+    PrimitiveList::iterator split = std::partition(_primitives.begin()+istart, _primitives.begin()+iend,
+                                                   LessEqualBin(axis, minValue, scale, numBins, bin));
+    int numLeft = static_cast<int>(split-_primitives.begin())-istart;
+
+    int leftChildIndex = static_cast<int>(nodes.size());
+    nodes.push_back(KdTree::KdNode(-istart-1, numLeft));
+
+    int rightChildIndex = static_cast<int>(nodes.size());
+    nodes.push_back(KdTree::KdNode(-(istart+numLeft)-1, numPrimitives-numLeft));
+
+    divideSAH(options, nodes, leftChildIndex, level+1, subTrees, subTreeMaximumNumPrimitives);
+    divideSAH(options, nodes, rightChildIndex, level+1, subTrees, subTreeMaximumNumPrimitives);
+
+    KdTree::KdNode& node = nodes[nodeIndex];
+    node.first = leftChildIndex;
+    node.second = rightChildIndex;
+    node.bb.init();
+    node.bb.expandBy(nodes[leftChildIndex].bb);
+    node.bb.expandBy(nodes[rightChildIndex].bb);
+
+    return nodeIndex;
+}
+
+void BuildKdTree::mergeSubTrees(SubTreeList& subTrees)
+{
+    KdTree::KdNodeList& nodes = _kdTree.getNodes();
+
+    for(SubTreeList::iterator itr = subTrees.begin();
+        itr != subTrees.end();
+        ++itr)
+    {
+        // the subtree's root replaces the node it was deferred from, the rest are appended.
+        int offset = static_cast<int>(nodes.size())-1;
+        for(KdTree::KdNodeList::iterator nitr = itr->_nodes.begin();
+            nitr != itr->_nodes.end();
+            ++nitr)
+        {
+            KdTree::KdNode node = *nitr;
+            if (node.first>0)
+            {
+                node.first += offset;
+                node.second += offset;
+            }
+
+            if (nitr==itr->_nodes.begin()) nodes[itr->_nodeIndex] = node;
+            else nodes.push_back(node);
+        }
+
+        KdTree::KdNodeList().swap(itr->_nodes);
+    }
+}
+
+void BuildKdTree::compactVertexIndices()
+{
+    // copy the vertex index data into leaf order, so each leaf's primitives are contiguous in memory,
+    // padding the start of a leaf when that reduces the number of cache lines it spans.
+    const unsigned int indicesPerCacheLine = 64/sizeof(unsigned int);
+
+    const KdTree::KdNodeList& nodes = _kdTree.getNodes();
+    KdTree::Indices& primitiveIndices = _kdTree.getPrimitiveIndices();
+    KdTree::Indices& vertexIndices = _kdTree.getVertexIndices();
+
+    if (nodes.empty()) return;
+
+    KdTree::Indices newVertexIndices;
+    newVertexIndices.reserve(vertexIndices.size()+vertexIndices.size()/4);
+
+    std::vector<int> nodeStack;
+    nodeStack.push_back(0);
+    while(!nodeStack.empty())
+    {
+        const KdTree::KdNode& node = nodes[nodeStack.back()];
+        nodeStack.pop_back();
+
+        if (node.first<0)
+        {
+            int istart = -node.first-1;
+            int iend = istart+node.second;
+
+            unsigned int leafSize = 0;
+            for(int i=istart; i<iend; ++i)
+            {
+                leafSize += 2+vertexIndices[primitiveIndices[i]+1];
+            }
+
+            unsigned int start = newVertexIndices.size();
+            unsigned int offset = start%indicesPerCacheLine;
+            unsigned int minimumNumCacheLines = (leafSize+indicesPerCacheLine-1)/indicesPerCacheLine;
+            unsigned int numCacheLines = (offset+leafSize+indicesPerCacheLine-1)/indicesPerCacheLine;
+            if (offset!=0 && numCacheLines>minimumNumCacheLines)
+            {
+                newVertexIndices.resize(start+indicesPerCacheLine-offset, 0);
+            }
+
+            for(int i=istart; i<iend; ++i)
+            {
+                unsigned int primitiveIndex = primitiveIndices[i];
+                unsigned int primitiveSize = 2+vertexIndices[primitiveIndex+1];
+
+                primitiveIndices[i] = newVertexIndices.size();
+                newVertexIndices.insert(newVertexIndices.end(), vertexIndices.begin()+primitiveIndex, vertexIndices.begin()+primitiveIndex+primitiveSize);
+            }
+        }
+        else
+        {
+            if (node.second>0) nodeStack.push_back(node.second);
+            if (node.first>0) nodeStack.push_back(node.first);
+        }
+    }
+
+    vertexIndices.swap(newVertexIndices);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // KdTree::BuildOptions
@@ -476,8 +996,14 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
 KdTree::BuildOptions::BuildOptions():
         _numVerticesProcessed(0),
         _targetNumTrianglesPerLeaf(4),
-        _maxNumLevels(32)
+        _maxNumLevels(32),
+        _splitMethod(SURFACE_AREA_HEURISTIC_SPLIT),
+        _numSurfaceAreaHeuristicBins(16),
+        _numThreads(0),
+        _parallelBuildMinimumNumPrimitives(32768)
 {
+    const char* ptr = getenv("OSG_KDTREE_BUILD_THREADS");
+    if (ptr) _numThreads = atoi(ptr);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -521,15 +1047,121 @@ KdTreeBuilder::KdTreeBuilder(const KdTreeBuilder& rhs):
 {
 }
 
+void KdTreeBuilder::apply(osg::Node& node)
+{
+    traverse(node);
+
+    if (getNodePath().size()<=1) buildKdTrees();
+}
+
 void KdTreeBuilder::apply(osg::Geometry& geometry)
 {
     osg::KdTree* previous = dynamic_cast<osg::KdTree*>(geometry.getShape());
     if (previous) return;
 
-    osg::ref_ptr<osg::KdTree> kdTree = osg::clone(_kdTreePrototype.get());
+    _geometryList.push_back(&geometry);
+
+    if (getNodePath().size()<=1) buildKdTrees();
+}
+
+namespace
+{
+
+struct BuildGeometryKdTrees
+{
+    typedef std::vector< osg::ref_ptr<osg::Geometry> > GeometryList;
+    typedef std::vector< osg::ref_ptr<osg::KdTree> > KdTreeList;
+
+    BuildGeometryKdTrees(const KdTree::BuildOptions& options, GeometryList& geometries, KdTreeList& kdTrees, const std::vector<unsigned int>& indices):
+        _geometries(geometries),
+        _kdTrees(kdTrees),
+        _indices(indices),
+        _numVerticesProcessed(indices.size(), 0),
+        _built(indices.size(), false)
+    {
+        // each KdTree is built using a single thread as the parallelism is across the Geometry
+        _options = options;
+        _options._numThreads = 1;
+    }
 
-    if (kdTree->build(_buildOptions, &geometry))
+    void operator () (unsigned int i)
     {
-        geometry.setShape(kdTree.get());
+        unsigned int index = _indices[i];
+
+        KdTree::BuildOptions options = _options;
+        options._numVerticesProcessed = 0;
+
+        _built[i] = _kdTrees[index]->build(options, _geometries[index].get());
+        _numVerticesProcessed[i] = options._numVerticesProcessed;
+    }
+
+    KdTree::BuildOptions                _options;
+    GeometryList&                       _geometries;
+    KdTreeList&                         _kdTrees;
+    const std::vector<unsigned int>&    _indices;
+    std::vector<unsigned int>           _numVerticesProcessed;
+    std::vector<unsigned char>          _built;
+
+protected:
+
+    BuildGeometryKdTrees& operator = (const BuildGeometryKdTrees&) { return *this; }
+};
+
+}
+
+void KdTreeBuilder::buildKdTrees()
+{
+    if (_geometryList.empty()) return;
+
+    GeometryList geometries;
+    geometries.swap(_geometryList);
+
+    // Geometry shared between several parents will have been collected more than once.
+    std::sort(geometries.begin(), geometries.end());
+    geometries.erase(std::unique(geometries.begin(), geometries.end()), geometries.end());
+
+    BuildGeometryKdTrees::KdTreeList kdTrees;
+    for(GeometryList::iterator itr = geometries.begin();
+        itr != geometries.end();
+        ++itr)
+    {
+        kdTrees.push_back(osg::clone(_kdTreePrototype.get()));
+    }
+
+    // large Geometry are built one at a time, each using all the threads, while the rest are built in parallel with each other.
+    unsigned int numThreads = getNumBuildThreads(_buildOptions);
+
+    std::vector<unsigned int> parallelIndices;
+    for(unsigned int i=0; i<geometries.size(); ++i)
+    {
+        osg::Geometry* geometry = geometries[i].get();
+        const osg::Array* vertices = geometry->getVertexArray();
+        if (numThreads<=1 || geometries.size()==1 || !vertices || vertices->getNumElements()>=_buildOptions._parallelBuildMinimumNumPrimitives)
+        {
+            if (kdTrees[i]->build(_buildOptions, geometry))
+            {
+                geometry->setShape(kdTrees[i].get());
+            }
+        }
+        else
+        {
+            parallelIndices.push_back(i);
+        }
+    }
+
+    if (parallelIndices.empty()) return;
+
+    BuildGeometryKdTrees buildGeometryKdTrees(_buildOptions, geometries, kdTrees, parallelIndices);
+    parallelFor(buildGeometryKdTrees, parallelIndices.size(), numThreads);
+
+    for(unsigned int i=0; i<parallelIndices.size(); ++i)
+    {
+        _buildOptions._numVerticesProcessed += buildGeometryKdTrees._numVerticesProcessed[i];
+
+        if (buildGeometryKdTrees._built[i])
+        {
+            unsigned int index = parallelIndices[i];
+            geometries[index]->setShape(kdTrees[index].get());
+        }
     }
 }
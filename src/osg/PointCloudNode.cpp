@@ -0,0 +1,189 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osg/PointCloudNode>
+#include <osg/CullStack>
+
+#include <OpenThreads/ScopedLock>
+
+#include <math.h>
+#include <queue>
+
+using namespace osg;
+
+PointCloudNode::PointCloudNode():
+    _numPoints(0),
+    _pointBudget(1000000),
+    _pointSpacing(2.0f),
+    _numPointsSelected(0)
+{
+}
+
+PointCloudNode::PointCloudNode(const PointCloudNode& node,const CopyOp& copyop):
+    PagedLOD(node,copyop),
+    _numPoints(node._numPoints),
+    _pointBudget(node._pointBudget),
+    _pointSpacing(node._pointSpacing),
+    _numPointsSelected(0)
+{
+}
+
+PointCloudNode::~PointCloudNode()
+{
+}
+
+// the distance in pixels between the points of the cell when spread over its projected bounding sphere.
+static float computeProjectedPointSpacing(const CullStack& cullStack, const PointCloudNode& cell)
+{
+    float pixelRadius = cullStack.clampedPixelSize(cell.getBound());
+    if (cullStack.getLODScale()>0.0f) pixelRadius /= cullStack.getLODScale();
+    return 2.0f*pixelRadius/sqrtf(static_cast<float>(osg::maximum(cell.getNumPoints(), 1u)));
+}
+
+void PointCloudNode::select(CullStack& cullStack, Selection& selection) const
+{
+    selection._cells.clear();
+    selection._refinements.clear();
+    selection._numPoints = 0;
+
+    // visit the cells coarsest projected point spacing first, so the budget goes to the cells that gain most detail.
+    typedef std::pair<float, const PointCloudNode*> PrioritizedCell;
+    std::priority_queue<PrioritizedCell> cells;
+    if (!cullStack.isCulled(getBound())) cells.push(PrioritizedCell(computeProjectedPointSpacing(cullStack, *this), this));
+
+    while(!cells.empty())
+    {
+        float spacing = cells.top().first;
+        const PointCloudNode* cell = cells.top().second;
+        cells.pop();
+
+        // the cell's own points are culled against their bound in the same way as the cull traversal will, as
+        // they may not fill the cell.
+        unsigned int numPoints = (cell->getNumChildren()>0 && !cullStack.isCulled(*cell->getChild(0))) ? cell->getNumPoints() : 0;
+
+        // a cell that doesn't fit in what is left of the budget is skipped, smaller cells may still fit.
+        if (numPoints>_pointBudget-selection._numPoints) continue;
+
+        selection._cells.insert(cell);
+        selection._numPoints += numPoints;
+
+        if (spacing<=_pointSpacing) continue;
+
+        if (cell->getNumChildren()>1)
+        {
+            selection._refinements[cell] = spacing;
+
+            const Group* childCells = cell->getChild(1)->asGroup();
+            for(unsigned int i=0; childCells && i<childCells->getNumChildren(); ++i)
+            {
+                const PointCloudNode* child = dynamic_cast<const PointCloudNode*>(childCells->getChild(i));
+                if (child && !cullStack.isCulled(child->getBound()))
+                {
+                    cells.push(PrioritizedCell(computeProjectedPointSpacing(cullStack, *child), child));
+                }
+            }
+        }
+        else if (cell->getNumFileNames()>1 && !cell->getFileName(1).empty() &&
+                 cell->getNumPoints()<=_pointBudget-selection._numPoints)
+        {
+            // only request the child cells when the budget has room for at least as many points as the cell.
+            selection._refinements[cell] = spacing;
+        }
+    }
+}
+
+const PointCloudNode::Selection* PointCloudNode::findSelection(NodeVisitor& nv) const
+{
+    // the selection is held by the topmost PointCloudNode above this node for the duration of its traversal.
+    const NodePath& nodePath = nv.getNodePath();
+    for(NodePath::const_iterator itr = nodePath.begin(); itr!=nodePath.end() && *itr!=this; ++itr)
+    {
+        const PointCloudNode* root = dynamic_cast<const PointCloudNode*>(*itr);
+        if (!root) continue;
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(root->_selectionsMutex);
+        Selections::const_iterator sitr = root->_selections.find(&nv);
+        if (sitr!=root->_selections.end()) return sitr->second;
+    }
+    return 0;
+}
+
+void PointCloudNode::traverseCells(NodeVisitor& nv, const Selection& selection)
+{
+    if (selection._cells.count(this)==0) return;
+
+    if (!_children.empty()) _children[0]->accept(nv);
+
+    Selection::Refinements::const_iterator itr = selection._refinements.find(this);
+    if (itr==selection._refinements.end()) return;
+
+    if (_children.size()>1)
+    {
+        if (nv.getFrameStamp())
+        {
+            _perRangeDataList[1]._timeStamp = nv.getFrameStamp()->getReferenceTime();
+            _perRangeDataList[1]._frameNumber = nv.getFrameStamp()->getFrameNumber();
+        }
+        _children[1]->accept(nv);
+    }
+    else if (!_disableExternalChildrenPaging &&
+             nv.getDatabaseRequestHandler() &&
+             _perRangeDataList.size()>1)
+    {
+        // request the child cells, the cells with the coarsest projected point spacing first.
+        PerRangeData& childCells = _perRangeDataList[1];
+        float priority = childCells._priorityOffset + itr->second * childCells._priorityScale;
+        nv.getDatabaseRequestHandler()->requestNodeFile(_databasePath+childCells._filename, nv.getNodePath(), priority, nv.getFrameStamp(), childCells._databaseRequest, _databaseOptions.get());
+    }
+}
+
+void PointCloudNode::traverse(NodeVisitor& nv)
+{
+    if (nv.getFrameStamp() &&
+        nv.getVisitorType()==osg::NodeVisitor::CULL_VISITOR)
+    {
+        setFrameNumberOfLastTraversal(nv.getFrameStamp()->getFrameNumber());
+    }
+
+    CullStack* cullStack = nv.getVisitorType()==osg::NodeVisitor::CULL_VISITOR ? nv.asCullStack() : 0;
+    if (!cullStack || nv.getTraversalMode()!=NodeVisitor::TRAVERSE_ACTIVE_CHILDREN)
+    {
+        // all the loaded cells hold distinct points, so other traversals visit all of them.
+        if (nv.getTraversalMode()!=NodeVisitor::TRAVERSE_NONE) Group::traverse(nv);
+        return;
+    }
+
+    const Selection* selection = findSelection(nv);
+    if (selection)
+    {
+        traverseCells(nv, *selection);
+        return;
+    }
+
+    // this is the topmost PointCloudNode, select the cells of the whole octree then traverse down to them.
+    Selection rootSelection;
+    select(*cullStack, rootSelection);
+    _numPointsSelected = rootSelection._numPoints;
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_selectionsMutex);
+        _selections[&nv] = &rootSelection;
+    }
+
+    traverseCells(nv, rootSelection);
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_selectionsMutex);
+        _selections.erase(&nv);
+    }
+}
@@ -14,6 +14,17 @@
 #include <osg/Polytope>
 #include <osg/Notify>
 
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define OSG_POLYTOPE_USE_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+    #include <emmintrin.h>
+    #define OSG_POLYTOPE_USE_SSE2
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__aarch64__)
+    #include <arm_neon.h>
+    #define OSG_POLYTOPE_USE_NEON
+#endif
+
 using namespace osg;
 
 bool Polytope::contains(const osg::Vec3f& v0, const osg::Vec3f& v1, const osg::Vec3f& v2) const
@@ -99,3 +110,258 @@ bool Polytope::contains(const osg::Vec3f& v0, const osg::Vec3f& v1, const osg::V
     //OSG_NOTICE<<"Polytope::contains() triangle within Polytope, src.size()="<<src.size()<<std::endl;
     return true;
 }
+
+#if defined(OSG_POLYTOPE_USE_AVX) || defined(OSG_POLYTOPE_USE_SSE2) || defined(OSG_POLYTOPE_USE_NEON)
+
+namespace
+{
+
+// Plane distances are computed in double precision and rounded to float before comparison,
+// matching Plane::distance(const Vec3f&), so the batched tests give the same results as the per volume tests.
+#if defined(OSG_POLYTOPE_USE_AVX)
+
+    const unsigned int NUM_LANES = 4;
+    typedef __m256d DoubleLanes;
+    typedef __m128 FloatLanes;
+
+    inline DoubleLanes loadLanes(const double* v) { return _mm256_loadu_pd(v); }
+    inline FloatLanes loadLanes(const float* v) { return _mm_loadu_ps(v); }
+    inline DoubleLanes splatLanes(double v) { return _mm256_set1_pd(v); }
+    inline FloatLanes zeroLanes() { return _mm_setzero_ps(); }
+    inline FloatLanes negateLanes(FloatLanes v) { return _mm_sub_ps(_mm_setzero_ps(), v); }
+
+    inline FloatLanes distanceLanes(const double* p, DoubleLanes x, DoubleLanes y, DoubleLanes z)
+    {
+        DoubleLanes d = _mm256_add_pd(_mm256_mul_pd(splatLanes(p[0]), x), _mm256_mul_pd(splatLanes(p[1]), y));
+        d = _mm256_add_pd(d, _mm256_mul_pd(splatLanes(p[2]), z));
+        d = _mm256_add_pd(d, splatLanes(p[3]));
+        return _mm256_cvtpd_ps(d);
+    }
+
+    inline unsigned int lessThanLanes(FloatLanes lhs, FloatLanes rhs) { return _mm_movemask_ps(_mm_cmplt_ps(lhs, rhs)); }
+    inline unsigned int greaterThanLanes(FloatLanes lhs, FloatLanes rhs) { return _mm_movemask_ps(_mm_cmpgt_ps(lhs, rhs)); }
+
+#elif defined(OSG_POLYTOPE_USE_SSE2)
+
+    const unsigned int NUM_LANES = 2;
+    typedef __m128d DoubleLanes;
+    typedef __m128 FloatLanes;
+
+    inline DoubleLanes loadLanes(const double* v) { return _mm_loadu_pd(v); }
+    inline FloatLanes loadLanes(const float* v) { return _mm_set_ps(0.0f, 0.0f, v[1], v[0]); }
+    inline DoubleLanes splatLanes(double v) { return _mm_set1_pd(v); }
+    inline FloatLanes zeroLanes() { return _mm_setzero_ps(); }
+    inline FloatLanes negateLanes(FloatLanes v) { return _mm_sub_ps(_mm_setzero_ps(), v); }
+
+    inline FloatLanes distanceLanes(const double* p, DoubleLanes x, DoubleLanes y, DoubleLanes z)
+    {
+        DoubleLanes d = _mm_add_pd(_mm_mul_pd(splatLanes(p[0]), x), _mm_mul_pd(splatLanes(p[1]), y));
+        d = _mm_add_pd(d, _mm_mul_pd(splatLanes(p[2]), z));
+        d = _mm_add_pd(d, splatLanes(p[3]));
+        return _mm_cvtpd_ps(d);
+    }
+
+    inline unsigned int lessThanLanes(FloatLanes lhs, FloatLanes rhs) { return _mm_movemask_ps(_mm_cmplt_ps(lhs, rhs)) & 0x3; }
+    inline unsigned int greaterThanLanes(FloatLanes lhs, FloatLanes rhs) { return _mm_movemask_ps(_mm_cmpgt_ps(lhs, rhs)) & 0x3; }
+
+#elif defined(OSG_POLYTOPE_USE_NEON)
+
+    const unsigned int NUM_LANES = 2;
+    typedef float64x2_t DoubleLanes;
+    typedef float32x2_t FloatLanes;
+
+    inline DoubleLanes loadLanes(const double* v) { return vld1q_f64(v); }
+    inline FloatLanes loadLanes(const float* v) { return vld1_f32(v); }
+    inline DoubleLanes splatLanes(double v) { return vdupq_n_f64(v); }
+    inline FloatLanes zeroLanes() { return vdup_n_f32(0.0f); }
+    inline FloatLanes negateLanes(FloatLanes v) { return vneg_f32(v); }
+
+    inline FloatLanes distanceLanes(const double* p, DoubleLanes x, DoubleLanes y, DoubleLanes z)
+    {
+        DoubleLanes d = vaddq_f64(vmulq_f64(splatLanes(p[0]), x), vmulq_f64(splatLanes(p[1]), y));
+        d = vaddq_f64(d, vmulq_f64(splatLanes(p[2]), z));
+        d = vaddq_f64(d, splatLanes(p[3]));
+        return vcvt_f32_f64(d);
+    }
+
+    inline unsigned int laneBits(uint32x2_t m) { return (vget_lane_u32(m, 0) & 0x1) | (vget_lane_u32(m, 1) & 0x2); }
+    inline unsigned int lessThanLanes(FloatLanes lhs, FloatLanes rhs) { return laneBits(vclt_f32(lhs, rhs)); }
+    inline unsigned int greaterThanLanes(FloatLanes lhs, FloatLanes rhs) { return laneBits(vcgt_f32(lhs, rhs)); }
+
+#endif
+
+// the kernels assume the default double precision Plane and single precision bounding volumes.
+const bool s_batchSpheresUsingLanes = sizeof(Plane::value_type)==sizeof(double) && sizeof(BoundingSphere::value_type)==sizeof(float);
+const bool s_batchBoxesUsingLanes = sizeof(Plane::value_type)==sizeof(double) && sizeof(BoundingBox::value_type)==sizeof(float);
+
+}
+
+#endif
+
+void Polytope::contains(const std::vector<BoundingSphere>& spheres, std::vector<bool>& contained, std::vector<ClippingMask>& resultMasks) const
+{
+    const ClippingMask mask = _maskStack.back();
+    const unsigned int numSpheres = spheres.size();
+    const unsigned int base = resultMasks.size();
+
+    // contains(bs) leaves the result mask untouched when no planes are active.
+    contained.resize(base+numSpheres, true);
+    resultMasks.resize(base+numSpheres, mask ? mask : _resultMask);
+
+    if (!mask) return;
+
+    unsigned int i = 0;
+
+#if defined(OSG_POLYTOPE_USE_AVX) || defined(OSG_POLYTOPE_USE_SSE2) || defined(OSG_POLYTOPE_USE_NEON)
+    if (s_batchSpheresUsingLanes)
+    {
+        for(; i+NUM_LANES<=numSpheres; i+=NUM_LANES)
+        {
+            double x[NUM_LANES], y[NUM_LANES], z[NUM_LANES];
+            float r[NUM_LANES];
+            for(unsigned int l=0; l<NUM_LANES; ++l)
+            {
+                const BoundingSphere& bs = spheres[i+l];
+                x[l] = bs.center().x();
+                y[l] = bs.center().y();
+                z[l] = bs.center().z();
+                r[l] = bs.radius();
+            }
+
+            DoubleLanes cx = loadLanes(x), cy = loadLanes(y), cz = loadLanes(z);
+            FloatLanes radius = loadLanes(r);
+            FloatLanes negativeRadius = negateLanes(radius);
+
+            unsigned int outside = 0;
+            ClippingMask selector_mask = 0x1;
+            for(PlaneList::const_iterator itr=_planeList.begin();
+                itr!=_planeList.end();
+                ++itr)
+            {
+                if (mask&selector_mask)
+                {
+                    FloatLanes d = distanceLanes(itr->ptr(), cx, cy, cz);
+                    outside |= lessThanLanes(d, negativeRadius);
+
+                    // subsequent checks against this plane not required for spheres entirely inside it.
+                    unsigned int inside = greaterThanLanes(d, radius);
+                    for(unsigned int l=0; inside; ++l, inside>>=1)
+                    {
+                        if (inside&1) resultMasks[base+i+l] ^= selector_mask;
+                    }
+                }
+                selector_mask <<= 1;
+            }
+
+            for(unsigned int l=0; outside; ++l, outside>>=1)
+            {
+                if (outside&1) contained[base+i+l] = false;
+            }
+        }
+    }
+#endif
+
+    for(; i<numSpheres; ++i)
+    {
+        const BoundingSphere& bs = spheres[i];
+        ClippingMask& resultMask = resultMasks[base+i];
+        ClippingMask selector_mask = 0x1;
+        for(PlaneList::const_iterator itr=_planeList.begin();
+            itr!=_planeList.end();
+            ++itr)
+        {
+            if (resultMask&selector_mask)
+            {
+                int res=itr->intersect(bs);
+                if (res<0) { contained[base+i] = false; break; } // outside clipping set.
+                else if (res>0) resultMask ^= selector_mask; // subsequent checks against this plane not required.
+            }
+            selector_mask <<= 1;
+        }
+    }
+}
+
+void Polytope::contains(const std::vector<BoundingBox>& boxes, std::vector<bool>& contained, std::vector<ClippingMask>& resultMasks) const
+{
+    const ClippingMask mask = _maskStack.back();
+    const unsigned int numBoxes = boxes.size();
+    const unsigned int base = resultMasks.size();
+
+    // contains(bb) leaves the result mask untouched when no planes are active.
+    contained.resize(base+numBoxes, true);
+    resultMasks.resize(base+numBoxes, mask ? mask : _resultMask);
+
+    if (!mask) return;
+
+    unsigned int i = 0;
+
+#if defined(OSG_POLYTOPE_USE_AVX) || defined(OSG_POLYTOPE_USE_SSE2) || defined(OSG_POLYTOPE_USE_NEON)
+    if (s_batchBoxesUsingLanes)
+    {
+        for(; i+NUM_LANES<=numBoxes; i+=NUM_LANES)
+        {
+            double minX[NUM_LANES], minY[NUM_LANES], minZ[NUM_LANES];
+            double maxX[NUM_LANES], maxY[NUM_LANES], maxZ[NUM_LANES];
+            for(unsigned int l=0; l<NUM_LANES; ++l)
+            {
+                const BoundingBox& bb = boxes[i+l];
+                minX[l] = bb.xMin(); minY[l] = bb.yMin(); minZ[l] = bb.zMin();
+                maxX[l] = bb.xMax(); maxY[l] = bb.yMax(); maxZ[l] = bb.zMax();
+            }
+
+            DoubleLanes bbMinX = loadLanes(minX), bbMinY = loadLanes(minY), bbMinZ = loadLanes(minZ);
+            DoubleLanes bbMaxX = loadLanes(maxX), bbMaxY = loadLanes(maxY), bbMaxZ = loadLanes(maxZ);
+            FloatLanes zero = zeroLanes();
+
+            unsigned int outside = 0;
+            ClippingMask selector_mask = 0x1;
+            for(PlaneList::const_iterator itr=_planeList.begin();
+                itr!=_planeList.end();
+                ++itr)
+            {
+                if (mask&selector_mask)
+                {
+                    // the upper corner is the one furthest along the plane normal, as per Plane::calculateUpperLowerBBCorners().
+                    const Plane::value_type* p = itr->ptr();
+                    FloatLanes d_lower = distanceLanes(p, p[0]>=0.0 ? bbMinX : bbMaxX, p[1]>=0.0 ? bbMinY : bbMaxY, p[2]>=0.0 ? bbMinZ : bbMaxZ);
+                    FloatLanes d_upper = distanceLanes(p, p[0]>=0.0 ? bbMaxX : bbMinX, p[1]>=0.0 ? bbMaxY : bbMinY, p[2]>=0.0 ? bbMaxZ : bbMinZ);
+
+                    // if lowest point above plane than all above, if highest point is below plane then all below.
+                    unsigned int inside = greaterThanLanes(d_lower, zero);
+                    outside |= lessThanLanes(d_upper, zero) & ~inside;
+
+                    for(unsigned int l=0; inside; ++l, inside>>=1)
+                    {
+                        if (inside&1) resultMasks[base+i+l] ^= selector_mask;
+                    }
+                }
+                selector_mask <<= 1;
+            }
+
+            for(unsigned int l=0; outside; ++l, outside>>=1)
+            {
+                if (outside&1) contained[base+i+l] = false;
+            }
+        }
+    }
+#endif
+
+    for(; i<numBoxes; ++i)
+    {
+        const BoundingBox& bb = boxes[i];
+        ClippingMask& resultMask = resultMasks[base+i];
+        ClippingMask selector_mask = 0x1;
+        for(PlaneList::const_iterator itr=_planeList.begin();
+            itr!=_planeList.end();
+            ++itr)
+        {
+            if (resultMask&selector_mask)
+            {
+                int res=itr->intersect(bb);
+                if (res<0) { contained[base+i] = false; break; } // outside clipping set.
+                else if (res>0) resultMask ^= selector_mask; // subsequent checks against this plane not required.
+            }
+            selector_mask <<= 1;
+        }
+    }
+}
@@ -13,6 +13,8 @@
 */
 
 #include <osgAnimation/Animation>
+#include <osgAnimation/AnimationCache>
+#include <osg/Notify>
 
 using namespace osgAnimation;
 
@@ -114,7 +116,7 @@ void Animation::setWeight (float weight)
     _weight = weight;
 }
 
-bool Animation::update (double time, int priority)
+bool Animation::computeLocalTime(double time, double& localTime)
 {
     if (!_duration) // if not initialized then do it
         computeDuration();
@@ -127,10 +129,7 @@ bool Animation::update (double time, int priority)
     case ONCE:
         if (t > _originalDuration)
         {
-            for (ChannelList::const_iterator chan = _channels.begin();
-                     chan != _channels.end(); ++chan)
-                (*chan)->update(_originalDuration, _weight, priority);
-
+            localTime = _originalDuration;
             return false;
         }
         break;
@@ -158,12 +157,69 @@ bool Animation::update (double time, int priority)
         break;
     }
 
+    localTime = t;
+    return true;
+}
+
+bool Animation::update (double time, int priority)
+{
+    double t;
+    bool playing = computeLocalTime(time, t);
+
     ChannelList::const_iterator chan;
     for( chan=_channels.begin(); chan!=_channels.end(); ++chan)
     {
         (*chan)->update(t, _weight, priority);
     }
-    return true;
+    return playing;
+}
+
+bool Animation::update (double time, int priority, AnimationCache* cache)
+{
+    if (!cache)
+        return update(time, priority);
+
+    double t;
+    bool playing = computeLocalTime(time, t);
+
+    // skip if weight == 0, as the channels do
+    if (_weight >= 1e-4)
+        applyPose(*cache->getPose(*this, t), priority);
+    return playing;
+}
+
+void Animation::samplePose(double localTime, Pose& pose) const
+{
+    pose._time = localTime;
+    pose._offsets.resize(_channels.size());
+
+    // store the values at multiples of 8 bytes so each is aligned for its type
+    unsigned int size = 0;
+    for (unsigned int i = 0; i < _channels.size(); ++i)
+    {
+        pose._offsets[i] = size;
+        size += (_channels[i]->getValueSize() + sizeof(double) - 1) / sizeof(double);
+    }
+    pose._values.resize(size);
+
+    for (unsigned int i = 0; i < _channels.size(); ++i)
+    {
+        _channels[i]->sampleValue(localTime, pose.getValue(i));
+    }
+}
+
+void Animation::applyPose(const Pose& pose, int priority)
+{
+    if (pose.getNumChannels() != _channels.size())
+    {
+        OSG_WARN << "Animation::applyPose(" << getName() << ") the pose has " << pose.getNumChannels() << " channels instead of " << _channels.size() << std::endl;
+        return;
+    }
+
+    for (unsigned int i = 0; i < _channels.size(); ++i)
+    {
+        _channels[i]->updateFromValue(pose.getValue(i), _weight, priority);
+    }
 }
 
 void Animation::resetTargets()
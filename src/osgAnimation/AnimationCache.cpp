@@ -0,0 +1,213 @@
+/*  -*-c++-*-
+ *  Copyright (C) 2008 Cedric Pinson <cedric.pinson@plopbyte.net>
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgAnimation/AnimationCache>
+#include <osgAnimation/Animation>
+#include <osg/Notify>
+#include <OpenThreads/ScopedLock>
+#include <math.h>
+
+using namespace osgAnimation;
+
+AnimationCache::AnimationCache():
+    _timeQuantum(1.0/120.0),
+    _frameTime(0.0),
+    _frameNumber(0),
+    _hits(0),
+    _misses(0),
+    _updateTime(0.0),
+    _totalHits(0),
+    _totalMisses(0)
+{
+    _stats = new osg::Stats("AnimationCache");
+}
+
+AnimationCache::~AnimationCache()
+{
+}
+
+void AnimationCache::setTimeQuantum(double quantum)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    _timeQuantum = quantum > 0.0 ? quantum : 0.0;
+    _entries.clear();
+}
+
+double AnimationCache::quantize(double time) const
+{
+    if (_timeQuantum <= 0.0)
+        return time;
+    return floor(time / _timeQuantum + 0.5) * _timeQuantum;
+}
+
+AnimationCache::AnimationEntry& AnimationCache::getOrCreateEntry(const Animation& animation)
+{
+    const ChannelList& channels = animation.getChannels();
+    _key.resize(channels.size());
+    for (unsigned int i = 0; i < channels.size(); ++i)
+    {
+        const Sampler* sampler = channels[i]->getSampler();
+        _key[i] = sampler ? sampler->getKeyframeContainer() : 0;
+    }
+
+    AnimationEntryMap::iterator itr = _entries.find(_key);
+    if (itr != _entries.end())
+        return itr->second;
+
+    AnimationEntry& entry = _entries[_key];
+    entry._keyframes.assign(_key.begin(), _key.end());
+    return entry;
+}
+
+Pose* AnimationCache::samplePose(const Animation& animation, double time)
+{
+    osg::ref_ptr<Pose> pose;
+    if (!_freePoses.empty())
+    {
+        pose = _freePoses.back();
+        _freePoses.pop_back();
+    }
+    else
+    {
+        pose = new Pose;
+    }
+    animation.samplePose(time, *pose);
+    return pose.release();
+}
+
+const Pose* AnimationCache::getPose(const Animation& animation, double localTime)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    double time = quantize(localTime);
+    AnimationEntry& entry = getOrCreateEntry(animation);
+    CachedPose& cached = entry._poses[time];
+    cached._lastUsedFrame = _frameNumber;
+    if (cached._pose.valid())
+    {
+        ++_hits;
+        ++_totalHits;
+    }
+    else
+    {
+        ++_misses;
+        ++_totalMisses;
+        cached._pose = samplePose(animation, time);
+    }
+    return cached._pose.get();
+}
+
+unsigned int AnimationCache::createPosePool(const Animation& animation)
+{
+    // the local time of an animation goes from 0 to the duration of its channels
+    double duration = animation.computeDurationFromChannels();
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    AnimationEntry& entry = getOrCreateEntry(animation);
+    entry._pinned = true;
+
+    if (_timeQuantum <= 0.0)
+    {
+        OSG_WARN << "AnimationCache::createPosePool(" << animation.getName() << ") requires a time quantum" << std::endl;
+        return entry._poses.size();
+    }
+
+    unsigned int numSteps = static_cast<unsigned int>(ceil(duration / _timeQuantum));
+    for (unsigned int i = 0; i <= numSteps; ++i)
+    {
+        double time = quantize(double(i) * _timeQuantum);
+        CachedPose& cached = entry._poses[time];
+        if (!cached._pose.valid())
+            cached._pose = samplePose(animation, time);
+    }
+    return entry._poses.size();
+}
+
+void AnimationCache::removePosePool(const Animation& animation)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    AnimationEntry& entry = getOrCreateEntry(animation);
+    entry._pinned = false;
+}
+
+void AnimationCache::clear()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    _entries.clear();
+    _freePoses.clear();
+}
+
+unsigned int AnimationCache::getNumPoses() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    unsigned int numPoses = 0;
+    for (AnimationEntryMap::const_iterator itr = _entries.begin(); itr != _entries.end(); ++itr)
+        numPoses += itr->second._poses.size();
+    return numPoses;
+}
+
+void AnimationCache::beginFrame(double time)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    if (time == _frameTime && (_hits || _misses))
+        return;
+
+    if (_hits || _misses)
+    {
+        _stats->setAttribute(_frameNumber, "Cache hit ratio", double(_hits) / double(_hits + _misses));
+        _stats->setAttribute(_frameNumber, "Cache hits", _hits);
+        _stats->setAttribute(_frameNumber, "Cache misses", _misses);
+        _stats->setAttribute(_frameNumber, "Update time", _updateTime * 1000.0);
+    }
+
+    // release the poses not used during the frame, recycling those not referenced elsewhere
+    for (AnimationEntryMap::iterator itr = _entries.begin(); itr != _entries.end(); )
+    {
+        AnimationEntry& entry = itr->second;
+        if (!entry._pinned)
+        {
+            for (PoseMap::iterator pitr = entry._poses.begin(); pitr != entry._poses.end(); )
+            {
+                if (pitr->second._lastUsedFrame != _frameNumber)
+                {
+                    if (pitr->second._pose->referenceCount() == 1)
+                        _freePoses.push_back(pitr->second._pose);
+                    entry._poses.erase(pitr++);
+                }
+                else
+                {
+                    ++pitr;
+                }
+            }
+        }
+
+        if (entry._poses.empty() && !entry._pinned)
+            _entries.erase(itr++);
+        else
+            ++itr;
+    }
+
+    ++_frameNumber;
+    _frameTime = time;
+    _hits = 0;
+    _misses = 0;
+    _updateTime = 0.0;
+}
+
+void AnimationCache::addUpdateTime(double seconds)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    _updateTime += seconds;
+}
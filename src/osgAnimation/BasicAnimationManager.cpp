@@ -14,6 +14,7 @@
 
 #include <osgAnimation/BasicAnimationManager>
 #include <osgAnimation/LinkVisitor>
+#include <osg/Timer>
 
 using namespace osgAnimation;
 
@@ -26,7 +27,8 @@ BasicAnimationManager::BasicAnimationManager(const BasicAnimationManager& b, con
     osg::Object(b, copyop),
     osg::Callback(b, copyop),
     AnimationManagerBase(b,copyop),
-    _lastUpdate(0.0)
+    _lastUpdate(0.0),
+    _animationCache(b._animationCache)
 {
 }
 
@@ -91,6 +93,13 @@ void BasicAnimationManager::update (double time)
 {
     _lastUpdate = time; // keep time of last update
 
+    osg::Timer_t startTick = 0;
+    if (_animationCache.valid())
+    {
+        _animationCache->beginFrame(time);
+        startTick = osg::Timer::instance()->tick();
+    }
+
     // could filtered with an active flag
     for (TargetSet::iterator it = _targets.begin(); it != _targets.end(); ++it)
         (*it).get()->reset();
@@ -104,7 +113,7 @@ void BasicAnimationManager::update (double time)
         AnimationList& list = iterAnim->second;
         for (unsigned int i = 0; i < list.size(); i++)
         {
-            if (! list[i]->update(time, priority))
+            if (! list[i]->update(time, priority, _animationCache.get()))
             {
                 // debug
                 // std::cout << list[i]->getName() << " finished at " << time << std::endl;
@@ -123,6 +132,9 @@ void BasicAnimationManager::update (double time)
             toremove.pop_back();
         }
     }
+
+    if (_animationCache.valid())
+        _animationCache->addUpdateTime(osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick()));
 }
 
 
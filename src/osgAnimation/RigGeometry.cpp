@@ -15,6 +15,10 @@
 #include <osgAnimation/VertexInfluence>
 #include <osgAnimation/RigGeometry>
 #include <osgAnimation/RigTransformSoftware>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
+#include <map>
 #include <sstream>
 
 using namespace osgAnimation;
@@ -164,3 +168,153 @@ void RigGeometry::copyFrom(osg::Geometry& from)
 
 
 
+
+// the ParallelUpdateRigGeometry whose subgraph each update traversal is traversing.
+typedef std::map<const osg::NodeVisitor*, ParallelUpdateRigGeometry*> ParallelUpdateTraversals;
+static OpenThreads::Mutex s_parallelUpdateTraversalsMutex;
+static ParallelUpdateTraversals s_parallelUpdateTraversals;
+static OpenThreads::Atomic s_numParallelUpdateTraversals;
+
+class ParallelUpdateRigGeometry::SkinningThread : public OpenThreads::Thread
+{
+public:
+    SkinningThread(ParallelUpdateRigGeometry* callback): _callback(callback) {}
+
+    virtual void run()
+    {
+        while(true)
+        {
+            _callback->_startBarrier.block(_callback->_numThreads);
+
+            if (_callback->_done) return;
+
+            _callback->updateRigGeometries();
+
+            _callback->_endBarrier.block(_callback->_numThreads);
+        }
+    }
+
+    ParallelUpdateRigGeometry* _callback;
+};
+
+ParallelUpdateRigGeometry::ParallelUpdateRigGeometry(unsigned int numThreads):
+    _numThreads(numThreads),
+    _done(false)
+{
+    if (_numThreads==0) _numThreads = osg::maximum(OpenThreads::GetNumberOfProcessors(), 1);
+}
+
+ParallelUpdateRigGeometry::ParallelUpdateRigGeometry(const ParallelUpdateRigGeometry& org, const osg::CopyOp& copyop):
+    osg::Object(org, copyop),
+    osg::Callback(org, copyop),
+    osg::NodeCallback(org, copyop),
+    _numThreads(org._numThreads),
+    _done(false)
+{
+}
+
+ParallelUpdateRigGeometry::~ParallelUpdateRigGeometry()
+{
+    stopThreads();
+}
+
+void ParallelUpdateRigGeometry::setNumThreads(unsigned int numThreads)
+{
+    stopThreads();
+    _numThreads = numThreads>0 ? numThreads : osg::maximum(OpenThreads::GetNumberOfProcessors(), 1);
+}
+
+void ParallelUpdateRigGeometry::startThreads()
+{
+    // the update thread skins too, so only the rest need threads.
+    _done = false;
+    for(unsigned int i=1; i<_numThreads; ++i)
+    {
+        SkinningThread* thread = new SkinningThread(this);
+        _threads.push_back(thread);
+        thread->start();
+    }
+}
+
+void ParallelUpdateRigGeometry::stopThreads()
+{
+    if (_threads.empty()) return;
+
+    _done = true;
+    _startBarrier.block(_numThreads);
+
+    for(Threads::iterator itr = _threads.begin();
+        itr != _threads.end();
+        ++itr)
+    {
+        (*itr)->join();
+        delete *itr;
+    }
+    _threads.clear();
+}
+
+void ParallelUpdateRigGeometry::operator()(osg::Node* node, osg::NodeVisitor* nv)
+{
+    bool nested = false;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_parallelUpdateTraversalsMutex);
+        // a ParallelUpdateRigGeometry above this one defers the RigGeometry of this subgraph too.
+        nested = s_parallelUpdateTraversals.find(nv)!=s_parallelUpdateTraversals.end();
+        if (!nested)
+        {
+            s_parallelUpdateTraversals[nv] = this;
+            ++s_numParallelUpdateTraversals;
+        }
+    }
+
+    traverse(node, nv);
+
+    if (nested) return;
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_parallelUpdateTraversalsMutex);
+        s_parallelUpdateTraversals.erase(nv);
+        --s_numParallelUpdateTraversals;
+    }
+
+    if (_rigGeometries.empty()) return;
+
+    _nextRigGeometry.exchange(0);
+    if (_numThreads>1 && _rigGeometries.size()>1)
+    {
+        if (_threads.empty()) startThreads();
+
+        _startBarrier.block(_numThreads);
+        updateRigGeometries();
+        _endBarrier.block(_numThreads);
+    }
+    else
+    {
+        updateRigGeometries();
+    }
+
+    _rigGeometries.clear();
+}
+
+void ParallelUpdateRigGeometry::updateRigGeometries()
+{
+    unsigned int numRigGeometries = _rigGeometries.size();
+    for(unsigned int i=(++_nextRigGeometry)-1; i<numRigGeometries; i=(++_nextRigGeometry)-1)
+    {
+        _rigGeometries[i]->update();
+    }
+}
+
+bool ParallelUpdateRigGeometry::defer(osg::NodeVisitor* nv, RigGeometry* geom)
+{
+    if (static_cast<unsigned int>(s_numParallelUpdateTraversals)==0) return false;
+
+    if (!dynamic_cast<RigTransformSoftware*>(geom->getRigTransformImplementation())) return false;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_parallelUpdateTraversalsMutex);
+    ParallelUpdateTraversals::iterator itr = s_parallelUpdateTraversals.find(nv);
+    if (itr==s_parallelUpdateTraversals.end()) return false;
+
+    itr->second->_rigGeometries.push_back(geom);
+    return true;
+}
@@ -20,10 +20,18 @@
 #include <osgAnimation/RigGeometry>
 
 #include <algorithm>
+#include <string.h>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+    #define OSGANIMATION_SKINNING_USE_SSE2
+#endif
 
 using namespace osgAnimation;
 
-RigTransformSoftware::RigTransformSoftware()
+RigTransformSoftware::RigTransformSoftware():
+    _positionSourceModifiedCount(0),
+    _normalSourceModifiedCount(0)
 {
     _needInit = true;
 }
@@ -31,7 +39,9 @@ RigTransformSoftware::RigTransformSoftware()
 RigTransformSoftware::RigTransformSoftware(const RigTransformSoftware& rts,const osg::CopyOp& copyop):
     RigTransform(rts, copyop),
     _needInit(rts._needInit),
-    _invalidInfluence(rts._invalidInfluence)
+    _invalidInfluence(rts._invalidInfluence),
+    _positionSourceModifiedCount(0),
+    _normalSourceModifiedCount(0)
 {
 
 }
@@ -133,6 +143,9 @@ bool RigTransformSoftware::prepareData(RigGeometry&rig)
     /// build minimal set of VertexGroup
     buildMinimumUpdateSet(rig);
 
+    /// the bones of the new vertex groups are found by init
+    _needInit = true;
+
     return true;
 }
 
@@ -203,6 +216,9 @@ bool RigTransformSoftware::init(RigGeometry&rig)
         itvg->normalize();
     }
 
+    _bones.assign(localid2bone.begin(), localid2bone.end());
+    buildSkinningGroups();
+
     _needInit = false;
 
     return true;
@@ -229,6 +245,158 @@ void RigTransformSoftware::VertexGroup::normalize()
     }
 }
 
+void RigTransformSoftware::buildSkinningGroups()
+{
+    _skinningGroups.clear();
+    _influenceBones.clear();
+    _influenceWeights.clear();
+    _blockVertices.clear();
+
+    for(VertexGroupList::iterator itvg = _uniqVertexGroupList.begin(); itvg != _uniqVertexGroupList.end(); ++itvg)
+    {
+        const IndexList& vertices = itvg->getVertices();
+        if (vertices.empty()) continue;
+
+        if (itvg->getBoneWeights().empty())
+        {
+            OSG_WARN << this << " RigTransformSoftware::VertexGroup no bones found, " << vertices.size() << " vertices are not skinned" << std::endl;
+        }
+
+        SkinningGroup group;
+        group._firstInfluence = _influenceBones.size();
+        group._numInfluences = itvg->getBoneWeights().size();
+        group._firstBlock = _blockVertices.size()/4;
+        group._numBlocks = (vertices.size()+3)/4;
+        _skinningGroups.push_back(group);
+
+        for(BonePtrWeightList::iterator bwit = itvg->getBoneWeights().begin(); bwit != itvg->getBoneWeights().end(); ++bwit)
+        {
+            _influenceBones.push_back(bwit->getBoneID());
+            _influenceWeights.push_back(bwit->getWeight());
+        }
+
+        _blockVertices.insert(_blockVertices.end(), vertices.begin(), vertices.end());
+        _blockVertices.resize(_blockVertices.size() + group._numBlocks*4 - vertices.size(), vertices.back());
+    }
+
+    // the source blocks need gathering again.
+    _positionSource = 0;
+    _normalSource = 0;
+}
+
+void RigTransformSoftware::updateSourceBlocks(const osg::Vec3Array& source, osg::ref_ptr<const osg::Array>& cachedSource, unsigned int& cachedModifiedCount, std::vector<float>& blocks)
+{
+    if (cachedSource.get()==&source && cachedModifiedCount==source.getModifiedCount()) return;
+
+    blocks.resize(_blockVertices.size()*3);
+    for(unsigned int block = 0; block < _blockVertices.size()/4; ++block)
+    {
+        float* blockValues = &blocks[block*12];
+        for(unsigned int i = 0; i < 4; ++i)
+        {
+            const osg::Vec3& v = source[_blockVertices[block*4+i]];
+            blockValues[i] = v.x();
+            blockValues[4+i] = v.y();
+            blockValues[8+i] = v.z();
+        }
+    }
+
+    cachedSource = &source;
+    cachedModifiedCount = source.getModifiedCount();
+}
+
+void RigTransformSoftware::computeBoneMatrices(const osg::Matrix& transform, const osg::Matrix& invTransform)
+{
+    // the blend of the bone matrices of a vertex group transformed from the skeleton to the geometry is
+    // transform * sum(weight * bone) * invTransform, whose translation adds that of invTransform once, so it is left
+    // out of the bone matrices and added to the blend instead.
+    _boneMatrices.resize(_bones.size()*12);
+    for(unsigned int b = 0; b < _bones.size(); ++b)
+    {
+        float* columns = &_boneMatrices[b*12];
+        const Bone* bone = _bones[b].get();
+        if (!bone)
+        {
+            OSG_WARN << this << " RigTransformSoftware::computeBoneMatrices Warning a bone is null, skip it" << std::endl;
+            memset(columns, 0, 12*sizeof(float));
+            continue;
+        }
+
+        osg::Matrix matrix = transform * (bone->getInvBindMatrixInSkeletonSpace() * bone->getMatrixInSkeletonSpace()) * invTransform;
+        for(unsigned int j = 0; j < 3; ++j)
+        {
+            for(unsigned int i = 0; i < 3; ++i) columns[j*4+i] = matrix(i,j);
+            columns[j*4+3] = matrix(3,j) - invTransform(3,j);
+        }
+    }
+
+    osg::Matrix identity = transform * invTransform;
+    for(unsigned int j = 0; j < 3; ++j)
+    {
+        for(unsigned int i = 0; i < 4; ++i)
+        {
+            _identity[j*4+i] = identity(i,j);
+            _translation[j*4+i] = (i==3) ? invTransform(3,j) : 0.0f;
+        }
+    }
+}
+
+namespace
+{
+
+// Transform the vertices of numBlocks blocks of four by the 3x4 matrix held by columns, out.x = x*matrix[0] +
+// y*matrix[1] + z*matrix[2] + matrix[3] and so on, without the translation for normals, scattering them to dst.
+template<bool Translate>
+void skinBlocks(const float* matrix, const float* blocks, const unsigned int* vertices, unsigned int numBlocks, osg::Vec3* dst)
+{
+#ifdef OSGANIMATION_SKINNING_USE_SSE2
+    const __m128 m00 = _mm_set1_ps(matrix[0]), m10 = _mm_set1_ps(matrix[1]), m20 = _mm_set1_ps(matrix[2]), m30 = _mm_set1_ps(matrix[3]);
+    const __m128 m01 = _mm_set1_ps(matrix[4]), m11 = _mm_set1_ps(matrix[5]), m21 = _mm_set1_ps(matrix[6]), m31 = _mm_set1_ps(matrix[7]);
+    const __m128 m02 = _mm_set1_ps(matrix[8]), m12 = _mm_set1_ps(matrix[9]), m22 = _mm_set1_ps(matrix[10]), m32 = _mm_set1_ps(matrix[11]);
+
+    float out[12];
+    for(unsigned int block = 0; block < numBlocks; ++block, blocks += 12, vertices += 4)
+    {
+        __m128 x = _mm_loadu_ps(blocks);
+        __m128 y = _mm_loadu_ps(blocks+4);
+        __m128 z = _mm_loadu_ps(blocks+8);
+
+        __m128 ox = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m00), _mm_mul_ps(y, m10)), _mm_mul_ps(z, m20));
+        __m128 oy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m01), _mm_mul_ps(y, m11)), _mm_mul_ps(z, m21));
+        __m128 oz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m02), _mm_mul_ps(y, m12)), _mm_mul_ps(z, m22));
+        if (Translate)
+        {
+            ox = _mm_add_ps(ox, m30);
+            oy = _mm_add_ps(oy, m31);
+            oz = _mm_add_ps(oz, m32);
+        }
+
+        _mm_storeu_ps(out, ox);
+        _mm_storeu_ps(out+4, oy);
+        _mm_storeu_ps(out+8, oz);
+        for(unsigned int i = 0; i < 4; ++i)
+        {
+            dst[vertices[i]].set(out[i], out[4+i], out[8+i]);
+        }
+    }
+#else
+    for(unsigned int block = 0; block < numBlocks; ++block, blocks += 12, vertices += 4)
+    {
+        for(unsigned int i = 0; i < 4; ++i)
+        {
+            float x = blocks[i], y = blocks[4+i], z = blocks[8+i];
+            osg::Vec3 v(x*matrix[0] + y*matrix[1] + z*matrix[2],
+                        x*matrix[4] + y*matrix[5] + z*matrix[6],
+                        x*matrix[8] + y*matrix[9] + z*matrix[10]);
+            if (Translate) v += osg::Vec3(matrix[3], matrix[7], matrix[11]);
+            dst[vertices[i]] = v;
+        }
+    }
+#endif
+}
+
+}
+
 void RigTransformSoftware::operator()(RigGeometry& geom)
 {
     if (_needInit && !init(geom)) return;
@@ -248,19 +416,60 @@ void RigTransformSoftware::operator()(RigGeometry& geom)
     osg::Vec3Array* normalDst = static_cast<osg::Vec3Array*>(destination.getNormalArray());
 
 
-    compute<osg::Vec3>(geom.getMatrixFromSkeletonToGeometry(),
-                       geom.getInvMatrixFromSkeletonToGeometry(),
-                       &positionSrc->front(),
-                       &positionDst->front());    
-    positionDst->dirty();
+    if (!positionDst || positionDst->size()!=positionSrc->size() || (normalSrc && (!normalDst || normalDst->size()!=normalSrc->size())))
+    {
+        OSG_WARN << this << " RigTransformSoftware destination arrays don't match the source geometry" << std::endl;
+        return;
+    }
+
+    updateSourceBlocks(*positionSrc, _positionSource, _positionSourceModifiedCount, _positionBlocks);
+    if (normalSrc) updateSourceBlocks(*normalSrc, _normalSource, _normalSourceModifiedCount, _normalBlocks);
 
-    if (normalSrc )
+    computeBoneMatrices(geom.getMatrixFromSkeletonToGeometry(), geom.getInvMatrixFromSkeletonToGeometry());
+
+    for(SkinningGroupList::const_iterator itr = _skinningGroups.begin(); itr != _skinningGroups.end(); ++itr)
     {
-        computeNormal<osg::Vec3>(geom.getMatrixFromSkeletonToGeometry(),
-                                 geom.getInvMatrixFromSkeletonToGeometry(),
-                                 &normalSrc->front(),
-                                 &normalDst->front());
-        normalDst->dirty();
+        const SkinningGroup& group = *itr;
+
+        // blend the bone matrices of the group.
+        float matrix[12];
+        if (group._numInfluences==0)
+        {
+            memcpy(matrix, _identity, sizeof(matrix));
+        }
+        else
+        {
+#ifdef OSGANIMATION_SKINNING_USE_SSE2
+            __m128 c0 = _mm_loadu_ps(_translation), c1 = _mm_loadu_ps(_translation+4), c2 = _mm_loadu_ps(_translation+8);
+            for(unsigned int i = group._firstInfluence; i < group._firstInfluence+group._numInfluences; ++i)
+            {
+                const float* columns = &_boneMatrices[_influenceBones[i]*12];
+                __m128 weight = _mm_set1_ps(_influenceWeights[i]);
+                c0 = _mm_add_ps(c0, _mm_mul_ps(weight, _mm_loadu_ps(columns)));
+                c1 = _mm_add_ps(c1, _mm_mul_ps(weight, _mm_loadu_ps(columns+4)));
+                c2 = _mm_add_ps(c2, _mm_mul_ps(weight, _mm_loadu_ps(columns+8)));
+            }
+            _mm_storeu_ps(matrix, c0);
+            _mm_storeu_ps(matrix+4, c1);
+            _mm_storeu_ps(matrix+8, c2);
+#else
+            memcpy(matrix, _translation, sizeof(matrix));
+            for(unsigned int i = group._firstInfluence; i < group._firstInfluence+group._numInfluences; ++i)
+            {
+                const float* columns = &_boneMatrices[_influenceBones[i]*12];
+                float weight = _influenceWeights[i];
+                for(unsigned int c = 0; c < 12; ++c) matrix[c] += weight*columns[c];
+            }
+#endif
+        }
+
+        skinBlocks<true>(matrix, &_positionBlocks[group._firstBlock*12], &_blockVertices[group._firstBlock*4], group._numBlocks, &positionDst->front());
+        if (normalSrc)
+        {
+            skinBlocks<false>(matrix, &_normalBlocks[group._firstBlock*12], &_blockVertices[group._firstBlock*4], group._numBlocks, &normalDst->front());
+        }
     }
 
+    positionDst->dirty();
+    if (normalSrc) normalDst->dirty();
 }
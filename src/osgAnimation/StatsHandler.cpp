@@ -28,11 +28,13 @@
 #include <osgViewer/ViewerEventHandlers>
 #include <osgViewer/Renderer>
 #include <osgAnimation/TimelineAnimationManager>
+#include <osgAnimation/BasicAnimationManager>
 
 #include <osg/PolygonMode>
 #include <osg/Geometry>
 #include <iostream>
 #include <cstdlib>
+#include <algorithm>
 
 static unsigned int getRandomValueinRange(unsigned int v)
 {
@@ -461,15 +463,22 @@ struct ValueTextDrawCallback : public virtual osg::Drawable::DrawCallback
 struct FindTimelineStats : public osg::NodeVisitor
 {
     std::vector<osg::ref_ptr<osgAnimation::Timeline> > _timelines;
+    std::vector<osg::ref_ptr<osgAnimation::AnimationCache> > _animationCaches;
 
     FindTimelineStats() : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN) {}
 
+    bool empty() const { return _timelines.empty() && _animationCaches.empty(); }
+
     void apply(osg::Node& node) {
         osg::Callback* cb = node.getUpdateCallback();
         while (cb) {
             osgAnimation::TimelineAnimationManager* tam = dynamic_cast<osgAnimation::TimelineAnimationManager*>(cb);
             if (tam)
                 _timelines.push_back(tam->getTimeline());
+            osgAnimation::BasicAnimationManager* bam = dynamic_cast<osgAnimation::BasicAnimationManager*>(cb);
+            if (bam && bam->getAnimationCache() &&
+                std::find(_animationCaches.begin(), _animationCaches.end(), bam->getAnimationCache()) == _animationCaches.end())
+                _animationCaches.push_back(bam->getAnimationCache());
             cb = cb->getNestedCallback();
         }
         traverse(node);
@@ -477,6 +486,75 @@ struct FindTimelineStats : public osg::NodeVisitor
 };
 
 
+// on screen stats of an AnimationCache shared by BasicAnimationManagers
+static osg::MatrixTransform* createStatsForAnimationCache(osgAnimation::AnimationCache* cache, float statsWidth, float statsHeight)
+{
+    std::string font("fonts/arial.ttf");
+
+    float leftPos = 10.0f;
+    float startBlocks = 150.0f;
+    float characterSize = 20.0f;
+    float backgroundMargin = 5;
+    float graphSpacing = 5;
+
+    osg::Vec4 backgroundColor(0.0, 0.0, 0.0f, 0.3);
+    osg::Vec4 color(1.0, 1.0, 1.0, 1.0);
+    osg::Vec4 graphColor(0.4, 1.0, 0.4, 1.0);
+
+    osg::Stats* stats = cache->getStats();
+
+    osg::MatrixTransform* group = new osg::MatrixTransform;
+    group->setDataVariance(osg::Object::DYNAMIC);
+
+    osg::Vec3 pos(leftPos, statsHeight-24.0f, 0.0f);
+    {
+        osg::Geode* geode = new osg::Geode;
+        geode->addDrawable(createBackgroundRectangle(
+            pos + osg::Vec3(-backgroundMargin, backgroundMargin, 0),
+            statsWidth - 2 * backgroundMargin,
+            3 * (characterSize + graphSpacing) + 2 * backgroundMargin,
+            backgroundColor));
+        group->addChild(geode);
+    }
+
+    pos.y() -= characterSize;
+
+    osg::Geode* geode = new osg::Geode;
+    group->addChild(geode);
+
+    const char* labels[] = { "Hit ratio: ", "Update ms: " };
+    const char* attributes[] = { "Cache hit ratio", "Update time" };
+    for (unsigned int i = 0; i < 2; ++i)
+    {
+        osg::ref_ptr<osgText::Text> label = new osgText::Text;
+        geode->addDrawable(label.get());
+        label->setColor(color);
+        label->setFont(font);
+        label->setCharacterSize(characterSize);
+        label->setPosition(pos);
+        label->setText(labels[i]);
+
+        osg::ref_ptr<osgText::Text> value = new osgText::Text;
+        geode->addDrawable(value.get());
+        value->setColor(color);
+        value->setFont(font);
+        value->setCharacterSize(characterSize);
+        value->setPosition(pos + osg::Vec3(startBlocks, 0, 0));
+        value->setText("0.0");
+        value->setDrawCallback(new ValueTextDrawCallback(stats, attributes[i]));
+
+        pos.y() -= characterSize + graphSpacing;
+    }
+
+    StatsGraph* graph = new StatsGraph(pos + osg::Vec3(startBlocks, characterSize, 0), statsWidth - 4 * backgroundMargin - startBlocks, characterSize);
+    graph->setCullingActive(false);
+    graph->addStatGraph(stats, stats, graphColor, 1.0, "Cache hit ratio");
+    group->addChild(graph);
+
+    return group;
+}
+
+
 StatsHandler::StatsHandler():
     _keyEventTogglesOnScreenStats('a'),
     _keyEventPrintsOutStats('A'),
@@ -516,7 +594,7 @@ bool StatsHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdap
                     if (!_switch.get()) {
                         FindTimelineStats finder;
                         viewer->getSceneData()->accept(finder);
-                        if (finder._timelines.empty())
+                        if (finder.empty())
                             return false;
                     }
 
@@ -578,6 +656,12 @@ bool StatsHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdap
                     }
 
                 }
+                for (unsigned int i = 0; i < finder._animationCaches.size(); i++) {
+                    osg::Stats* stats = finder._animationCaches[i]->getStats();
+                    OSG_NOTICE<<std::endl<<"Animation cache stats report:"<<std::endl;
+                    for(unsigned int f = stats->getEarliestFrameNumber(); f<= stats->getLatestFrameNumber(); ++f)
+                        stats->report(osg::notify(osg::NOTICE), f);
+                }
                 return true;
             }
         }
@@ -636,7 +720,7 @@ void StatsHandler::setUpScene(osgViewer::Viewer* viewer)
 
     FindTimelineStats finder;
     viewer->getSceneData()->accept(finder);
-    if (finder._timelines.empty())
+    if (finder.empty())
         return;
 
     _switch = new osg::Switch;
@@ -657,6 +741,12 @@ void StatsHandler::setUpScene(osgViewer::Viewer* viewer)
         m->setMatrix(osg::Matrix::translate(0, -i * 100, 0));
         _group->addChild(m);
     }
+
+    for (int i = 0; i < (int)finder._animationCaches.size(); i++) {
+        osg::MatrixTransform* m = createStatsForAnimationCache(finder._animationCaches[i].get(), _statsWidth, _statsHeight);
+        m->setMatrix(osg::Matrix::translate(0, -(int)(finder._timelines.size() + i) * 100, 0));
+        _group->addChild(m);
+    }
 }
 
 
@@ -16,7 +16,12 @@
 #include <osgDB/Registry>
 #include <osgDB/Registry>
 #include <osgDB/ObjectWrapper>
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Thread>
 #include <sstream>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
 
 using namespace osgDB;
 
@@ -48,6 +53,60 @@ public:
 
 REGISTER_COMPRESSOR( "null", NullCompressor )
 
+// Base class of the streambufs that decompress the data as the InputStream reads it, rather than decompressing the
+// whole stream up front. tellg() returns the position in the decompressed data, and seeking forward, as done to skip
+// objects of unknown classes, decompresses and discards the data in between. Seeking backward is only possible
+// within the data decompressed last.
+class DecompressionStreamBuf : public std::streambuf
+{
+public:
+    DecompressionStreamBuf() : _bufferPosition(0) {}
+
+protected:
+    /** Decompress the next data into _buffer, returning false at the end of the data or on an error.*/
+    virtual bool fillBuffer() = 0;
+
+    virtual int_type underflow()
+    {
+        if ( gptr()<egptr() ) return traits_type::to_int_type(*gptr());
+
+        _bufferPosition += static_cast<off_type>(egptr()-eback());
+        if ( !fillBuffer() || _buffer.empty() )
+        {
+            setg( 0, 0, 0 );
+            return traits_type::eof();
+        }
+
+        setg( &_buffer[0], &_buffer[0], &_buffer[0]+_buffer.size() );
+        return traits_type::to_int_type(*gptr());
+    }
+
+    virtual pos_type seekoff( off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which )
+    {
+        if ( dir==std::ios_base::cur ) off += _bufferPosition + static_cast<off_type>(gptr()-eback());
+        else if ( dir!=std::ios_base::beg ) return pos_type(off_type(-1));
+        return seekpos( pos_type(off), which );
+    }
+
+    virtual pos_type seekpos( pos_type pos, std::ios_base::openmode which )
+    {
+        off_type position = off_type(pos);
+        if ( !(which&std::ios_base::in) || position<_bufferPosition ) return pos_type(off_type(-1));
+
+        while ( position>_bufferPosition+static_cast<off_type>(egptr()-eback()) )
+        {
+            setg( eback(), egptr(), egptr() );
+            if ( traits_type::eq_int_type(underflow(), traits_type::eof()) ) return pos_type(off_type(-1));
+        }
+
+        setg( eback(), eback()+(position-_bufferPosition), egptr() );
+        return pos;
+    }
+
+    std::vector<char>   _buffer;
+    off_type            _bufferPosition;
+};
+
 #ifdef USE_ZLIB
 
 #include <zlib.h>
@@ -169,8 +228,477 @@ public:
         (void)inflateEnd( &strm );
         return ret==Z_STREAM_END ? true : false;
     }
+
+    virtual std::streambuf* createDecompressionStreamBuf( std::istream& fin, const osgDB::Options* /*options*/ )
+    {
+        ZLibDecompressionStreamBuf* streamBuf = new ZLibDecompressionStreamBuf( fin );
+        if ( streamBuf->valid() ) return streamBuf;
+
+        delete streamBuf;
+        return 0;
+    }
+
+protected:
+
+    // Inflates a CHUNK of the compressed data at a time as it is read.
+    class ZLibDecompressionStreamBuf : public DecompressionStreamBuf
+    {
+    public:
+        ZLibDecompressionStreamBuf( std::istream& fin ) : _fin(fin), _finished(false)
+        {
+            _strm.zalloc = Z_NULL;
+            _strm.zfree = Z_NULL;
+            _strm.opaque = Z_NULL;
+            _strm.avail_in = 0;
+            _strm.next_in = Z_NULL;
+            _valid = inflateInit2( &_strm, 15 + 32 )==Z_OK; // autodected zlib or gzip header
+        }
+
+        virtual ~ZLibDecompressionStreamBuf()
+        {
+            if ( _valid ) (void)inflateEnd( &_strm );
+        }
+
+        bool valid() const { return _valid; }
+
+    protected:
+        virtual bool fillBuffer()
+        {
+            if ( _finished ) return false;
+
+            _buffer.resize( CHUNK*4 );
+            _strm.avail_out = _buffer.size();
+            _strm.next_out = (Bytef*)&_buffer[0];
+
+            /* run inflate() until the buffer is full or the deflate stream ends */
+            while ( _strm.avail_out>0 )
+            {
+                if ( _strm.avail_in==0 )
+                {
+                    _fin.read( (char *)_in, CHUNK );
+                    _strm.avail_in = _fin.gcount();
+                    _strm.next_in = _in;
+                    if ( _strm.avail_in==0 ) break;
+                }
+
+                int ret = inflate( &_strm, Z_NO_FLUSH );
+                if ( ret==Z_STREAM_END ) { _finished = true; break; }
+                if ( ret!=Z_OK && ret!=Z_BUF_ERROR )
+                {
+                    OSG_WARN << "ZLibCompressor: Failed to inflate stream." << std::endl;
+                    _finished = true;
+                    _buffer.clear();
+                    return false;
+                }
+            }
+
+            _buffer.resize( _buffer.size()-_strm.avail_out );
+            if ( _buffer.empty() ) _finished = true;
+            return !_buffer.empty();
+        }
+
+        std::istream&   _fin;
+        z_stream        _strm;
+        unsigned char   _in[CHUNK];
+        bool            _valid;
+        bool            _finished;
+    };
 };
 
 REGISTER_COMPRESSOR( "zlib", ZLibCompressor )
 
 #endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  BlockCompressor
+//
+// Base class for compressors that split the stream into blocks compressed independently of each other. The
+// compressed data starts with the block size, the number of blocks and an index of the compressed and original
+// size of every block, so that the blocks can be located without decompressing those ahead of them and
+// compressed and decompressed in parallel. Blocks that don't compress are stored as they are, flagged by their
+// compressed size being equal to their original size.
+//
+// The writer's Options may set CompressionLevel=<level>, CompressionBlockSize=<bytes> and CompressionThreads=<num>,
+// and the reader's Options DecompressionThreads=<num>. The number of threads defaults to 1 as files are usually
+// read by several DatabasePager threads at once, 0 uses a thread per processor.
+class BlockCompressor : public BaseCompressor
+{
+public:
+    BlockCompressor( int defaultLevel ) : _defaultLevel(defaultLevel) {}
+
+    struct BlockInfo
+    {
+        unsigned int compressedSize;
+        unsigned int originalSize;
+    };
+
+    typedef std::vector<BlockInfo> BlockIndex;
+
+    /** Compress a block into dst, returning false if it fails or the compressed block would not be smaller.*/
+    virtual bool compressBlock( const char* src, unsigned int srcSize, std::string& dst, int level ) const = 0;
+
+    /** Decompress a block of compressed data into exactly dstSize bytes.*/
+    virtual bool decompressBlock( const char* src, unsigned int srcSize, char* dst, unsigned int dstSize ) const = 0;
+
+    virtual bool compress( std::ostream& fout, const std::string& src )
+    { return compress( fout, src, 0 ); }
+
+    virtual bool decompress( std::istream& fin, std::string& target )
+    { return decompress( fin, target, 0 ); }
+
+    virtual bool compress( std::ostream& fout, const std::string& src, const osgDB::Options* options )
+    {
+        int level = _defaultLevel;
+        unsigned int blockSize = 256*1024;
+        unsigned int numThreads = 1;
+        if ( options )
+        {
+            std::string value = options->getPluginStringData("CompressionLevel");
+            if ( !value.empty() ) level = atoi( value.c_str() );
+
+            value = options->getPluginStringData("CompressionBlockSize");
+            if ( !value.empty() && atoi(value.c_str())>0 ) blockSize = atoi( value.c_str() );
+
+            numThreads = getNumThreads( options, "CompressionThreads" );
+        }
+
+        unsigned int numBlocks = static_cast<unsigned int>( (src.size()+blockSize-1)/blockSize );
+
+        CompressBlocks operation( *this, src, blockSize, level, numBlocks );
+        if ( !applyToBlocks(operation, numBlocks, numThreads) ) return false;
+
+        fout.write( (char*)&blockSize, INT_SIZE );
+        fout.write( (char*)&numBlocks, INT_SIZE );
+        for ( unsigned int i=0; i<numBlocks; ++i )
+        {
+            unsigned int originalSize = operation.getOriginalSize(i);
+            unsigned int compressedSize = operation._compressed[i].empty() ? originalSize : static_cast<unsigned int>(operation._compressed[i].size());
+            fout.write( (char*)&compressedSize, INT_SIZE );
+            fout.write( (char*)&originalSize, INT_SIZE );
+        }
+
+        for ( unsigned int i=0; i<numBlocks; ++i )
+        {
+            if ( operation._compressed[i].empty() ) fout.write( src.data()+size_t(i)*blockSize, operation.getOriginalSize(i) );
+            else fout.write( operation._compressed[i].data(), operation._compressed[i].size() );
+        }
+        return !fout.fail();
+    }
+
+    virtual bool decompress( std::istream& fin, std::string& target, const osgDB::Options* options )
+    {
+        BlockIndex index;
+        if ( !readIndex(fin, index) ) return false;
+
+        size_t compressedSize = 0, originalSize = 0;
+        for ( BlockIndex::iterator itr=index.begin(); itr!=index.end(); ++itr )
+        {
+            compressedSize += itr->compressedSize;
+            originalSize += itr->originalSize;
+        }
+
+        std::string compressed;
+        compressed.resize( compressedSize );
+        if ( compressedSize>0 ) fin.read( &compressed[0], compressedSize );
+        if ( fin.fail() ) return false;
+
+        target.resize( originalSize );
+        if ( originalSize==0 ) return true;
+
+        DecompressBlocks operation( *this, index, compressed.data(), &target[0] );
+        return applyToBlocks( operation, static_cast<unsigned int>(index.size()), getNumThreads(options, "DecompressionThreads") );
+    }
+
+    virtual std::streambuf* createDecompressionStreamBuf( std::istream& fin, const osgDB::Options* options )
+    {
+        BlockIndex index;
+        if ( !readIndex(fin, index) ) return 0;
+        return new BlockDecompressionStreamBuf( *this, fin, index, getNumThreads(options, "DecompressionThreads") );
+    }
+
+    /** Read the block index that precedes the blocks.*/
+    static bool readIndex( std::istream& fin, BlockIndex& index )
+    {
+        unsigned int blockSize = 0, numBlocks = 0;
+        fin.read( (char*)&blockSize, INT_SIZE );
+        fin.read( (char*)&numBlocks, INT_SIZE );
+        if ( fin.fail() ) return false;
+
+        index.resize( numBlocks );
+        for ( unsigned int i=0; i<numBlocks; ++i )
+        {
+            fin.read( (char*)&(index[i].compressedSize), INT_SIZE );
+            fin.read( (char*)&(index[i].originalSize), INT_SIZE );
+            if ( fin.fail() || index[i].originalSize>blockSize || index[i].compressedSize>index[i].originalSize ) return false;
+        }
+        return true;
+    }
+
+    /** Decompress a block, or copy it if it was stored uncompressed.*/
+    bool readBlock( const char* src, const BlockInfo& info, char* dst ) const
+    {
+        if ( info.compressedSize==info.originalSize )
+        {
+            memcpy( dst, src, info.originalSize );
+            return true;
+        }
+        return decompressBlock( src, info.compressedSize, dst, info.originalSize );
+    }
+
+protected:
+
+    struct BlockOperation
+    {
+        virtual ~BlockOperation() {}
+        virtual bool apply( unsigned int block ) = 0;
+    };
+
+    struct CompressBlocks : public BlockOperation
+    {
+        CompressBlocks( const BlockCompressor& compressor, const std::string& src, unsigned int blockSize, int level, unsigned int numBlocks ) :
+            _compressor(compressor), _src(src), _blockSize(blockSize), _level(level), _compressed(numBlocks) {}
+
+        unsigned int getOriginalSize( unsigned int block ) const
+        {
+            size_t offset = size_t(block)*_blockSize;
+            return static_cast<unsigned int>( osg::minimum(size_t(_blockSize), _src.size()-offset) );
+        }
+
+        virtual bool apply( unsigned int block )
+        {
+            // blocks that don't compress are left empty and stored as they are.
+            if ( !_compressor.compressBlock(_src.data()+size_t(block)*_blockSize, getOriginalSize(block), _compressed[block], _level) )
+                _compressed[block].clear();
+            return true;
+        }
+
+        const BlockCompressor&      _compressor;
+        const std::string&          _src;
+        unsigned int                _blockSize;
+        int                         _level;
+        std::vector<std::string>    _compressed;
+    };
+
+    struct DecompressBlocks : public BlockOperation
+    {
+        DecompressBlocks( const BlockCompressor& compressor, const BlockIndex& index, const char* src, char* dst ) :
+            _compressor(compressor), _index(index)
+        {
+            size_t srcOffset = 0, dstOffset = 0;
+            for ( BlockIndex::const_iterator itr=index.begin(); itr!=index.end(); ++itr )
+            {
+                _src.push_back( src+srcOffset );
+                _dst.push_back( dst+dstOffset );
+                srcOffset += itr->compressedSize;
+                dstOffset += itr->originalSize;
+            }
+        }
+
+        virtual bool apply( unsigned int block )
+        { return _compressor.readBlock( _src[block], _index[block], _dst[block] ); }
+
+        const BlockCompressor&      _compressor;
+        const BlockIndex&           _index;
+        std::vector<const char*>    _src;
+        std::vector<char*>          _dst;
+    };
+
+    // Decompresses a block at a time as it is read, or as many blocks as there are threads to decompress them.
+    class BlockDecompressionStreamBuf : public DecompressionStreamBuf
+    {
+    public:
+        BlockDecompressionStreamBuf( const BlockCompressor& compressor, std::istream& fin, const BlockIndex& index, unsigned int numThreads ) :
+            _compressor(compressor), _fin(fin), _index(index), _nextBlock(0), _numThreads(numThreads) {}
+
+    protected:
+        virtual bool fillBuffer()
+        {
+            unsigned int lastBlock = osg::minimum( _nextBlock+_numThreads, static_cast<unsigned int>(_index.size()) );
+            if ( _nextBlock>=lastBlock ) return false;
+
+            BlockIndex blocks( _index.begin()+_nextBlock, _index.begin()+lastBlock );
+            _nextBlock = lastBlock;
+
+            size_t compressedSize = 0, originalSize = 0;
+            for ( BlockIndex::iterator itr=blocks.begin(); itr!=blocks.end(); ++itr )
+            {
+                compressedSize += itr->compressedSize;
+                originalSize += itr->originalSize;
+            }
+
+            _compressed.resize( compressedSize );
+            if ( compressedSize>0 ) _fin.read( &_compressed[0], compressedSize );
+            _buffer.resize( originalSize );
+            if ( _fin.fail() || originalSize==0 ) return false;
+
+            DecompressBlocks operation( _compressor, blocks, &_compressed[0], &_buffer[0] );
+            if ( applyToBlocks(operation, static_cast<unsigned int>(blocks.size()), _numThreads) ) return true;
+
+            OSG_WARN << "BlockCompressor: Failed to decompress block." << std::endl;
+            _nextBlock = static_cast<unsigned int>(_index.size());
+            return false;
+        }
+
+        const BlockCompressor&  _compressor;
+        std::istream&           _fin;
+        BlockIndex              _index;
+        unsigned int            _nextBlock;
+        unsigned int            _numThreads;
+        std::vector<char>       _compressed;
+    };
+
+    class BlockThread : public OpenThreads::Thread
+    {
+    public:
+        BlockThread( BlockOperation& operation, OpenThreads::Atomic& nextBlock, unsigned int numBlocks, OpenThreads::Atomic& numFailed ) :
+            _operation(operation), _nextBlock(nextBlock), _numBlocks(numBlocks), _numFailed(numFailed) {}
+
+        virtual void run()
+        {
+            for ( unsigned int block=(++_nextBlock)-1; block<_numBlocks; block=(++_nextBlock)-1 )
+            {
+                if ( !_operation.apply(block) ) ++_numFailed;
+            }
+        }
+
+        BlockOperation&         _operation;
+        OpenThreads::Atomic&    _nextBlock;
+        unsigned int            _numBlocks;
+        OpenThreads::Atomic&    _numFailed;
+    };
+
+    static unsigned int getNumThreads( const osgDB::Options* options, const std::string& name )
+    {
+        std::string value = options ? options->getPluginStringData(name) : std::string();
+        if ( value.empty() ) return 1;
+
+        int numThreads = atoi( value.c_str() );
+        if ( numThreads<=0 ) numThreads = OpenThreads::GetNumberOfProcessors();
+        return osg::maximum( numThreads, 1 );
+    }
+
+    static bool applyToBlocks( BlockOperation& operation, unsigned int numBlocks, unsigned int numThreads )
+    {
+        OpenThreads::Atomic nextBlock, numFailed;
+        numThreads = osg::minimum( numThreads, numBlocks );
+        if ( numThreads<=1 )
+        {
+            for ( unsigned int block=0; block<numBlocks; ++block )
+            {
+                if ( !operation.apply(block) ) return false;
+            }
+            return true;
+        }
+
+        // the calling thread works through the blocks along with the additional threads.
+        std::vector< BlockThread* > threads;
+        for ( unsigned int i=1; i<numThreads; ++i )
+        {
+            threads.push_back( new BlockThread(operation, nextBlock, numBlocks, numFailed) );
+            threads.back()->startThread();
+        }
+
+        BlockThread( operation, nextBlock, numBlocks, numFailed ).run();
+
+        for ( std::vector< BlockThread* >::iterator itr=threads.begin(); itr!=threads.end(); ++itr )
+        {
+            (*itr)->join();
+            delete *itr;
+        }
+        return numFailed==0;
+    }
+
+    int _defaultLevel;
+};
+
+#ifdef USE_ZLIB
+
+// ZLib block compressor
+class ZLibBlockCompressor : public BlockCompressor
+{
+public:
+    ZLibBlockCompressor() : BlockCompressor(6) {}
+
+    virtual bool compressBlock( const char* src, unsigned int srcSize, std::string& dst, int level ) const
+    {
+        uLongf dstSize = compressBound( srcSize );
+        dst.resize( dstSize );
+        if ( compress2((Bytef*)&dst[0], &dstSize, (const Bytef*)src, srcSize, osg::clampBetween(level, 0, 9))!=Z_OK || dstSize>=srcSize )
+            return false;
+
+        dst.resize( dstSize );
+        return true;
+    }
+
+    virtual bool decompressBlock( const char* src, unsigned int srcSize, char* dst, unsigned int dstSize ) const
+    {
+        uLongf size = dstSize;
+        return uncompress( (Bytef*)dst, &size, (const Bytef*)src, srcSize )==Z_OK && size==dstSize;
+    }
+};
+
+REGISTER_COMPRESSOR( "zlib-blocks", ZLibBlockCompressor )
+
+#endif
+
+#ifdef USE_ZSTD
+
+#include <zstd.h>
+
+// Zstandard block compressor
+class ZstdBlockCompressor : public BlockCompressor
+{
+public:
+    ZstdBlockCompressor() : BlockCompressor(3) {}
+
+    virtual bool compressBlock( const char* src, unsigned int srcSize, std::string& dst, int level ) const
+    {
+        dst.resize( ZSTD_compressBound(srcSize) );
+        size_t dstSize = ZSTD_compress( &dst[0], dst.size(), src, srcSize, level );
+        if ( ZSTD_isError(dstSize) || dstSize>=srcSize ) return false;
+
+        dst.resize( dstSize );
+        return true;
+    }
+
+    virtual bool decompressBlock( const char* src, unsigned int srcSize, char* dst, unsigned int dstSize ) const
+    {
+        size_t size = ZSTD_decompress( dst, dstSize, src, srcSize );
+        return !ZSTD_isError(size) && size==dstSize;
+    }
+};
+
+REGISTER_COMPRESSOR( "zstd", ZstdBlockCompressor )
+
+#endif
+
+#ifdef USE_LZ4
+
+#include <lz4.h>
+
+// LZ4 block compressor, levels above 1 use the LZ4 acceleration factor to trade ratio for speed.
+class LZ4BlockCompressor : public BlockCompressor
+{
+public:
+    LZ4BlockCompressor() : BlockCompressor(1) {}
+
+    virtual bool compressBlock( const char* src, unsigned int srcSize, std::string& dst, int level ) const
+    {
+        dst.resize( LZ4_compressBound(srcSize) );
+        int dstSize = LZ4_compress_fast( src, &dst[0], srcSize, static_cast<int>(dst.size()), osg::maximum(level, 1) );
+        if ( dstSize<=0 || static_cast<unsigned int>(dstSize)>=srcSize ) return false;
+
+        dst.resize( dstSize );
+        return true;
+    }
+
+    virtual bool decompressBlock( const char* src, unsigned int srcSize, char* dst, unsigned int dstSize ) const
+    {
+        return LZ4_decompress_safe( src, dst, srcSize, dstSize )==static_cast<int>(dstSize);
+    }
+};
+
+REGISTER_COMPRESSOR( "lz4", LZ4BlockCompressor )
+
+#endif
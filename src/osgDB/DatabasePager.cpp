@@ -16,13 +16,17 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
 #include <osgDB/Registry>
+#include <osgDB/fstream>
 
 #include <osg/Geode>
+#include <osg/Geometry>
 #include <osg/Timer>
 #include <osg/Texture>
 #include <osg/Notify>
 #include <osg/ProxyNode>
 #include <osg/ApplicationUsage>
+#include <osg/CullStack>
+#include <osg/Math>
 
 #include <OpenThreads/ScopedLock>
 
@@ -30,6 +34,7 @@
 #include <functional>
 #include <set>
 #include <iterator>
+#include <sstream>
 
 #include <stdlib.h>
 #include <string.h>
@@ -48,6 +53,8 @@ static osg::ApplicationUsageProxy DatabasePager_e3(osg::ApplicationUsage::ENVIRO
 static osg::ApplicationUsageProxy DatabasePager_e4(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_PRIORITY <mode>", "Set the thread priority to DEFAULT, MIN, LOW, NOMINAL, HIGH or MAX.");
 static osg::ApplicationUsageProxy DatabasePager_e11(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_MAX_PAGEDLOD <num>","Set the target maximum number of PagedLOD to maintain.");
 static osg::ApplicationUsageProxy DatabasePager_e12(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_ASSIGN_PBO_TO_IMAGES <ON/OFF>","Set whether PixelBufferObjects should be assigned to Images to aid download to the GPU.");
+static osg::ApplicationUsageProxy DatabasePager_e13(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_PREFETCH_TIME <seconds>","Set the time ahead of the camera that tiles are prefetched for, 0 disables prefetching.");
+static osg::ApplicationUsageProxy DatabasePager_e14(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_MEMORY_BUDGET <megabytes>","Set the target maximum memory used by the paged in subgraphs, 0 disables the memory budget.");
 
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -130,6 +137,133 @@ private:
     }
 };
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  EstimateResidentBytesVisitor
+//
+// Estimates the memory used by a loaded subgraph, counting each shared array, primitive set and texture once. The CPU bytes
+// are the vertex arrays, primitives and the images retained after being applied, the GPU bytes the buffer objects or display
+// lists compiled from the geometry and the textures, including their mipmaps.
+class EstimateResidentBytesVisitor : public osg::NodeVisitor
+{
+public:
+    EstimateResidentBytesVisitor():
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _cpuBytes(0.0),
+        _gpuBytes(0.0)
+    {
+    }
+
+    META_NodeVisitor("osgDB","EstimateResidentBytesVisitor")
+
+    virtual void apply(osg::Node& node)
+    {
+        if (node.getStateSet()) apply(*node.getStateSet());
+        traverse(node);
+    }
+
+    virtual void apply(osg::Drawable& drawable)
+    {
+        if (!_objects.insert(&drawable).second) return;
+
+        if (drawable.getStateSet()) apply(*drawable.getStateSet());
+
+        osg::Geometry* geometry = drawable.asGeometry();
+        if (!geometry) return;
+
+        double bytes = 0.0;
+
+        osg::Geometry::ArrayList arrays;
+        geometry->getArrayList(arrays);
+        for(osg::Geometry::ArrayList::iterator itr = arrays.begin();
+            itr != arrays.end();
+            ++itr)
+        {
+            if (_objects.insert(itr->get()).second) bytes += (*itr)->getTotalDataSize();
+        }
+
+        for(unsigned int i=0; i<geometry->getNumPrimitiveSets(); ++i)
+        {
+            osg::PrimitiveSet* primitiveSet = geometry->getPrimitiveSet(i);
+            if (primitiveSet && _objects.insert(primitiveSet).second) bytes += primitiveSet->getTotalDataSize();
+        }
+
+        _cpuBytes += bytes;
+        if (drawable.getUseVertexBufferObjects() || drawable.getUseDisplayList()) _gpuBytes += bytes;
+    }
+
+    void apply(osg::StateSet& stateset)
+    {
+        if (!_objects.insert(&stateset).second) return;
+
+        for(unsigned int i=0; i<stateset.getNumTextureAttributeLists(); ++i)
+        {
+            osg::Texture* texture = dynamic_cast<osg::Texture*>(stateset.getTextureAttribute(i, osg::StateAttribute::TEXTURE));
+            if (texture && _objects.insert(texture).second) apply(*texture);
+        }
+    }
+
+    void apply(osg::Texture& texture)
+    {
+        osg::Texture::FilterMode minFilter = texture.getFilter(osg::Texture::MIN_FILTER);
+        bool mipmapped = minFilter!=osg::Texture::LINEAR && minFilter!=osg::Texture::NEAREST;
+
+        if (texture.getNumImages()==0)
+        {
+            // render to texture, assume four bytes a texel.
+            _gpuBytes += 4.0*double(texture.getTextureWidth())*double(osg::maximum(texture.getTextureHeight(),1))*double(osg::maximum(texture.getTextureDepth(),1));
+            return;
+        }
+
+        for(unsigned int i=0; i<texture.getNumImages(); ++i)
+        {
+            osg::Image* image = texture.getImage(i);
+            if (!image) continue;
+
+            double imageBytes = image->getTotalSizeInBytesIncludingMipmaps();
+            double textureBytes = (mipmapped && !image->isMipmap()) ? imageBytes*4.0/3.0 : imageBytes;
+
+            if (!texture.getUnRefImageDataAfterApply() && _objects.insert(image).second) _cpuBytes += imageBytes;
+            _gpuBytes += textureBytes;
+        }
+    }
+
+    std::set<const osg::Object*>    _objects;
+    double                          _cpuBytes;
+    double                          _gpuBytes;
+};
+
+// Releases the estimated bytes of the merged subgraphs found in a removed subgraph.
+class DatabasePager::ReleaseResidentTilesVisitor : public osg::NodeVisitor
+{
+public:
+    ReleaseResidentTilesVisitor(DatabasePager* pager):
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _pager(pager)
+    {
+    }
+
+    META_NodeVisitor("osgDB","ReleaseResidentTilesVisitor")
+
+    virtual void apply(osg::Node& node)
+    {
+        release(&node);
+        traverse(node);
+    }
+
+    void release(const osg::Node* node)
+    {
+        DatabasePager::ResidentTileMap::iterator itr = _pager->_residentTiles.find(node);
+        if (itr==_pager->_residentTiles.end()) return;
+
+        _pager->_residentCPUBytes -= itr->second._cpuBytes;
+        _pager->_residentGPUBytes -= itr->second._gpuBytes;
+        _pager->_residentTiles.erase(itr);
+    }
+
+    DatabasePager* _pager;
+};
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 //  SetBasedPagedLODList
@@ -575,12 +709,297 @@ DatabasePager::ReadQueue::ReadQueue(DatabasePager* pager, const std::string& nam
     _block = new osg::RefBlock;
 }
 
+DatabasePager::ReadQueue::~ReadQueue()
+{
+    for(RequestHeap::iterator itr = _requestHeap.begin();
+        itr != _requestHeap.end();
+        ++itr)
+    {
+        itr->_request->_readQueue = 0;
+        invalidate(itr->_request.get());
+    }
+}
+
 void DatabasePager::ReadQueue::updateBlock()
 {
-    _block->set((!_requestList.empty() || !_childrenToDeleteList.empty()) &&
+    _block->set((!_requestHeap.empty() || !_childrenToDeleteList.empty()) &&
                 !_pager->_databasePagerThreadPaused);
 }
 
+bool DatabasePager::ReadQueue::higherPriority(const HeapEntry& lhs, const HeapEntry& rhs)
+{
+    // the priority passed to requestNodeFile(..) is the normalized screen space size, or the closeness to the eye point, of the
+    // tile computed by the PagedLOD/ProxyNode cull traversal, so order on it first and then on the most recently requested.
+    if (lhs._priority!=rhs._priority) return lhs._priority>rhs._priority;
+    if (lhs._frameNumber!=rhs._frameNumber) return static_cast<int>(lhs._frameNumber-rhs._frameNumber)>0;
+    return lhs._timestamp>rhs._timestamp;
+}
+
+void DatabasePager::ReadQueue::setKey(HeapEntry& entry)
+{
+    entry._frameNumber = entry._request->_frameNumberLastRequest;
+    entry._timestamp = entry._request->_timestampLastRequest;
+    entry._priority = entry._request->_priorityLastRequest;
+}
+
+void DatabasePager::ReadQueue::place(HeapEntry& entry, unsigned int index)
+{
+    HeapEntry& destination = _requestHeap[index];
+    if (&destination!=&entry) destination = entry;
+    destination._request->_readQueueIndex = index;
+}
+
+void DatabasePager::ReadQueue::siftUp(unsigned int index)
+{
+    HeapEntry entry = _requestHeap[index];
+    while(index>0)
+    {
+        unsigned int parent = (index-1)/2;
+        if (!higherPriority(entry, _requestHeap[parent])) break;
+        place(_requestHeap[parent], index);
+        index = parent;
+    }
+    place(entry, index);
+}
+
+void DatabasePager::ReadQueue::siftDown(unsigned int index)
+{
+    unsigned int size = _requestHeap.size();
+    HeapEntry entry = _requestHeap[index];
+    while(true)
+    {
+        unsigned int child = index*2+1;
+        if (child>=size) break;
+        if (child+1<size && higherPriority(_requestHeap[child+1], _requestHeap[child])) ++child;
+        if (!higherPriority(_requestHeap[child], entry)) break;
+        place(_requestHeap[child], index);
+        index = child;
+    }
+    place(entry, index);
+}
+
+void DatabasePager::ReadQueue::removeAt(unsigned int index)
+{
+    _requestHeap[index]._request->_readQueue = 0;
+
+    unsigned int last = _requestHeap.size()-1;
+    if (index!=last)
+    {
+        place(_requestHeap[last], index);
+        _requestHeap.pop_back();
+
+        if (index>0 && higherPriority(_requestHeap[index], _requestHeap[(index-1)/2])) siftUp(index);
+        else siftDown(index);
+    }
+    else
+    {
+        _requestHeap.pop_back();
+    }
+}
+
+void DatabasePager::ReadQueue::addNoLock(DatabasePager::DatabaseRequest* databaseRequest)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+
+    if (databaseRequest->_readQueue==this)
+    {
+        // already queued so just reflect any change in its priority.
+        unsigned int index = databaseRequest->_readQueueIndex;
+        setKey(_requestHeap[index]);
+        siftUp(index);
+        siftDown(databaseRequest->_readQueueIndex);
+        return;
+    }
+
+    HeapEntry entry;
+    entry._request = databaseRequest;
+    setKey(entry);
+
+    databaseRequest->_readQueue = this;
+    databaseRequest->_timeQueued = osg::Timer::instance()->tick();
+
+    _requestHeap.push_back(entry);
+    siftUp(_requestHeap.size()-1);
+
+    updateBlock();
+}
+
+void DatabasePager::ReadQueue::updatePriority(DatabasePager::DatabaseRequest* databaseRequest)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+
+    // the request may have been taken or moved to another queue since the caller checked.
+    if (databaseRequest->_readQueue!=this) return;
+
+    unsigned int index = databaseRequest->_readQueueIndex;
+    setKey(_requestHeap[index]);
+    siftUp(index);
+    siftDown(databaseRequest->_readQueueIndex);
+}
+
+void DatabasePager::ReadQueue::remove(DatabasePager::DatabaseRequest* databaseRequest)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+
+    if (databaseRequest->_readQueue!=this) return;
+
+    removeAt(databaseRequest->_readQueueIndex);
+
+    updateBlock();
+}
+
+void DatabasePager::ReadQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& databaseRequest)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+
+    int frameNumber = _pager->_frameNumber;
+
+    // requests that haven't been renewed are only cancelled once they reach the top of the heap, so pruning
+    // costs O(log n) per cancelled request rather than a sweep of the whole queue each frame.
+    while(!_requestHeap.empty())
+    {
+        osg::ref_ptr<DatabaseRequest> first = _requestHeap.front()._request;
+        removeAt(0);
+
+        if (first->isRequestCurrent(frameNumber))
+        {
+            double latency = osg::Timer::instance()->delta_m(first->_timeQueued, osg::Timer::instance()->tick());
+
+            unsigned int bucket = 0;
+            for(double bound = 1.0; bucket<NUM_LATENCY_BUCKETS-1 && latency>=bound; bound *= 2.0) ++bucket;
+
+            ++_stats._numTaken;
+            _stats._totalLatency += latency;
+            if (latency>_stats._maximumLatency) _stats._maximumLatency = latency;
+            ++_stats._latencyHistogram[bucket];
+
+            databaseRequest = first;
+            break;
+        }
+
+        OSG_INFO<<"DatabasePager::ReadQueue::takeFirst(): Pruning "<<first.get()<<std::endl;
+        invalidate(first.get());
+        ++_stats._numCancelled;
+    }
+
+    _frameNumberLastPruned = frameNumber;
+
+    updateBlock();
+}
+
+bool DatabasePager::ReadQueue::pruneOldRequestsAndCheckIfEmpty()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+
+    unsigned int frameNumber = _pager->_frameNumber;
+    if (_frameNumberLastPruned != frameNumber)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+
+        // compact the heap down to the current requests and then restore the heap ordering.
+        unsigned int numCurrent = 0;
+        for(unsigned int i=0; i<_requestHeap.size(); ++i)
+        {
+            HeapEntry& entry = _requestHeap[i];
+            if (entry._request->isRequestCurrent(frameNumber))
+            {
+                if (numCurrent!=i) _requestHeap[numCurrent] = entry;
+                ++numCurrent;
+            }
+            else
+            {
+                OSG_INFO<<"DatabasePager::ReadQueue::pruneOldRequestsAndCheckIfEmpty(): Pruning "<<entry._request.get()<<std::endl;
+                entry._request->_readQueue = 0;
+                invalidate(entry._request.get());
+                ++_stats._numCancelled;
+            }
+        }
+
+        if (numCurrent!=_requestHeap.size())
+        {
+            _requestHeap.resize(numCurrent);
+            for(unsigned int i=0; i<numCurrent; ++i) _requestHeap[i]._request->_readQueueIndex = i;
+            for(unsigned int i=numCurrent/2; i>0; --i) siftDown(i-1);
+        }
+
+        _frameNumberLastPruned = frameNumber;
+
+        updateBlock();
+    }
+
+    return _requestHeap.empty();
+}
+
+bool DatabasePager::ReadQueue::empty()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+    return _requestHeap.empty();
+}
+
+unsigned int DatabasePager::ReadQueue::size()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+    return _requestHeap.size();
+}
+
+void DatabasePager::ReadQueue::clear()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+
+    for(RequestHeap::iterator itr = _requestHeap.begin();
+        itr != _requestHeap.end();
+        ++itr)
+    {
+        itr->_request->_readQueue = 0;
+        invalidate(itr->_request.get());
+    }
+
+    _requestHeap.clear();
+
+    _frameNumberLastPruned = _pager->_frameNumber;
+
+    updateBlock();
+}
+
+void DatabasePager::ReadQueue::swap(RequestList& requestList)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+
+    RequestList previousRequests;
+    previousRequests.swap(requestList);
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+
+        // hand over the queued requests in priority order.
+        while(!_requestHeap.empty())
+        {
+            requestList.push_back(_requestHeap.front()._request);
+            removeAt(0);
+        }
+    }
+
+    for(RequestList::iterator itr = previousRequests.begin();
+        itr != previousRequests.end();
+        ++itr)
+    {
+        addNoLock(itr->get());
+    }
+
+    updateBlock();
+}
+
+void DatabasePager::ReadQueue::takeStats(QueueStats& stats)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+    stats = _stats;
+    _stats = QueueStats();
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 //  DatabaseThread
@@ -757,6 +1176,8 @@ void DatabasePager::DatabaseThread::run()
                     {
                         OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
                         databaseRequest->_loadedModel = modelFromCache;
+                        databaseRequest->_cpuBytes = 0.0;
+                        databaseRequest->_gpuBytes = 0.0;
                     }
 
                     // move the request to the dataToMerge list so it can be merged during the update phase of the frame.
@@ -915,11 +1336,16 @@ void DatabasePager::DatabaseThread::run()
                     OSG_NOTICE<<"Loaded from ObjectCache"<<std::endl;
                 }
 
+                // estimate the memory the subgraph will use once merged, models shared with the ObjectCache are not counted.
+                EstimateResidentBytesVisitor estimateResidentBytes;
+                if (!rr.loadedFromCache()) loadedModel->accept(estimateResidentBytes);
 
                 {
                     OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
                     databaseRequest->_loadedModel = loadedModel;
                     databaseRequest->_compileSet = compileSet;
+                    databaseRequest->_cpuBytes = estimateResidentBytes._cpuBytes;
+                    databaseRequest->_gpuBytes = estimateResidentBytes._gpuBytes;
                 }
                 // Dereference the databaseRequest while the queue is
                 // locked. This prevents the request from being
@@ -1047,6 +1473,27 @@ DatabasePager::DatabasePager()
                         strcmp(str,"on")==0 || strcmp(str,"ON")==0;
     }
 
+    _prefetchTime = 0.0;
+    if( (str = getenv("OSG_DATABASE_PAGER_PREFETCH_TIME")) != 0)
+    {
+        _prefetchTime = osg::asciiToDouble(str);
+        OSG_NOTICE<<"_prefetchTime = "<<_prefetchTime<<std::endl;
+    }
+
+    _targetMaximumResidentBytes = 0.0;
+    if( (str = getenv("OSG_DATABASE_PAGER_MEMORY_BUDGET")) != 0)
+    {
+        _targetMaximumResidentBytes = osg::asciiToDouble(str)*1024.0*1024.0;
+        OSG_NOTICE<<"_targetMaximumResidentBytes = "<<_targetMaximumResidentBytes<<std::endl;
+    }
+    _residentCPUBytes = 0.0;
+    _residentGPUBytes = 0.0;
+
+    _prefetchMaximumBytesInFlight = 16*1024*1024;
+    _prefetchEyeValid = false;
+    _prefetchEyeTime = 0.0;
+    _prefetchBytesInFlight = 0;
+
     // initialize the stats variables
     resetStats();
 
@@ -1122,6 +1569,17 @@ DatabasePager::DatabasePager(const DatabasePager& rhs)
 
     _doPreCompile = rhs._doPreCompile;
 
+    _prefetchTime = rhs._prefetchTime;
+    _prefetchMaximumBytesInFlight = rhs._prefetchMaximumBytesInFlight;
+    _prefetchAnimationPath = rhs._prefetchAnimationPath;
+    _prefetchEyeValid = false;
+    _prefetchEyeTime = 0.0;
+    _prefetchBytesInFlight = 0;
+
+    _targetMaximumResidentBytes = rhs._targetMaximumResidentBytes;
+    _residentCPUBytes = 0.0;
+    _residentGPUBytes = 0.0;
+
     _fileRequestQueue = new ReadQueue(this,"fileRequestQueue");
     _httpRequestQueue = new ReadQueue(this,"httpRequestQueue");
 
@@ -1319,6 +1777,15 @@ void DatabasePager::clear()
     // note, no need to use a mutex as the list is only accessed from the update thread.
     _activePagedLODList->clear();
 
+    _prefetchRequestList.clear();
+    _prefetchedTileList.clear();
+    _prefetchBytesInFlight = 0;
+    _prefetchEyeValid = false;
+
+    _residentTiles.clear();
+    _residentCPUBytes = 0.0;
+    _residentGPUBytes = 0.0;
+
     // ??
     // _activeGraphicsContexts
 }
@@ -1330,6 +1797,12 @@ void DatabasePager::resetStats()
     _maximumTimeToMergeTile = -DBL_MAX;
     _totalTimeToMergeTiles = 0.0;
     _numTilesMerges = 0;
+
+    _numPrefetchRequests = 0;
+    _numPrefetchHits.exchange(0);
+    _numPrefetchWasted = 0;
+
+    _numMemoryBudgetExpiries = 0;
 }
 
 bool DatabasePager::getRequestsInProgress() const
@@ -1350,10 +1823,32 @@ bool DatabasePager::getRequestsInProgress() const
 }
 
 
+// estimate of the size of the files that can't be found locally, such as those read over http.
+static const unsigned int s_defaultPrefetchFileSize = 256*1024;
+
+static unsigned int estimateFileSize(const std::string& fileName, const osgDB::Options* options)
+{
+    std::string foundFileName = osgDB::findDataFile(fileName, options);
+    if (foundFileName.empty()) return s_defaultPrefetchFileSize;
+
+    osgDB::ifstream fin(foundFileName.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    if (!fin) return s_defaultPrefetchFileSize;
+
+    return static_cast<unsigned int>(fin.tellg());
+}
+
 void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath& nodePath,
                                     float priority, const osg::FrameStamp* framestamp,
                                     osg::ref_ptr<osg::Referenced>& databaseRequestRef,
                                     const osg::Referenced* options)
+{
+    requestNodeFile(fileName, nodePath, priority, framestamp, databaseRequestRef, options, false);
+}
+
+void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath& nodePath,
+                                    float priority, const osg::FrameStamp* framestamp,
+                                    osg::ref_ptr<osg::Referenced>& databaseRequestRef,
+                                    const osg::Referenced* options, bool prefetch)
 {
     osgDB::Options* loadOptions = dynamic_cast<osgDB::Options*>(const_cast<osg::Referenced*>(options));
     if (!loadOptions)
@@ -1415,6 +1910,7 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
     {
         DatabaseRequest* databaseRequest = dynamic_cast<DatabaseRequest*>(databaseRequestRef.get());
         bool requeue = false;
+        ReadQueue* readQueue = 0;
         if (databaseRequest)
         {
             OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_dr_mutex);
@@ -1423,10 +1919,24 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
                 OSG_INFO<<"DatabaseRequest has been previously invalidated whilst still attached to scene graph."<<std::endl;
                 databaseRequest = 0;
             }
+            else if (prefetch && !databaseRequest->_prefetch)
+            {
+                // leave the cull traversal's request at the priority it assigned.
+                return;
+            }
             else
             {
                 OSG_INFO<<"DatabasePager::requestNodeFile("<<fileName<<") updating already assigned."<<std::endl;
 
+                if (!prefetch && databaseRequest->_prefetch)
+                {
+                    // the cull traversal has caught up with a prefetched tile that is still in flight.
+                    databaseRequest->_prefetch = false;
+                    ++_numPrefetchHits;
+                }
+
+                // only a change of priority moves a queued request within its read queue's heap.
+                if (databaseRequest->_priorityLastRequest!=priority) readQueue = databaseRequest->_readQueue;
 
                 databaseRequest->_valid = true;
                 databaseRequest->_frameNumberLastRequest = frameNumber;
@@ -1453,13 +1963,27 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
             }
         }
         if (requeue)
+        {
             _fileRequestQueue->add(databaseRequest);
+        }
+        else if (readQueue)
+        {
+            readQueue->updatePriority(databaseRequest);
+        }
     }
 
     if (!foundEntry)
     {
         OSG_INFO<<"In DatabasePager::requestNodeFile("<<fileName<<")"<<std::endl;
 
+        unsigned int prefetchBytes = 0;
+        if (prefetch)
+        {
+            if (_prefetchBytesInFlight>=_prefetchMaximumBytesInFlight) return;
+
+            prefetchBytes = estimateFileSize(fileName, loadOptions);
+        }
+
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_fileRequestQueue->_requestMutex);
 
         if (!databaseRequestRef.valid() || databaseRequestRef->referenceCount()==1)
@@ -1481,6 +2005,16 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
             databaseRequest->_loadOptions = loadOptions;
             databaseRequest->_objectCache = 0;
 
+            if (prefetch)
+            {
+                databaseRequest->_prefetch = true;
+                databaseRequest->_prefetchBytes = prefetchBytes;
+
+                _prefetchBytesInFlight += prefetchBytes;
+                ++_numPrefetchRequests;
+                _prefetchRequestList.push_back(databaseRequest.get());
+            }
+
             _fileRequestQueue->addNoLock(databaseRequest.get());
         }
     }
@@ -1583,6 +2117,9 @@ void DatabasePager::updateSceneGraph(const osg::FrameStamp& frameStamp)
         timeFor_addLoadedDataToSceneGraph = timer.elapsedTime_m() - timeFor_removeExpiredSubgraphs;
 #endif
 
+        updatePrefetchStats(frameStamp);
+
+        recordStats(frameStamp);
     }
 
 #if UPDATE_TIMING
@@ -1599,6 +2136,114 @@ void DatabasePager::updateSceneGraph(const osg::FrameStamp& frameStamp)
 #endif
 }
 
+void DatabasePager::recordStats(const osg::FrameStamp &frameStamp)
+{
+    if (!_stats.valid() || !_stats->collectStats("database_pager")) return;
+
+    unsigned int frameNumber = frameStamp.getFrameNumber();
+
+    ReadQueue* queues[] = { _fileRequestQueue.get(), _httpRequestQueue.get() };
+    for(unsigned int q=0; q<2; ++q)
+    {
+        ReadQueue* queue = queues[q];
+
+        ReadQueue::QueueStats queueStats;
+        queue->takeStats(queueStats);
+
+        const std::string& name = queue->_name;
+        _stats->setAttribute(frameNumber, name+" size", queue->size());
+        _stats->setAttribute(frameNumber, name+" taken", queueStats._numTaken);
+        _stats->setAttribute(frameNumber, name+" cancelled", queueStats._numCancelled);
+        _stats->setAttribute(frameNumber, name+" latency average", queueStats._numTaken>0 ? queueStats._totalLatency/static_cast<double>(queueStats._numTaken) : 0.0);
+        _stats->setAttribute(frameNumber, name+" latency maximum", queueStats._maximumLatency);
+
+        unsigned int bound = 1;
+        for(unsigned int i=0; i<ReadQueue::NUM_LATENCY_BUCKETS; ++i, bound *= 2)
+        {
+            std::ostringstream attributeName;
+            if (i<ReadQueue::NUM_LATENCY_BUCKETS-1) attributeName<<name<<" latency <"<<bound<<"ms";
+            else attributeName<<name<<" latency >="<<bound/2<<"ms";
+            _stats->setAttribute(frameNumber, attributeName.str(), queueStats._latencyHistogram[i]);
+        }
+    }
+
+    if (_prefetchTime>0.0)
+    {
+        _stats->setAttribute(frameNumber, "prefetch requests", _numPrefetchRequests);
+        _stats->setAttribute(frameNumber, "prefetch hits", static_cast<unsigned int>(_numPrefetchHits));
+        _stats->setAttribute(frameNumber, "prefetch wasted", _numPrefetchWasted);
+        _stats->setAttribute(frameNumber, "prefetch bytes in flight", _prefetchBytesInFlight);
+    }
+
+    _stats->setAttribute(frameNumber, "resident CPU bytes", _residentCPUBytes);
+    _stats->setAttribute(frameNumber, "resident GPU bytes", _residentGPUBytes);
+    if (_targetMaximumResidentBytes>0.0)
+    {
+        _stats->setAttribute(frameNumber, "memory budget expiries", _numMemoryBudgetExpiries);
+    }
+}
+
+void DatabasePager::updatePrefetchStats(const osg::FrameStamp &frameStamp)
+{
+    if (!_prefetchRequestList.empty())
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_dr_mutex);
+
+        for(RequestQueue::RequestList::iterator itr = _prefetchRequestList.begin();
+            itr != _prefetchRequestList.end();
+            )
+        {
+            DatabaseRequest* databaseRequest = itr->get();
+
+            // once merged, or discarded, only this list still references the request.
+            bool completed = databaseRequest->referenceCount()==1;
+            bool cancelled = !completed && !databaseRequest->valid();
+            if (completed || cancelled)
+            {
+                if (cancelled && databaseRequest->_prefetch) ++_numPrefetchWasted;
+
+                _prefetchBytesInFlight -= databaseRequest->_prefetchBytes;
+                databaseRequest->_prefetchBytes = 0;
+                itr = _prefetchRequestList.erase(itr);
+            }
+            else
+            {
+                ++itr;
+            }
+        }
+    }
+
+    double timeStamp = frameStamp.getReferenceTime();
+    double expiryDelay = _prefetchTime*2.0;
+
+    for(PrefetchedTileList::iterator itr = _prefetchedTileList.begin();
+        itr != _prefetchedTileList.end();
+        )
+    {
+        osg::ref_ptr<osg::PagedLOD> plod;
+        if (!itr->_pagedLOD.lock(plod) || itr->_childNo>=plod->getNumChildren())
+        {
+            // expired before the cull traversal used it.
+            ++_numPrefetchWasted;
+            itr = _prefetchedTileList.erase(itr);
+        }
+        else if (plod->getFrameNumber(itr->_childNo)>itr->_frameNumberMerged)
+        {
+            ++_numPrefetchHits;
+            itr = _prefetchedTileList.erase(itr);
+        }
+        else if (timeStamp-itr->_timeMerged>expiryDelay)
+        {
+            ++_numPrefetchWasted;
+            itr = _prefetchedTileList.erase(itr);
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+}
+
 bool DatabasePager::requiresRedraw() const
 {
     return (getDataToCompileListSize()>0);
@@ -1655,8 +2300,22 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
                 }
             }
 
+            if (databaseRequest->_prefetch && plod)
+            {
+                // track whether the cull traversal goes on to use the tile that was loaded ahead of it.
+                PrefetchedTile prefetchedTile;
+                prefetchedTile._pagedLOD = plod;
+                prefetchedTile._childNo = plod->getNumChildren();
+                prefetchedTile._frameNumberMerged = frameNumber;
+                prefetchedTile._timeMerged = timeStamp;
+                _prefetchedTileList.push_back(prefetchedTile);
+            }
+            databaseRequest->_prefetch = false;
+
             group->addChild(databaseRequest->_loadedModel.get());
 
+            addResidentTile(plod, databaseRequest);
+
             // Check if parent plod was already registered if not start visitor from parent
             if( plod &&
                 !_activePagedLODList->containsPagedLOD( plod ) )
@@ -1746,7 +2405,11 @@ void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
     if (s_total_max_stage_a<time_a) s_total_max_stage_a = time_a;
 
 
-    if (numPagedLODs <= _targetMaximumNumberOfPageLOD)
+    // release the bytes of the merged subgraphs that have been removed from the scene graph and deleted.
+    ObjectList childrenRemoved;
+    releaseResidentTiles(childrenRemoved);
+
+    if (numPagedLODs <= _targetMaximumNumberOfPageLOD && _targetMaximumResidentBytes<=0.0)
     {
         // nothing to do
         return;
@@ -1754,8 +2417,6 @@ void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
 
     int numToPrune = numPagedLODs - _targetMaximumNumberOfPageLOD;
 
-    ObjectList childrenRemoved;
-
     double expiryTime = frameStamp.getReferenceTime() - 0.1;
     unsigned int expiryFrame = frameStamp.getFrameNumber() - 1;
 
@@ -1771,6 +2432,11 @@ void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
         _activePagedLODList->removeExpiredChildren(
             numToPrune, expiryTime, expiryFrame, childrenRemoved, true);
 
+    if (!childrenRemoved.empty()) releaseResidentTiles(childrenRemoved);
+
+    if (_targetMaximumResidentBytes>0.0)
+        expireChildrenOverMemoryBudget(expiryTime, expiryFrame, childrenRemoved);
+
     osg::Timer_t end_b_Tick = osg::Timer::instance()->tick();
     double time_b = osg::Timer::instance()->delta_m(end_a_Tick,end_b_Tick);
 
@@ -1809,6 +2475,136 @@ void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
                               " C="<<time_c<<" avg="<<s_total_time_stage_c/s_total_iter_stage_c<<" max = "<<s_total_max_stage_c<<std::endl;
 }
 
+void DatabasePager::addResidentTile(osg::PagedLOD* plod, DatabaseRequest* databaseRequest)
+{
+    osg::Node* loadedModel = databaseRequest->_loadedModel.get();
+    if (!loadedModel || _residentTiles.count(loadedModel)!=0) return;
+
+    ResidentTile& residentTile = _residentTiles[loadedModel];
+    residentTile._pagedLOD = plod;
+    residentTile._child = loadedModel;
+    residentTile._priority = databaseRequest->_priorityLastRequest;
+    residentTile._cpuBytes = databaseRequest->_cpuBytes;
+    residentTile._gpuBytes = databaseRequest->_gpuBytes;
+
+    _residentCPUBytes += residentTile._cpuBytes;
+    _residentGPUBytes += residentTile._gpuBytes;
+}
+
+void DatabasePager::releaseResidentTiles(ObjectList& childrenRemoved)
+{
+    if (_residentTiles.empty()) return;
+
+    ReleaseResidentTilesVisitor releaseResidentTiles(this);
+    for(ObjectList::iterator itr = childrenRemoved.begin();
+        itr != childrenRemoved.end();
+        ++itr)
+    {
+        osg::Node* node = dynamic_cast<osg::Node*>(itr->get());
+        if (node) node->accept(releaseResidentTiles);
+    }
+
+    // subgraphs removed from the scene graph by the application are released once deleted.
+    for(ResidentTileMap::iterator itr = _residentTiles.begin();
+        itr != _residentTiles.end();
+        )
+    {
+        if (!itr->second._child.valid())
+        {
+            _residentCPUBytes -= itr->second._cpuBytes;
+            _residentGPUBytes -= itr->second._gpuBytes;
+            _residentTiles.erase(itr++);
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+}
+
+namespace
+{
+    struct MemoryBudgetCandidate
+    {
+        unsigned int                _frameNumber;
+        float                       _priority;
+        osg::ref_ptr<osg::PagedLOD> _pagedLOD;
+
+        bool operator < (const MemoryBudgetCandidate& rhs) const
+        {
+            if (_frameNumber<rhs._frameNumber) return true;
+            if (rhs._frameNumber<_frameNumber) return false;
+            return _priority<rhs._priority;
+        }
+    };
+}
+
+void DatabasePager::expireChildrenOverMemoryBudget(double expiryTime, unsigned int expiryFrame, ObjectList& childrenRemoved)
+{
+    // make room for the loaded subgraphs that will be merged this frame.
+    double bytesToMerge = 0.0;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_dataToMergeList->_requestMutex);
+        for(RequestQueue::RequestList::iterator itr = _dataToMergeList->_requestList.begin();
+            itr != _dataToMergeList->_requestList.end();
+            ++itr)
+        {
+            bytesToMerge += (*itr)->_cpuBytes + (*itr)->_gpuBytes;
+        }
+    }
+
+    double targetResidentBytes = _targetMaximumResidentBytes - bytesToMerge;
+    if (getResidentBytes()<=targetResidentBytes) return;
+
+    // only the last child of a PagedLOD can be expired, collect those that haven't been traversed recently.
+    std::vector<MemoryBudgetCandidate> candidates;
+    for(ResidentTileMap::iterator itr = _residentTiles.begin();
+        itr != _residentTiles.end();
+        ++itr)
+    {
+        MemoryBudgetCandidate candidate;
+        if (!itr->second._pagedLOD.lock(candidate._pagedLOD)) continue;
+
+        osg::PagedLOD* plod = candidate._pagedLOD.get();
+        unsigned int numChildren = plod->getNumChildren();
+        if (numChildren<=plod->getNumChildrenThatCannotBeExpired() || plod->getChild(numChildren-1)!=itr->first) continue;
+
+        unsigned int cindex = numChildren-1;
+        if (plod->getFrameNumber(cindex)+plod->getMinimumExpiryFrames(cindex)>=expiryFrame ||
+            plod->getTimeStamp(cindex)+plod->getMinimumExpiryTime(cindex)>=expiryTime) continue;
+
+        candidate._frameNumber = plod->getFrameNumber(cindex);
+        candidate._priority = itr->second._priority;
+        candidates.push_back(candidate);
+    }
+
+    // expire the least recently traversed children first, then those of lowest priority.
+    std::sort(candidates.begin(), candidates.end());
+
+    ReleaseResidentTilesVisitor releaseResidentTiles(this);
+    for(std::vector<MemoryBudgetCandidate>::iterator itr = candidates.begin();
+        itr != candidates.end() && getResidentBytes()>targetResidentBytes;
+        ++itr)
+    {
+        ExpirePagedLODsVisitor expirePagedLODsVisitor;
+        osg::NodeList expiredChildren;
+        if (!expirePagedLODsVisitor.removeExpiredChildrenAndFindPagedLODs(itr->_pagedLOD.get(), expiryTime, expiryFrame, expiredChildren)) continue;
+
+        for(osg::NodeList::iterator citr = expiredChildren.begin();
+            citr != expiredChildren.end();
+            ++citr)
+        {
+            (*citr)->accept(releaseResidentTiles);
+            childrenRemoved.push_back(citr->get());
+            ++_numMemoryBudgetExpiries;
+        }
+
+        // the PagedLODs in the expired subgraphs are no longer part of the scene graph.
+        osg::NodeList expiredPagedLODs(expirePagedLODsVisitor._childPagedLODs.begin(), expirePagedLODsVisitor._childPagedLODs.end());
+        _activePagedLODList->removeNodes(expiredPagedLODs);
+    }
+}
+
 class DatabasePager::FindPagedLODsVisitor : public osg::NodeVisitor
 {
 public:
@@ -1848,3 +2644,167 @@ void DatabasePager::registerPagedLODs(osg::Node* subgraph, unsigned int frameNum
     FindPagedLODsVisitor fplv(*_activePagedLODList, frameNumber);
     subgraph->accept(fplv);
 }
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Prefetching
+//
+struct DatabasePager::PrefetchRequestHandler : public osg::NodeVisitor::DatabaseRequestHandler
+{
+    PrefetchRequestHandler(DatabasePager* pager):
+        _pager(pager),
+        _priorityOffset(0.0f) {}
+
+    virtual void requestNodeFile(const std::string& fileName, osg::NodePath& nodePath, float priority, const osg::FrameStamp* framestamp, osg::ref_ptr<osg::Referenced>& databaseRequest, const osg::Referenced* options)
+    {
+        _pager->requestNodeFile(fileName, nodePath, priority+_priorityOffset, framestamp, databaseRequest, options, true);
+    }
+
+    DatabasePager*  _pager;
+    float           _priorityOffset;
+};
+
+/** Traverses the scene graph as the CullVisitor would from a predicted view, so the PagedLOD and ProxyNode within the predicted
+  * view frustum make their requests for the tiles they would need through the PrefetchRequestHandler.*/
+class DatabasePager::PrefetchVisitor : public osg::NodeVisitor, public osg::CullStack
+{
+public:
+
+    PrefetchVisitor(PrefetchRequestHandler* handler):
+        osg::NodeVisitor(osg::NodeVisitor::NODE_VISITOR, osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+        _frameStamp(new osg::FrameStamp)
+    {
+        setDatabaseRequestHandler(handler);
+    }
+
+    META_NodeVisitor("osgDB","PrefetchVisitor")
+
+    virtual osg::CullStack* asCullStack() { return static_cast<osg::CullStack*>(this); }
+    virtual const osg::CullStack* asCullStack() const { return static_cast<const osg::CullStack*>(this); }
+
+    virtual osg::Vec3 getEyePoint() const { return getEyeLocal(); }
+    virtual osg::Vec3 getViewPoint() const { return getViewPointLocal(); }
+
+    virtual float getDistanceToEyePoint(const osg::Vec3& pos, bool withLODScale) const
+    {
+        if (withLODScale) return (pos-getEyeLocal()).length()*getLODScale();
+        else return (pos-getEyeLocal()).length();
+    }
+
+    virtual float getDistanceToViewPoint(const osg::Vec3& pos, bool withLODScale) const
+    {
+        if (withLODScale) return (pos-getViewPointLocal()).length()*getLODScale();
+        else return (pos-getViewPointLocal()).length();
+    }
+
+    void traverseFromView(osg::Node* subgraph, const osg::Camera* camera, const osg::Matrixd& viewMatrix, const osg::FrameStamp& frameStamp)
+    {
+        osg::CullStack::reset();
+
+        *_frameStamp = frameStamp;
+        setFrameStamp(_frameStamp.get());
+        setTraversalMask(camera->getCullMask());
+
+        // the near and far planes are those computed for the current view, so don't cull against them.
+        setCullingMode(camera->getCullingMode() & ~(osg::CullSettings::NEAR_PLANE_CULLING|osg::CullSettings::FAR_PLANE_CULLING));
+        setLODScale(camera->getLODScale());
+
+        pushViewport(const_cast<osg::Viewport*>(camera->getViewport()));
+        pushProjectionMatrix(createOrReuseMatrix(camera->getProjectionMatrix()));
+        pushModelViewMatrix(createOrReuseMatrix(viewMatrix), osg::Transform::ABSOLUTE_RF);
+
+        subgraph->accept(*this);
+
+        popModelViewMatrix();
+        popProjectionMatrix();
+        popViewport();
+    }
+
+    virtual void apply(osg::Node& node)
+    {
+        if (isCulled(node)) return;
+
+        pushCurrentMask();
+        traverse(node);
+        popCurrentMask();
+    }
+
+    virtual void apply(osg::Transform& transform)
+    {
+        if (isCulled(transform)) return;
+
+        pushCurrentMask();
+
+        osg::RefMatrix* matrix = createOrReuseMatrix(*getModelViewMatrix());
+        transform.computeLocalToWorldMatrix(*matrix,this);
+        pushModelViewMatrix(matrix, transform.getReferenceFrame());
+
+        traverse(transform);
+
+        popModelViewMatrix();
+        popCurrentMask();
+    }
+
+    // nested cameras have views of their own, and the drawables have nothing to page.
+    virtual void apply(osg::Camera&) {}
+    virtual void apply(osg::Geode&) {}
+    virtual void apply(osg::Drawable&) {}
+
+protected:
+
+    osg::ref_ptr<osg::FrameStamp> _frameStamp;
+};
+
+void DatabasePager::prefetch(osg::Node* subgraph, const osg::Camera* camera, const osg::FrameStamp& frameStamp)
+{
+    if (_prefetchTime<=0.0 || !subgraph || !camera || !camera->getViewport()) return;
+
+    const osg::Matrixd& viewMatrix = camera->getViewMatrix();
+    osg::Vec3d eye = osg::Matrixd::inverse(viewMatrix).getTrans();
+
+    // estimate the camera's velocity from its recent motion, smoothing out the frame to frame variation.
+    double referenceTime = frameStamp.getReferenceTime();
+    if (_prefetchEyeValid && referenceTime>_prefetchEyeTime)
+    {
+        osg::Vec3d velocity = (eye-_prefetchEye)/(referenceTime-_prefetchEyeTime);
+        _prefetchVelocity = (_prefetchVelocity+velocity)*0.5;
+    }
+    else
+    {
+        _prefetchVelocity.set(0.0, 0.0, 0.0);
+    }
+
+    _prefetchEye = eye;
+    _prefetchEyeTime = referenceTime;
+    _prefetchEyeValid = true;
+
+    // a stationary camera's tiles are all requested by the cull traversal.
+    if (!_prefetchAnimationPath.valid() && _prefetchVelocity.length2()==0.0) return;
+
+    osg::ref_ptr<PrefetchRequestHandler> handler = new PrefetchRequestHandler(this);
+    osg::ref_ptr<PrefetchVisitor> prefetchVisitor = new PrefetchVisitor(handler.get());
+
+    // sample the predicted path from the furthest point back to the nearest, so a tile needed at several points is left with
+    // the priority of the nearest. Each sample is offset below the priorities the cull traversal assigns, which lie in -1 to 1.
+    const unsigned int numSamples = 2;
+    for(unsigned int i=numSamples; i>0; --i)
+    {
+        double dt = _prefetchTime*static_cast<double>(i)/static_cast<double>(numSamples);
+
+        osg::Matrixd predictedViewMatrix;
+        if (_prefetchAnimationPath.valid())
+        {
+            osg::Matrixd cameraMatrix;
+            if (!_prefetchAnimationPath->getMatrix(frameStamp.getSimulationTime()+dt, cameraMatrix)) continue;
+            predictedViewMatrix.invert(cameraMatrix);
+        }
+        else
+        {
+            predictedViewMatrix = osg::Matrixd::translate(-_prefetchVelocity*dt) * viewMatrix;
+        }
+
+        handler->_priorityOffset = -2.0f*static_cast<float>(i);
+        prefetchVisitor->traverseFromView(subgraph, camera, predictedViewMatrix, frameStamp);
+    }
+}
@@ -26,7 +26,7 @@ using namespace osgDB;
 static std::string s_lastSchema;
 
 InputStream::InputStream( const osgDB::Options* options )
-    :   _fileVersion(0), _useSchemaData(false), _forceReadingImage(false), _dataDecompress(0)
+    :   _fileVersion(0), _useSchemaData(false), _forceReadingImage(false), _dataDecompress(0), _dataDecompressStreamBuf(0)
 {
     BEGIN_BRACKET.set( "{", +INDENT_VALUE );
     END_BRACKET.set( "}", -INDENT_VALUE );
@@ -76,6 +76,8 @@ InputStream::~InputStream()
 {
     if (_dataDecompress)
         delete _dataDecompress;
+    if (_dataDecompressStreamBuf)
+        delete _dataDecompressStreamBuf;
 }
 
 int InputStream::getFileVersion( const std::string& d ) const
@@ -1046,11 +1048,23 @@ void InputStream::decompress()
             return;
         }
 
-        if ( !compressor->decompress(*(_in->getStream()), data) )
-            throwException( "InputStream: Failed to decompress stream." );
-        if ( getException() ) return;
+        // parse directly from the decompressing stream where the compressor supports it, unless the
+        // DecompressWholeStream option asks for the whole stream to be decompressed into memory first.
+        if ( !_options.valid() || _options->getPluginStringData("DecompressWholeStream").empty() )
+            _dataDecompressStreamBuf = compressor->createDecompressionStreamBuf( *(_in->getStream()), _options.get() );
 
-        _dataDecompress = new std::stringstream(data);
+        if ( _dataDecompressStreamBuf )
+        {
+            _dataDecompress = new std::istream( _dataDecompressStreamBuf );
+        }
+        else
+        {
+            if ( !compressor->decompress(*(_in->getStream()), data, _options.get()) )
+                throwException( "InputStream: Failed to decompress stream." );
+            if ( getException() ) return;
+
+            _dataDecompress = new std::stringstream(data);
+        }
         _in->setStream( _dataDecompress );
         _fields.pop_back();
     }
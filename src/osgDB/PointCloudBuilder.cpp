@@ -0,0 +1,592 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/PointCloudBuilder>
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/WriteFile>
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Notify>
+#include <osg/PointCloudNode>
+
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Thread>
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sstream>
+
+using namespace osgDB;
+
+namespace
+{
+
+typedef PointCloudBuilder::Point Point;
+typedef PointCloudBuilder::Points Points;
+
+struct Cell
+{
+    Cell() : depth(0) {}
+    Cell(const std::string& cellName, const osg::BoundingBox& cellBound, unsigned int cellDepth) :
+        name(cellName), bound(cellBound), depth(cellDepth) {}
+
+    Cell child(unsigned int octant) const
+    {
+        osg::Vec3 center = bound.center();
+        osg::BoundingBox childBound;
+        childBound._min.set((octant&1) ? center.x() : bound.xMin(), (octant&2) ? center.y() : bound.yMin(), (octant&4) ? center.z() : bound.zMin());
+        childBound._max.set((octant&1) ? bound.xMax() : center.x(), (octant&2) ? bound.yMax() : center.y(), (octant&4) ? bound.zMax() : center.z());
+        return Cell(name+static_cast<char>('0'+octant), childBound, depth+1);
+    }
+
+    unsigned int octant(const osg::Vec3& position) const
+    {
+        osg::Vec3 center = bound.center();
+        return (position.x()>=center.x() ? 1 : 0) | (position.y()>=center.y() ? 2 : 0) | (position.z()>=center.z() ? 4 : 0);
+    }
+
+    std::string         name;
+    osg::BoundingBox    bound;
+    unsigned int        depth;
+};
+
+// The points passed down to a cell's children, held in memory until there are more than the store's maximum,
+// after which they are appended to a temporary file a buffer at a time.
+class PointStore
+{
+public:
+    PointStore() : _maxNumPointsInMemory(0), _file(0), _numPointsInFile(0), _error(false) {}
+
+    void setUp(const std::string& fileName, size_t maxNumPointsInMemory)
+    {
+        _fileName = fileName;
+        _maxNumPointsInMemory = maxNumPointsInMemory;
+    }
+
+    void add(const Point& point)
+    {
+        _points.push_back(point);
+        if (!_fileName.empty() && _points.size()>=_maxNumPointsInMemory) write();
+    }
+
+    // Append the points in memory to the file if the store has started using it.
+    void close()
+    {
+        if (_numPointsInFile>0 && !_points.empty()) write();
+        if (_numPointsInFile>0) Points().swap(_points);
+        if (_file) { fclose(_file); _file = 0; }
+    }
+
+    void swap(PointStore& rhs)
+    {
+        std::swap(_fileName, rhs._fileName);
+        std::swap(_maxNumPointsInMemory, rhs._maxNumPointsInMemory);
+        _points.swap(rhs._points);
+        std::swap(_file, rhs._file);
+        std::swap(_numPointsInFile, rhs._numPointsInFile);
+        std::swap(_error, rhs._error);
+    }
+
+    size_t size() const { return _numPointsInFile+_points.size(); }
+    bool empty() const { return size()==0; }
+    bool error() const { return _error; }
+
+    // Read the next chunk of points, from the file then those in memory, removing the file once it has been read.
+    bool read(Points& points, size_t maxNumPoints)
+    {
+        points.clear();
+        if (_numPointsInFile>0)
+        {
+            if (!_file && (_file = osgDB::fopen(_fileName.c_str(), "rb"))==0) { _error = true; _numPointsInFile = 0; return false; }
+
+            size_t numPoints = std::min(maxNumPoints, _numPointsInFile);
+            points.resize(numPoints);
+            if (fread(&points[0], sizeof(Point), numPoints, _file)!=numPoints) _error = true;
+            _numPointsInFile -= numPoints;
+            if (_numPointsInFile==0 || _error)
+            {
+                fclose(_file);
+                _file = 0;
+                remove(_fileName.c_str());
+                _numPointsInFile = 0;
+            }
+            return !_error;
+        }
+
+        points.swap(_points);
+        Points().swap(_points);
+        return !points.empty();
+    }
+
+    void clear()
+    {
+        if (_file) { fclose(_file); _file = 0; }
+        if (_numPointsInFile>0) remove(_fileName.c_str());
+        _numPointsInFile = 0;
+        Points().swap(_points);
+    }
+
+protected:
+    void write()
+    {
+        if (!_file && (_file = osgDB::fopen(_fileName.c_str(), "wb"))==0)
+        {
+            OSG_WARN<<"PointCloudBuilder: unable to open temporary file "<<_fileName<<std::endl;
+            _error = true;
+            _fileName.clear();
+            return;
+        }
+
+        if (fwrite(&_points[0], sizeof(Point), _points.size(), _file)!=_points.size()) _error = true;
+        _numPointsInFile += _points.size();
+        _points.clear();
+    }
+
+    std::string     _fileName;
+    size_t          _maxNumPointsInMemory;
+    Points          _points;
+    FILE*           _file;
+    size_t          _numPointsInFile;
+    bool            _error;
+};
+
+// The points kept by a cell, the first point read in each cell of a grid over the cell, and the store of the
+// points passed down to its children.
+struct CellPoints
+{
+    Points              points;
+    std::vector<bool>   occupied;
+    PointStore          remainder;
+};
+
+struct Task
+{
+    Cell                        cell;
+    PointStore                  input;
+    osg::ref_ptr<osg::Group>    group;
+};
+
+struct BuildContext
+{
+    std::string     tileDirectory;
+    std::string     baseName;
+    std::string     tileExtension;
+    osg::ref_ptr<Options> tileOptions;
+    size_t          chunkSize;
+    size_t          maxNumPointsPerTile;
+    size_t          maxNumPointsInMemory;
+    unsigned int    gridSize;
+    unsigned int    maxDepth;
+
+    OpenThreads::Atomic numTiles;
+    OpenThreads::Atomic numErrors;
+
+    bool paged() const { return !tileDirectory.empty(); }
+
+    std::string getTileFileName(const Cell& cell) const { return baseName+"_"+cell.name+"."+tileExtension; }
+    std::string getTemporaryFileName(const Cell& cell) const { return osgDB::concatPaths(tileDirectory, baseName+"_"+cell.name+".points"); }
+};
+
+class ChunkReader
+{
+public:
+    virtual ~ChunkReader() {}
+    virtual bool read(Points& points) = 0;
+};
+
+class SourceChunkReader : public ChunkReader
+{
+public:
+    SourceChunkReader(PointCloudBuilder::PointSource& source, size_t chunkSize) : _source(source), _chunkSize(chunkSize) {}
+    virtual bool read(Points& points) { points.clear(); return _source.readChunk(points, _chunkSize) || !points.empty(); }
+
+protected:
+    PointCloudBuilder::PointSource& _source;
+    size_t                          _chunkSize;
+};
+
+class StoreChunkReader : public ChunkReader
+{
+public:
+    StoreChunkReader(PointStore& store, size_t chunkSize) : _store(store), _chunkSize(chunkSize) {}
+    virtual bool read(Points& points) { return _store.read(points, _chunkSize); }
+
+protected:
+    PointStore& _store;
+    size_t      _chunkSize;
+};
+
+// Distribute the points read from reader between the targets, a single target or the eight children of a cell.
+void partition(BuildContext& context, ChunkReader& reader, const Cell& parent, const Cell* targets, unsigned int numTargets, CellPoints* outputs)
+{
+    const unsigned int gridSize = context.gridSize;
+    for(unsigned int t=0; t<numTargets; ++t)
+    {
+        if (context.paged()) outputs[t].remainder.setUp(context.getTemporaryFileName(targets[t]), context.maxNumPointsInMemory);
+    }
+
+    Points chunk;
+    while (reader.read(chunk))
+    {
+        for(Points::const_iterator itr=chunk.begin(); itr!=chunk.end(); ++itr)
+        {
+            unsigned int t = numTargets==1 ? 0 : parent.octant(itr->position);
+            const osg::BoundingBox& bound = targets[t].bound;
+            CellPoints& output = outputs[t];
+
+            unsigned int index = 0;
+            for(int axis=2; axis>=0; --axis)
+            {
+                float size = bound._max[axis]-bound._min[axis];
+                int i = size>0.0f ? static_cast<int>((itr->position[axis]-bound._min[axis])/size*float(gridSize)) : 0;
+                index = index*gridSize + static_cast<unsigned int>(osg::clampBetween(i, 0, static_cast<int>(gridSize)-1));
+            }
+
+            if (output.occupied.empty()) output.occupied.resize(gridSize*gridSize*gridSize, false);
+            if (!output.occupied[index])
+            {
+                output.occupied[index] = true;
+                output.points.push_back(*itr);
+            }
+            else
+            {
+                output.remainder.add(*itr);
+            }
+        }
+    }
+
+    for(unsigned int t=0; t<numTargets; ++t)
+    {
+        CellPoints& output = outputs[t];
+        std::vector<bool>().swap(output.occupied);
+        output.remainder.close();
+
+        // cells with few points, or at the maximum depth, keep all their points.
+        if (!output.remainder.empty() &&
+            (output.points.size()+output.remainder.size()<=context.maxNumPointsPerTile || targets[t].depth>=context.maxDepth))
+        {
+            if (targets[t].depth>=context.maxDepth)
+            {
+                OSG_INFO<<"PointCloudBuilder: cell "<<targets[t].name<<" at maximum depth keeps "<<output.remainder.size()<<" additional points"<<std::endl;
+            }
+
+            Points points;
+            while (output.remainder.read(points, context.chunkSize))
+            {
+                output.points.insert(output.points.end(), points.begin(), points.end());
+            }
+        }
+
+        if (output.remainder.error()) ++context.numErrors;
+    }
+}
+
+osg::Geode* createGeode(const Points& points)
+{
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array(points.size());
+    osg::ref_ptr<osg::Vec4ubArray> colours = new osg::Vec4ubArray(points.size());
+    colours->setNormalize(true);
+    for(size_t i=0; i<points.size(); ++i)
+    {
+        (*vertices)[i] = points[i].position;
+        (*colours)[i] = points[i].color;
+    }
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setUseVertexBufferObjects(true);
+    geometry->setVertexArray(vertices.get());
+    geometry->setColorArray(colours.get(), osg::Array::BIND_PER_VERTEX);
+    geometry->addPrimitiveSet(new osg::DrawArrays(GL_POINTS, 0, vertices->size()));
+
+    osg::Geode* geode = new osg::Geode;
+    geode->addDrawable(geometry.get());
+    return geode;
+}
+
+// Create the node of a cell drawing its points, with children loaded or switched in by distance when the cell has
+// more points to pass down, setting childGroup to the group the cell's children are to be added to.
+osg::Node* createCellNode(BuildContext& context, const Cell& cell, const Points& points, bool hasChildren, osg::ref_ptr<osg::Group>& childGroup)
+{
+    osg::ref_ptr<osg::PointCloudNode> node = new osg::PointCloudNode;
+    node->setCenterMode(osg::LOD::USER_DEFINED_CENTER);
+    node->setCenter(cell.bound.center());
+    node->setRadius(cell.bound.radius());
+    node->setNumPoints(static_cast<unsigned int>(points.size()));
+    node->addChild(createGeode(points), 0.0f, FLT_MAX);
+    if (!hasChildren) return node.release();
+
+    childGroup = new osg::Group;
+    if (context.paged())
+    {
+        node->setFileName(1, context.getTileFileName(cell));
+        node->setRange(1, 0.0f, FLT_MAX);
+    }
+    else
+    {
+        node->addChild(childGroup.get(), 0.0f, FLT_MAX);
+    }
+    return node.release();
+}
+
+// Split the points passed down to a cell between its children, building the children that fit in memory and
+// returning those that need splitting further in pendingTasks.
+void processTask(BuildContext& context, Task& task, std::vector<Task*>& pendingTasks)
+{
+    Cell children[8];
+    for(unsigned int i=0; i<8; ++i) children[i] = task.cell.child(i);
+
+    CellPoints outputs[8];
+    StoreChunkReader reader(task.input, context.chunkSize);
+    partition(context, reader, task.cell, children, 8, outputs);
+    if (task.input.error()) ++context.numErrors;
+    task.input.clear();
+
+    for(unsigned int i=0; i<8; ++i)
+    {
+        CellPoints& output = outputs[i];
+        if (output.points.empty()) continue;
+
+        bool hasChildren = !output.remainder.empty();
+        osg::ref_ptr<osg::Group> childGroup;
+        task.group->addChild(createCellNode(context, children[i], output.points, hasChildren, childGroup));
+        Points().swap(output.points);
+
+        if (hasChildren)
+        {
+            Task* childTask = new Task;
+            childTask->cell = children[i];
+            childTask->input.swap(output.remainder);
+            childTask->group = childGroup;
+
+            if (childTask->input.size()>context.maxNumPointsInMemory)
+            {
+                pendingTasks.push_back(childTask);
+            }
+            else
+            {
+                processTask(context, *childTask, pendingTasks);
+                delete childTask;
+            }
+        }
+    }
+
+    if (context.paged())
+    {
+        std::string fileName = osgDB::concatPaths(context.tileDirectory, context.getTileFileName(task.cell));
+        if (osgDB::writeNodeFile(*task.group, fileName, context.tileOptions.get())) ++context.numTiles;
+        else
+        {
+            OSG_WARN<<"PointCloudBuilder: unable to write tile "<<fileName<<std::endl;
+            ++context.numErrors;
+        }
+        task.group = 0;
+    }
+}
+
+class TaskThread : public OpenThreads::Thread
+{
+public:
+    TaskThread(BuildContext& context, std::vector<Task*>& tasks, std::vector< std::vector<Task*> >& pendingTasks, OpenThreads::Atomic& nextTask) :
+        _context(context), _tasks(tasks), _pendingTasks(pendingTasks), _nextTask(nextTask) {}
+
+    virtual void run()
+    {
+        for(unsigned int i=(++_nextTask)-1; i<_tasks.size(); i=(++_nextTask)-1)
+        {
+            processTask(_context, *_tasks[i], _pendingTasks[i]);
+        }
+    }
+
+protected:
+    BuildContext&                           _context;
+    std::vector<Task*>&                     _tasks;
+    std::vector< std::vector<Task*> >&      _pendingTasks;
+    OpenThreads::Atomic&                    _nextTask;
+};
+
+}
+
+PointCloudBuilder::PointCloudBuilder():
+    _chunkSize(1024*1024),
+    _maxNumPointsPerTile(32768),
+    _memoryBudget(512.0*1024.0*1024.0),
+    _numThreads(1),
+    _tileExtension("osgb"),
+    _pointBudget(1000000),
+    _pointSpacing(2.0f),
+    _maxDepth(20),
+    _numPoints(0),
+    _numTiles(0)
+{
+}
+
+bool PointCloudBuilder::readOptions(const Options* options)
+{
+    if (!options) return false;
+
+    bool requested = false;
+    std::istringstream iss(options->getOptionString());
+    std::string opt;
+    while (iss >> opt)
+    {
+        std::string::size_type pos = opt.find('=');
+        std::string name = opt.substr(0, pos);
+        std::string value = pos!=std::string::npos ? opt.substr(pos+1) : std::string();
+
+        if (name=="pointCloudStream") requested = true;
+        else if (name=="pointCloudTiles" && !value.empty()) { _tileDirectory = value; requested = true; }
+        else if (name=="pointCloudMemoryBudget" && !value.empty()) _memoryBudget = atof(value.c_str())*1024.0*1024.0;
+        else if (name=="pointCloudPointsPerTile" && !value.empty()) _maxNumPointsPerTile = osg::maximum(atoi(value.c_str()), 1);
+        else if (name=="pointCloudThreads" && !value.empty()) _numThreads = osg::maximum(atoi(value.c_str()), 0);
+        else if (name=="pointCloudChunkSize" && !value.empty()) _chunkSize = osg::maximum(atoi(value.c_str()), 1);
+        else if (name=="pointCloudBudget" && !value.empty()) _pointBudget = osg::maximum(atoi(value.c_str()), 0);
+        else if (name=="pointCloudSpacing" && !value.empty()) _pointSpacing = static_cast<float>(atof(value.c_str()));
+    }
+    return requested;
+}
+
+osg::ref_ptr<osg::Node> PointCloudBuilder::build(PointSource& source, const std::string& baseName)
+{
+    _numPoints = 0;
+    _numTiles = 0;
+
+    unsigned int numThreads = _numThreads>0 ? _numThreads : static_cast<unsigned int>(osg::maximum(OpenThreads::GetNumberOfProcessors(), 1));
+
+    BuildContext context;
+    context.tileDirectory = _tileDirectory;
+    context.baseName = baseName;
+    context.tileExtension = _tileExtension;
+    context.tileOptions = _tileOptions;
+    context.maxNumPointsPerTile = osg::maximum(_maxNumPointsPerTile, 1u);
+    context.gridSize = 1;
+    while ((context.gridSize+1)*(context.gridSize+1)*(context.gridSize+1)<=context.maxNumPointsPerTile) ++context.gridSize;
+    context.maxDepth = _maxDepth;
+
+    // each build thread works within its share of the budget, reading a chunk at a time and splitting the points
+    // between eight children, each keeping up to a tile of points and holding its remaining points in memory
+    // before spilling them to a temporary file.
+    size_t budgetPoints = static_cast<size_t>(_memoryBudget/double(numThreads)/double(sizeof(Point)));
+    context.chunkSize = osg::clampBetween(budgetPoints/8, static_cast<size_t>(1024), static_cast<size_t>(osg::maximum(_chunkSize, 1u)));
+    size_t fixedPoints = context.chunkSize + 16*context.maxNumPointsPerTile;
+    context.maxNumPointsInMemory = budgetPoints>fixedPoints ? (budgetPoints-fixedPoints)/10 : 0;
+    if (context.maxNumPointsInMemory<context.maxNumPointsPerTile)
+    {
+        if (context.paged())
+        {
+            OSG_NOTICE<<"PointCloudBuilder: memory budget of "<<_memoryBudget/(1024.0*1024.0)<<"MB is too small for "
+                      <<numThreads<<" threads with "<<context.maxNumPointsPerTile<<" points per tile"<<std::endl;
+        }
+        context.maxNumPointsInMemory = context.maxNumPointsPerTile;
+    }
+
+    if (context.paged() && !osgDB::makeDirectory(context.tileDirectory))
+    {
+        OSG_WARN<<"PointCloudBuilder: unable to create tile directory "<<context.tileDirectory<<std::endl;
+        return 0;
+    }
+
+    // a cube around the points keeps the cells of the octree cubes.
+    osg::BoundingBox bound;
+    if (!source.getBound(bound))
+    {
+        SourceChunkReader reader(source, context.chunkSize);
+        Points chunk;
+        while (reader.read(chunk))
+        {
+            for(Points::const_iterator itr=chunk.begin(); itr!=chunk.end(); ++itr) bound.expandBy(itr->position);
+        }
+
+        if (!source.reset())
+        {
+            OSG_WARN<<"PointCloudBuilder: unable to read the points a second time"<<std::endl;
+            return 0;
+        }
+    }
+    if (!bound.valid()) return 0;
+
+    float halfSize = osg::maximum(osg::maximum(bound.xMax()-bound.xMin(), bound.yMax()-bound.yMin()), bound.zMax()-bound.zMin())*0.5f;
+    halfSize = osg::maximum(halfSize*1.0001f, 1e-6f);
+    osg::Vec3 center = bound.center();
+    Cell root("r", osg::BoundingBox(center-osg::Vec3(halfSize, halfSize, halfSize), center+osg::Vec3(halfSize, halfSize, halfSize)), 0);
+
+    // the root cell keeps its subsample of the points from the source and passes the rest to its children.
+    CellPoints rootPoints;
+    SourceChunkReader reader(source, context.chunkSize);
+    partition(context, reader, root, &root, 1, &rootPoints);
+    _numPoints = rootPoints.points.size()+rootPoints.remainder.size();
+    if (_numPoints==0) return 0;
+
+    bool hasChildren = !rootPoints.remainder.empty();
+    osg::ref_ptr<osg::Group> childGroup;
+    osg::ref_ptr<osg::PointCloudNode> rootNode = static_cast<osg::PointCloudNode*>(createCellNode(context, root, rootPoints.points, hasChildren, childGroup));
+    rootNode->setPointBudget(_pointBudget);
+    rootNode->setPointSpacing(_pointSpacing);
+    Points().swap(rootPoints.points);
+
+    std::vector<Task*> tasks;
+    if (hasChildren)
+    {
+        Task* task = new Task;
+        task->cell = root;
+        task->input.swap(rootPoints.remainder);
+        task->group = childGroup;
+        tasks.push_back(task);
+    }
+
+    // the tiles' cells take their database path from the directory of the tile file they are read from.
+    if (context.paged()) rootNode->setDatabasePath(context.tileDirectory);
+
+    // split the cells a level at a time, the subtrees of each level's cells are built on the build threads.
+    while (!tasks.empty())
+    {
+        std::vector< std::vector<Task*> > pendingTasks(tasks.size());
+        OpenThreads::Atomic nextTask;
+
+        // the calling thread works through the tasks along with the additional threads.
+        std::vector< TaskThread* > threads;
+        unsigned int numTaskThreads = osg::minimum(numThreads, static_cast<unsigned int>(tasks.size()));
+        for(unsigned int i=1; i<numTaskThreads; ++i)
+        {
+            threads.push_back(new TaskThread(context, tasks, pendingTasks, nextTask));
+            threads.back()->startThread();
+        }
+
+        TaskThread(context, tasks, pendingTasks, nextTask).run();
+
+        for(std::vector< TaskThread* >::iterator itr=threads.begin(); itr!=threads.end(); ++itr)
+        {
+            (*itr)->join();
+            delete *itr;
+        }
+
+        for(std::vector<Task*>::iterator itr=tasks.begin(); itr!=tasks.end(); ++itr) delete *itr;
+        tasks.clear();
+
+        for(std::vector< std::vector<Task*> >::iterator itr=pendingTasks.begin(); itr!=pendingTasks.end(); ++itr)
+        {
+            tasks.insert(tasks.end(), itr->begin(), itr->end());
+        }
+    }
+
+    _numTiles = static_cast<unsigned int>(context.numTiles);
+    if (static_cast<unsigned int>(context.numErrors)>0)
+    {
+        OSG_WARN<<"PointCloudBuilder: "<<static_cast<unsigned int>(context.numErrors)<<" errors building "<<baseName<<std::endl;
+        return 0;
+    }
+
+    return rootNode.get();
+}
@@ -7,6 +7,7 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
 #include <osgDB/fstream>
+#include <osgDB/PointCloudBuilder>
 #include <osgDB/Registry>
 
 #include <iostream>
@@ -19,6 +20,70 @@
 #include <liblas/point.hpp>
 #include <liblas/detail/timer.hpp>
 
+// Reads the points of a LAS file a chunk at a time for the osgDB::PointCloudBuilder, scaling and re-centering the
+// points in the same way as the whole file read.
+class LASPointSource : public osgDB::PointCloudBuilder::PointSource
+{
+    public:
+
+        LASPointSource(liblas::Reader& reader, bool scale, const osg::Vec3d& mid) :
+            _reader(reader),
+            _scale(scale),
+            _mid(mid)
+        {
+        }
+
+        virtual bool readChunk(osgDB::PointCloudBuilder::Points& points, unsigned int maxNumPoints)
+        {
+            liblas::Header const& h = _reader.GetHeader();
+            for (unsigned int i = 0; i < maxNumPoints; ++i)
+            {
+                if (!_reader.ReadNextPoint()) return false;
+
+                liblas::Point const& p = _reader.GetPoint();
+                liblas::Color c = p.GetColor();
+
+                osg::Vec3d position(p.GetRawX(), p.GetRawY(), p.GetRawZ());
+                if (_scale)
+                {
+                    position = osg::componentMultiply(position, osg::Vec3d(h.GetScaleX(), h.GetScaleY(), h.GetScaleZ()));
+                }
+
+                points.push_back(osgDB::PointCloudBuilder::Point(osg::Vec3(position - _mid),
+                                                                 osg::Vec4ub(c.GetRed() >> 8, c.GetGreen() >> 8, c.GetBlue() >> 8, 255)));
+            }
+            return true;
+        }
+
+        virtual bool reset()
+        {
+            _reader.Reset();
+            return true;
+        }
+
+        virtual bool getBound(osg::BoundingBox& bb)
+        {
+            liblas::Header const& h = _reader.GetHeader();
+            osg::Vec3d minimum(h.GetMinX() - h.GetOffsetX(), h.GetMinY() - h.GetOffsetY(), h.GetMinZ() - h.GetOffsetZ());
+            osg::Vec3d maximum(h.GetMaxX() - h.GetOffsetX(), h.GetMaxY() - h.GetOffsetY(), h.GetMaxZ() - h.GetOffsetZ());
+            if (!_scale)
+            {
+                osg::Vec3d inverseScale(1.0 / h.GetScaleX(), 1.0 / h.GetScaleY(), 1.0 / h.GetScaleZ());
+                minimum = osg::componentMultiply(minimum, inverseScale);
+                maximum = osg::componentMultiply(maximum, inverseScale);
+            }
+
+            bb.set(osg::Vec3(minimum - _mid), osg::Vec3(maximum - _mid));
+            return bb.valid();
+        }
+
+    protected:
+
+        liblas::Reader& _reader;
+        bool            _scale;
+        osg::Vec3d      _mid;
+};
+
 class ReaderWriterLAS : public osgDB::ReaderWriter
 {
     public:
@@ -30,6 +95,14 @@ class ReaderWriterLAS : public osgDB::ReaderWriter
             supportsOption("v", "Verbose output");
             supportsOption("noScale", "don't scale vertices according to las header - put scale in matrixTransform");
             supportsOption("noReCenter", "don't transform vertex coords to re-center the pointcloud");
+            supportsOption("pointCloudStream", "Read the points a chunk at a time into an in memory octree.");
+            supportsOption("pointCloudTiles=<directory>", "Read the points a chunk at a time into an octree of paged tiles written to the directory.");
+            supportsOption("pointCloudMemoryBudget=<megabytes>", "Memory budget of the point cloud tile build.");
+            supportsOption("pointCloudPointsPerTile=<num>", "Maximum number of points in each point cloud octree tile.");
+            supportsOption("pointCloudThreads=<num>", "Number of threads building the point cloud octree, defaults to the number of processors.");
+            supportsOption("pointCloudChunkSize=<num>", "Number of points read from the file in each chunk.");
+            supportsOption("pointCloudBudget=<num>", "Maximum number of points of the point cloud drawn each frame.");
+            supportsOption("pointCloudSpacing=<pixels>", "Projected point spacing below which the point cloud octree isn't refined.");
         }
 
         virtual const char* className() const { return "LAS point cloud reader"; }
@@ -53,7 +126,7 @@ class ReaderWriterLAS : public osgDB::ReaderWriter
             {
                 return ReadResult::ERROR_IN_READING_FILE;
             }
-            return readNode(ifs, options);
+            return readPoints(ifs, options, osgDB::getStrippedName(fileName));
         }
 
         virtual ReadResult readObject(std::istream& fin, const osgDB::ReaderWriter::Options* options) const
@@ -61,7 +134,15 @@ class ReaderWriterLAS : public osgDB::ReaderWriter
             return readNode(fin, options);
         }
 
-       virtual ReadResult readNode(std::istream& ifs, const Options* options) const {
+        virtual ReadResult readNode(std::istream& ifs, const Options* options) const
+        {
+            return readPoints(ifs, options, "pointcloud");
+        }
+
+    protected:
+
+        ReadResult readPoints(std::istream& ifs, const Options* options, const std::string& name) const
+        {
             // Reading options
             bool _verbose = false;
             bool _scale = true;
@@ -106,6 +187,36 @@ class ReaderWriterLAS : public osgDB::ReaderWriter
                 std::cout << std::endl;
             }
 
+            // stream the points into an octree of tiles, the header's bounds give the mid point for re-centering.
+            osg::ref_ptr<osgDB::PointCloudBuilder> builder = new osgDB::PointCloudBuilder;
+            builder->setNumThreads(0);
+            if (builder->readOptions(options))
+            {
+                osg::Vec3d mid;
+                if (_recenter)
+                {
+                    mid.set(0.5 * (h.GetMinX() + h.GetMaxX()) - h.GetOffsetX(),
+                            0.5 * (h.GetMinY() + h.GetMaxY()) - h.GetOffsetY(),
+                            0.5 * (h.GetMinZ() + h.GetMaxZ()) - h.GetOffsetZ());
+                    if (!_scale)
+                    {
+                        mid = osg::componentMultiply(mid, osg::Vec3d(1.0 / h.GetScaleX(), 1.0 / h.GetScaleY(), 1.0 / h.GetScaleZ()));
+                    }
+                }
+
+                osg::ref_ptr<LASPointSource> source = new LASPointSource(reader, _scale, mid);
+                osg::ref_ptr<osg::Node> node = builder->build(*source, name);
+                if (!node.valid()) return ReadResult::ERROR_IN_READING_FILE;
+
+                if (_verbose)
+                {
+                    std::cout << "Read points: " << builder->getNumPoints() << " into " << builder->getNumTiles() << " tiles" << std::endl;
+                }
+
+                osg::MatrixTransform* mt = createTransform(h, _scale, _recenter, mid.x(), mid.y(), mid.z());
+                mt->addChild(node.get());
+                return mt;
+            }
 
             // POINTS ////
 
@@ -258,7 +369,15 @@ class ReaderWriterLAS : public osgDB::ReaderWriter
             }
 
             // MatrixTransform with the mid-point translation
+            osg::MatrixTransform *mt = createTransform(h, _scale, _recenter, mid_x, mid_y, mid_z);
+
+            mt->addChild (geode);
 
+            return mt;
+        }
+
+        static osg::MatrixTransform* createTransform(liblas::Header const& h, bool _scale, bool _recenter, double mid_x, double mid_y, double mid_z)
+        {
             osg::MatrixTransform *mt = new osg::MatrixTransform;
             mt->setDataVariance(osg::Object::STATIC);//can be optimized away
             if (_scale)//vertex positions are scaled already
@@ -287,8 +406,6 @@ class ReaderWriterLAS : public osgDB::ReaderWriter
                 }
             }
 
-            mt->addChild (geode);
-
             return mt;
         }
 };
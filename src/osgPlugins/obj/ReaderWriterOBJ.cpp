@@ -42,6 +42,8 @@
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
 
+#include <OpenThreads/Thread>
+
 #include <osgUtil/MeshOptimizers>
 #include <osgUtil/SmoothingVisitor>
 #include <osgUtil/Tessellator>
@@ -63,6 +65,8 @@ public:
         supportsOption("noTriStripPolygons","Do not do the default tri stripping of polygons");
         supportsOption("generateFacetNormals","generate facet normals for vertices without normals");
         supportsOption("noReverseFaces","avoid to reverse faces when normals and triangles orientation are reversed");
+        supportsOption("parseThreads=<num>","Number of threads to parse the file with, defaults to the number of processors");
+        supportsOption("lineByLineParse","Parse the file a line at a time rather than in blocks");
 
         supportsOption("DIFFUSE=<unit>", "Set texture unit for diffuse texture");
         supportsOption("AMBIENT=<unit>", "Set texture unit for ambient texture");
@@ -170,6 +174,8 @@ protected:
         int precision;
         bool outputTextureFiles;
         int specularExponent;
+        /// Number of threads to parse the file with, 0 to parse it a line at a time.
+        unsigned int numParseThreads;
 
         ObjOptionsStruct()
         {
@@ -182,6 +188,7 @@ protected:
             precision = std::numeric_limits<double>::digits10 + 2;
             outputTextureFiles = false;
             specularExponent = -1;
+            numParseThreads = OpenThreads::GetNumberOfProcessors();
         }
     };
 
@@ -661,6 +668,10 @@ osg::Geometry* ReaderWriterOBJ::convertElementListToGeometry(obj::Model& model,
         #ifdef USE_DRAWARRAYLENGTHS
             osg::DrawArrayLengths* drawArrayLengths = new osg::DrawArrayLengths(GL_POLYGON,startPos);
             geometry->addPrimitiveSet(drawArrayLengths);
+        #else
+            // collect the polygons and add them to the geometry at once, as each addPrimitiveSet(..) dirties all the
+            // primitive sets added before it.
+            osg::Geometry::PrimitiveSetList primitives(geometry->getPrimitiveSetList());
         #endif
 
         for(itr=elementList.begin();
@@ -677,13 +688,13 @@ osg::Geometry* ReaderWriterOBJ::convertElementListToGeometry(obj::Model& model,
                     {
                         osg::DrawArrays* drawArrays = new osg::DrawArrays(GL_POLYGON,startPos,element.vertexIndices.size());
                         startPos += element.vertexIndices.size();
-                        geometry->addPrimitiveSet(drawArrays);
+                        primitives.push_back(drawArrays);
                     }
                     else
                     {
                         osg::DrawArrays* drawArrays = new osg::DrawArrays(GL_TRIANGLE_FAN,startPos,element.vertexIndices.size());
                         startPos += element.vertexIndices.size();
-                        geometry->addPrimitiveSet(drawArrays);
+                        primitives.push_back(drawArrays);
                     }
                 #endif
 
@@ -761,6 +772,10 @@ osg::Geometry* ReaderWriterOBJ::convertElementListToGeometry(obj::Model& model,
                 }
             }
         }
+
+        #ifndef USE_DRAWARRAYLENGTHS
+            geometry->setPrimitiveSetList(primitives);
+        #endif
     }
 
     if(hasReversedFaces)
@@ -908,6 +923,20 @@ ReaderWriterOBJ::ObjOptionsStruct ReaderWriterOBJ::parseOptions(const osgDB::Rea
                     localOptions.precision = val;
                 }
             }
+            else if (pre_equals == "parseThreads")
+            {
+                int val = std::atoi(post_equals.c_str());
+                if (val <= 0) {
+                    OSG_NOTICE << "Warning: invalid parseThreads value: " << post_equals << std::endl;
+                }
+                else {
+                    localOptions.numParseThreads = val;
+                }
+            }
+            else if (pre_equals == "lineByLineParse")
+            {
+                localOptions.numParseThreads = 0;
+            }
             else if (pre_equals == "NsIfNotPresent")
             {
                 int value = atoi(post_equals.c_str());
@@ -955,12 +984,13 @@ osgDB::ReaderWriter::ReadResult ReaderWriterOBJ::readNode(const std::string& fil
         osg::ref_ptr<Options> local_opt = options ? static_cast<Options*>(options->clone(osg::CopyOp::SHALLOW_COPY)) : new Options;
         local_opt->getDatabasePathList().push_front(osgDB::getFilePath(fileName));
 
+        ObjOptionsStruct localOptions = parseOptions(options);
+
         obj::Model model;
         model.setDatabasePath(osgDB::getFilePath(fileName.c_str()));
+        model.setNumParseThreads(localOptions.numParseThreads);
         model.readOBJ(fin, local_opt.get());
 
-        ObjOptionsStruct localOptions = parseOptions(options);
-
         osg::Node* node = convertModelToSceneGraph(model, localOptions, local_opt.get());
         return node;
     }
@@ -972,11 +1002,12 @@ osgDB::ReaderWriter::ReadResult ReaderWriterOBJ::readNode(std::istream& fin, con
 {
     if (fin)
     {
+        ObjOptionsStruct localOptions = parseOptions(options);
+
         obj::Model model;
+        model.setNumParseThreads(localOptions.numParseThreads);
         model.readOBJ(fin, options);
 
-        ObjOptionsStruct localOptions = parseOptions(options);
-
         osg::Node* node = convertModelToSceneGraph(model, localOptions, options);
         return node;
     }
@@ -25,6 +25,12 @@
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
 
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Thread>
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
 #include <string.h>
 
 using namespace obj;
@@ -560,21 +566,614 @@ std::string trim(const std::string& s)
   return std::string(s, b, e - b + 1);
 }
 
-inline bool isZBrushColorField(char* line)
+inline bool isZBrushColorField(const char* line)
 {
     return strncmp(line, "#MRGB", 5) == 0;
 }
 
+// Get the zBrush vertex colors given in comments under the form :
+// * #MRGB MMRRGGBB MMRRGGBB ... (up to 64 hexadecimal color fields)
+static void readZBrushColors(const char* line, Model::Vec4Array& colors)
+{
+    float r, g, b;
+    std::string colorFields(strlen(line)>6 ? line + 6 : "");
+    while (colorFields.size() >= 8)
+    {
+        std::string currentValue;
+
+        // Skipping the MM component
+        colorFields = colorFields.substr(2);
+
+        currentValue = colorFields.substr(0,2);
+        r = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
+        colorFields = colorFields.substr(2);
+
+        currentValue = colorFields.substr(0,2);
+        g = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
+        colorFields = colorFields.substr(2);
+
+        currentValue = colorFields.substr(0,2);
+        b = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
+        colorFields = colorFields.substr(2);
+
+        colors.push_back(osg::Vec4(r, g, b, 1.0));
+    }
+}
+
 bool Model::readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* options)
 {
     OSG_INFO<<"Reading OBJ file"<<std::endl;
 
+    if (numParseThreads==0) return readOBJLineByLine(fin, options);
+    return readOBJBlocks(fin, options);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// The block parser reads the file in large blocks, splits each block into chunks of whole lines and parses
+// the v, vn, vt, f, l and p lines of the chunks in parallel, with hand written number parsers in place of
+// sscanf. The chunks are then merged in file order, applying the usemtl, o, g, s and mtllib lines between
+// the elements, so the resulting Model is the same as reading it line by line. Lines with a continuation,
+// very long lines and lines with unusual characters are still read with Model::readline(..).
+//
+namespace
+{
+
+enum CharacterClass
+{
+    ORDINARY_CHARACTER = 0,
+    END_OF_LINE,
+    SPECIAL_CHARACTER
+};
+
+struct CharacterClassTable
+{
+    CharacterClassTable()
+    {
+        memset(classes, ORDINARY_CHARACTER, sizeof(classes));
+        classes[static_cast<unsigned char>('\n')] = END_OF_LINE;
+        classes[static_cast<unsigned char>('\r')] = END_OF_LINE;
+        classes[static_cast<unsigned char>('\\')] = SPECIAL_CHARACTER;
+        classes[static_cast<unsigned char>('\0')] = SPECIAL_CHARACTER;
+        classes[static_cast<unsigned char>('\v')] = SPECIAL_CHARACTER;
+        classes[static_cast<unsigned char>('\f')] = SPECIAL_CHARACTER;
+    }
+
+    unsigned char classes[256];
+};
+
+static const CharacterClassTable s_characterClasses;
+
+// lines longer than this are split by Model::readline(..) so are left to it.
+static const std::ptrdiff_t MAXIMUM_BLOCK_LINE_LENGTH = 4000;
+
+static const size_t MINIMUM_CHUNK_SIZE = 1024*1024;
+static const size_t BLOCK_SIZE_PER_THREAD = 16*1024*1024;
+
+inline bool isEndOfLine(char c) { return c=='\n' || c=='\r'; }
+inline bool isBlank(char c) { return c==' ' || c=='\t'; }
+inline bool isSpace(char c) { return c==' ' || c=='\t' || c=='\v' || c=='\f'; }
+inline bool isDigit(char c) { return c>='0' && c<='9'; }
+
+// Return the first position at or after ptr that starts a new line, not continued from the previous line, or end.
+const char* findNextLineStart(const char* begin, const char* ptr, const char* end)
+{
+    while (ptr<end)
+    {
+        while (ptr<end && !isEndOfLine(*ptr)) ++ptr;
+        if (ptr==end) return end;
+
+        const char* runBegin = ptr;
+        while (runBegin>begin && isEndOfLine(*(runBegin-1))) --runBegin;
+        while (ptr<end && isEndOfLine(*ptr)) ++ptr;
+
+        if (runBegin==begin || *(runBegin-1)!='\\') return ptr;
+    }
+    return end;
+}
+
+// Return the last position in [begin, end) that starts a new line whose end of line run is complete, or 0.
+const char* findLastLineStart(const char* begin, const char* end)
+{
+    const char* ptr = end-1;
+    while (ptr>begin)
+    {
+        // the end of line run before ptr must be followed by the start of a line within the block.
+        if (isEndOfLine(*(ptr-1)) && !isEndOfLine(*ptr))
+        {
+            const char* runBegin = ptr-1;
+            while (runBegin>begin && isEndOfLine(*(runBegin-1))) --runBegin;
+            if (runBegin==begin || *(runBegin-1)!='\\') return ptr;
+            ptr = runBegin;
+        }
+        else --ptr;
+    }
+    return 0;
+}
+
+const double s_powersOf10[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Parse a float with strtof, the data is always null terminated after the last line.
+bool parseFloatWithStrtof(const char*& ptr, const char* end, float& value)
+{
+    char* numberEnd = 0;
+    float result = strtof(ptr, &numberEnd);
+    if (numberEnd==ptr || numberEnd>end) return false;
+
+    value = result;
+    ptr = numberEnd;
+    return true;
+}
+
+// Parse a float as sscanf's %f does. Decimal numbers with up to 19 significant digits and a small exponent are
+// converted exactly, as the mantissa and power of 10 are exact doubles, the rare double results that lie exactly
+// half way between two floats and all other forms are left to strtof.
+bool parseFloat(const char*& ptr, const char* end, float& value)
+{
+    while (ptr<end && isSpace(*ptr)) ++ptr;
+    if (ptr==end) return false;
+
+    const char* p = ptr;
+    bool negative = false;
+    if (*p=='-' || *p=='+') negative = (*(p++)=='-');
+
+    unsigned long long mantissa = 0;
+    int numSignificantDigits = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+    for(; p<end && isDigit(*p); ++p)
+    {
+        hasDigits = true;
+        if (mantissa==0 && *p=='0') continue;
+        if (++numSignificantDigits>19) return parseFloatWithStrtof(ptr, end, value);
+        mantissa = mantissa*10 + (*p-'0');
+    }
+
+    if (p<end && *p=='.')
+    {
+        for(++p; p<end && isDigit(*p); ++p)
+        {
+            hasDigits = true;
+            --exponent;
+            if (mantissa==0 && *p=='0') continue;
+            if (++numSignificantDigits>19) return parseFloatWithStrtof(ptr, end, value);
+            mantissa = mantissa*10 + (*p-'0');
+        }
+    }
+
+    if (!hasDigits || (p<end && (*p=='x' || *p=='X'))) return parseFloatWithStrtof(ptr, end, value);
+
+    if (p<end && (*p=='e' || *p=='E'))
+    {
+        const char* e = p+1;
+        bool negativeExponent = false;
+        if (e<end && (*e=='-' || *e=='+')) negativeExponent = (*(e++)=='-');
+
+        // sscanf consumes an exponent without digits, ignoring it.
+        int exponentValue = 0;
+        for(; e<end && isDigit(*e); ++e)
+        {
+            if (exponentValue<10000) exponentValue = exponentValue*10 + (*e-'0');
+        }
+        exponent += negativeExponent ? -exponentValue : exponentValue;
+        p = e;
+    }
+
+    float result = 0.0f;
+    if (mantissa!=0)
+    {
+        if (mantissa>=(1ULL<<53) || exponent<-22 || exponent>22) return parseFloatWithStrtof(ptr, end, value);
+
+        double d = static_cast<double>(mantissa);
+        d = (exponent<0) ? d/s_powersOf10[-exponent] : d*s_powersOf10[exponent];
+
+        result = static_cast<float>(d);
+        if (static_cast<double>(result)!=d)
+        {
+            float neighbour = nextafterf(result, d>static_cast<double>(result) ? HUGE_VALF : -HUGE_VALF);
+            if ((static_cast<double>(result)+static_cast<double>(neighbour))*0.5==d) return parseFloatWithStrtof(ptr, end, value);
+        }
+    }
+
+    value = negative ? -result : result;
+    ptr = p;
+    return true;
+}
+
+unsigned int parseFloats(const char* ptr, const char* end, float* values, unsigned int maximumNumValues)
+{
+    unsigned int numValues = 0;
+    while (numValues<maximumNumValues && parseFloat(ptr, end, values[numValues])) ++numValues;
+    return numValues;
+}
+
+// Parse an integer as sscanf's %d does.
+bool parseInt(const char*& ptr, const char* end, int& value)
+{
+    const char* p = ptr;
+    while (p<end && isSpace(*p)) ++p;
+
+    bool negative = false;
+    if (p<end && (*p=='-' || *p=='+')) negative = (*(p++)=='-');
+    if (p==end || !isDigit(*p)) return false;
+
+    long long result = 0;
+    for(; p<end && isDigit(*p); ++p)
+    {
+        if (result<=INT_MAX) result = result*10 + (*p-'0');
+    }
+    if (result>INT_MAX) result = INT_MAX;
+
+    value = static_cast<int>(negative ? -result : result);
+    ptr = p;
+    return true;
+}
+
+struct ReadElement
+{
+    osg::ref_ptr<Element>   element;
+    unsigned int            numVertices;
+    unsigned int            numNormals;
+    unsigned int            numTexCoords;
+};
+
+struct Chunk
+{
+    Chunk() : begin(0), end(0), firstVertex(0), firstNormal(0), firstTexCoord(0) {}
+
+    const char*                 begin;
+    const char*                 end;
+
+    Model::Vec3Array            vertices;
+    Model::Vec4Array            colors;
+    Model::Vec3Array            normals;
+    Model::Vec2Array            texcoords;
+
+    // the elements hold the indices as written in the file, along with the number of vertices, normals and
+    // texcoords read in the chunk before them, until remapIndices() is called.
+    std::vector<ReadElement>    elements;
+
+    // the usemtl, o, g, s, mtllib and unhandled lines, with the number of elements read before each.
+    typedef std::vector< std::pair<size_t, std::string> > StateLines;
+    StateLines                  stateLines;
+
+    unsigned int                firstVertex;
+    unsigned int                firstNormal;
+    unsigned int                firstTexCoord;
+};
+
+void parseElement(Chunk& chunk, Element::DataType dataType, const char* ptr, const char* end)
+{
+    osg::ref_ptr<Element> element = new Element(dataType);
+
+    int vi=0, ti=0, ni=0;
+    while (ptr<end)
+    {
+        // skip white space
+        while (ptr<end && isBlank(*ptr)) ++ptr;
+
+        // v/t/n, v//n, v/t or v
+        const char* p = ptr;
+        if (parseInt(p, end, vi))
+        {
+            element->vertexIndices.push_back(vi);
+            if (p<end && *p=='/')
+            {
+                ++p;
+                if (p<end && *p=='/')
+                {
+                    ++p;
+                    if (parseInt(p, end, ni)) element->normalIndices.push_back(ni);
+                }
+                else if (parseInt(p, end, ti))
+                {
+                    element->texCoordIndices.push_back(ti);
+                    if (p<end && *p=='/' && parseInt(++p, end, ni)) element->normalIndices.push_back(ni);
+                }
+            }
+        }
+
+        // skip to white space or end of line
+        while (ptr<end && !isBlank(*ptr)) ++ptr;
+    }
+
+    if (element->vertexIndices.empty()) return;
+
+    // normals and texcoords that aren't given for all the vertices are discarded, as are those out of range later.
+    if (element->normalIndices.size()!=element->vertexIndices.size()) element->normalIndices.clear();
+    if (element->texCoordIndices.size()!=element->vertexIndices.size()) element->texCoordIndices.clear();
+
+    ReadElement readElement;
+    readElement.element = element;
+    readElement.numVertices = chunk.vertices.size();
+    readElement.numNormals = chunk.normals.size();
+    readElement.numTexCoords = chunk.texcoords.size();
+    chunk.elements.push_back(readElement);
+}
+
+// Parse a line, if normalized is false the line is as written in the file, otherwise it has been read with
+// Model::readline(..) which strips the white space and converts tabs to spaces.
+void parseLine(Chunk& chunk, const char* begin, const char* end, bool normalized)
+{
+    if (!normalized)
+    {
+        while (begin<end && isBlank(*begin)) ++begin;
+        while (end>begin && *(end-1)==' ') --end;
+    }
+    if (begin==end) return;
+
+    std::ptrdiff_t length = end-begin;
+    if (*begin=='#' || *begin=='$')
+    {
+        if (length>=5 && strncmp(begin, "#MRGB", 5)==0)
+        {
+            std::string line(begin, end);
+            readZBrushColors(line.c_str(), chunk.colors);
+        }
+    }
+    else if (*begin=='v' && length>=2 && isBlank(begin[1]))
+    {
+        float values[7];
+        unsigned int fieldsRead = parseFloats(begin+2, end, values, 7);
+
+        if (fieldsRead==1) chunk.vertices.push_back(osg::Vec3(values[0],0.0f,0.0f));
+        else if (fieldsRead==2) chunk.vertices.push_back(osg::Vec3(values[0],values[1],0.0f));
+        else if (fieldsRead==3) chunk.vertices.push_back(osg::Vec3(values[0],values[1],values[2]));
+        else if (fieldsRead==4) chunk.vertices.push_back(osg::Vec3(values[0]/values[3],values[1]/values[3],values[2]/values[3]));
+        else if (fieldsRead==6 || fieldsRead==7)
+        {
+            chunk.vertices.push_back(osg::Vec3(values[0],values[1],values[2]));
+            chunk.colors.push_back(osg::Vec4(values[3],values[4],values[5],fieldsRead==7 ? values[6] : 1.0f));
+        }
+    }
+    else if (*begin=='v' && length>=3 && begin[1]=='n' && isBlank(begin[2]))
+    {
+        float values[3];
+        unsigned int fieldsRead = parseFloats(begin+3, end, values, 3);
+
+        if (fieldsRead==1) chunk.normals.push_back(osg::Vec3(values[0],0.0f,0.0f));
+        else if (fieldsRead==2) chunk.normals.push_back(osg::Vec3(values[0],values[1],0.0f));
+        else if (fieldsRead==3) chunk.normals.push_back(osg::Vec3(values[0],values[1],values[2]));
+    }
+    else if (*begin=='v' && length>=3 && begin[1]=='t' && isBlank(begin[2]))
+    {
+        float values[3];
+        unsigned int fieldsRead = parseFloats(begin+3, end, values, 3);
+
+        if (fieldsRead==1) chunk.texcoords.push_back(osg::Vec2(values[0],0.0f));
+        else if (fieldsRead>=2) chunk.texcoords.push_back(osg::Vec2(values[0],values[1]));
+    }
+    else if ((*begin=='f' || *begin=='l' || *begin=='p') && length>=2 && isBlank(begin[1]))
+    {
+        parseElement(chunk, (*begin=='p') ? Element::POINTS : (*begin=='l') ? Element::POLYLINE : Element::POLYGON, begin+2, end);
+    }
+    else
+    {
+        std::string line(begin, end);
+        for(std::string::iterator itr=line.begin(); itr!=line.end(); ++itr)
+        {
+            if (*itr=='\t') *itr = ' ';
+        }
+        chunk.stateLines.push_back(std::make_pair(chunk.elements.size(), line));
+    }
+}
+
+void parseChunk(Chunk& chunk, Model& model)
+{
+    const char* ptr = chunk.begin;
+    while (ptr<chunk.end)
+    {
+        const char* lineEnd = ptr;
+        bool special = false;
+        for(; lineEnd<chunk.end; ++lineEnd)
+        {
+            unsigned char characterClass = s_characterClasses.classes[static_cast<unsigned char>(*lineEnd)];
+            if (characterClass==END_OF_LINE) break;
+            if (characterClass==SPECIAL_CHARACTER) special = true;
+        }
+
+        if (special || lineEnd-ptr>MAXIMUM_BLOCK_LINE_LENGTH)
+        {
+            // read the lines up to the next line that isn't continued with Model::readline(..).
+            const char* spanEnd = findNextLineStart(chunk.begin, lineEnd, chunk.end);
+            std::istringstream sin(std::string(ptr, spanEnd));
+            sin.imbue(std::locale::classic());
+
+            const int LINE_SIZE = 4096;
+            char line[LINE_SIZE];
+            while (sin)
+            {
+                model.readline(sin, line, LINE_SIZE);
+                parseLine(chunk, line, line+strlen(line), true);
+            }
+            ptr = spanEnd;
+        }
+        else
+        {
+            parseLine(chunk, ptr, lineEnd, false);
+            ptr = lineEnd+1;
+        }
+    }
+}
+
+// Convert the indices as written in the file into indices into the Model's arrays, as readOBJLineByLine() does.
+void remapIndices(Chunk& chunk)
+{
+    for(std::vector<ReadElement>::iterator itr=chunk.elements.begin(); itr!=chunk.elements.end(); ++itr)
+    {
+        Element& element = *(itr->element);
+        int numVertices = chunk.firstVertex+itr->numVertices;
+        int numNormals = chunk.firstNormal+itr->numNormals;
+        int numTexCoords = chunk.firstTexCoord+itr->numTexCoords;
+
+        for(Element::IndexList::iterator index=element.vertexIndices.begin(); index!=element.vertexIndices.end(); ++index)
+        {
+            *index = (*index<0) ? numVertices+*index : *index-1;
+        }
+
+        Element::IndexList::iterator last = element.normalIndices.begin();
+        for(Element::IndexList::iterator index=element.normalIndices.begin(); index!=element.normalIndices.end(); ++index)
+        {
+            int ni = (*index<0) ? numNormals+*index : *index-1;
+            if (numNormals>0 && ni<numNormals) *(last++) = ni;
+        }
+        element.normalIndices.erase(last, element.normalIndices.end());
+        if (element.normalIndices.size()!=element.vertexIndices.size()) element.normalIndices.clear();
+
+        last = element.texCoordIndices.begin();
+        for(Element::IndexList::iterator index=element.texCoordIndices.begin(); index!=element.texCoordIndices.end(); ++index)
+        {
+            int ti = (*index<0) ? numTexCoords+*index : *index-1;
+            if (numTexCoords>0 && ti<numTexCoords) *(last++) = ti;
+        }
+        element.texCoordIndices.erase(last, element.texCoordIndices.end());
+        if (element.texCoordIndices.size()!=element.vertexIndices.size()) element.texCoordIndices.clear();
+    }
+}
+
+class ChunkThread : public OpenThreads::Thread
+{
+public:
+    ChunkThread(std::vector<Chunk>& chunks, OpenThreads::Atomic& nextChunk, Model* model) :
+        _chunks(chunks), _nextChunk(nextChunk), _model(model) {}
+
+    virtual void run()
+    {
+        for(unsigned int i=(++_nextChunk)-1; i<_chunks.size(); i=(++_nextChunk)-1)
+        {
+            if (_model) parseChunk(_chunks[i], *_model);
+            else remapIndices(_chunks[i]);
+        }
+    }
+
+protected:
+    std::vector<Chunk>&     _chunks;
+    OpenThreads::Atomic&    _nextChunk;
+    Model*                  _model;
+};
+
+// Parse the chunks, or remap their indices if model is 0, using up to numThreads threads.
+void applyToChunks(std::vector<Chunk>& chunks, unsigned int numThreads, Model* model)
+{
+    OpenThreads::Atomic nextChunk;
+    numThreads = osg::minimum(numThreads, static_cast<unsigned int>(chunks.size()));
+
+    // the calling thread works through the chunks along with the additional threads.
+    std::vector< ChunkThread* > threads;
+    for(unsigned int i=1; i<numThreads; ++i)
+    {
+        threads.push_back(new ChunkThread(chunks, nextChunk, model));
+        threads.back()->startThread();
+    }
+
+    ChunkThread(chunks, nextChunk, model).run();
+
+    for(std::vector< ChunkThread* >::iterator itr=threads.begin(); itr!=threads.end(); ++itr)
+    {
+        (*itr)->join();
+        delete *itr;
+    }
+}
+
+}
+
+bool Model::readOBJBlocks(std::istream& fin, const osgDB::ReaderWriter::Options* options)
+{
+    std::vector<char> buffer;
+    size_t numBuffered = 0;
+    bool endOfFile = false;
+    while (!endOfFile)
+    {
+        // read the next block after the partial line left from the previous block, growing the buffer for long lines.
+        size_t bufferSize = numBuffered + BLOCK_SIZE_PER_THREAD*numParseThreads;
+        buffer.resize(bufferSize+1);
+        fin.read(&buffer[numBuffered], bufferSize-numBuffered);
+        size_t size = numBuffered + static_cast<size_t>(fin.gcount());
+        endOfFile = !fin;
+
+        // null terminate the data for the number parsers.
+        buffer[size] = 0;
+
+        const char* begin = &buffer[0];
+        const char* end = begin+size;
+        const char* blockEnd = endOfFile ? end : findLastLineStart(begin, end);
+        if (!blockEnd)
+        {
+            numBuffered = size;
+            continue;
+        }
+
+        // split the block into chunks of whole lines.
+        size_t numChunks = osg::clampBetween(static_cast<size_t>(blockEnd-begin)/MINIMUM_CHUNK_SIZE, static_cast<size_t>(1), static_cast<size_t>(numParseThreads));
+        std::vector<Chunk> chunks(numChunks);
+        const char* chunkBegin = begin;
+        for(size_t i=0; i<numChunks; ++i)
+        {
+            chunks[i].begin = chunkBegin;
+            chunks[i].end = (i+1==numChunks) ? blockEnd : findNextLineStart(begin, chunkBegin+(blockEnd-chunkBegin)/(numChunks-i), blockEnd);
+            chunkBegin = chunks[i].end;
+        }
+
+        applyToChunks(chunks, numParseThreads, this);
+
+        unsigned int firstVertex = vertices.size(), firstNormal = normals.size(), firstTexCoord = texcoords.size();
+        for(std::vector<Chunk>::iterator itr=chunks.begin(); itr!=chunks.end(); ++itr)
+        {
+            itr->firstVertex = firstVertex;
+            itr->firstNormal = firstNormal;
+            itr->firstTexCoord = firstTexCoord;
+            firstVertex += itr->vertices.size();
+            firstNormal += itr->normals.size();
+            firstTexCoord += itr->texcoords.size();
+        }
+
+        applyToChunks(chunks, numParseThreads, 0);
+
+        // merge the chunks in file order.
+        for(std::vector<Chunk>::iterator itr=chunks.begin(); itr!=chunks.end(); ++itr)
+        {
+            Chunk& chunk = *itr;
+            vertices.insert(vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+            colors.insert(colors.end(), chunk.colors.begin(), chunk.colors.end());
+            normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+            texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+
+            Chunk::StateLines::iterator stateLine = chunk.stateLines.begin();
+            for(size_t i=0; i<chunk.elements.size(); ++i)
+            {
+                for(; stateLine!=chunk.stateLines.end() && stateLine->first<=i; ++stateLine)
+                {
+                    readStateLine(stateLine->second.c_str(), options);
+                }
+                addReadElement(chunk.elements[i].element.get());
+            }
+
+            for(; stateLine!=chunk.stateLines.end(); ++stateLine)
+            {
+                readStateLine(stateLine->second.c_str(), options);
+            }
+        }
+
+        // keep the partial line at the end of the block for the next block.
+        numBuffered = end-blockEnd;
+        if (numBuffered>0) memmove(&buffer[0], blockEnd, numBuffered);
+    }
+
+    return true;
+}
+
+bool Model::readOBJLineByLine(std::istream& fin, const osgDB::ReaderWriter::Options* options)
+{
     fin.imbue(std::locale::classic());
 
     const int LINE_SIZE = 4096;
     char line[LINE_SIZE];
     float x = 0.0f, y = 0.0f, z = 0.0f, w = 0.0f;
-    float r,g,b,a;
+    float g,b,a;
 
     while (fin)
     {
@@ -586,30 +1185,7 @@ bool Model::readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* optio
         }
         else if(isZBrushColorField(line))
         {
-            // Get the zBrush vertex colors given in comments under the form :
-            // * #MRGB MMRRGGBB MMRRGGBB ... (up to 64 hexadecimal color fields)
-            std::string colorFields(line + 6);
-            while (colorFields.size() >= 8)
-            {
-                std::string currentValue;
-
-                // Skipping the MM component
-                colorFields = colorFields.substr(2);
-
-                currentValue = colorFields.substr(0,2);
-                r = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
-                colorFields = colorFields.substr(2);
-
-                currentValue = colorFields.substr(0,2);
-                g = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
-                colorFields = colorFields.substr(2);
-
-                currentValue = colorFields.substr(0,2);
-                b = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
-                colorFields = colorFields.substr(2);
-
-                colors.push_back(osg::Vec4(r, g, b, 1.0));
-            }
+            readZBrushColors(line, colors);
         }
         else if (strlen(line)>0)
         {
@@ -658,7 +1234,7 @@ bool Model::readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* optio
             {
                 char* ptr = line+2;
 
-                Element* element = new Element( (line[0]=='p') ? Element::POINTS :
+                osg::ref_ptr<Element> element = new Element( (line[0]=='p') ? Element::POINTS :
                                                 (line[0]=='l') ? Element::POLYLINE :
                                                 Element::POLYGON );
 
@@ -706,112 +1282,11 @@ bool Model::readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* optio
                     element->texCoordIndices.clear();
                 }
 
-                if (!element->vertexIndices.empty())
-                {
-                    Element::CoordinateCombination coordateCombination = element->getCoordinateCombination();
-                    if (coordateCombination!=currentElementState.coordinateCombination)
-                    {
-                        currentElementState.coordinateCombination = coordateCombination;
-                        currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                    }
-                    addElement(element);
-                }
-                else
-                {
-                    // empty element, don't both adding, just unref to delete it.
-                    element->unref();
-                }
-
-            }
-            else if (strncmp(line,"usemtl ",7)==0)
-            {
-                std::string materialName( line+7 );
-                if (currentElementState.materialName != materialName)
-                {
-                    currentElementState.materialName = materialName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
-            }
-            else if (strncmp(line,"mtllib ",7)==0)
-            {
-                std::string materialFileName = trim( line+7 );
-                std::string fullPathFileName = osgDB::findDataFile( materialFileName, options );
-                if (!fullPathFileName.empty())
-                {
-                    osgDB::ifstream mfin( fullPathFileName.c_str() );
-                    if (mfin)
-                    {
-                        OSG_INFO << "Obj reading mtllib '" << fullPathFileName << "'\n";
-                        readMTL(mfin);
-                    }
-                    else
-                    {
-                        OSG_WARN << "Obj unable to load mtllib '" << fullPathFileName << "'\n";
-                    }
-                }
-                else
-                {
-                    OSG_WARN << "Obj unable to find mtllib '" << materialFileName << "'\n";
-                }
-            }
-            else if (strncmp(line,"o ",2)==0)
-            {
-                std::string objectName(line+2);
-                if (currentElementState.objectName != objectName)
-                {
-                    currentElementState.objectName = objectName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
-            }
-            else if (strcmp(line,"o")==0)
-            {
-                std::string objectName(""); // empty name
-                if (currentElementState.objectName != objectName)
-                {
-                    currentElementState.objectName = objectName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
-            }
-            else if (strncmp(line,"g ",2)==0)
-            {
-                std::string groupName(line+2);
-                if (currentElementState.groupName != groupName)
-                {
-                    currentElementState.groupName = groupName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
-            }
-            else if (strcmp(line,"g")==0)
-            {
-                std::string groupName(""); // empty name
-                if (currentElementState.groupName != groupName)
-                {
-                    currentElementState.groupName = groupName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
-            }
-            else if (strncmp(line,"s ",2)==0)
-            {
-                int smoothingGroup=0;
-                if (strncmp(line+2,"off",3)==0) smoothingGroup = 0;
-                else
-                {
-                    int result = sscanf(line+2,"%d",&smoothingGroup);
-                    if (result!=1)
-                    {
-                        OSG_NOTICE <<"*** error reading smoothing group ***"<<std::endl;
-                    }
-                }
-
-                if (currentElementState.smoothingGroup != smoothingGroup)
-                {
-                    currentElementState.smoothingGroup = smoothingGroup;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
+                addReadElement(element.get());
             }
             else
             {
-                OSG_NOTICE <<"*** line not handled *** :"<<line<<std::endl;
+                readStateLine(line, options);
             }
 
         }
@@ -844,6 +1319,114 @@ bool Model::readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* optio
 }
 
 
+void Model::readStateLine(const char* line, const osgDB::ReaderWriter::Options* options)
+{
+    if (strncmp(line,"usemtl ",7)==0)
+    {
+        std::string materialName( line+7 );
+        if (currentElementState.materialName != materialName)
+        {
+            currentElementState.materialName = materialName;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else if (strncmp(line,"mtllib ",7)==0)
+    {
+        std::string materialFileName = trim( line+7 );
+        std::string fullPathFileName = osgDB::findDataFile( materialFileName, options );
+        if (!fullPathFileName.empty())
+        {
+            osgDB::ifstream mfin( fullPathFileName.c_str() );
+            if (mfin)
+            {
+                OSG_INFO << "Obj reading mtllib '" << fullPathFileName << "'\n";
+                readMTL(mfin);
+            }
+            else
+            {
+                OSG_WARN << "Obj unable to load mtllib '" << fullPathFileName << "'\n";
+            }
+        }
+        else
+        {
+            OSG_WARN << "Obj unable to find mtllib '" << materialFileName << "'\n";
+        }
+    }
+    else if (strncmp(line,"o ",2)==0)
+    {
+        std::string objectName(line+2);
+        if (currentElementState.objectName != objectName)
+        {
+            currentElementState.objectName = objectName;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else if (strcmp(line,"o")==0)
+    {
+        std::string objectName(""); // empty name
+        if (currentElementState.objectName != objectName)
+        {
+            currentElementState.objectName = objectName;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else if (strncmp(line,"g ",2)==0)
+    {
+        std::string groupName(line+2);
+        if (currentElementState.groupName != groupName)
+        {
+            currentElementState.groupName = groupName;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else if (strcmp(line,"g")==0)
+    {
+        std::string groupName(""); // empty name
+        if (currentElementState.groupName != groupName)
+        {
+            currentElementState.groupName = groupName;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else if (strncmp(line,"s ",2)==0)
+    {
+        int smoothingGroup=0;
+        if (strncmp(line+2,"off",3)==0) smoothingGroup = 0;
+        else
+        {
+            int result = sscanf(line+2,"%d",&smoothingGroup);
+            if (result!=1)
+            {
+                OSG_NOTICE <<"*** error reading smoothing group ***"<<std::endl;
+            }
+        }
+
+        if (currentElementState.smoothingGroup != smoothingGroup)
+        {
+            currentElementState.smoothingGroup = smoothingGroup;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else
+    {
+        OSG_NOTICE <<"*** line not handled *** :"<<line<<std::endl;
+    }
+}
+
+void Model::addReadElement(Element* element)
+{
+    // empty elements aren't added.
+    if (element->vertexIndices.empty()) return;
+
+    Element::CoordinateCombination coordateCombination = element->getCoordinateCombination();
+    if (coordateCombination!=currentElementState.coordinateCombination)
+    {
+        currentElementState.coordinateCombination = coordateCombination;
+        currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+    }
+    addElement(element);
+}
+
 void Model::addElement(Element* element)
 {
     if (!currentElementList)
@@ -189,16 +189,26 @@ class Model
 {
 public:
     Model():
+        numParseThreads(1),
         currentElementList(0) {}
 
     void setDatabasePath(const std::string& path) { databasePath = path; }
     const std::string& getDatabasePath() const { return databasePath; }
 
+    /** Set the number of threads readOBJ(..) parses the blocks of the file with,
+      * 0 reads the file a line at a time with readOBJLineByLine(..).*/
+    void setNumParseThreads(unsigned int numThreads) { numParseThreads = numThreads; }
+    unsigned int getNumParseThreads() const { return numParseThreads; }
+
     std::string lastComponent(const char* linep);
     bool readMTL(std::istream& fin);
     bool readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* options);
+    bool readOBJBlocks(std::istream& fin, const osgDB::ReaderWriter::Options* options);
+    bool readOBJLineByLine(std::istream& fin, const osgDB::ReaderWriter::Options* options);
 
     bool readline(std::istream& fin, char* line, const int LINE_SIZE);
+    void readStateLine(const char* line, const osgDB::ReaderWriter::Options* options);
+    void addReadElement(Element* element);
     void addElement(Element* element);
 
     osg::Vec3 averageNormal(const Element& element) const;
@@ -218,6 +228,7 @@ public:
 
 
     std::string     databasePath;
+    unsigned int    numParseThreads;
     MaterialMap     materialMap;
 
     Vec3Array       vertices;
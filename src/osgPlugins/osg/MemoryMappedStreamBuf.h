@@ -0,0 +1,132 @@
+#ifndef OSG2_MEMORYMAPPEDSTREAMBUF
+#define OSG2_MEMORYMAPPEDSTREAMBUF
+
+#include <osgDB/ConvertUTF>
+#include <streambuf>
+#include <string>
+#include <string.h>
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+// A read only std::streambuf over a memory mapped file, the whole file is presented as the get area so that
+// std::istream::read(..) copies each block, such as the vertex arrays and image data, with a single memcpy from
+// the mapping without going through a file buffer.
+class MemoryMappedStreamBuf : public std::streambuf
+{
+public:
+    MemoryMappedStreamBuf( const std::string& fileName ) : _data(0), _size(0)
+    {
+#ifdef _WIN32
+        _mapping = NULL;
+    #ifdef OSG_USE_UTF8_FILENAME
+        HANDLE file = CreateFileW( osgDB::convertUTF8toUTF16(fileName).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                                   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL|FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+    #else
+        HANDLE file = CreateFileA( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                                   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL|FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+    #endif
+        if ( file==INVALID_HANDLE_VALUE ) return;
+
+        LARGE_INTEGER fileSize;
+        if ( GetFileSizeEx(file, &fileSize) && fileSize.QuadPart>0 && (unsigned long long)fileSize.QuadPart<=(size_t)-1 )
+        {
+            _mapping = CreateFileMapping( file, NULL, PAGE_READONLY, 0, 0, NULL );
+            if ( _mapping!=NULL )
+            {
+                _data = static_cast<char*>( MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0) );
+                if ( _data ) _size = static_cast<size_t>( fileSize.QuadPart );
+                else { CloseHandle(_mapping); _mapping = NULL; }
+            }
+        }
+        CloseHandle( file );
+#else
+        int fd = open( fileName.c_str(), O_RDONLY );
+        if ( fd<0 ) return;
+
+        struct stat fileStat;
+        if ( fstat(fd, &fileStat)==0 && fileStat.st_size>0 && (unsigned long long)fileStat.st_size<=(size_t)-1 )
+        {
+            void* data = mmap( 0, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0 );
+            if ( data!=MAP_FAILED )
+            {
+                _data = static_cast<char*>( data );
+                _size = static_cast<size_t>( fileStat.st_size );
+    #ifdef MADV_SEQUENTIAL
+                madvise( data, _size, MADV_SEQUENTIAL );
+    #endif
+            }
+        }
+        close( fd );
+#endif
+        if ( _data ) setg( _data, _data, _data+_size );
+    }
+
+    virtual ~MemoryMappedStreamBuf()
+    {
+        if ( !_data ) return;
+#ifdef _WIN32
+        UnmapViewOfFile( _data );
+        CloseHandle( _mapping );
+#else
+        munmap( _data, _size );
+#endif
+    }
+
+    bool valid() const { return _data!=0; }
+
+protected:
+    virtual int_type underflow()
+    { return gptr()<egptr() ? traits_type::to_int_type(*gptr()) : traits_type::eof(); }
+
+    virtual std::streamsize xsgetn( char* s, std::streamsize n )
+    {
+        std::streamsize available = static_cast<std::streamsize>(egptr()-gptr());
+        if ( n>available ) n = available;
+        if ( n>0 )
+        {
+            memcpy( s, gptr(), static_cast<size_t>(n) );
+            setg( eback(), gptr()+n, egptr() );
+        }
+        return n;
+    }
+
+    virtual std::streamsize showmanyc()
+    { return gptr()<egptr() ? static_cast<std::streamsize>(egptr()-gptr()) : -1; }
+
+    virtual pos_type seekoff( off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which )
+    {
+        if ( !(which&std::ios_base::in) ) return pos_type(off_type(-1));
+
+        off_type position = off;
+        if ( dir==std::ios_base::cur ) position += static_cast<off_type>(gptr()-eback());
+        else if ( dir==std::ios_base::end ) position += static_cast<off_type>(_size);
+        return seekpos( pos_type(position), which );
+    }
+
+    virtual pos_type seekpos( pos_type pos, std::ios_base::openmode which )
+    {
+        off_type position = off_type(pos);
+        if ( !(which&std::ios_base::in) || position<0 || position>static_cast<off_type>(_size) ) return pos_type(off_type(-1));
+
+        setg( eback(), eback()+position, egptr() );
+        return pos;
+    }
+
+    char*   _data;
+    size_t  _size;
+#ifdef _WIN32
+    HANDLE  _mapping;
+#endif
+};
+
+#endif
@@ -20,6 +20,7 @@
 #include "AsciiStreamOperator.h"
 #include "BinaryStreamOperator.h"
 #include "XmlStreamOperator.h"
+#include "MemoryMappedStreamBuf.h"
 
 using namespace osgDB;
 
@@ -128,9 +129,15 @@ public:
         supportsOption( "Ascii", "Import/Export option: Force reading/writing ascii file" );
         supportsOption( "XML", "Import/Export option: Force reading/writing XML file" );
         supportsOption( "ForceReadingImage", "Import option: Load an empty image instead if required file missed" );
+        supportsOption( "MemoryMapped", "Import option: Read files through a memory mapping of the whole file" );
+        supportsOption( "DecompressWholeStream", "Import option: Decompress the whole stream into memory before reading it" );
+        supportsOption( "DecompressionThreads=<num>", "Import option: Number of threads block compressors decompress with, 0 for all processors" );
         supportsOption( "SchemaData", "Export option: Record inbuilt schema data into a binary file" );
         supportsOption( "SchemaFile=<file>", "Import/Export option: Use/Record an ascii schema file" );
         supportsOption( "Compressor=<name>", "Export option: Use an inbuilt or user-defined compressor" );
+        supportsOption( "CompressionLevel=<level>", "Export option: Compression level of the block compressors" );
+        supportsOption( "CompressionBlockSize=<bytes>", "Export option: Size of the blocks block compressors compress independently" );
+        supportsOption( "CompressionThreads=<num>", "Export option: Number of threads block compressors compress with, 0 for all processors" );
         supportsOption( "WriteImageHint=<hint>", "Export option: Hint of writing image to stream: "
                         "<IncludeData> writes Image::data() directly; "
                         "<IncludeFile> writes the image file itself to stream; "
@@ -182,6 +189,16 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        if ( local_opt->getPluginStringData("MemoryMapped")=="true" )
+        {
+            MemoryMappedStreamBuf buffer( fileName );
+            if ( buffer.valid() )
+            {
+                std::istream istream( &buffer );
+                return readObject( istream, local_opt );
+            }
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readObject( istream, local_opt );
     }
@@ -213,6 +230,16 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        if ( local_opt->getPluginStringData("MemoryMapped")=="true" )
+        {
+            MemoryMappedStreamBuf buffer( fileName );
+            if ( buffer.valid() )
+            {
+                std::istream istream( &buffer );
+                return readImage( istream, local_opt );
+            }
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readImage( istream, local_opt );
     }
@@ -244,6 +271,16 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        if ( local_opt->getPluginStringData("MemoryMapped")=="true" )
+        {
+            MemoryMappedStreamBuf buffer( fileName );
+            if ( buffer.valid() )
+            {
+                std::istream istream( &buffer );
+                return readNode( istream, local_opt );
+            }
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readNode( istream, local_opt );
     }
@@ -42,6 +42,14 @@ public:
     ReaderWriterPLY()
     {
         supportsExtension("ply","Stanford Triangle Format");
+        supportsOption("pointCloudStream","Read a point cloud a chunk at a time into an in memory octree.");
+        supportsOption("pointCloudTiles=<directory>","Read a point cloud a chunk at a time into an octree of paged tiles written to the directory.");
+        supportsOption("pointCloudMemoryBudget=<megabytes>","Memory budget of the point cloud tile build.");
+        supportsOption("pointCloudPointsPerTile=<num>","Maximum number of points in each point cloud octree tile.");
+        supportsOption("pointCloudThreads=<num>","Number of threads building the point cloud octree, defaults to the number of processors.");
+        supportsOption("pointCloudChunkSize=<num>","Number of points read from the file in each chunk.");
+        supportsOption("pointCloudBudget=<num>","Maximum number of points of the point cloud drawn each frame.");
+        supportsOption("pointCloudSpacing=<pixels>","Projected point spacing below which the point cloud octree isn't refined.");
     }
 
     virtual const char* className() const { return "ReaderWriterPLY"; }
@@ -76,6 +84,22 @@ osgDB::ReaderWriter::ReadResult ReaderWriterPLY::readNode(const std::string& fil
     std::string fileName = osgDB::findDataFile(filename, options);
     if (fileName.empty()) return ReadResult::FILE_NOT_FOUND;
 
+    // point clouds can be streamed into an octree of tiles, files with faces are read as a whole.
+    osg::ref_ptr<osgDB::PointCloudBuilder> builder = new osgDB::PointCloudBuilder;
+    builder->setNumThreads(0);
+    if (builder->readOptions(options))
+    {
+        osg::ref_ptr<ply::PointSource> source = new ply::PointSource(fileName);
+        if (source->open())
+        {
+            osg::ref_ptr<osg::Node> node = builder->build(*source, osgDB::getStrippedName(fileName));
+            if (node.valid()) return node.get();
+            return ReadResult::ERROR_IN_READING_FILE;
+        }
+
+        OSG_INFO << "ReaderWriterPLY: " << fileName << " isn't a point cloud, reading it as a whole." << std::endl;
+    }
+
     //Instance of vertex data which will read the ply file and convert in to osg::Node
     ply::VertexData vertexData;
     osg::Node* node = vertexData.readPlyFile(fileName.c_str());
@@ -562,3 +562,157 @@ osg::Node* VertexData::readPlyFile( const char* filename, const bool ignoreColor
 }
 
 
+
+/*  Temporary vertex structure for point cloud loading.  */
+struct _Point
+{
+    float           x;
+    float           y;
+    float           z;
+    unsigned char   red;
+    unsigned char   green;
+    unsigned char   blue;
+    unsigned char   alpha;
+};
+
+
+ply::PointSource::PointSource( const std::string& fileName )
+    : _fileName( fileName ),
+      _file( NULL ),
+      _numVertices( 0 ),
+      _numRead( 0 ),
+      _hasColors( false ),
+      _hasAlpha( false )
+{
+}
+
+
+ply::PointSource::~PointSource()
+{
+    close();
+}
+
+
+void ply::PointSource::close()
+{
+    if( _file )
+    {
+        ply_close( _file );
+        _file = NULL;
+    }
+}
+
+
+/*  Open the file and set up reading its vertices, which need to be the first element, without any faces.  */
+bool ply::PointSource::open()
+{
+    close();
+
+    int     nPlyElems;
+    char**  elemNames = NULL;
+    int     fileType;
+    float   version;
+
+    try
+    {
+        _file = ply_open_for_reading( const_cast< char* >( _fileName.c_str() ),
+                                      &nPlyElems, &elemNames,
+                                      &fileType, &version );
+    }
+    catch( exception& e )
+    {
+        MESHERROR << "Unable to read PLY file, an exception occurred:  "
+                  << e.what() << endl;
+    }
+
+    if( !_file )
+        return false;
+
+    bool isPointCloud = nPlyElems > 0 && equal_strings( elemNames[0], "vertex" );
+    for( int i = 1; i < nPlyElems; ++i )
+    {
+        if( _file->elems[i]->num > 0 )
+            isPointCloud = false;
+    }
+
+    if( isPointCloud )
+    {
+        int nProps;
+        PlyProperty** props = ply_get_element_description( _file, elemNames[0], &_numVertices, &nProps );
+
+        _hasColors = false;
+        _hasAlpha = false;
+        for( int j = 0; j < nProps; ++j )
+        {
+            if( equal_strings( props[j]->name, "red" ) )
+                _hasColors = true;
+            if( equal_strings( props[j]->name, "alpha" ) )
+                _hasAlpha = true;
+            free( props[j] );
+        }
+        free( props );
+
+        PlyProperty pointProps[] =
+        {
+            { "x", PLY_FLOAT, PLY_FLOAT, offsetof( _Point, x ), 0, 0, 0, 0 },
+            { "y", PLY_FLOAT, PLY_FLOAT, offsetof( _Point, y ), 0, 0, 0, 0 },
+            { "z", PLY_FLOAT, PLY_FLOAT, offsetof( _Point, z ), 0, 0, 0, 0 },
+            { "red", PLY_UCHAR, PLY_UCHAR, offsetof( _Point, red ), 0, 0, 0, 0 },
+            { "green", PLY_UCHAR, PLY_UCHAR, offsetof( _Point, green ), 0, 0, 0, 0 },
+            { "blue", PLY_UCHAR, PLY_UCHAR, offsetof( _Point, blue ), 0, 0, 0, 0 },
+            { "alpha", PLY_UCHAR, PLY_UCHAR, offsetof( _Point, alpha ), 0, 0, 0, 0 },
+        };
+
+        int numProps = _hasAlpha ? 7 : ( _hasColors ? 6 : 3 );
+        for( int i = 0; i < numProps; ++i )
+            ply_get_property( _file, "vertex", &pointProps[i] );
+    }
+
+    for( int i = 0; i < nPlyElems; ++i )
+        free( elemNames[i] );
+    free( elemNames );
+
+    _numRead = 0;
+    if( !isPointCloud )
+        close();
+
+    return isPointCloud;
+}
+
+
+bool ply::PointSource::readChunk( osgDB::PointCloudBuilder::Points& points, unsigned int maxNumPoints )
+{
+    if( !_file )
+        return false;
+
+    _Point point;
+    point.red = point.green = point.blue = point.alpha = 255;
+
+    int numPoints = std::min( _numVertices - _numRead, static_cast< int >( maxNumPoints ) );
+    points.reserve( points.size() + numPoints );
+    try
+    {
+        for( int i = 0; i < numPoints; ++i )
+        {
+            ply_get_element( _file, static_cast< void* >( &point ) );
+            points.push_back( osgDB::PointCloudBuilder::Point( osg::Vec3( point.x, point.y, point.z ),
+                                                               osg::Vec4ub( point.red, point.green, point.blue, point.alpha ) ) );
+        }
+    }
+    catch( exception& e )
+    {
+        MESHERROR << "Unable to read vertex in PLY file, an exception occurred:  "
+                  << e.what() << endl;
+        close();
+        return false;
+    }
+
+    _numRead += numPoints;
+    return _numRead < _numVertices;
+}
+
+
+bool ply::PointSource::reset()
+{
+    return open();
+}
@@ -16,6 +16,8 @@
 #include <osg/Node>
 #include <osg/PrimitiveSet>
 
+#include <osgDB/PointCloudBuilder>
+
 #include <vector>
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -84,6 +86,32 @@ namespace ply
         osg::ref_ptr<osg::DrawElementsUInt> _triangles;
         osg::ref_ptr<osg::DrawElementsUInt> _quads;
     };
+
+    /*  Reads the vertices of a ply point cloud a chunk at a time for the osgDB::PointCloudBuilder.  */
+    class PointSource : public osgDB::PointCloudBuilder::PointSource
+    {
+    public:
+        PointSource( const std::string& fileName );
+
+        // Opens the file, returning false if it can't be read or isn't a point cloud
+        bool open();
+
+        virtual bool readChunk( osgDB::PointCloudBuilder::Points& points, unsigned int maxNumPoints );
+
+        virtual bool reset();
+
+    protected:
+        virtual ~PointSource();
+
+        void close();
+
+        std::string _fileName;
+        PlyFile*    _file;
+        int         _numVertices;
+        int         _numRead;
+        bool        _hasColors;
+        bool        _hasAlpha;
+    };
 }
 
 
@@ -39,13 +39,18 @@
 #include <osg/Geode>
 #include <osg/Geometry>
 
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Thread>
+
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
 #include <string.h>
+#include <stdlib.h>
 #include <memory>
 #include <iomanip>
+#include <vector>
 
 #include <iostream>
 #include <iomanip>
@@ -55,6 +60,9 @@ struct STLOptionsStruct {
     bool separateFiles;
     bool dontSaveNormals;
     bool noTriStripPolygons;
+    bool weldVertices;
+    bool perFacetRead;
+    unsigned int numParseThreads;
 };
 
 STLOptionsStruct parseOptions(const osgDB::ReaderWriter::Options* options)  {
@@ -64,6 +72,9 @@ STLOptionsStruct parseOptions(const osgDB::ReaderWriter::Options* options)  {
     localOptions.separateFiles = false;
     localOptions.dontSaveNormals = false;
     localOptions.noTriStripPolygons = false;
+    localOptions.weldVertices = false;
+    localOptions.perFacetRead = false;
+    localOptions.numParseThreads = osg::maximum(OpenThreads::GetNumberOfProcessors(), 1);
 
     if (options != NULL)
     {
@@ -87,12 +98,124 @@ STLOptionsStruct parseOptions(const osgDB::ReaderWriter::Options* options)  {
             {
                 localOptions.noTriStripPolygons = true;
             }
+            else if (opt == "weldVertices")
+            {
+                localOptions.weldVertices = true;
+            }
+            else if (opt == "perFacetRead")
+            {
+                localOptions.perFacetRead = true;
+            }
+            else if (opt.compare(0, 13, "parseThreads=") == 0)
+            {
+                localOptions.numParseThreads = osg::maximum(atoi(opt.c_str() + 13), 1);
+            }
         }
     }
 
     return localOptions;
 }
 
+inline unsigned int hashFloats(unsigned int hash, const float* values, unsigned int numValues)
+{
+    for (unsigned int i = 0; i < numValues; ++i)
+    {
+        unsigned int bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        bits *= 0xcc9e2d51u;
+        bits = (bits << 15) | (bits >> 17);
+        hash ^= bits * 0x1b873593u;
+        hash = ((hash << 13) | (hash >> 19)) * 5u + 0xe6546b64u;
+    }
+    return hash;
+}
+
+/**
+ * Merge the vertices of non indexed triangles whose position, normal and colour are bitwise identical, using an
+ * open addressing hash table of indices into the welded arrays. The normals and colours are optional, the arrays
+ * passed in are replaced by the welded arrays and the triangles indexing them are returned.
+ */
+static osg::ref_ptr<osg::DrawElementsUInt> weldVertices(osg::ref_ptr<osg::Vec3Array>& vertices, osg::ref_ptr<osg::Vec3Array>& normals, osg::ref_ptr<osg::Vec4Array>& colors)
+{
+    const unsigned int numVertices = vertices->size();
+
+    unsigned int tableSize = 1;
+    while (tableSize < numVertices * 2) tableSize <<= 1;
+    const unsigned int unused = ~0u;
+    std::vector<unsigned int> table(tableSize, unused);
+
+    osg::ref_ptr<osg::Vec3Array> weldedVertices = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec3Array> weldedNormals = normals.valid() ? new osg::Vec3Array : 0;
+    osg::ref_ptr<osg::Vec4Array> weldedColors = colors.valid() ? new osg::Vec4Array : 0;
+    osg::ref_ptr<osg::DrawElementsUInt> triangles = new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES);
+    triangles->reserve(numVertices);
+
+    for (unsigned int i = 0; i < numVertices; ++i)
+    {
+        const osg::Vec3& vertex = (*vertices)[i];
+        unsigned int hash = hashFloats(0, vertex.ptr(), 3);
+        if (normals.valid()) hash = hashFloats(hash, (*normals)[i].ptr(), 3);
+        if (colors.valid()) hash = hashFloats(hash, (*colors)[i].ptr(), 4);
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6bu;
+        hash ^= hash >> 13;
+
+        unsigned int slot = hash & (tableSize - 1);
+        for (; table[slot] != unused; slot = (slot + 1) & (tableSize - 1))
+        {
+            unsigned int index = table[slot];
+            if (memcmp(&(*weldedVertices)[index], &vertex, sizeof(osg::Vec3)) == 0 &&
+                (!normals.valid() || memcmp(&(*weldedNormals)[index], &(*normals)[i], sizeof(osg::Vec3)) == 0) &&
+                (!colors.valid() || memcmp(&(*weldedColors)[index], &(*colors)[i], sizeof(osg::Vec4)) == 0))
+            {
+                break;
+            }
+        }
+
+        if (table[slot] == unused)
+        {
+            table[slot] = weldedVertices->size();
+            weldedVertices->push_back(vertex);
+            if (normals.valid()) weldedNormals->push_back((*normals)[i]);
+            if (colors.valid()) weldedColors->push_back((*colors)[i]);
+        }
+        triangles->push_back(table[slot]);
+    }
+
+    vertices = weldedVertices;
+    normals = weldedNormals;
+    colors = weldedColors;
+    return triangles;
+}
+
+// A line of an ASCII file parsed by the block reader, the chunks of a block are parsed in parallel and their lines
+// then replayed in file order by the AsciiReaderObject.
+struct StlAsciiLine
+{
+    enum Type
+    {
+        VERTEX,
+        FACET,
+        SOLID,
+        ENDSOLID
+    };
+
+    StlAsciiLine(Type lineType, const osg::Vec3& lineValue = osg::Vec3()) : type(lineType), value(lineValue) {}
+
+    Type type;
+    osg::Vec3 value;
+};
+
+struct StlAsciiChunk
+{
+    StlAsciiChunk() : begin(0), end(0) {}
+
+    const char* begin;
+    const char* end;
+    std::vector<StlAsciiLine> lines;
+    std::vector<std::string> solidNames;
+};
+
 /**
  * STL importer for OpenSceneGraph.
  */
@@ -106,6 +229,10 @@ public:
         supportsOption("smooth", "Run SmoothingVisitor");
         supportsOption("separateFiles", "Save each geode in a different file. Can result in a huge amount of files!");
         supportsOption("dontSaveNormals", "Set all normals to [0 0 0] when saving to a file.");
+        supportsOption("noTriStripPolygons", "Do not run the mesh optimizers on the read geometry.");
+        supportsOption("weldVertices", "Merge the identical vertices of the facets into indexed triangles, with smooth only the positions need to match.");
+        supportsOption("parseThreads=<num>", "Number of threads parsing each block of an ASCII file, defaults to the number of processors.");
+        supportsOption("perFacetRead", "Read a binary file a facet at a time and an ASCII file a line at a time instead of in blocks.");
     }
 
     virtual const char* className() const
@@ -128,6 +255,8 @@ private:
         ReaderObject(bool noTriStripPolygons, bool generateNormals = true):
             _noTriStripPolygons(noTriStripPolygons),
             _generateNormal(generateNormals),
+            _weldVertices(false),
+            _weldPositionsOnly(false),
             _numFacets(0)
         {
         }
@@ -149,12 +278,13 @@ private:
         {
             osg::ref_ptr<osg::Geometry> geom = new osg::Geometry;
 
-            geom->setVertexArray(_vertex.get());
+            osg::ref_ptr<osg::Vec3Array> vertices = _vertex;
 
-            if (_normal.valid())
+            osg::ref_ptr<osg::Vec3Array> perVertexNormals;
+            if (_normal.valid() && !(_weldVertices && _weldPositionsOnly))
             {
                 // need to convert per triangle normals to per vertex
-                osg::ref_ptr<osg::Vec3Array> perVertexNormals = new osg::Vec3Array;
+                perVertexNormals = new osg::Vec3Array;
                 perVertexNormals->reserveArray(_normal->size() * 3);
                 for(osg::Vec3Array::iterator itr = _normal->begin();
                     itr != _normal->end();
@@ -164,15 +294,14 @@ private:
                     perVertexNormals->push_back(*itr);
                     perVertexNormals->push_back(*itr);
                 }
-
-                geom->setNormalArray(perVertexNormals.get(), osg::Array::BIND_PER_VERTEX);
             }
 
+            osg::ref_ptr<osg::Vec4Array> perVertexColours;
             if (_color.valid())
             {
                 // need to convert per triangle colours to per vertex
                 OSG_INFO << "STL file with color" << std::endl;
-                osg::ref_ptr<osg::Vec4Array> perVertexColours = new osg::Vec4Array;
+                perVertexColours = new osg::Vec4Array;
                 perVertexColours->reserveArray(_color->size() * 3);
                 for(osg::Vec4Array::iterator itr = _color->begin();
                     itr != _color->end();
@@ -183,12 +312,29 @@ private:
                     perVertexColours->push_back(*itr);
                 }
 
-                if(perVertexColours->size() == geom->getVertexArray()->getNumElements()) {
-                    geom->setColorArray(perVertexColours.get(), osg::Array::BIND_PER_VERTEX);
+                if(!vertices.valid() || perVertexColours->size() != vertices->size()) {
+                    perVertexColours = 0;
                 }
             }
 
-            geom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::TRIANGLES, 0, _numFacets * 3));
+            // welding needs every attribute per vertex, which malformed ASCII files may not provide.
+            unsigned int numVertices = _numFacets * 3;
+            osg::ref_ptr<osg::PrimitiveSet> primitives;
+            if (_weldVertices && vertices.valid() && vertices->size() == numVertices &&
+                (!perVertexNormals.valid() || perVertexNormals->size() == numVertices))
+            {
+                primitives = weldVertices(vertices, perVertexNormals, perVertexColours);
+                OSG_INFO << "STL welded " << numVertices << " vertices to " << vertices->size() << std::endl;
+            }
+            else
+            {
+                primitives = new osg::DrawArrays(osg::PrimitiveSet::TRIANGLES, 0, numVertices);
+            }
+
+            geom->setVertexArray(vertices.get());
+            if (perVertexNormals.valid()) geom->setNormalArray(perVertexNormals.get(), osg::Array::BIND_PER_VERTEX);
+            if (perVertexColours.valid()) geom->setColorArray(perVertexColours.get(), osg::Array::BIND_PER_VERTEX);
+            geom->addPrimitiveSet(primitives.get());
 
             if(!_noTriStripPolygons) {
                 osgUtil::optimizeMesh(geom.get());
@@ -197,6 +343,14 @@ private:
             return geom;
         }
 
+        // Set whether asGeometry() welds the vertices, matching only their positions and colours when the normals
+        // are generated later by the SmoothingVisitor.
+        void setWeldVertices(bool weldVertices, bool weldPositionsOnly)
+        {
+            _weldVertices = weldVertices;
+            _weldPositionsOnly = weldPositionsOnly;
+        }
+
         bool isEmpty()
         {
             return _numFacets == 0;
@@ -210,6 +364,8 @@ private:
     protected:
         bool _noTriStripPolygons;
         bool _generateNormal;
+        bool _weldVertices;
+        bool _weldPositionsOnly;
         unsigned int _numFacets;
 
         std::string _solidName;
@@ -231,11 +387,46 @@ private:
     {
     public:
         AsciiReaderObject(bool noTriStripPolygons)
-        : ReaderObject(noTriStripPolygons)
+        : ReaderObject(noTriStripPolygons),
+          _numParseThreads(0),
+          _vertexCount(0),
+          _normalIndex(0),
+          _numBuffered(0),
+          _endOfFile(false),
+          _chunkIndex(0),
+          _lineIndex(0),
+          _solidNameIndex(0)
         {
+            _facetIndex[0] = _facetIndex[1] = _facetIndex[2] = 0;
         }
 
+        // Set the number of threads parsing each block of the file, 0 reads the file a line at a time.
+        void setNumParseThreads(unsigned int numParseThreads) { _numParseThreads = numParseThreads; }
+
         ReadResult read(FILE *fp);
+
+    protected:
+        ReadResult readLineByLine(FILE *fp);
+        ReadResult readBlocks(FILE *fp);
+        bool readBlock(FILE *fp);
+
+        void beginSolid();
+        void addFacet(const osg::Vec3& normal);
+        void addVertex(const osg::Vec3& vertex);
+
+        unsigned int _numParseThreads;
+
+        unsigned int _vertexCount;
+        unsigned int _facetIndex[3];
+        unsigned int _normalIndex;
+
+        std::vector<char> _buffer;
+        size_t _numBuffered;
+        bool _endOfFile;
+        std::vector<StlAsciiChunk> _chunks;
+        size_t _chunkIndex;
+        size_t _lineIndex;
+        size_t _solidNameIndex;
     };
 
     class BinaryReaderObject : public ReaderObject
@@ -243,14 +434,19 @@ private:
     public:
         BinaryReaderObject(unsigned int expectNumFacets, bool noTriStripPolygons, bool generateNormals = true)
             : ReaderObject(noTriStripPolygons, generateNormals),
-            _expectNumFacets(expectNumFacets)
+            _expectNumFacets(expectNumFacets),
+            _numFacetsPerRead(1)
         {
         }
 
+        // Set the number of facets read from the file with each fread.
+        void setNumFacetsPerRead(unsigned int numFacetsPerRead) { _numFacetsPerRead = osg::maximum(numFacetsPerRead, 1u); }
+
         ReadResult read(FILE *fp);
 
     protected:
         unsigned int _expectNumFacets;
+        unsigned int _numFacetsPerRead;
     };
 
     class CreateStlVisitor : public osg::NodeVisitor
@@ -437,6 +633,119 @@ bool fileComesFromMagics(FILE *fp, osg::Vec4& magicsColor)
     return false;
 }
 
+namespace
+{
+
+const size_t MINIMUM_CHUNK_SIZE = 1024*1024;
+const size_t BLOCK_SIZE_PER_THREAD = 16*1024*1024;
+const unsigned int FACETS_PER_READ = 64*1024;
+
+inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+inline bool startsWith(const char* ptr, const char* end, const char* keyword, size_t length)
+{
+    return static_cast<size_t>(end - ptr) >= length && strncmp(ptr, keyword, length) == 0;
+}
+
+// Parse the white space separated values of a line after skipping numSkip words, matching the sscanf and
+// osg::asciiToFloat() parsing of the line by line reader. The buffer is null terminated so the value at the
+// end of the line stops at the end of the line.
+bool parseVec3(const char* ptr, const char* end, unsigned int numSkip, osg::Vec3& value)
+{
+    for (unsigned int i = 0; i < numSkip + 3; ++i)
+    {
+        while (ptr < end && isSpace(*ptr)) ++ptr;
+        if (ptr == end) return false;
+
+        if (i >= numSkip) value[i - numSkip] = osg::asciiToFloat(ptr);
+        while (ptr < end && !isSpace(*ptr)) ++ptr;
+    }
+    return true;
+}
+
+void parseAsciiChunk(StlAsciiChunk& chunk)
+{
+    const char* ptr = chunk.begin;
+    while (ptr < chunk.end)
+    {
+        const char* lineEnd = static_cast<const char*>(memchr(ptr, '\n', chunk.end - ptr));
+        const char* nextLine = lineEnd ? lineEnd + 1 : chunk.end;
+        if (!lineEnd) lineEnd = chunk.end;
+
+        // strip the leading and trailing white space.
+        while (lineEnd > ptr && isSpace(*(lineEnd - 1))) --lineEnd;
+        while (ptr < lineEnd && isSpace(*ptr)) ++ptr;
+
+        osg::Vec3 value;
+        if (startsWith(ptr, lineEnd, "vertex", 6))
+        {
+            if (parseVec3(ptr + 6, lineEnd, 0, value)) chunk.lines.push_back(StlAsciiLine(StlAsciiLine::VERTEX, value));
+        }
+        else if (startsWith(ptr, lineEnd, "facet", 5))
+        {
+            if (parseVec3(ptr + 5, lineEnd, 1, value)) chunk.lines.push_back(StlAsciiLine(StlAsciiLine::FACET, value));
+        }
+        else if (startsWith(ptr, lineEnd, "solid", 5))
+        {
+            chunk.solidNames.push_back(lineEnd - ptr > 6 ? std::string(ptr + 6, lineEnd) : std::string());
+            chunk.lines.push_back(StlAsciiLine(StlAsciiLine::SOLID));
+        }
+        else if (startsWith(ptr, lineEnd, "endsolid", 8))
+        {
+            chunk.lines.push_back(StlAsciiLine(StlAsciiLine::ENDSOLID));
+        }
+
+        ptr = nextLine;
+    }
+}
+
+class ChunkThread : public OpenThreads::Thread
+{
+public:
+    ChunkThread(std::vector<StlAsciiChunk>& chunks, OpenThreads::Atomic& nextChunk) :
+        _chunks(chunks), _nextChunk(nextChunk) {}
+
+    virtual void run()
+    {
+        for(unsigned int i=(++_nextChunk)-1; i<_chunks.size(); i=(++_nextChunk)-1)
+        {
+            parseAsciiChunk(_chunks[i]);
+        }
+    }
+
+protected:
+    std::vector<StlAsciiChunk>& _chunks;
+    OpenThreads::Atomic&        _nextChunk;
+};
+
+// Parse the chunks using up to numThreads threads.
+void parseAsciiChunks(std::vector<StlAsciiChunk>& chunks, unsigned int numThreads)
+{
+    OpenThreads::Atomic nextChunk;
+    numThreads = osg::minimum(numThreads, static_cast<unsigned int>(chunks.size()));
+
+    // the calling thread works through the chunks along with the additional threads.
+    std::vector< ChunkThread* > threads;
+    for(unsigned int i=1; i<numThreads; ++i)
+    {
+        threads.push_back(new ChunkThread(chunks, nextChunk));
+        threads.back()->startThread();
+    }
+
+    ChunkThread(chunks, nextChunk).run();
+
+    for(std::vector< ChunkThread* >::iterator itr=threads.begin(); itr!=threads.end(); ++itr)
+    {
+        (*itr)->join();
+        delete *itr;
+    }
+}
+
+}
+
 osgDB::ReaderWriter::ReadResult ReaderWriterSTL::readNode(const std::string& file, const osgDB::ReaderWriter::Options* options) const
 {
     std::string ext = osgDB::getLowerCaseFileExtension(file);
@@ -512,7 +821,7 @@ osgDB::ReaderWriter::ReadResult ReaderWriterSTL::readNode(const std::string& fil
         return ReadResult::ERROR_IN_READING_FILE;
     }
 
-    if (!isBinary)
+    if (!isBinary && localOptions.perFacetRead)
     {
         fclose(fp);
 
@@ -532,9 +841,19 @@ osgDB::ReaderWriter::ReadResult ReaderWriterSTL::readNode(const std::string& fil
     ReaderObject *readerObject;
 
     if (isBinary)
-        readerObject = new BinaryReaderObject(expectFacets, localOptions.noTriStripPolygons);
+    {
+        BinaryReaderObject* binaryReaderObject = new BinaryReaderObject(expectFacets, localOptions.noTriStripPolygons);
+        binaryReaderObject->setNumFacetsPerRead(localOptions.perFacetRead ? 1 : FACETS_PER_READ);
+        readerObject = binaryReaderObject;
+    }
     else
-        readerObject = new AsciiReaderObject(localOptions.noTriStripPolygons);
+    {
+        AsciiReaderObject* asciiReaderObject = new AsciiReaderObject(localOptions.noTriStripPolygons);
+        asciiReaderObject->setNumParseThreads(localOptions.perFacetRead ? 0 : localOptions.numParseThreads);
+        readerObject = asciiReaderObject;
+    }
+
+    readerObject->setWeldVertices(localOptions.weldVertices, localOptions.smooth);
 
     osg::ref_ptr<ReaderObject> readerPtr(readerObject);
 
@@ -580,20 +899,75 @@ osgDB::ReaderWriter::ReadResult ReaderWriterSTL::readNode(const std::string& fil
 
 ReaderWriterSTL::ReaderObject::ReadResult ReaderWriterSTL::AsciiReaderObject::read(FILE* fp)
 {
-    unsigned int vertexCount = 0;
-    unsigned int facetIndex[] = { 0, 0, 0 };
-    unsigned int vertexIndex = 0;
-    unsigned int normalIndex = 0;
+    beginSolid();
 
-    const int MaxLineSize = 256;
-    char buf[MaxLineSize];
-    char sx[MaxLineSize], sy[MaxLineSize], sz[MaxLineSize];
+    if (_numParseThreads == 0)
+        return readLineByLine(fp);
+    else
+        return readBlocks(fp);
+}
 
+void ReaderWriterSTL::AsciiReaderObject::beginSolid()
+{
     if (!isEmpty())
     {
         clear();
     }
 
+    _vertexCount = 0;
+    _facetIndex[0] = _facetIndex[1] = _facetIndex[2] = 0;
+    _normalIndex = 0;
+}
+
+void ReaderWriterSTL::AsciiReaderObject::addFacet(const osg::Vec3& facetNormal)
+{
+    if (!_normal.valid())
+        _normal = new osg::Vec3Array;
+
+    osg::Vec3 normal(facetNormal);
+    normal.normalize();
+
+    _normalIndex = _normal->size();
+    _normal->push_back(normal);
+
+    _numFacets++;
+    _vertexCount = 0;
+}
+
+void ReaderWriterSTL::AsciiReaderObject::addVertex(const osg::Vec3& vertex)
+{
+    if (!_vertex.valid())
+        _vertex = new osg::Vec3Array;
+
+    unsigned int vertexIndex = _vertex->size();
+    if (_vertexCount < 3)
+    {
+        _vertex->push_back(vertex);
+        _facetIndex[_vertexCount++] = vertexIndex;
+    }
+    else
+    {
+        /*
+         * There are some invalid ASCII files around (at least one ;-)
+         * that have more than three vertices per facet - add an
+         * additional triangle.
+         */
+        _normal->push_back((*_normal)[_normalIndex]);
+        _vertex->push_back((*_vertex)[_facetIndex[0]]);
+        _vertex->push_back((*_vertex)[_facetIndex[2]]);
+        _vertex->push_back(vertex);
+        _facetIndex[1] = _facetIndex[2];
+        _facetIndex[2] = vertexIndex;
+        _numFacets++;
+    }
+}
+
+ReaderWriterSTL::ReaderObject::ReadResult ReaderWriterSTL::AsciiReaderObject::readLineByLine(FILE* fp)
+{
+    const int MaxLineSize = 256;
+    char buf[MaxLineSize];
+    char sx[MaxLineSize], sy[MaxLineSize], sz[MaxLineSize];
+
     while (fgets(buf, sizeof(buf), fp))
     {
         unsigned int len = strlen(buf);
@@ -622,34 +996,11 @@ ReaderWriterSTL::ReaderObject::ReadResult ReaderWriterSTL::AsciiReaderObject::re
         {
             if (sscanf(bp + 6, "%s %s %s", sx, sy, sz) == 3)
             {
-                if (!_vertex.valid())
-                    _vertex = new osg::Vec3Array;
-
                 float vx = osg::asciiToFloat(sx);
                 float vy = osg::asciiToFloat(sy);
                 float vz = osg::asciiToFloat(sz);
 
-                vertexIndex = _vertex->size();
-                if (vertexCount < 3)
-                {
-                    _vertex->push_back(osg::Vec3(vx, vy, vz));
-                    facetIndex[vertexCount++] = vertexIndex;
-                }
-                else
-                {
-                    /*
-                     * There are some invalid ASCII files around (at least one ;-)
-                     * that have more than three vertices per facet - add an
-                     * additional triangle.
-                     */
-                    _normal->push_back((*_normal)[normalIndex]);
-                    _vertex->push_back((*_vertex)[facetIndex[0]]);
-                    _vertex->push_back((*_vertex)[facetIndex[2]]);
-                    _vertex->push_back(osg::Vec3(vx, vy, vz));
-                    facetIndex[1] = facetIndex[2];
-                    facetIndex[2] = vertexIndex;
-                    _numFacets++;
-                }
+                addVertex(osg::Vec3(vx, vy, vz));
             }
         }
         else if (strncmp(bp, "facet", 5) == 0)
@@ -660,17 +1011,7 @@ ReaderWriterSTL::ReaderObject::ReadResult ReaderWriterSTL::AsciiReaderObject::re
                 float ny = osg::asciiToFloat(sy);
                 float nz = osg::asciiToFloat(sz);
 
-                if (!_normal.valid())
-                    _normal = new osg::Vec3Array;
-
-                osg::Vec3 normal(nx, ny, nz);
-                normal.normalize();
-
-                normalIndex = _normal->size();
-                _normal->push_back(normal);
-
-                _numFacets++;
-                vertexCount = 0;
+                addFacet(osg::Vec3(nx, ny, nz));
             }
         }
         else if (strncmp(bp, "solid", 5) == 0)
@@ -688,6 +1029,105 @@ ReaderWriterSTL::ReaderObject::ReadResult ReaderWriterSTL::AsciiReaderObject::re
     return ReadEOF;
 }
 
+ReaderWriterSTL::ReaderObject::ReadResult ReaderWriterSTL::AsciiReaderObject::readBlocks(FILE* fp)
+{
+    // replay the parsed lines in file order, reading the next block once the lines of the current block are used up.
+    do
+    {
+        for (; _chunkIndex < _chunks.size(); ++_chunkIndex, _lineIndex = 0, _solidNameIndex = 0)
+        {
+            const StlAsciiChunk& chunk = _chunks[_chunkIndex];
+            while (_lineIndex < chunk.lines.size())
+            {
+                const StlAsciiLine& line = chunk.lines[_lineIndex++];
+                switch (line.type)
+                {
+                    case StlAsciiLine::VERTEX:
+                        addVertex(line.value);
+                        break;
+                    case StlAsciiLine::FACET:
+                        addFacet(line.value);
+                        break;
+                    case StlAsciiLine::SOLID:
+                        _solidName = chunk.solidNames[_solidNameIndex++];
+                        OSG_INFO << "STL loader parsing '" << _solidName << "'" << std::endl;
+                        break;
+                    case StlAsciiLine::ENDSOLID:
+                        OSG_INFO << "STL loader done parsing '" << _solidName << "'" << std::endl;
+                        return ReadSuccess;
+                }
+            }
+        }
+    }
+    while (readBlock(fp));
+
+    return ReadEOF;
+}
+
+bool ReaderWriterSTL::AsciiReaderObject::readBlock(FILE* fp)
+{
+    _chunks.clear();
+    _chunkIndex = 0;
+    _lineIndex = 0;
+    _solidNameIndex = 0;
+
+    while (!_endOfFile)
+    {
+        // read the next block after the partial line left from the previous block, growing the buffer for long lines.
+        size_t bufferSize = _numBuffered + BLOCK_SIZE_PER_THREAD * _numParseThreads;
+        _buffer.resize(bufferSize + 1);
+        size_t numRead = fread(&_buffer[_numBuffered], 1, bufferSize - _numBuffered, fp);
+        size_t size = _numBuffered + numRead;
+        _endOfFile = numRead < bufferSize - _numBuffered;
+
+        // null terminate the data for osg::asciiToFloat().
+        _buffer[size] = 0;
+
+        const char* begin = &_buffer[0];
+        const char* end = begin + size;
+        const char* blockEnd = end;
+        if (!_endOfFile)
+        {
+            while (blockEnd > begin && *(blockEnd - 1) != '\n') --blockEnd;
+            if (blockEnd == begin)
+            {
+                _numBuffered = size;
+                continue;
+            }
+        }
+
+        // split the block into chunks of whole lines.
+        size_t numChunks = osg::clampBetween(static_cast<size_t>(blockEnd - begin) / MINIMUM_CHUNK_SIZE, static_cast<size_t>(1), static_cast<size_t>(_numParseThreads));
+        _chunks.resize(numChunks);
+        const char* chunkBegin = begin;
+        for (size_t i = 0; i < numChunks; ++i)
+        {
+            _chunks[i].begin = chunkBegin;
+            if (i + 1 == numChunks)
+            {
+                _chunks[i].end = blockEnd;
+            }
+            else
+            {
+                const char* splitPoint = chunkBegin + (blockEnd - chunkBegin) / (numChunks - i);
+                const char* lineEnd = static_cast<const char*>(memchr(splitPoint, '\n', blockEnd - splitPoint));
+                _chunks[i].end = lineEnd ? lineEnd + 1 : blockEnd;
+            }
+            chunkBegin = _chunks[i].end;
+        }
+
+        parseAsciiChunks(_chunks, _numParseThreads);
+
+        // keep the partial line at the end of the block for the next block.
+        _numBuffered = end - blockEnd;
+        if (_numBuffered > 0) memmove(&_buffer[0], blockEnd, _numBuffered);
+
+        return true;
+    }
+
+    return false;
+}
+
 ReaderWriterSTL::ReaderObject::ReadResult ReaderWriterSTL::BinaryReaderObject::read(FILE* fp)
 {
     if (isEmpty())
@@ -707,18 +1147,35 @@ ReaderWriterSTL::ReaderObject::ReadResult ReaderWriterSTL::BinaryReaderObject::r
         return ReadError;
     }
 
+    _vertex = new osg::Vec3Array;
+    _vertex->reserve(_expectNumFacets * 3);
+    _normal = new osg::Vec3Array;
+    _normal->reserve(_expectNumFacets);
+    _color = new osg::Vec4Array;
+
+    // read the facets in blocks of _numFacetsPerRead, parsing each facet from the block.
+    std::vector<char> buffer(osg::minimum(_numFacetsPerRead, osg::maximum(_expectNumFacets, 1u)) * sizeof_StlFacet);
+    unsigned int numFacetsPerRead = buffer.size() / sizeof_StlFacet;
+    unsigned int numBuffered = 0;
+    unsigned int bufferIndex = 0;
+
     StlFacet facet;
     for (unsigned int i = 0; i < _expectNumFacets; ++i)
     {
-        if (::fread((void*) &facet, sizeof_StlFacet, 1, fp) != 1)
+        if (bufferIndex == numBuffered)
         {
-            OSG_FATAL << "ReaderWriterSTL::readStlBinary: Failed to read facet " << i << std::endl;
-            return ReadError;
+            numBuffered = osg::minimum(numFacetsPerRead, _expectNumFacets - i);
+            bufferIndex = 0;
+            if (::fread((void*) &buffer[0], sizeof_StlFacet, numBuffered, fp) != numBuffered)
+            {
+                OSG_FATAL << "ReaderWriterSTL::readStlBinary: Failed to read facet " << i << std::endl;
+                return ReadError;
+            }
         }
 
+        memcpy((void*) &facet, &buffer[(bufferIndex++) * sizeof_StlFacet], sizeof_StlFacet);
+
         // vertices
-        if (!_vertex.valid())
-            _vertex = new osg::Vec3Array;
 
         osg::Vec3 v0(facet.vertex[0].x, facet.vertex[0].y, facet.vertex[0].z);
         osg::Vec3 v1(facet.vertex[1].x, facet.vertex[1].y, facet.vertex[1].z);
@@ -741,8 +1198,6 @@ ReaderWriterSTL::ReaderObject::ReadResult ReaderWriterSTL::BinaryReaderObject::r
             normal.set(facet.normal.x, facet.normal.y, facet.normal.z);
         }
 
-        if (!_normal.valid())
-            _normal = new osg::Vec3Array;
         _normal->push_back(normal);
 
         /*
@@ -753,10 +1208,6 @@ ReaderWriterSTL::ReaderObject::ReadResult ReaderWriterSTL::BinaryReaderObject::r
          * for a given face, according to the value of the last bit (0 = per-face, 1 = per-object)
          * Moreover, magics uses RGB instead of BGR (as the other software)
          */
-        if (!_color.valid())
-        {
-            _color = new osg::Vec4Array;
-        }
 
         // Case of a Magics file
         if(comesFromMagics)
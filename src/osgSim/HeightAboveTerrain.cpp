@@ -38,28 +38,65 @@ unsigned int HeightAboveTerrain::addPoint(const osg::Vec3d& point)
     return index;
 }
 
+struct HeightAboveTerrain::ComputeIntersectionsOperation : public IntersectionThreadPool::Operation
+{
+    ComputeIntersectionsOperation(HeightAboveTerrain& hat, osg::Node* scene, osg::EllipsoidModel* em):
+        _hat(hat),
+        _scene(scene),
+        _em(em) {}
+
+    virtual void operator () (osgUtil::IntersectionVisitor& iv, unsigned int begin, unsigned int end)
+    {
+        _hat.computeIntersections(iv, _scene, _em, begin, end);
+    }
+
+    HeightAboveTerrain&     _hat;
+    osg::Node*              _scene;
+    osg::EllipsoidModel*    _em;
+
+protected:
+
+    ComputeIntersectionsOperation& operator = (const ComputeIntersectionsOperation&) { return *this; }
+};
+
 void HeightAboveTerrain::computeIntersections(osg::Node* scene, osg::Node::NodeMask traversalMask)
 {
     osg::CoordinateSystemNode* csn = dynamic_cast<osg::CoordinateSystemNode*>(scene);
     osg::EllipsoidModel* em = csn ? csn->getEllipsoidModel() : 0;
 
+    if (_threadPool.valid() && _threadPool->getNumThreads()>1 && _HATList.size()>1)
+    {
+        // compute the bounds up front so that the threads traversing the scene concurrently only ever read them.
+        scene->getBound();
+
+        ComputeIntersectionsOperation operation(*this, scene, em);
+        _threadPool->run(operation, _HATList.size(), _dcrc.get(), traversalMask);
+        return;
+    }
+
+    _intersectionVisitor.setTraversalMask(traversalMask);
+
+    computeIntersections(_intersectionVisitor, scene, em, 0, _HATList.size());
+}
+
+void HeightAboveTerrain::computeIntersections(osgUtil::IntersectionVisitor& iv, osg::Node* scene, osg::EllipsoidModel* em, unsigned int beginIndex, unsigned int endIndex)
+{
     osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::IntersectorGroup();
 
-    for(HATList::iterator itr = _HATList.begin();
-        itr != _HATList.end();
-        ++itr)
+    for(unsigned int i=beginIndex; i<endIndex; ++i)
     {
+        HAT& hat = _HATList[i];
         if (em)
         {
 
-            osg::Vec3d start = itr->_point;
+            osg::Vec3d start = hat._point;
             osg::Vec3d upVector = em->computeLocalUpVector(start.x(), start.y(), start.z());
 
             double latitude, longitude, height;
             em->convertXYZToLatLongHeight(start.x(), start.y(), start.z(), latitude, longitude, height);
             osg::Vec3d end = start - upVector * (height - _lowestHeight);
 
-            itr->_hat = height;
+            hat._hat = height;
 
             OSG_NOTICE<<"lat = "<<latitude<<" longitude = "<<longitude<<" height = "<<height<<std::endl;
 
@@ -68,26 +105,25 @@ void HeightAboveTerrain::computeIntersections(osg::Node* scene, osg::Node::NodeM
         }
         else
         {
-            osg::Vec3d start = itr->_point;
+            osg::Vec3d start = hat._point;
             osg::Vec3d upVector (0.0, 0.0, 1.0);
 
             double height = start.z();
             osg::Vec3d end = start - upVector * (height - _lowestHeight);
 
-            itr->_hat = height;
+            hat._hat = height;
 
             osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector( start, end);
             intersectorGroup->addIntersector( intersector.get() );
         }
     }
 
-    _intersectionVisitor.reset();
-    _intersectionVisitor.setTraversalMask(traversalMask);
-    _intersectionVisitor.setIntersector( intersectorGroup.get() );
+    iv.reset();
+    iv.setIntersector( intersectorGroup.get() );
 
-    scene->accept(_intersectionVisitor);
+    scene->accept(iv);
 
-    unsigned int index = 0;
+    unsigned int index = beginIndex;
     osgUtil::IntersectorGroup::Intersectors& intersectors = intersectorGroup->getIntersectors();
     for(osgUtil::IntersectorGroup::Intersectors::iterator intersector_itr = intersectors.begin();
         intersector_itr != intersectors.end();
@@ -107,6 +143,8 @@ void HeightAboveTerrain::computeIntersections(osg::Node* scene, osg::Node::NodeM
         }
     }
 
+    // release the intersector group and the scene graph references its intersections hold.
+    iv.setIntersector(0);
 }
 
 double HeightAboveTerrain::computeHeightAboveTerrain(osg::Node* scene, const osg::Vec3d& point, osg::Node::NodeMask traversalMask)
@@ -17,76 +17,307 @@
 #include <osgDB/ReadFile>
 #include <osgUtil/LineSegmentIntersector>
 
+#include <OpenThreads/Thread>
+
 using namespace osgSim;
 
-DatabaseCacheReadCallback::DatabaseCacheReadCallback()
+DatabaseCacheReadCallback::DatabaseCacheReadCallback(unsigned int numShards)
 {
     _maxNumFilesToCache = 2000;
+
+    if (numShards==0) numShards = 1;
+    for(unsigned int i=0; i<numShards; ++i)
+    {
+        _shards.push_back(new Shard);
+    }
+}
+
+DatabaseCacheReadCallback::Shard& DatabaseCacheReadCallback::getShard(const std::string& filename)
+{
+    // FNV-1a hash of the file name.
+    unsigned int hash = 2166136261u;
+    for(std::string::const_iterator itr = filename.begin();
+        itr != filename.end();
+        ++itr)
+    {
+        hash = (hash ^ static_cast<unsigned char>(*itr)) * 16777619u;
+    }
+    return *_shards[hash % _shards.size()];
+}
+
+unsigned int DatabaseCacheReadCallback::getNumFilesCached() const
+{
+    unsigned int numFilesCached = 0;
+    for(Shards::const_iterator itr = _shards.begin();
+        itr != _shards.end();
+        ++itr)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock((*itr)->_mutex);
+        numFilesCached += (*itr)->_leastRecentlyUsedList.size();
+    }
+    return numFilesCached;
 }
 
 void DatabaseCacheReadCallback::clearDatabaseCache()
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
-    _filenameSceneMap.clear();
+    for(Shards::iterator itr = _shards.begin();
+        itr != _shards.end();
+        ++itr)
+    {
+        Shard& shard = *(*itr);
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+        shard._filenameSceneMap.clear();
+        shard._leastRecentlyUsedList.clear();
+    }
 }
 
 void DatabaseCacheReadCallback::pruneUnusedDatabaseCache()
 {
+    for(Shards::iterator itr = _shards.begin();
+        itr != _shards.end();
+        ++itr)
+    {
+        Shard& shard = *(*itr);
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        for(FileNameSceneMap::iterator fitr = shard._filenameSceneMap.begin();
+            fitr != shard._filenameSceneMap.end();)
+        {
+            if (fitr->second._node.valid() && fitr->second._node->referenceCount()==1)
+            {
+                OSG_INFO<<"Pruning "<<fitr->first<<std::endl;
+                shard._leastRecentlyUsedList.erase(fitr->second._leastRecentlyUsedItr);
+                shard._filenameSceneMap.erase(fitr++);
+            }
+            else
+            {
+                ++fitr;
+            }
+        }
+    }
 }
 
 osg::ref_ptr<osg::Node> DatabaseCacheReadCallback::readNodeFile(const std::string& filename)
 {
-    // first check to see if file is already loaded.
+    Shard& shard = getShard(filename);
+
+    // first check to see if file is already loaded, or is being loaded by another thread.
     {
-        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
 
-        FileNameSceneMap::iterator itr = _filenameSceneMap.find(filename);
-        if (itr != _filenameSceneMap.end())
+        FileNameSceneMap::iterator itr = shard._filenameSceneMap.find(filename);
+        while (itr != shard._filenameSceneMap.end() && !itr->second._node)
+        {
+            shard._loaded.wait(&shard._mutex);
+            itr = shard._filenameSceneMap.find(filename);
+        }
+
+        if (itr != shard._filenameSceneMap.end())
         {
             OSG_INFO<<"Getting from cache "<<filename<<std::endl;
 
-            return itr->second.get();
+            // move to the front of the least recently used list.
+            shard._leastRecentlyUsedList.splice(shard._leastRecentlyUsedList.begin(), shard._leastRecentlyUsedList, itr->second._leastRecentlyUsedItr);
+
+            return itr->second._node.get();
         }
+
+        // insert an entry without a node so other threads wait for this thread to load the file rather than loading it too.
+        shard._filenameSceneMap[filename];
     }
 
-    // now load the file.
+    // now load the file, outside of the lock so other threads can use the shard in the meantime.
     osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile(filename);
 
+    // compute the bounds now, so that threads traversing the cached subgraph concurrently only ever read them.
+    if (node.valid()) node->getBound();
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+    // remove the loading entry, it's reinserted below if the file loaded.
+    shard._filenameSceneMap.erase(filename);
+
     // insert into the cache.
     if (node.valid())
     {
-        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
-
-        if (_filenameSceneMap.size() < _maxNumFilesToCache)
+        unsigned int maxNumFilesToCachePerShard = (_maxNumFilesToCache + _shards.size() - 1) / _shards.size();
+        if (shard._leastRecentlyUsedList.size() >= maxNumFilesToCachePerShard)
         {
-            OSG_INFO<<"Inserting into cache "<<filename<<std::endl;
-
-            _filenameSceneMap[filename] = node;
-        }
-        else
-        {
-            // for time being implement a crude search for a candidate to chuck out from the cache.
-            for(FileNameSceneMap::iterator itr = _filenameSceneMap.begin();
-                itr != _filenameSceneMap.end();
-                ++itr)
+            // search from the least recently used for a candidate to chuck out from the cache.
+            for(LeastRecentlyUsedList::iterator litr = shard._leastRecentlyUsedList.end();
+                litr != shard._leastRecentlyUsedList.begin();)
             {
-                if (itr->second->referenceCount()==1)
+                --litr;
+
+                FileNameSceneMap::iterator fitr = shard._filenameSceneMap.find(*litr);
+                if (fitr->second._node->referenceCount()==1)
                 {
-                    OSG_INFO<<"Erasing "<<itr->first<<std::endl;
+                    OSG_INFO<<"Erasing "<<fitr->first<<std::endl;
                     // found a node which is only referenced in the cache so we can discard it
                     // and know that the actual memory will be released.
-                    _filenameSceneMap.erase(itr);
+                    shard._filenameSceneMap.erase(fitr);
+                    shard._leastRecentlyUsedList.erase(litr);
                     break;
                 }
             }
             OSG_INFO<<"And the replacing with "<<filename<<std::endl;
-            _filenameSceneMap[filename] = node;
         }
+        else
+        {
+            OSG_INFO<<"Inserting into cache "<<filename<<std::endl;
+        }
+
+        shard._leastRecentlyUsedList.push_front(filename);
+
+        CacheEntry& entry = shard._filenameSceneMap[filename];
+        entry._node = node;
+        entry._leastRecentlyUsedItr = shard._leastRecentlyUsedList.begin();
     }
 
+    // wake any threads waiting for this file, if it failed to load they'll try loading it themselves.
+    shard._loaded.broadcast();
+
     return node;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  IntersectionThreadPool
+//
+class IntersectionThreadPool::IntersectionThread : public OpenThreads::Thread
+{
+    public:
+
+        IntersectionThread(IntersectionThreadPool* pool, osgUtil::IntersectionVisitor* iv):
+            _pool(pool),
+            _intersectionVisitor(iv) {}
+
+        virtual void run()
+        {
+            while(true)
+            {
+                _pool->_startBarrier.block(_pool->_numThreads);
+
+                if (_pool->_done) return;
+
+                _pool->runBatches(*_intersectionVisitor);
+
+                _pool->_endBarrier.block(_pool->_numThreads);
+            }
+        }
+
+        IntersectionThreadPool*         _pool;
+        osgUtil::IntersectionVisitor*   _intersectionVisitor;
+};
+
+IntersectionThreadPool::IntersectionThreadPool(unsigned int numThreads):
+    _numThreads(numThreads),
+    _done(false),
+    _operation(0),
+    _numTests(0),
+    _batchSize(0),
+    _numBatches(0)
+{
+    if (_numThreads==0) _numThreads = osg::maximum(OpenThreads::GetNumberOfProcessors(), 1);
+
+    for(unsigned int i=0; i<_numThreads; ++i)
+    {
+        osg::ref_ptr<osgUtil::IntersectionVisitor> iv = new osgUtil::IntersectionVisitor;
+        _intersectionVisitors.push_back(iv);
+
+        // the calling thread intersects using the first IntersectionVisitor, so only the rest need threads.
+        if (i>0)
+        {
+            IntersectionThread* thread = new IntersectionThread(this, iv.get());
+            _threads.push_back(thread);
+            thread->start();
+        }
+    }
+}
+
+IntersectionThreadPool::~IntersectionThreadPool()
+{
+    _done = true;
+
+    if (!_threads.empty())
+    {
+        _startBarrier.block(_numThreads);
+
+        for(Threads::iterator itr = _threads.begin();
+            itr != _threads.end();
+            ++itr)
+        {
+            (*itr)->join();
+            delete *itr;
+        }
+    }
+}
+
+void IntersectionThreadPool::run(Operation& operation, unsigned int numTests, osgUtil::IntersectionVisitor::ReadCallback* readCallback, osg::Node::NodeMask traversalMask)
+{
+    if (numTests==0) return;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_runMutex);
+
+    for(IntersectionVisitors::iterator itr = _intersectionVisitors.begin();
+        itr != _intersectionVisitors.end();
+        ++itr)
+    {
+        (*itr)->setReadCallback(readCallback);
+        (*itr)->setTraversalMask(traversalMask);
+    }
+
+    // several batches per thread so threads that finish early pick up the remaining work, while keeping the batches
+    // large enough for the LineSegmentIntersector's to be intersected together as packets.
+    _operation = &operation;
+    _numTests = numTests;
+    _batchSize = osg::maximum((numTests + _numThreads*4 - 1) / (_numThreads*4), 1u);
+    _numBatches = (numTests + _batchSize - 1) / _batchSize;
+    _nextBatch.exchange(0);
+
+    if (!_threads.empty()) _startBarrier.block(_numThreads);
+
+    runBatches(*_intersectionVisitors.front());
+
+    if (!_threads.empty()) _endBarrier.block(_numThreads);
+
+    _operation = 0;
+}
+
+void IntersectionThreadPool::runBatches(osgUtil::IntersectionVisitor& iv)
+{
+    unsigned int index;
+    while((index = (++_nextBatch)-1) < _numBatches)
+    {
+        unsigned int begin = index*_batchSize;
+        unsigned int end = osg::minimum(begin+_batchSize, _numTests);
+        (*_operation)(iv, begin, end);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  LineOfSight
+//
+struct LineOfSight::ComputeIntersectionsOperation : public IntersectionThreadPool::Operation
+{
+    ComputeIntersectionsOperation(LineOfSight& los, osg::Node* scene):
+        _los(los),
+        _scene(scene) {}
+
+    virtual void operator () (osgUtil::IntersectionVisitor& iv, unsigned int begin, unsigned int end)
+    {
+        _los.computeIntersections(iv, _scene, begin, end);
+    }
+
+    LineOfSight&    _los;
+    osg::Node*      _scene;
+
+protected:
+
+    ComputeIntersectionsOperation& operator = (const ComputeIntersectionsOperation&) { return *this; }
+};
+
 LineOfSight::LineOfSight()
 {
     setDatabaseCacheReadCallback(new DatabaseCacheReadCallback);
@@ -105,24 +336,38 @@ unsigned int LineOfSight::addLOS(const osg::Vec3d& start, const osg::Vec3d& end)
 }
 
 void LineOfSight::computeIntersections(osg::Node* scene, osg::Node::NodeMask traversalMask)
+{
+    if (_threadPool.valid() && _threadPool->getNumThreads()>1 && _LOSList.size()>1)
+    {
+        // compute the bounds up front so that the threads traversing the scene concurrently only ever read them.
+        scene->getBound();
+
+        ComputeIntersectionsOperation operation(*this, scene);
+        _threadPool->run(operation, _LOSList.size(), _dcrc.get(), traversalMask);
+        return;
+    }
+
+    _intersectionVisitor.setTraversalMask(traversalMask);
+
+    computeIntersections(_intersectionVisitor, scene, 0, _LOSList.size());
+}
+
+void LineOfSight::computeIntersections(osgUtil::IntersectionVisitor& iv, osg::Node* scene, unsigned int begin, unsigned int end)
 {
     osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::IntersectorGroup();
 
-    for(LOSList::iterator itr = _LOSList.begin();
-        itr != _LOSList.end();
-        ++itr)
+    for(unsigned int i=begin; i<end; ++i)
     {
-        osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector(itr->_start, itr->_end);
+        osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector(_LOSList[i]._start, _LOSList[i]._end);
         intersectorGroup->addIntersector( intersector.get() );
     }
 
-    _intersectionVisitor.reset();
-    _intersectionVisitor.setTraversalMask(traversalMask);
-    _intersectionVisitor.setIntersector( intersectorGroup.get() );
+    iv.reset();
+    iv.setIntersector( intersectorGroup.get() );
 
-    scene->accept(_intersectionVisitor);
+    scene->accept(iv);
 
-    unsigned int index = 0;
+    unsigned int index = begin;
     osgUtil::IntersectorGroup::Intersectors& intersectors = intersectorGroup->getIntersectors();
     for(osgUtil::IntersectorGroup::Intersectors::iterator intersector_itr = intersectors.begin();
         intersector_itr != intersectors.end();
@@ -147,6 +392,8 @@ void LineOfSight::computeIntersections(osg::Node* scene, osg::Node::NodeMask tra
         }
     }
 
+    // release the intersector group and the scene graph references its intersections hold.
+    iv.setIntersector(0);
 }
 
 LineOfSight::Intersections LineOfSight::computeIntersections(osg::Node* scene, const osg::Vec3d& start, const osg::Vec3d& end, osg::Node::NodeMask traversalMask)
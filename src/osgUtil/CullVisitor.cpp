@@ -30,8 +30,13 @@
 
 #include <osgUtil/CullVisitor>
 
+#include <OpenThreads/Thread>
+#include <OpenThreads/Barrier>
+#include <OpenThreads/Atomic>
+
 #include <float.h>
 #include <algorithm>
+#include <typeinfo>
 
 #include <osg/Timer>
 
@@ -43,6 +48,384 @@ inline float MAX_F(float a, float b)
 inline int EQUAL_F(float a, float b)
     { return a == b || fabsf(a-b) <= MAX_F(fabsf(a),fabsf(b))*1e-3f; }
 
+/** Thread pool and per thread results used by CullVisitor::parallelTraverse(..) to cull the children of a Group in parallel.
+  * The children are partitioned into contiguous fragments which the threads claim one at a time until none remain,
+  * so threads that finish early pick up the remaining work. Each fragment collects its results into its own StateGraph
+  * and RenderStage, these are then merged into the parent CullVisitor in fragment order so the resulting StateGraph
+  * and RenderBin contents are the same as a serial traversal.*/
+class CullVisitor::ParallelCullContext : public osg::Referenced
+{
+    public:
+
+        typedef CullVisitor::value_type value_type;
+        typedef CullVisitor::DistanceMatrixDrawableMap DistanceMatrixDrawableMap;
+
+        struct Fragment
+        {
+            Fragment():
+                _forkStateGraph(0),
+                _begin(0),
+                _end(0),
+                _znear(FLT_MAX),
+                _zfar(-FLT_MAX),
+                _numLeaves(0),
+                _clearMask(0) {}
+
+            osg::ref_ptr<StateGraph>    _rootStateGraph;
+            StateGraph*                 _forkStateGraph;
+            osg::ref_ptr<RenderStage>   _renderStage;
+
+            unsigned int                _begin;
+            unsigned int                _end;
+
+            value_type                  _znear;
+            value_type                  _zfar;
+            DistanceMatrixDrawableMap   _nearPlaneCandidateMap;
+            DistanceMatrixDrawableMap   _farPlaneCandidateMap;
+
+            unsigned int                _numLeaves;
+
+            osg::Vec4                   _clearColor;
+            GLbitfield                  _clearMask;
+        };
+
+        class CullThread : public OpenThreads::Thread
+        {
+            public:
+
+                CullThread(ParallelCullContext* context, CullVisitor* cv):
+                    _context(context),
+                    _cullVisitor(cv) {}
+
+                virtual void run()
+                {
+                    while(true)
+                    {
+                        _context->_startBarrier.block(_context->_numThreads);
+
+                        if (_context->_done) return;
+
+                        _context->cullFragments(_cullVisitor.get());
+
+                        _context->_endBarrier.block(_context->_numThreads);
+                    }
+                }
+
+                ParallelCullContext*        _context;
+                osg::ref_ptr<CullVisitor>   _cullVisitor;
+        };
+
+        ParallelCullContext(const CullVisitor& cv, unsigned int numThreads):
+            _numThreads(numThreads),
+            _done(false),
+            _cullVisitorsRequireReset(true),
+            _parent(0),
+            _group(0),
+            _numFragments(0)
+        {
+            for(unsigned int i=0; i<_numThreads; ++i)
+            {
+                osg::ref_ptr<CullVisitor> worker = cv.clone();
+                worker->_parallelCullWorker = true;
+                _cullVisitors.push_back(worker);
+
+                // the calling thread culls using the first worker CullVisitor, so only the rest need threads.
+                if (i>0)
+                {
+                    CullThread* thread = new CullThread(this, worker.get());
+                    _threads.push_back(thread);
+                    thread->start();
+                }
+            }
+        }
+
+        unsigned int getNumThreads() const { return _numThreads; }
+
+        void setCullVisitorsRequireReset() { _cullVisitorsRequireReset = true; }
+
+        void cull(CullVisitor& parent, osg::Group& group)
+        {
+            if (_cullVisitorsRequireReset)
+            {
+                // the worker CullVisitors are reset once per frame as their RenderLeaf's remain in use until the next frame.
+                for(CullVisitorList::iterator itr = _cullVisitors.begin();
+                    itr != _cullVisitors.end();
+                    ++itr)
+                {
+                    (*itr)->reset();
+                }
+                _cullVisitorsRequireReset = false;
+            }
+
+            unsigned int numChildren = group.getNumChildren();
+            unsigned int numFragments = osg::minimum(numChildren, _numThreads*4);
+            if (_fragments.size()<numFragments) _fragments.resize(numFragments);
+            _numFragments = numFragments;
+
+            for(unsigned int i=0; i<numFragments; ++i)
+            {
+                _fragments[i]._begin = (numChildren*i)/numFragments;
+                _fragments[i]._end = (numChildren*(i+1))/numFragments;
+            }
+
+            _parent = &parent;
+            _group = &group;
+            _nextFragment.exchange(0);
+
+            _startBarrier.block(_numThreads);
+
+            cullFragments(_cullVisitors.front().get());
+
+            _endBarrier.block(_numThreads);
+
+            for(unsigned int i=0; i<numFragments; ++i)
+            {
+                merge(parent, _fragments[i]);
+            }
+
+            _parent = 0;
+            _group = 0;
+        }
+
+    protected:
+
+        virtual ~ParallelCullContext()
+        {
+            _done = true;
+
+            if (!_threads.empty())
+            {
+                _startBarrier.block(_numThreads);
+
+                for(ThreadList::iterator itr = _threads.begin();
+                    itr != _threads.end();
+                    ++itr)
+                {
+                    (*itr)->join();
+                    delete *itr;
+                }
+            }
+        }
+
+        void cullFragments(CullVisitor* cv)
+        {
+            unsigned int index;
+            while((index = (++_nextFragment)-1) < _numFragments)
+            {
+                cullFragment(cv, _fragments[index]);
+            }
+        }
+
+        void cullFragment(CullVisitor* cv, Fragment& fragment)
+        {
+            const CullVisitor& parent = *_parent;
+
+            // replicate the parent's StateGraph parental chain so leaves are collected relative to the same StateSet's.
+            if (!fragment._rootStateGraph) fragment._rootStateGraph = new StateGraph;
+            fragment._rootStateGraph->clean();
+
+            {
+                std::vector<StateGraph*> stateGraphParentalChain;
+                for(StateGraph* sg = parent._currentStateGraph; sg; sg = sg->_parent)
+                {
+                    stateGraphParentalChain.push_back(sg);
+                }
+
+                StateGraph* sg = fragment._rootStateGraph.get();
+                std::vector<StateGraph*>::reverse_iterator ritr = stateGraphParentalChain.rbegin();
+                if (ritr!=stateGraphParentalChain.rend())
+                {
+                    sg->setStateSet((*ritr++)->getStateSet());
+                    while(ritr != stateGraphParentalChain.rend())
+                    {
+                        sg = sg->find_or_insert((*ritr++)->getStateSet());
+                    }
+                }
+                fragment._forkStateGraph = sg;
+            }
+
+            // set up the fragment's RenderStage to mirror the parent's current RenderStage.
+            RenderStage* parentStage = parent._currentRenderBin->getStage();
+            if (!fragment._renderStage) fragment._renderStage = new RenderStage;
+            else fragment._renderStage->reset();
+
+            RenderStage* rs = fragment._renderStage.get();
+            rs->setCamera(parentStage->getCamera());
+            rs->setViewport(parentStage->getViewport());
+            rs->setDrawBuffer(parentStage->getDrawBuffer(), parentStage->getDrawBufferApplyMask());
+            rs->setReadBuffer(parentStage->getReadBuffer(), parentStage->getReadBufferApplyMask());
+            rs->setColorMask(parentStage->getColorMask());
+            rs->setClearColor(parentStage->getClearColor());
+            rs->setClearMask(parentStage->getClearMask());
+            rs->setInitialViewMatrix(parentStage->getInitialViewMatrix());
+
+            fragment._clearColor = rs->getClearColor();
+            fragment._clearMask = rs->getClearMask();
+
+            cv->inheritParallelCullState(parent);
+            cv->_rootStateGraph = fragment._rootStateGraph;
+            cv->_currentStateGraph = fragment._forkStateGraph;
+            cv->_currentRenderBin = rs;
+
+            for(unsigned int i=fragment._begin; i<fragment._end; ++i)
+            {
+                _group->getChild(i)->accept(*cv);
+            }
+
+            fragment._znear = cv->_computed_znear;
+            fragment._zfar = cv->_computed_zfar;
+            fragment._nearPlaneCandidateMap.swap(cv->_nearPlaneCandidateMap);
+            fragment._farPlaneCandidateMap.swap(cv->_farPlaneCandidateMap);
+            fragment._numLeaves = cv->_traversalOrderNumber;
+        }
+
+        typedef std::map<StateGraph*, StateGraph*> StateGraphMap;
+
+        static void mapStateGraphs(StateGraph* dst, StateGraph* src, StateGraphMap& stateGraphMap)
+        {
+            stateGraphMap[src] = dst;
+            for(StateGraph::ChildList::iterator itr = src->_children.begin();
+                itr != src->_children.end();
+                ++itr)
+            {
+                mapStateGraphs(dst->find_or_insert(itr->first), itr->second.get(), stateGraphMap);
+            }
+        }
+
+        static void mergeRenderBins(RenderBin* dst, RenderBin* src, StateGraphMap& stateGraphMap, unsigned int traversalOrderOffset)
+        {
+            RenderBin::StateGraphList& stateGraphList = src->getStateGraphList();
+            for(RenderBin::StateGraphList::iterator itr = stateGraphList.begin();
+                itr != stateGraphList.end();
+                ++itr)
+            {
+                StateGraph* src_sg = *itr;
+                StateGraph* dst_sg = stateGraphMap[src_sg];
+
+                // as per CullVisitor::addDrawable(..) StateGraph's are added to the bin of their first leaf.
+                if (dst_sg->leaves_empty()) dst->addStateGraph(dst_sg);
+
+                for(StateGraph::LeafList::iterator litr = src_sg->_leaves.begin();
+                    litr != src_sg->_leaves.end();
+                    ++litr)
+                {
+                    (*litr)->_traversalOrderNumber += traversalOrderOffset;
+                    dst_sg->addLeaf(litr->get());
+                }
+                src_sg->_leaves.clear();
+            }
+            stateGraphList.clear();
+
+            RenderBin::RenderBinList& srcBins = src->getRenderBinList();
+            RenderBin::RenderBinList& dstBins = dst->getRenderBinList();
+            for(RenderBin::RenderBinList::iterator itr = srcBins.begin();
+                itr != srcBins.end();
+                ++itr)
+            {
+                RenderBin::RenderBinList::iterator dst_itr = dstBins.find(itr->first);
+                if (dst_itr==dstBins.end())
+                {
+                    // create an empty RenderBin of the same kind as the source bin.
+                    osg::ref_ptr<RenderBin> rb = dynamic_cast<RenderBin*>(itr->second->clone(osg::CopyOp::SHALLOW_COPY));
+                    rb->getStateGraphList().clear();
+                    rb->getRenderBinList().clear();
+                    rb->getRenderLeafList().clear();
+                    rb->reparent(dst);
+                    dst_itr = dstBins.insert(RenderBin::RenderBinList::value_type(itr->first, rb)).first;
+                }
+
+                mergeRenderBins(dst_itr->second.get(), itr->second.get(), stateGraphMap, traversalOrderOffset);
+            }
+            srcBins.clear();
+        }
+
+        static void mergeRenderStageList(RenderStage::RenderStageList& srcList, PositionalStateContainer* srcPSC, RenderStage* dstStage, bool preRender)
+        {
+            for(RenderStage::RenderStageList::iterator itr = srcList.begin();
+                itr != srcList.end();
+                ++itr)
+            {
+                RenderStage* rs = itr->second.get();
+                if (rs->getInheritedPositionalStateContainer()==srcPSC)
+                {
+                    rs->setInheritedPositionalStateContainer(dstStage->getPositionalStateContainer());
+                }
+
+                if (preRender) dstStage->addPreRenderStage(rs, itr->first);
+                else dstStage->addPostRenderStage(rs, itr->first);
+            }
+            srcList.clear();
+        }
+
+        void merge(CullVisitor& parent, Fragment& fragment)
+        {
+            RenderStage* dstStage = parent._currentRenderBin->getStage();
+            RenderStage* srcStage = fragment._renderStage.get();
+
+            StateGraphMap stateGraphMap;
+            mapStateGraphs(parent._currentStateGraph, fragment._forkStateGraph, stateGraphMap);
+
+            mergeRenderBins(parent._currentRenderBin, srcStage, stateGraphMap, parent._traversalOrderNumber);
+            parent._traversalOrderNumber += fragment._numLeaves;
+
+            fragment._rootStateGraph->prune();
+
+            // positioned attributes such as lights and clip planes.
+            PositionalStateContainer* srcPSC = srcStage->getPositionalStateContainer();
+            if (!srcPSC->_attrList.empty() || !srcPSC->_texAttrListMap.empty())
+            {
+                PositionalStateContainer* dstPSC = dstStage->getPositionalStateContainer();
+                dstPSC->_attrList.insert(dstPSC->_attrList.end(), srcPSC->_attrList.begin(), srcPSC->_attrList.end());
+                for(PositionalStateContainer::TexUnitAttrMatrixListMap::iterator itr = srcPSC->_texAttrListMap.begin();
+                    itr != srcPSC->_texAttrListMap.end();
+                    ++itr)
+                {
+                    PositionalStateContainer::AttrMatrixList& dstList = dstPSC->_texAttrListMap[itr->first];
+                    dstList.insert(dstList.end(), itr->second.begin(), itr->second.end());
+                }
+            }
+
+            // nested Camera's and RenderStage bins.
+            mergeRenderStageList(srcStage->getPreRenderList(), srcPSC, dstStage, true);
+            mergeRenderStageList(srcStage->getPostRenderList(), srcPSC, dstStage, false);
+
+            // pass on any changes made by ClearNode's.
+            if (srcStage->getClearMask()!=fragment._clearMask || srcStage->getClearColor()!=fragment._clearColor)
+            {
+                dstStage->setClearMask(srcStage->getClearMask());
+                dstStage->setClearColor(srcStage->getClearColor());
+            }
+
+            if (fragment._znear<parent._computed_znear) parent._computed_znear = fragment._znear;
+            if (fragment._zfar>parent._computed_zfar) parent._computed_zfar = fragment._zfar;
+
+            parent._nearPlaneCandidateMap.insert(fragment._nearPlaneCandidateMap.begin(), fragment._nearPlaneCandidateMap.end());
+            parent._farPlaneCandidateMap.insert(fragment._farPlaneCandidateMap.begin(), fragment._farPlaneCandidateMap.end());
+            fragment._nearPlaneCandidateMap.clear();
+            fragment._farPlaneCandidateMap.clear();
+        }
+
+        typedef std::vector< osg::ref_ptr<CullVisitor> >    CullVisitorList;
+        typedef std::vector< CullThread* >                  ThreadList;
+        typedef std::vector< Fragment >                     FragmentList;
+
+        unsigned int            _numThreads;
+        volatile bool           _done;
+        bool                    _cullVisitorsRequireReset;
+
+        CullVisitorList         _cullVisitors;
+        ThreadList              _threads;
+
+        OpenThreads::Barrier    _startBarrier;
+        OpenThreads::Barrier    _endBarrier;
+        OpenThreads::Atomic     _nextFragment;
+
+        CullVisitor*            _parent;
+        osg::Group*             _group;
+        FragmentList            _fragments;
+        unsigned int            _numFragments;
+};
+
 
 CullVisitor::CullVisitor():
     osg::NodeVisitor(CULL_VISITOR,TRAVERSE_ACTIVE_CHILDREN),
@@ -52,7 +435,12 @@ CullVisitor::CullVisitor():
     _computed_zfar(-FLT_MAX),
     _traversalOrderNumber(0),
     _currentReuseRenderLeafIndex(0),
-    _numberOfEncloseOverrideRenderBinDetails(0)
+    _numberOfEncloseOverrideRenderBinDetails(0),
+    _parallelCullWorker(false),
+    _parallelCullMinimumNumChildren(16),
+    _batchCullMinimumNumChildren(8),
+    _batchCullNode(0),
+    _batchCullIndex(0)
 {
     _identifier = new Identifier;
 }
@@ -68,7 +456,12 @@ CullVisitor::CullVisitor(const CullVisitor& rhs):
     _traversalOrderNumber(0),
     _currentReuseRenderLeafIndex(0),
     _numberOfEncloseOverrideRenderBinDetails(0),
-    _identifier(rhs._identifier)
+    _identifier(rhs._identifier),
+    _parallelCullWorker(false),
+    _parallelCullMinimumNumChildren(rhs._parallelCullMinimumNumChildren),
+    _batchCullMinimumNumChildren(rhs._batchCullMinimumNumChildren),
+    _batchCullNode(0),
+    _batchCullIndex(0)
 {
 }
 
@@ -133,6 +526,9 @@ void CullVisitor::reset()
 
     _nearPlaneCandidateMap.clear();
     _farPlaneCandidateMap.clear();
+
+    // the worker CullVisitors' RenderLeaf's are reused from the next parallel traversal onwards.
+    if (_parallelCullContext.valid()) _parallelCullContext->setCullVisitorsRequireReset();
 }
 
 float CullVisitor::getDistanceToEyePoint(const Vec3& pos, bool withLODScale) const
@@ -891,7 +1287,17 @@ void CullVisitor::apply(Geode& node)
     StateSet* node_state = node.getStateSet();
     if (node_state) pushStateSet(node_state);
 
-    handle_cull_callbacks_and_traverse(node);
+    if (_batchCullMinimumNumChildren>0 &&
+        node.getNumDrawables()>=_batchCullMinimumNumChildren &&
+        node.getCullCallback()==0 &&
+        typeid(node)==typeid(osg::Geode))
+    {
+        batchCullTraverse(node);
+    }
+    else
+    {
+        handle_cull_callbacks_and_traverse(node);
+    }
 
     // pop the node's state off the geostate stack.
     if (node_state) popStateSet();
@@ -919,7 +1325,7 @@ void CullVisitor::apply(osg::Drawable& drawable)
         }
     }
 
-    if (drawable.isCullingActive() && isCulled(bb)) return;
+    if (drawable.isCullingActive() && (&drawable==_batchCullNode ? isBatchCulled() : isCulled(bb))) return;
 
 
     if (_computeNearFar && bb.valid())
@@ -1145,7 +1551,24 @@ void CullVisitor::apply(Group& node)
     StateSet* node_state = node.getStateSet();
     if (node_state) pushStateSet(node_state);
 
-    handle_cull_callbacks_and_traverse(node);
+    if (_numCullThreads>1 && !_parallelCullWorker &&
+        node.getNumChildren()>=_parallelCullMinimumNumChildren &&
+        node.getCullCallback()==0 &&
+        typeid(node)==typeid(osg::Group))
+    {
+        if (!parallelTraverse(node)) batchCullTraverse(node);
+    }
+    else if (_batchCullMinimumNumChildren>0 &&
+             node.getNumChildren()>=_batchCullMinimumNumChildren &&
+             node.getCullCallback()==0 &&
+             typeid(node)==typeid(osg::Group))
+    {
+        batchCullTraverse(node);
+    }
+    else
+    {
+        handle_cull_callbacks_and_traverse(node);
+    }
 
     // pop the node's state off the render graph stack.
     if (node_state) popStateSet();
@@ -1154,6 +1577,137 @@ void CullVisitor::apply(Group& node)
     popCurrentMask();
 }
 
+void CullVisitor::batchCullTraverse(osg::Group& group)
+{
+    unsigned int numChildren = group.getNumChildren();
+
+    _batchCullSpheres.clear();
+    for(unsigned int i=0; i<numChildren; ++i)
+    {
+        _batchCullSpheres.push_back(group.getChild(i)->getBound());
+    }
+
+    // results are appended to those of any parent Group's batch, then removed once the children have been traversed.
+    unsigned int base = _batchCulled.size();
+    if (_batchCullMinimumNumChildren==0 || !getCurrentCullingSet().isCulled(_batchCullSpheres, _batchCulled, _batchCullResultMasks))
+    {
+        traverse(group);
+        return;
+    }
+
+    for(unsigned int i=0; i<numChildren; ++i)
+    {
+        osg::Node* child = group.getChild(i);
+        _batchCullNode = child->isCullingActive() ? child : 0;
+        _batchCullIndex = base+i;
+        child->accept(*this);
+    }
+    _batchCullNode = 0;
+
+    _batchCulled.resize(base);
+    _batchCullResultMasks.resize(base);
+}
+
+void CullVisitor::batchCullTraverse(osg::Geode& geode)
+{
+    unsigned int numDrawables = geode.getNumDrawables();
+
+    _batchCullBoxes.clear();
+    for(unsigned int i=0; i<numDrawables; ++i)
+    {
+        const osg::Drawable* drawable = geode.getDrawable(i);
+        _batchCullBoxes.push_back(drawable ? drawable->getBoundingBox() : osg::BoundingBox());
+    }
+
+    unsigned int base = _batchCulled.size();
+    if (!getCurrentCullingSet().isCulled(_batchCullBoxes, _batchCulled, _batchCullResultMasks))
+    {
+        traverse(geode);
+        return;
+    }
+
+    for(unsigned int i=0; i<numDrawables; ++i)
+    {
+        // drawables with cull callbacks are culled after the callback has run, so may not match the batched result.
+        osg::Node* child = geode.getChild(i);
+        _batchCullNode = (child->asDrawable() && child->getCullCallback()==0 && _batchCullBoxes[i].valid()) ? child : 0;
+        _batchCullIndex = base+i;
+        child->accept(*this);
+    }
+    _batchCullNode = 0;
+
+    _batchCulled.resize(base);
+    _batchCullResultMasks.resize(base);
+}
+
+bool CullVisitor::parallelTraverse(osg::Group& group)
+{
+    // fragments are merged into the current RenderStage, so only fork when not within a nested RenderBin.
+    if (!_currentStateGraph || !_currentRenderBin || _currentRenderBin!=_currentRenderBin->getStage()) return false;
+
+    unsigned int numThreads = getNumCullThreads();
+    if (!_parallelCullContext || _parallelCullContext->getNumThreads()!=numThreads)
+    {
+        _parallelCullContext = new ParallelCullContext(*this, numThreads);
+    }
+
+    // compute any dirty bounding volumes up front rather than concurrently from the cull threads.
+    for(unsigned int i=0; i<group.getNumChildren(); ++i)
+    {
+        group.getChild(i)->getBound();
+    }
+
+    _parallelCullContext->cull(*this, group);
+
+    return true;
+}
+
+void CullVisitor::inheritParallelCullState(const CullVisitor& cv)
+{
+    setCullSettings(cv);
+
+    // NodeVisitor traversal state
+    _traversalNumber = cv._traversalNumber;
+    _frameStamp = cv._frameStamp;
+    _traversalMode = cv._traversalMode;
+    _traversalMask = cv._traversalMask;
+    _nodeMaskOverride = cv._nodeMaskOverride;
+    _nodePath = cv._nodePath;
+    _databaseRequestHandler = cv._databaseRequestHandler;
+    _imageRequestHandler = cv._imageRequestHandler;
+
+    // CullStack matrix and culling set stacks
+    _occluderList = cv._occluderList;
+    _projectionStack = cv._projectionStack;
+    _modelviewStack = cv._modelviewStack;
+    _MVPW_Stack = cv._MVPW_Stack;
+    _viewportStack = cv._viewportStack;
+    _referenceViewPoints = cv._referenceViewPoints;
+    _eyePointStack = cv._eyePointStack;
+    _viewPointStack = cv._viewPointStack;
+    _clipspaceCullingStack = cv._clipspaceCullingStack;
+    _projectionCullingStack = cv._projectionCullingStack;
+    _modelviewCullingStack.assign(cv._modelviewCullingStack.begin(), cv._modelviewCullingStack.begin()+cv._index_modelviewCullingStack);
+    _index_modelviewCullingStack = cv._index_modelviewCullingStack;
+    _back_modelviewCullingStack = _index_modelviewCullingStack>0 ? &_modelviewCullingStack[_index_modelviewCullingStack-1] : 0;
+    _frustumVolume = cv._frustumVolume;
+    _bbCornerNear = cv._bbCornerNear;
+    _bbCornerFar = cv._bbCornerFar;
+
+    // CullVisitor state
+    _rootRenderStage = cv._rootRenderStage;
+    _renderBinStack.clear();
+    _numberOfEncloseOverrideRenderBinDetails = cv._numberOfEncloseOverrideRenderBinDetails;
+    _renderInfo = cv._renderInfo;
+
+    _computed_znear = cv._computed_znear;
+    _computed_zfar = cv._computed_zfar;
+    _nearPlaneCandidateMap.clear();
+    _farPlaneCandidateMap.clear();
+
+    _traversalOrderNumber = 0;
+}
+
 void CullVisitor::apply(Transform& node)
 {
     if (isCulled(node)) return;
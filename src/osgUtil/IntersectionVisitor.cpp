@@ -25,6 +25,8 @@
 #include <osg/Notify>
 #include <osg/io_utils>
 
+#include <typeinfo>
+
 using namespace osgUtil;
 
 
@@ -105,6 +107,10 @@ void IntersectorGroup::intersect(osgUtil::IntersectionVisitor& iv, osg::Drawable
 {
     if (disabled()) return;
 
+    // LineSegmentIntersectors are collected so they can be intersected with the drawable as a single packet,
+    // subclasses may override intersect() so are left to intersect on their own.
+    _lineSegmentIntersectors.clear();
+
     unsigned int numTested = 0;
     for(Intersectors::iterator itr = _intersectors.begin();
         itr != _intersectors.end();
@@ -112,12 +118,25 @@ void IntersectorGroup::intersect(osgUtil::IntersectionVisitor& iv, osg::Drawable
     {
         if (!(*itr)->disabled())
         {
-            (*itr)->intersect(iv, drawable);
+            if (typeid(*(*itr))==typeid(LineSegmentIntersector))
+            {
+                _lineSegmentIntersectors.push_back(static_cast<LineSegmentIntersector*>(itr->get()));
+            }
+            else
+            {
+                (*itr)->intersect(iv, drawable);
+            }
 
             ++numTested;
         }
     }
 
+    if (!_lineSegmentIntersectors.empty())
+    {
+        LineSegmentIntersector::intersect(iv, drawable, _lineSegmentIntersectors);
+        _lineSegmentIntersectors.clear();
+    }
+
     // OSG_NOTICE<<"Number testing "<<numTested<<std::endl;
 
 }
@@ -23,6 +23,13 @@
 #include <osg/TexMat>
 #include <osg/TemplatePrimitiveFunctor>
 
+// the SSE2 triangle tests must round identically to the scalar code, which may not be the case when the compiler is
+// permitted to contract the scalar code's multiplies and adds into FMA instructions.
+#if (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)) && !defined(__FMA__)
+    #include <emmintrin.h>
+    #define OSG_LINESEGMENT_PACKET_USE_SSE2
+#endif
+
 using namespace osgUtil;
 
 namespace LineSegmentIntersectorUtils
@@ -402,6 +409,391 @@ struct IntersectFunctor
     }
 };
 
+/** Intersects a packet of line segments with a KdTree in a single traversal, testing all the segments still active at each
+  * node against its bounding box together, and each triangle against all the segments active in its leaf together.
+  * The triangle test mirrors IntersectFunctor<osg::Vec3d, double> so the intersections are identical to intersecting each
+  * segment on its own, with the determinant and first barycentric rejection tests done two segments at a time with SSE2.*/
+struct PacketIntersector
+{
+    typedef std::vector<unsigned int> ActiveList;
+
+    PacketIntersector(osgUtil::IntersectionVisitor& iv, osg::Drawable* drawable, osg::KdTree* kdTree):
+        _iv(iv),
+        _drawable(drawable),
+        _kdTree(kdTree)
+    {
+        osg::Geometry* geometry = drawable->asGeometry();
+        if (geometry) _vertices = dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray());
+    }
+
+    void addSegment(osgUtil::LineSegmentIntersector* lsi, const osg::Vec3d& s, const osg::Vec3d& e, bool limitOneIntersection)
+    {
+        // same set up as IntersectFunctor::set()
+        osg::Vec3d d = e - s;
+        double length = d.length();
+        double inverse_length = (length!=0.0) ? 1.0/length : 0.0;
+        d *= inverse_length;
+
+        _intersectors.push_back(lsi);
+        _sx.push_back(s.x()); _sy.push_back(s.y()); _sz.push_back(s.z());
+        _dx.push_back(d.x()); _dy.push_back(d.y()); _dz.push_back(d.z());
+        _length.push_back(length);
+        _inverse_length.push_back(inverse_length);
+        _limitOne.push_back(limitOneIntersection);
+        _hit.push_back(false);
+
+        // inverse of the segment's extent along each axis for the slab tests, a large finite value for a zero extent
+        // avoids the NaN's that would otherwise result from segments starting on a bounding box plane.
+        osg::Vec3d se = e - s;
+        _ix.push_back(se.x()!=0.0 ? 1.0/se.x() : 1e300);
+        _iy.push_back(se.y()!=0.0 ? 1.0/se.y() : 1e300);
+        _iz.push_back(se.z()!=0.0 ? 1.0/se.z() : 1e300);
+    }
+
+    unsigned int getNumSegments() const { return _intersectors.size(); }
+
+    void intersect()
+    {
+        if (_intersectors.empty()) return;
+
+        const osg::KdTree::KdNodeList& nodes = _kdTree->getNodes();
+        if (nodes.empty()) return;
+
+        _activeStack.resize(1);
+        ActiveList& active = _activeStack[0];
+        active.clear();
+        for(unsigned int i=0; i<_intersectors.size(); ++i) active.push_back(i);
+
+        traverse(nodes[0], 0);
+    }
+
+    void traverse(const osg::KdTree::KdNode& node, unsigned int depth)
+    {
+        if (node.first<0)
+        {
+            intersectLeaf(node, _activeStack[depth]);
+            return;
+        }
+
+        if (_activeStack.size()<=depth+1) _activeStack.resize(depth+2);
+
+        ActiveList& childActive = _activeStack[depth+1];
+        if (!intersectBound(node.bb, _activeStack[depth], childActive)) return;
+
+        const osg::KdTree::KdNodeList& nodes = _kdTree->getNodes();
+        if (node.first>0) traverse(nodes[node.first], depth+1);
+        if (node.second>0) traverse(nodes[node.second], depth+1);
+    }
+
+    bool intersectBound(const osg::BoundingBox& bb, const ActiveList& active, ActiveList& result)
+    {
+        result.clear();
+
+        // expand the box slightly so the slab tests are conservative, the triangle tests decide the actual intersections.
+        double epsilon = 1e-6*(1.0+osg::maximum(osg::maximum(osg::absolute(bb.xMin()), osg::absolute(bb.xMax())),
+                                                osg::maximum(osg::maximum(osg::absolute(bb.yMin()), osg::absolute(bb.yMax())),
+                                                             osg::maximum(osg::absolute(bb.zMin()), osg::absolute(bb.zMax())))));
+
+        double xMin = double(bb.xMin())-epsilon, xMax = double(bb.xMax())+epsilon;
+        double yMin = double(bb.yMin())-epsilon, yMax = double(bb.yMax())+epsilon;
+        double zMin = double(bb.zMin())-epsilon, zMax = double(bb.zMax())+epsilon;
+
+        unsigned int numActive = active.size();
+        unsigned int i = 0;
+
+#ifdef OSG_LINESEGMENT_PACKET_USE_SSE2
+        const __m128d bxMin = _mm_set1_pd(xMin), bxMax = _mm_set1_pd(xMax);
+        const __m128d byMin = _mm_set1_pd(yMin), byMax = _mm_set1_pd(yMax);
+        const __m128d bzMin = _mm_set1_pd(zMin), bzMax = _mm_set1_pd(zMax);
+        const __m128d zero = _mm_setzero_pd();
+        const __m128d one = _mm_set1_pd(1.0);
+
+        for(; i+1<numActive; i+=2)
+        {
+            unsigned int r0 = active[i], r1 = active[i+1];
+
+            __m128d tNear = zero;
+            __m128d tFar = one;
+
+            __m128d s = _mm_set_pd(_sx[r1], _sx[r0]);
+            __m128d inv = _mm_set_pd(_ix[r1], _ix[r0]);
+            __m128d t1 = _mm_mul_pd(_mm_sub_pd(bxMin, s), inv);
+            __m128d t2 = _mm_mul_pd(_mm_sub_pd(bxMax, s), inv);
+            tNear = _mm_max_pd(tNear, _mm_min_pd(t1, t2));
+            tFar = _mm_min_pd(tFar, _mm_max_pd(t1, t2));
+
+            s = _mm_set_pd(_sy[r1], _sy[r0]);
+            inv = _mm_set_pd(_iy[r1], _iy[r0]);
+            t1 = _mm_mul_pd(_mm_sub_pd(byMin, s), inv);
+            t2 = _mm_mul_pd(_mm_sub_pd(byMax, s), inv);
+            tNear = _mm_max_pd(tNear, _mm_min_pd(t1, t2));
+            tFar = _mm_min_pd(tFar, _mm_max_pd(t1, t2));
+
+            s = _mm_set_pd(_sz[r1], _sz[r0]);
+            inv = _mm_set_pd(_iz[r1], _iz[r0]);
+            t1 = _mm_mul_pd(_mm_sub_pd(bzMin, s), inv);
+            t2 = _mm_mul_pd(_mm_sub_pd(bzMax, s), inv);
+            tNear = _mm_max_pd(tNear, _mm_min_pd(t1, t2));
+            tFar = _mm_min_pd(tFar, _mm_max_pd(t1, t2));
+
+            int mask = _mm_movemask_pd(_mm_cmple_pd(tNear, tFar));
+            if (mask&1) result.push_back(r0);
+            if (mask&2) result.push_back(r1);
+        }
+#endif
+
+        for(; i<numActive; ++i)
+        {
+            unsigned int r = active[i];
+
+            double tNear = 0.0;
+            double tFar = 1.0;
+
+            double t1 = (xMin-_sx[r])*_ix[r], t2 = (xMax-_sx[r])*_ix[r];
+            tNear = osg::maximum(tNear, osg::minimum(t1, t2));
+            tFar = osg::minimum(tFar, osg::maximum(t1, t2));
+
+            t1 = (yMin-_sy[r])*_iy[r]; t2 = (yMax-_sy[r])*_iy[r];
+            tNear = osg::maximum(tNear, osg::minimum(t1, t2));
+            tFar = osg::minimum(tFar, osg::maximum(t1, t2));
+
+            t1 = (zMin-_sz[r])*_iz[r]; t2 = (zMax-_sz[r])*_iz[r];
+            tNear = osg::maximum(tNear, osg::minimum(t1, t2));
+            tFar = osg::minimum(tFar, osg::maximum(t1, t2));
+
+            if (tNear<=tFar) result.push_back(r);
+        }
+
+        return !result.empty();
+    }
+
+    void intersectLeaf(const osg::KdTree::KdNode& node, const ActiveList& active)
+    {
+        const osg::Vec3Array& vertices = *(_kdTree->getVertices());
+        const osg::KdTree::Indices& primitiveIndices = _kdTree->getPrimitiveIndices();
+        const osg::KdTree::Indices& vertexIndices = _kdTree->getVertexIndices();
+
+        int istart = -node.first-1;
+        int iend = istart + node.second;
+
+        for(int i=istart; i<iend; ++i)
+        {
+            unsigned int primitiveIndex = primitiveIndices[i];
+            unsigned int originalPIndex = vertexIndices[primitiveIndex++];
+            unsigned int numVertices = vertexIndices[primitiveIndex++];
+            switch(numVertices)
+            {
+                case(3):
+                    intersect(active, originalPIndex, vertices[vertexIndices[primitiveIndex]], vertices[vertexIndices[primitiveIndex+1]], vertices[vertexIndices[primitiveIndex+2]]);
+                    break;
+                case(4):
+                    intersect(active, originalPIndex, vertices[vertexIndices[primitiveIndex]], vertices[vertexIndices[primitiveIndex+1]], vertices[vertexIndices[primitiveIndex+3]]);
+                    intersect(active, originalPIndex, vertices[vertexIndices[primitiveIndex+1]], vertices[vertexIndices[primitiveIndex+2]], vertices[vertexIndices[primitiveIndex+3]]);
+                    break;
+                default:
+                    // points and lines aren't intersected by line segments.
+                    break;
+            }
+        }
+    }
+
+    void intersect(const ActiveList& active, unsigned int primitiveIndex, const osg::Vec3& v0, const osg::Vec3& v1, const osg::Vec3& v2)
+    {
+        // edges are computed in float then promoted, as in IntersectFunctor.
+        osg::Vec3d E2 = v2 - v0;
+        osg::Vec3d E1 = v1 - v0;
+
+        const double epsilon = 1e-10;
+
+        unsigned int numActive = active.size();
+        unsigned int i = 0;
+
+#ifdef OSG_LINESEGMENT_PACKET_USE_SSE2
+        const __m128d e1x = _mm_set1_pd(E1.x()), e1y = _mm_set1_pd(E1.y()), e1z = _mm_set1_pd(E1.z());
+        const __m128d e2x = _mm_set1_pd(E2.x()), e2y = _mm_set1_pd(E2.y()), e2z = _mm_set1_pd(E2.z());
+        const __m128d v0x = _mm_set1_pd(v0.x()), v0y = _mm_set1_pd(v0.y()), v0z = _mm_set1_pd(v0.z());
+        const __m128d zero = _mm_setzero_pd();
+        const __m128d positiveEpsilon = _mm_set1_pd(epsilon);
+        const __m128d negativeEpsilon = _mm_set1_pd(-epsilon);
+
+        for(; i+1<numActive; i+=2)
+        {
+            unsigned int r0 = active[i], r1 = active[i+1];
+
+            __m128d dx = _mm_set_pd(_dx[r1], _dx[r0]);
+            __m128d dy = _mm_set_pd(_dy[r1], _dy[r0]);
+            __m128d dz = _mm_set_pd(_dz[r1], _dz[r0]);
+
+            // P = d ^ E2, det = P * E1, u = P * T, evaluated in the same order as the scalar code.
+            __m128d px = _mm_sub_pd(_mm_mul_pd(dy, e2z), _mm_mul_pd(dz, e2y));
+            __m128d py = _mm_sub_pd(_mm_mul_pd(dz, e2x), _mm_mul_pd(dx, e2z));
+            __m128d pz = _mm_sub_pd(_mm_mul_pd(dx, e2y), _mm_mul_pd(dy, e2x));
+
+            __m128d det = _mm_add_pd(_mm_add_pd(_mm_mul_pd(px, e1x), _mm_mul_pd(py, e1y)), _mm_mul_pd(pz, e1z));
+
+            __m128d tx = _mm_sub_pd(_mm_set_pd(_sx[r1], _sx[r0]), v0x);
+            __m128d ty = _mm_sub_pd(_mm_set_pd(_sy[r1], _sy[r0]), v0y);
+            __m128d tz = _mm_sub_pd(_mm_set_pd(_sz[r1], _sz[r0]), v0z);
+
+            __m128d u = _mm_add_pd(_mm_add_pd(_mm_mul_pd(px, tx), _mm_mul_pd(py, ty)), _mm_mul_pd(pz, tz));
+
+            // the same rejection tests as the scalar code, so segments with NaN's are passed on to it too.
+            __m128d positiveReject = _mm_or_pd(_mm_cmplt_pd(u, zero), _mm_cmpgt_pd(u, det));
+            __m128d negativeReject = _mm_or_pd(_mm_cmpgt_pd(u, zero), _mm_cmplt_pd(u, det));
+            __m128d positive = _mm_andnot_pd(positiveReject, _mm_cmpgt_pd(det, positiveEpsilon));
+            __m128d negative = _mm_andnot_pd(negativeReject, _mm_cmplt_pd(det, negativeEpsilon));
+
+            int mask = _mm_movemask_pd(_mm_or_pd(positive, negative));
+            if (mask&1) intersect(r0, primitiveIndex, v0, v1, v2, E1, E2);
+            if (mask&2) intersect(r1, primitiveIndex, v0, v1, v2, E1, E2);
+        }
+#endif
+
+        for(; i<numActive; ++i)
+        {
+            intersect(active[i], primitiveIndex, v0, v1, v2, E1, E2);
+        }
+    }
+
+    void intersect(unsigned int r, unsigned int primitiveIndex, const osg::Vec3& v0, const osg::Vec3& v1, const osg::Vec3& v2, const osg::Vec3d& E1, const osg::Vec3d& E2)
+    {
+        if (_limitOne[r] && _hit[r]) return;
+
+        osg::Vec3d start(_sx[r], _sy[r], _sz[r]);
+        osg::Vec3d d(_dx[r], _dy[r], _dz[r]);
+        double length = _length[r];
+
+        osg::Vec3d T = start - v0;
+
+        osg::Vec3d P =  d ^ E2;
+
+        double det = P * E1;
+
+        double r0,r1,r2,ratio;
+
+        const double epsilon = 1e-10;
+        if (det>epsilon)
+        {
+            double u = (P*T);
+            if (u<0.0 || u>det) return;
+
+            osg::Vec3 Q = T ^ E1;
+            double v = (Q*d);
+            if (v<0.0 || v>det) return;
+
+            if ((u+v)> det) return;
+
+            double inv_det = 1.0/det;
+            double t = (Q*E2)*inv_det;
+            if (t<0.0 || t>length) return;
+
+            u *= inv_det;
+            v *= inv_det;
+
+            r0 = 1.0-u-v;
+            r1 = u;
+            r2 = v;
+            ratio = t * _inverse_length[r];
+        }
+        else if (det<-epsilon)
+        {
+            double u = (P*T);
+            if (u>0.0 || u<det) return;
+
+            osg::Vec3d Q = T ^ E1;
+            double v = (Q*d);
+            if (v>0.0 || v<det) return;
+
+            if ((u+v) < det) return;
+
+            double inv_det = 1.0/det;
+            double t = (Q*E2)*inv_det;
+            if (t<0.0 || t>length) return;
+
+            u *= inv_det;
+            v *= inv_det;
+
+            r0 = 1.0-u-v;
+            r1 = u;
+            r2 = v;
+            ratio = t * _inverse_length[r];
+        }
+        else
+        {
+            return;
+        }
+
+        osgUtil::LineSegmentIntersector* lsi = _intersectors[r];
+
+        // Remap ratio into the range of LineSegment
+        const osg::Vec3d& lsStart = lsi->getStart();
+        const osg::Vec3d& lsEnd = lsi->getEnd();
+        double remap_ratio =  ((start - lsStart).length() + ratio*length)/(lsEnd - lsStart).length();
+
+        osg::Vec3d in = lsStart*(1.0 - remap_ratio) + lsEnd*remap_ratio;
+        osg::Vec3d normal = E1^E2;
+        normal.normalize();
+
+        LineSegmentIntersector::Intersection hit;
+        hit.ratio = remap_ratio;
+        hit.matrix = _iv.getModelMatrix();
+        hit.nodePath = _iv.getNodePath();
+        hit.drawable = _drawable;
+        hit.primitiveIndex = primitiveIndex;
+
+        hit.localIntersectionPoint = in;
+        hit.localIntersectionNormal = normal;
+
+        if (_vertices.valid())
+        {
+            const osg::Vec3* first = &(_vertices->front());
+            hit.indexList.reserve(3);
+            hit.ratioList.reserve(3);
+
+            if (r0!=0.0f)
+            {
+                hit.indexList.push_back(&v0-first);
+                hit.ratioList.push_back(r0);
+            }
+
+            if (r1!=0.0f)
+            {
+                hit.indexList.push_back(&v1-first);
+                hit.ratioList.push_back(r1);
+            }
+
+            if (r2!=0.0f)
+            {
+                hit.indexList.push_back(&v2-first);
+                hit.ratioList.push_back(r2);
+            }
+        }
+
+        lsi->insertIntersection(hit);
+        _hit[r] = true;
+    }
+
+    osgUtil::IntersectionVisitor&                   _iv;
+    osg::Drawable*                                  _drawable;
+    osg::KdTree*                                    _kdTree;
+    osg::ref_ptr<osg::Vec3Array>                    _vertices;
+
+    std::vector<osgUtil::LineSegmentIntersector*>   _intersectors;
+    std::vector<double>                             _sx, _sy, _sz;
+    std::vector<double>                             _dx, _dy, _dz;
+    std::vector<double>                             _ix, _iy, _iz;
+    std::vector<double>                             _length;
+    std::vector<double>                             _inverse_length;
+    std::vector<unsigned char>                      _limitOne;
+    std::vector<unsigned char>                      _hit;
+
+    std::vector<ActiveList>                         _activeStack;
+
+protected:
+
+    PacketIntersector& operator = (const PacketIntersector&) { return *this; }
+};
+
 } // namespace LineSegmentIntersectorUtils
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -550,6 +942,49 @@ void LineSegmentIntersector::intersect(osgUtil::IntersectionVisitor& iv, osg::Dr
     }
 }
 
+void LineSegmentIntersector::intersect(osgUtil::IntersectionVisitor& iv, osg::Drawable* drawable, const LineSegmentIntersectorList& intersectors)
+{
+    osg::KdTree* kdTree = iv.getUseKdTreeWhenAvailable() ? dynamic_cast<osg::KdTree*>(drawable->getShape()) : 0;
+    if (!kdTree || !kdTree->getVertices() || intersectors.size()<2)
+    {
+        for(LineSegmentIntersectorList::const_iterator itr = intersectors.begin();
+            itr != intersectors.end();
+            ++itr)
+        {
+            (*itr)->intersect(iv, drawable);
+        }
+        return;
+    }
+
+    LineSegmentIntersectorUtils::PacketIntersector packet(iv, drawable, kdTree);
+
+    for(LineSegmentIntersectorList::const_iterator itr = intersectors.begin();
+        itr != intersectors.end();
+        ++itr)
+    {
+        LineSegmentIntersector* lsi = *itr;
+
+        if (lsi->reachedLimit()) continue;
+
+        // float precision segments are left to the per segment code path.
+        if (lsi->getPrecisionHint()!=USE_DOUBLE_CALCULATIONS)
+        {
+            lsi->intersect(iv, drawable);
+            continue;
+        }
+
+        osg::Vec3d s(lsi->_start), e(lsi->_end);
+        if ( drawable->isCullingActive() && !lsi->intersectAndClip( s, e, drawable->getBoundingBox() ) ) continue;
+
+        if (iv.getDoDummyTraversal()) continue;
+
+        bool limitOneIntersection = (lsi->_intersectionLimit == LIMIT_ONE_PER_DRAWABLE || lsi->_intersectionLimit == LIMIT_ONE);
+        packet.addSegment(lsi, s, e, limitOneIntersection);
+    }
+
+    packet.intersect();
+}
+
 void LineSegmentIntersector::reset()
 {
     Intersector::reset();
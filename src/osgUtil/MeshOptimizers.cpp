@@ -19,6 +19,8 @@
 #include <vector>
 
 #include <iostream>
+#include <math.h>
+#include <string.h>
 
 #include <osg/Geometry>
 #include <osg/Math>
@@ -28,6 +30,9 @@
 
 #include <osgUtil/MeshOptimizers>
 
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Thread>
+
 using namespace osg;
 
 namespace osgUtil
@@ -100,49 +105,386 @@ struct GeometryArrayGatherer
     ArrayList _arrayList;
 };
 
-// Compare vertices in a mesh using all their attributes. The vertices
-// are identified by their index. Extracted from TriStripVisitor.cpp
-struct VertexAttribComparitor : public GeometryArrayGatherer
+template<class Functor>
+void runTasks(Functor& functor, OpenThreads::Atomic& nextTask, unsigned int numTasks)
 {
-    VertexAttribComparitor(osg::Geometry& geometry)
-        : GeometryArrayGatherer(geometry)
+    for(unsigned int i=(++nextTask)-1; i<numTasks; i=(++nextTask)-1)
     {
+        functor(i);
     }
+}
+
+template<class Functor>
+class TaskThread : public OpenThreads::Thread
+{
+    public:
+
+        TaskThread(Functor& functor, OpenThreads::Atomic& nextTask, unsigned int numTasks):
+            _functor(functor),
+            _nextTask(nextTask),
+            _numTasks(numTasks) {}
+
+        virtual void run() { runTasks(_functor, _nextTask, _numTasks); }
+
+    protected:
+
+        Functor&                _functor;
+        OpenThreads::Atomic&    _nextTask;
+        unsigned int            _numTasks;
+};
+
+template<class Functor>
+void parallelFor(Functor& functor, unsigned int numTasks, unsigned int numThreads)
+{
+    OpenThreads::Atomic nextTask(0);
 
-    VertexAttribComparitor(const VertexAttribComparitor& rhs)
-        : GeometryArrayGatherer(rhs)
+    std::vector< TaskThread<Functor>* > threads;
+    for(unsigned int i=1; i<numThreads && i<numTasks; ++i)
     {
+        TaskThread<Functor>* thread = new TaskThread<Functor>(functor, nextTask, numTasks);
+        threads.push_back(thread);
+        thread->start();
     }
 
-    bool operator() (unsigned int lhs, unsigned int rhs) const
+    runTasks(functor, nextTask, numTasks);
+
+    for(typename std::vector< TaskThread<Functor>* >::iterator itr = threads.begin();
+        itr != threads.end();
+        ++itr)
     {
-        for(ArrayList::const_iterator itr=_arrayList.begin();
-            itr!=_arrayList.end();
-            ++itr)
+        (*itr)->join();
+        delete *itr;
+    }
+}
+
+inline unsigned int mixHash(unsigned int hash, unsigned int bits)
+{
+    bits *= 0xcc9e2d51u;
+    bits = (bits << 15) | (bits >> 17);
+    hash ^= bits * 0x1b873593u;
+    return ((hash << 13) | (hash >> 19)) * 5u + 0xe6546b64u;
+}
+
+inline unsigned int finalizeHash(unsigned int hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+// Hash a float so that values comparing equal hash alike, -0 as 0 and all NaNs as one value.
+inline unsigned int hashFloat(unsigned int hash, float value)
+{
+    if (value==0.0f) value = 0.0f;
+    unsigned int bits = 0x7fc00000u;
+    if (value==value) memcpy(&bits, &value, sizeof(bits));
+    return mixHash(hash, bits);
+}
+
+inline unsigned int hashDouble(unsigned int hash, double value)
+{
+    if (value==0.0) value = 0.0;
+    unsigned int bits[2] = { 0u, 0x7ff80000u };
+    if (value==value) memcpy(bits, &value, sizeof(bits));
+    return mixHash(mixHash(hash, bits[0]), bits[1]);
+}
+
+// The per vertex data of an array, read directly to hash and compare the vertices.
+struct VertexArrayData
+{
+    VertexArrayData(const osg::Array& array):
+        data(static_cast<const unsigned char*>(array.getDataPointer())),
+        elementSize(array.getElementSize()),
+        numComponents(array.getDataSize()),
+        dataType(array.getDataType()) {}
+
+    inline const unsigned char* element(unsigned int index) const { return data + static_cast<size_t>(index)*elementSize; }
+
+    inline double component(unsigned int index, unsigned int c) const
+    {
+        if (dataType==GL_FLOAT)
         {
-            int compare = (*itr)->compare(lhs,rhs);
-            if (compare==-1) return true;
-            if (compare==1) return false;
+            float value;
+            memcpy(&value, element(index)+c*sizeof(float), sizeof(float));
+            return value;
         }
-        return false;
+        double value;
+        memcpy(&value, element(index)+c*sizeof(double), sizeof(double));
+        return value;
     }
 
-    int compare(unsigned int lhs, unsigned int rhs)
+    unsigned int hash(unsigned int hashValue, unsigned int index) const
     {
-        for(ArrayList::iterator itr=_arrayList.begin();
-            itr!=_arrayList.end();
+        const unsigned char* values = element(index);
+        if (dataType==GL_FLOAT)
+        {
+            for(unsigned int c=0; c<numComponents; ++c)
+            {
+                float value;
+                memcpy(&value, values+c*sizeof(float), sizeof(float));
+                hashValue = hashFloat(hashValue, value);
+            }
+        }
+        else if (dataType==GL_DOUBLE)
+        {
+            for(unsigned int c=0; c<numComponents; ++c)
+            {
+                double value;
+                memcpy(&value, values+c*sizeof(double), sizeof(double));
+                hashValue = hashDouble(hashValue, value);
+            }
+        }
+        else
+        {
+            unsigned int b=0;
+            for(; b+sizeof(unsigned int)<=elementSize; b+=sizeof(unsigned int))
+            {
+                unsigned int bits;
+                memcpy(&bits, values+b, sizeof(bits));
+                hashValue = mixHash(hashValue, bits);
+            }
+            for(; b<elementSize; ++b) hashValue = mixHash(hashValue, values[b]);
+        }
+        return hashValue;
+    }
+
+    bool equal(unsigned int lhs, unsigned int rhs) const
+    {
+        if (dataType==GL_FLOAT || dataType==GL_DOUBLE)
+        {
+            for(unsigned int c=0; c<numComponents; ++c)
+            {
+                double lhsValue = component(lhs, c), rhsValue = component(rhs, c);
+                if (lhsValue!=rhsValue && (lhsValue==lhsValue || rhsValue==rhsValue)) return false;
+            }
+            return true;
+        }
+        return memcmp(element(lhs), element(rhs), elementSize)==0;
+    }
+
+    const unsigned char*    data;
+    unsigned int            elementSize;
+    unsigned int            numComponents;
+    GLenum                  dataType;
+};
+
+// Find the first of the vertices of a Geometry identical to each vertex, hashing all the per vertex arrays into open
+// addressing hash tables. The vertex hashes are computed in chunks on several threads, then the vertices are split by
+// their hash into partitions, each deduplicated on a thread in the order of the vertices. When welding, the hash
+// table is keyed by the cell of a grid of twice the tolerance containing the position, and a vertex is looked up in
+// the cells nearest to its position in each axis, so the welding is done serially.
+struct VertexDeduplicator
+{
+    struct HashEntry
+    {
+        HashEntry() : hash(0), index(~0u) {}
+
+        unsigned int hash;
+        unsigned int index;
+    };
+    typedef std::vector<HashEntry> HashTable;
+
+    VertexDeduplicator(const GeometryArrayGatherer::ArrayList& arrayList, unsigned int numVerts, double weldTolerance):
+        numVertices(numVerts),
+        tolerance(weldTolerance),
+        hashes(numVerts),
+        representatives(numVerts)
+    {
+        for(GeometryArrayGatherer::ArrayList::const_iterator itr=arrayList.begin();
+            itr!=arrayList.end();
             ++itr)
         {
-            int compare = (*itr)->compare(lhs,rhs);
-            if (compare==-1) return -1;
-            if (compare==1) return 1;
+            arrays.push_back(VertexArrayData(**itr));
         }
-        return 0;
+
+        // only positions of floats or doubles are welded.
+        GLenum dataType = arrays.front().dataType;
+        if ((dataType!=GL_FLOAT && dataType!=GL_DOUBLE) || arrays.front().numComponents>4) tolerance = 0.0;
     }
 
-protected:
-    VertexAttribComparitor& operator = (const VertexAttribComparitor&) { return *this; }
+    static const unsigned int numVerticesPerHashTask = 16384;
+
+    unsigned int getNumHashTasks() const { return (numVertices+numVerticesPerHashTask-1)/numVerticesPerHashTask; }
+
+    // when welding the positions are hashed separately, by cell.
+    void hashVertices(unsigned int task)
+    {
+        unsigned int firstArray = tolerance>0.0 ? 1 : 0;
+        unsigned int end = osg::minimum(numVertices, (task+1)*numVerticesPerHashTask);
+        for(unsigned int v=task*numVerticesPerHashTask; v<end; ++v)
+        {
+            unsigned int hash = 0;
+            for(unsigned int a=firstArray; a<arrays.size(); ++a)
+            {
+                hash = arrays[a].hash(hash, v);
+            }
+            hashes[v] = tolerance>0.0 ? hash : finalizeHash(hash);
+        }
+    }
+
+    bool equalVertices(unsigned int lhs, unsigned int rhs, unsigned int firstArray) const
+    {
+        for(unsigned int a=firstArray; a<arrays.size(); ++a)
+        {
+            if (!arrays[a].equal(lhs, rhs)) return false;
+        }
+        return true;
+    }
+
+    static unsigned int getTableSize(unsigned int numEntries)
+    {
+        unsigned int tableSize = 1;
+        while(tableSize<numEntries*2) tableSize <<= 1;
+        return tableSize;
+    }
+
+    static inline unsigned int getPartition(unsigned int hash, unsigned int numPartitions)
+    {
+        return static_cast<unsigned int>((static_cast<unsigned long long>(hash)*numPartitions)>>32);
+    }
 
+    void deduplicatePartition(unsigned int partition, unsigned int numPartitions)
+    {
+        unsigned int numEntries = numVertices;
+        if (numPartitions>1)
+        {
+            numEntries = 0;
+            for(unsigned int v=0; v<numVertices; ++v)
+            {
+                if (getPartition(hashes[v], numPartitions)==partition) ++numEntries;
+            }
+        }
+        if (numEntries==0) return;
+
+        HashTable table(getTableSize(numEntries));
+        unsigned int mask = table.size()-1;
+        for(unsigned int v=0; v<numVertices; ++v)
+        {
+            unsigned int hash = hashes[v];
+            if (numPartitions>1 && getPartition(hash, numPartitions)!=partition) continue;
+
+            unsigned int slot = hash & mask;
+            for(; table[slot].index!=~0u; slot=(slot+1) & mask)
+            {
+                if (table[slot].hash==hash && equalVertices(table[slot].index, v, 0)) break;
+            }
+
+            if (table[slot].index==~0u)
+            {
+                table[slot].hash = hash;
+                table[slot].index = v;
+            }
+            representatives[v] = table[slot].index;
+        }
+    }
+
+    bool withinTolerance(unsigned int lhs, unsigned int rhs) const
+    {
+        const VertexArrayData& positions = arrays.front();
+        double distance2 = 0.0;
+        for(unsigned int c=0; c<positions.numComponents; ++c)
+        {
+            double delta = positions.component(lhs, c)-positions.component(rhs, c);
+            distance2 += delta*delta;
+        }
+        return distance2<=tolerance*tolerance;
+    }
+
+    void weld()
+    {
+        const VertexArrayData& positions = arrays.front();
+        const unsigned int numComponents = positions.numComponents;
+        const double cellSize = tolerance*2.0;
+
+        HashTable table(getTableSize(numVertices));
+        unsigned int mask = table.size()-1;
+        for(unsigned int v=0; v<numVertices; ++v)
+        {
+            // a position within the tolerance lies in the cell of the vertex or in the nearest neighbouring cell in each axis.
+            double cells[4], neighbours[4];
+            for(unsigned int c=0; c<numComponents; ++c)
+            {
+                double position = positions.component(v, c)/cellSize;
+                cells[c] = floor(position);
+                neighbours[c] = (position-cells[c]<0.5) ? cells[c]-1.0 : cells[c]+1.0;
+            }
+
+            unsigned int cellHash = 0;
+            representatives[v] = v;
+            for(unsigned int n=0; n<(1u<<numComponents) && representatives[v]==v; ++n)
+            {
+                unsigned int hash = hashes[v];
+                for(unsigned int c=0; c<numComponents; ++c)
+                {
+                    hash = hashDouble(hash, (n & (1u<<c)) ? neighbours[c] : cells[c]);
+                }
+                hash = finalizeHash(hash);
+                if (n==0) cellHash = hash;
+
+                for(unsigned int slot=hash & mask; table[slot].index!=~0u; slot=(slot+1) & mask)
+                {
+                    unsigned int index = table[slot].index;
+                    if (table[slot].hash==hash && withinTolerance(index, v) && equalVertices(index, v, 1))
+                    {
+                        representatives[v] = index;
+                        break;
+                    }
+                }
+            }
+
+            if (representatives[v]==v)
+            {
+                unsigned int slot = cellHash & mask;
+                while(table[slot].index!=~0u) slot = (slot+1) & mask;
+                table[slot].hash = cellHash;
+                table[slot].index = v;
+            }
+        }
+    }
+
+    void deduplicate(unsigned int numThreads)
+    {
+        HashFunctor hashFunctor(*this);
+        parallelFor(hashFunctor, getNumHashTasks(), numThreads);
+
+        if (tolerance>0.0)
+        {
+            weld();
+        }
+        else
+        {
+            PartitionFunctor partitionFunctor(*this, numThreads);
+            parallelFor(partitionFunctor, numThreads, numThreads);
+        }
+    }
+
+    struct HashFunctor
+    {
+        HashFunctor(VertexDeduplicator& deduplicator) : _deduplicator(deduplicator) {}
+
+        void operator() (unsigned int task) { _deduplicator.hashVertices(task); }
+
+        VertexDeduplicator& _deduplicator;
+    };
+
+    struct PartitionFunctor
+    {
+        PartitionFunctor(VertexDeduplicator& deduplicator, unsigned int numPartitions) : _deduplicator(deduplicator), _numPartitions(numPartitions) {}
+
+        void operator() (unsigned int partition) { _deduplicator.deduplicatePartition(partition, _numPartitions); }
+
+        VertexDeduplicator& _deduplicator;
+        unsigned int _numPartitions;
+    };
+
+    std::vector<VertexArrayData>    arrays;
+    unsigned int                    numVertices;
+    double                          tolerance;
+    IndexList                       hashes;
+    IndexList                       representatives;
 };
 
 // Compact the vertex attribute arrays. Also stolen from TriStripVisitor
@@ -280,61 +622,34 @@ void IndexMeshVisitor::makeMesh(Geometry& geom)
     if (geom.containsSharedArrays()) geom.duplicateSharedArrays();
 
     // compute duplicate vertices
-    typedef std::vector<unsigned int> IndexList;
     unsigned int numVertices = geom.getVertexArray()->getNumElements();
-    IndexList indices(numVertices);
-    unsigned int i,j;
-    for(i=0;i<numVertices;++i)
-    {
-        indices[i] = i;
-    }
-
-    VertexAttribComparitor arrayComparitor(geom);
-    std::sort(indices.begin(),indices.end(),arrayComparitor);
+    unsigned int i;
 
-    unsigned int lastUnique = 0;
-    unsigned int numUnique = 1;
-    for(i=1;i<numVertices;++i)
+    GeometryArrayGatherer gatherer(geom);
+    for(GeometryArrayGatherer::ArrayList::iterator itr=gatherer._arrayList.begin();
+        itr!=gatherer._arrayList.end();
+        ++itr)
     {
-        if (arrayComparitor.compare(indices[lastUnique],indices[i]) != 0)
-        {
-            lastUnique = i;
-            ++numUnique;
-        }
-
+        // the arrays are read directly, so can't index arrays missing vertices.
+        if ((*itr)->getNumElements()<numVertices) return;
     }
-    IndexList remapDuplicatesToOrignals(numVertices);
-    lastUnique = 0;
-    for(i=1;i<numVertices;++i)
-    {
-        if (arrayComparitor.compare(indices[lastUnique],indices[i])!=0)
-        {
-            // found a new vertex entry, so previous run of duplicates needs
-            // to be put together.
-            unsigned int min_index = indices[lastUnique];
-            for(j=lastUnique+1;j<i;++j)
-            {
-                min_index = osg::minimum(min_index,indices[j]);
-            }
-            for(j=lastUnique;j<i;++j)
-            {
-                remapDuplicatesToOrignals[indices[j]]=min_index;
-            }
-            lastUnique = i;
-        }
 
-    }
-    unsigned int min_index = indices[lastUnique];
-    for(j=lastUnique+1;j<i;++j)
+    unsigned int numThreads = 1;
+    if (numVertices>=_parallelMinimumNumVertices)
     {
-        min_index = osg::minimum(min_index,indices[j]);
+        numThreads = _numThreads>0 ? _numThreads : static_cast<unsigned int>(osg::maximum(1, OpenThreads::GetNumberOfProcessors()));
     }
-    for(j=lastUnique;j<i;++j)
+
+    VertexDeduplicator deduplicator(gatherer._arrayList, numVertices, _weldTolerance);
+    deduplicator.deduplicate(numThreads);
+    const IndexList& remapDuplicatesToOrignals = deduplicator.representatives;
+
+    unsigned int numUnique = 0;
+    for(i=0;i<numVertices;++i)
     {
-        remapDuplicatesToOrignals[indices[j]]=min_index;
+        if (remapDuplicatesToOrignals[i]==i) ++numUnique;
     }
 
-
     // copy the arrays.
     IndexList finalMapping(numVertices);
     IndexList copyMapping;
@@ -376,7 +691,7 @@ void IndexMeshVisitor::makeMesh(Geometry& geom)
 
     // remap any shared vertex attributes
     RemapArray ra(copyMapping);
-    arrayComparitor.accept(ra);
+    gatherer.accept(ra);
     if (taf._in_indices.size() < 65536)
     {
         osg::DrawElementsUShort* elements = new DrawElementsUShort(GL_TRIANGLES);
@@ -411,254 +726,126 @@ void IndexMeshVisitor::makeMesh()
 
 namespace
 {
-// A simulation of a Least Recently Used cache. Position in the cache
-// corresponds to when the vertex was used i.e., 0 is the most
-// recently used.
-struct LRUCache
+// Collect the indices of the non degenerate triangles of the primitive sets.
+struct TriangleListOperator
 {
-    LRUCache(size_t maxSize_) : maxSize(maxSize_)
-    {
-        entries.reserve(maxSize_ + 3);
-    }
-    std::vector<unsigned> entries;
-    size_t maxSize;
+    std::vector<unsigned>* triIndices;
+    TriangleListOperator() : triIndices(0) {}
 
-    // Add a list of values to the cache
-    void addEntries(unsigned* begin, unsigned* end)
-    {
-        // If any of the new vertices are already in the cache, remove
-        // them, leaving some room at the front of the cache.
-        std::vector<unsigned>::reverse_iterator validEnd = entries.rend();
-        for (unsigned* pent = begin; pent != end; ++pent)
-        {
-            validEnd = std::remove(entries.rbegin(), validEnd, *pent);
-        }
-        // Now make room still needed for new cache entries
-        size_t newEnts = end - begin;
-        int spaceNeeded = newEnts - (entries.rend() - validEnd);
-        if (spaceNeeded > 0)
-        {
-            if (maxSize - entries.size() >= static_cast<unsigned>(spaceNeeded))
-                entries.resize(entries.size() + spaceNeeded);
-            else if (entries.size() < maxSize)
-                entries.resize(maxSize);
-            std::copy_backward(entries.begin() + newEnts - spaceNeeded,
-                               entries.end() - spaceNeeded, entries.end());
-        }
-        std::copy(begin, end, entries.begin());
-    }
-
-    bool empty()
+    void operator() (unsigned int p1, unsigned int p2, unsigned int p3)
     {
-        return entries.empty();
+        if (p1 == p2 || p2 == p3 || p1 == p3)
+            return;
+        triIndices->push_back(p1);
+        triIndices->push_back(p2);
+        triIndices->push_back(p3);
     }
 };
 
-// A list of triangles that use a vertex is associated with the Vertex
-// structure in another array.
-struct Vertex
+struct TriangleLister : public TriangleIndexFunctor<TriangleListOperator>
 {
-    int cachePosition;
-    float score;
-    int trisUsing;
-    int numActiveTris;          // triangles left to process
-    size_t triList;             // index to start of triangle storage
-    Vertex()
-        : cachePosition(-1), score(0.0f), trisUsing(0), numActiveTris(0), triList(0)
+    TriangleLister(std::vector<unsigned>* triIndices_)
     {
+        triIndices = triIndices_;
     }
 };
 
-// Code from Tom Forsyth's article. The algorithm is described in
-// detail at
-// http://home.comcast.net/~tom_forsyth/papers/fast_vert_cache_opt.html.
-// In summary, vertices are assigned a score based on the number of
-// triangles that use it (valence) and the vertex's position in the
-// model of the vertex cache, if any. Triangles are also given a
-// score, which is the sum of the scores of its vertices. The triangle
-// with the best score is added to the draw list, its vertices are
-// added and / or moved in the cache, the scores of vertices in the
-// cache and ejected from the cache are updated. Then the scores of
-// triangles that use those vertices are updated.
-//
-// Unless the cache is empty, the "best" triangle is found by
-// searching triangles that use vertices in the cache, not the whole
-// mesh. This keeps the algorithm running in time proportional to the
-// size of the mesh.
-
-// The "magic" scoring functions are described in the paper.
-const float cacheDecayPower = 1.5f;
-const float lastTriScore = 0.75f;
-const float valenceBoostScale = 2.0f;
-const float valenceBoostPower = 0.5f;
-
-const int maxCacheSize = 32;
-
-float findVertexScore (Vertex& vert)
+// The overdraw reduction of Sander et al. The triangles in draw order
+// are split into clusters, a cluster ending once its average cache
+// miss ratio drops below the threshold, so the clusters are as small
+// as possible without losing much of the cache efficiency. The
+// clusters are then sorted so that those facing away from the center
+// of the mesh, which are the most likely to occlude the rest of the
+// mesh, are drawn first.
+struct Cluster
 {
+    unsigned begin;
+    unsigned end;
+    double sortKey;
+    bool operator < (const Cluster& rhs) const { return sortKey > rhs.sortKey; }
+};
 
-    if (vert.numActiveTris == 0)
-    {
-        // No tri needs this vertex!
-        return -1.0f;
-    }
-    float score = 0.0f;
-    int cachePosition = vert.cachePosition;
+template<class ArrayType>
+void reorderClustersForOverdraw(const ArrayType& positions, std::vector<unsigned>& indices,
+                                unsigned cacheSize, float threshold)
+{
+    unsigned numTris = indices.size() / 3;
+    if (numTris == 0
+        || *std::max_element(indices.begin(), indices.end()) >= positions.size())
+        return;
 
-    if (cachePosition < 0)
-    {
-        // Vertex is not in FIFO cache - no score.
-    }
-    else
+    // Find the cluster boundaries, simulating a FIFO cache that is
+    // emptied at the start of each cluster.
+    std::vector<Cluster> clusters;
+    std::vector<unsigned> cacheTime(positions.size(), 0);
+    unsigned time = cacheSize + 1;
+    unsigned clusterMisses = 0;
+    Cluster cluster;
+    cluster.begin = 0;
+    for (unsigned t = 0; t < numTris; ++t)
     {
-        if (cachePosition < 3)
+        for (unsigned i = 0; i < 3; ++i)
         {
-            // This vertex was used in the last triangle,
-            // so it has a fixed score, whichever of the three
-            // it's in. Otherwise, you can get very different
-            // answers depending on whether you add
-            // the triangle 1,2,3 or 3,1,2 - which is silly.
-            score = lastTriScore;
+            unsigned vert = indices[t * 3 + i];
+            if (time - cacheTime[vert] > cacheSize)
+            {
+                cacheTime[vert] = time++;
+                ++clusterMisses;
+            }
         }
-        else
+        if (t + 1 == numTris
+            || float(clusterMisses) < threshold * float(t + 1 - cluster.begin))
         {
-            assert (cachePosition < maxCacheSize);
-            // Points for being high in the cache.
-            const float scaler = 1.0f / (maxCacheSize - 3);
-            score = 1.0f - (cachePosition - 3 ) * scaler;
-            score = powf(score, cacheDecayPower);
+            cluster.end = t + 1;
+            clusters.push_back(cluster);
+            cluster.begin = t + 1;
+            clusterMisses = 0;
+            time += cacheSize + 1;
         }
     }
-    // Bonus points for having a low number of tris still to
-    // use the vert, so we get rid of lone verts quickly.
-    float valenceBoost = powf(vert.numActiveTris, -valenceBoostPower);
-    score += valenceBoostScale * valenceBoost;
-    return score;
-}
-
-
-typedef std::vector<Vertex> VertexList;
-
-struct Triangle
-{
-    float score;
-    unsigned verts[3];
-};
-
-typedef std::vector<Triangle> TriangleList;
-
-inline float findTriangleScore(Triangle& tri, const VertexList& vertices)
-{
-    float result = 0.0f;
-    for (int i = 0; i < 3; ++i)
-        result += vertices[tri.verts[i]].score;
-    return result;
-}
-
-typedef std::pair<unsigned, float> TriangleScore;
+    if (clusters.size() < 2)
+        return;
 
-TriangleScore computeTriScores(Vertex& vert, const VertexList& vertices,
-                               TriangleList& triangles, std::vector<unsigned>& triStore)
-{
-    float bestScore = 0.0;
-    unsigned bestTri = 0;
-    for (size_t i = vert.triList;
-         i < vert.triList + vert.numActiveTris;
-         ++i)
-    {
-        unsigned tri = triStore[i];
-        float score = triangles[tri].score = findTriangleScore(triangles[tri],
-                                                               vertices);
-        if (score > bestScore)
+    // Area weighted centroids and normals of the clusters and the mesh.
+    std::vector<Vec3d> centroids(clusters.size());
+    std::vector<Vec3d> normals(clusters.size());
+    Vec3d meshCentroid;
+    double meshArea = 0.0;
+    for (unsigned c = 0; c < clusters.size(); ++c)
+    {
+        double area = 0.0;
+        for (unsigned t = clusters[c].begin; t < clusters[c].end; ++t)
         {
-            bestScore = score;
-            bestTri = tri;
+            Vec3d v0(positions[indices[t * 3]]);
+            Vec3d v1(positions[indices[t * 3 + 1]]);
+            Vec3d v2(positions[indices[t * 3 + 2]]);
+            Vec3d normal = (v1 - v0) ^ (v2 - v0);
+            double triArea = normal.length();
+            normals[c] += normal;
+            centroids[c] += (v0 + v1 + v2) * (triArea / 3.0);
+            area += triArea;
         }
+        meshCentroid += centroids[c];
+        meshArea += area;
+        if (area > 0.0)
+            centroids[c] /= area;
     }
-    return std::make_pair(bestTri, bestScore);
-}
-
-typedef std::vector<Triangle> TriangleList;
-
-struct TriangleCounterOperator
-{
-    VertexList* vertices;
-    int triangleCount;
-    TriangleCounterOperator() : vertices(0), triangleCount(0) {}
+    if (meshArea > 0.0)
+        meshCentroid /= meshArea;
 
-    void doVertex(unsigned p)
-    {
-        if (vertices->size() <= p)
-            vertices->resize(p + 1);
-        (*vertices)[p].trisUsing++;
-    }
+    for (unsigned c = 0; c < clusters.size(); ++c)
+        clusters[c].sortKey = (centroids[c] - meshCentroid) * normals[c];
+    std::stable_sort(clusters.begin(), clusters.end());
 
-    void operator() (unsigned int p1, unsigned int p2, unsigned int p3)
-    {
-        if (p1 == p2 || p2 == p3 || p1 == p3)
-            return;
-        doVertex(p1);
-        doVertex(p2);
-        doVertex(p3);
-        triangleCount++;
-    }
-};
-
-struct TriangleCounter : public TriangleIndexFunctor<TriangleCounterOperator>
-{
-    TriangleCounter(std::vector<Vertex>* vertices_)
-    {
-        vertices = vertices_;
-    }
-};
-
-// Initialize the vertex triangle lists and the triangle data structures
-struct TriangleAddOperator
-{
-    VertexList* vertices;
-    std::vector<unsigned>* vertexTris;
-    TriangleList* triangles;
-    int triIdx;
-    TriangleAddOperator() : vertices(0), vertexTris(0), triangles(0), triIdx(0) {}
-
-    void doVertex(unsigned p)
-    {
-        (*vertexTris)[(*vertices)[p].triList + (*vertices)[p].numActiveTris++] = triIdx;
-    }
-
-    void operator() (unsigned int p1, unsigned int p2, unsigned int p3)
-    {
-        if (p1 == p2 || p2 == p3 || p1 == p3)
-            return;
-
-        doVertex(p1);
-        doVertex(p2);
-        doVertex(p3);
-        (*triangles)[triIdx].verts[0] = p1;
-        (*triangles)[triIdx].verts[1] = p2;
-        (*triangles)[triIdx].verts[2] = p3;
-        triIdx++;
-    }
-};
-
-struct TriangleAdder : public TriangleIndexFunctor<TriangleAddOperator>
-{
-    TriangleAdder(VertexList* vertices_, std::vector<unsigned>* vertexTris_,
-                  TriangleList* triangles_)
-    {
-        vertices = vertices_;
-        vertexTris = vertexTris_;
-        triangles = triangles_;
-    }
-};
-
-struct CompareTriangle
-{
-    bool operator()(const Triangle& lhs, const Triangle& rhs)
-    {
-        return lhs.score < rhs.score;
-    }
-};
+    std::vector<unsigned> sortedIndices;
+    sortedIndices.reserve(indices.size());
+    for (std::vector<Cluster>::iterator itr = clusters.begin(), end = clusters.end();
+         itr != end;
+         ++itr)
+        sortedIndices.insert(sortedIndices.end(), indices.begin() + itr->begin * 3,
+                             indices.begin() + itr->end * 3);
+    indices.swap(sortedIndices);
+}
 }
 
 void VertexCacheVisitor::optimizeVertices(Geometry& geom)
@@ -750,130 +937,244 @@ void VertexCacheVisitor::optimizeVertices(Geometry& geom)
     geom.dirtyGLObjects();
 }
 
-// The main optimization loop
+// The main optimization loop, Tom Forsyth's algorithm described in
+// detail at
+// http://home.comcast.net/~tom_forsyth/papers/fast_vert_cache_opt.html.
+// In summary, vertices are assigned a score based on the number of
+// triangles that still use it (valence) and the vertex's position in
+// a model of a LRU vertex cache, if any. Triangles are given a score,
+// which is the sum of the scores of its vertices. The triangle with
+// the best score is added to the draw list, its vertices are added
+// and / or moved in the cache, and the scores of the vertices in the
+// cache and those ejected from it are updated.
+//
+// The best triangle is found among the triangles using the vertices
+// in the cache, as the scores of the other triangles are unchanged
+// and are lower than when they were last considered. When
+// none of them are left, the next triangle is taken from the most
+// recently added vertex that still has triangles, or failing that
+// the next triangle in the original order, so each triangle is
+// visited a constant number of times and the running time is
+// proportional to the size of the mesh. The scoring functions are
+// tabulated.
+namespace
+{
+// The "magic" scoring functions are described in the paper.
+const float cacheDecayPower = 1.5f;
+const float lastTriScore = 0.75f;
+const float valenceBoostScale = 2.0f;
+const float valenceBoostPower = 0.5f;
+
+const unsigned maxValenceScores = 64;
+
+struct VertexScoreTable
+{
+    VertexScoreTable(unsigned cacheSize)
+        : cachePositionScores(cacheSize + 1, 0.0f), valenceScores(maxValenceScores, 0.0f)
+    {
+        for (unsigned i = 0; i < cacheSize; ++i)
+        {
+            // Vertices used in the last triangle have a fixed score,
+            // whichever of the three they are, otherwise the order
+            // of the vertices of a triangle makes a difference.
+            if (i < 3)
+                cachePositionScores[i] = lastTriScore;
+            else
+                cachePositionScores[i] = powf(1.0f - float(i - 3) / float(cacheSize - 3), cacheDecayPower);
+        }
+        // Bonus points for having a low number of triangles still
+        // to use the vertex, so lone vertices are used up quickly.
+        for (unsigned i = 1; i < maxValenceScores; ++i)
+            valenceScores[i] = valenceBoostScale * powf(float(i), -valenceBoostPower);
+    }
+
+    // The cache position of a vertex not in the cache is the cache size.
+    inline float score(unsigned cachePosition, unsigned numActiveTris) const
+    {
+        float valenceScore = numActiveTris < maxValenceScores
+            ? valenceScores[numActiveTris]
+            : valenceBoostScale * powf(float(numActiveTris), -valenceBoostPower);
+        return cachePositionScores[cachePosition] + valenceScore;
+    }
+
+    std::vector<float> cachePositionScores;
+    std::vector<float> valenceScores;
+};
+
+// The triangles using a vertex are stored contiguously starting at
+// triList, the first numActiveTris of them not yet added to the draw
+// list.
+struct Vertex
+{
+    unsigned triList;
+    unsigned numActiveTris;
+    float score;
+};
+
+inline float findTriangleScore(const unsigned* verts, const std::vector<Vertex>& vertices)
+{
+    return vertices[verts[0]].score + vertices[verts[1]].score + vertices[verts[2]].score;
+}
+}
+
 void VertexCacheVisitor::doVertexOptimization(Geometry& geom,
                                               std::vector<unsigned>& vertDrawList)
 {
     Geometry::PrimitiveSetList& primSets = geom.getPrimitiveSetList();
-    // lists for all the vertices and triangles
-    VertexList vertices;
-    TriangleList triangles;
-    TriangleCounter triCounter(&vertices);
+    std::vector<unsigned> triIndices;
+    TriangleLister triLister(&triIndices);
     for (Geometry::PrimitiveSetList::iterator itr = primSets.begin(),
              end = primSets.end();
          itr != end;
          ++itr)
-        (*itr)->accept(triCounter);
-    triangles.resize(triCounter.triangleCount);
-    // Get total of triangles used by all the vertices
-    size_t vertTrisSize = 0;
-    for (VertexList::iterator itr = vertices.begin(), end = vertices.end();
+        (*itr)->accept(triLister);
+    unsigned numVerts = triIndices.empty() ? 0 : *std::max_element(triIndices.begin(), triIndices.end()) + 1;
+    const unsigned cacheSize = osg::maximum(_cacheSize, 4u);
+
+    std::vector<Vertex> vertices(numVerts);
+    for (std::vector<unsigned>::iterator itr = triIndices.begin(), end = triIndices.end();
+         itr != end;
+         ++itr)
+        vertices[*itr].numActiveTris++;
+    unsigned vertTrisSize = 0;
+    for (std::vector<Vertex>::iterator itr = vertices.begin(), end = vertices.end();
          itr != end;
          ++itr)
     {
         itr->triList = vertTrisSize;
-        vertTrisSize += itr->trisUsing;
+        vertTrisSize += itr->numActiveTris;
+        itr->numActiveTris = 0;
     }
-    // Store for lists of triangles (indices) used by the vertices
-    std::vector<unsigned> vertTriListStore(vertTrisSize);
-    TriangleAdder triAdder(&vertices, &vertTriListStore, &triangles);
-    for (Geometry::PrimitiveSetList::iterator itr = primSets.begin(),
-             end = primSets.end();
-         itr != end;
-         ++itr)
-        (*itr)->accept(triAdder);
-    // Set up initial scores for vertices and triangles
-    for (VertexList::iterator itr = vertices.begin(), end = vertices.end();
-         itr != end;
-         ++itr)
-        itr->score = findVertexScore(*itr);
-    for (TriangleList::iterator itr = triangles.begin(), end = triangles.end();
+    std::vector<unsigned> vertTris(vertTrisSize);
+    for (unsigned i = 0; i < triIndices.size(); ++i)
+    {
+        Vertex& vert = vertices[triIndices[i]];
+        vertTris[vert.triList + vert.numActiveTris++] = i / 3;
+    }
+
+    // Set up initial scores for vertices
+    VertexScoreTable scoreTable(cacheSize);
+    for (std::vector<Vertex>::iterator itr = vertices.begin(), end = vertices.end();
          itr != end;
          ++itr)
-    {
-        itr->score = 0.0f;
-        for (int i = 0; i < 3; ++i)
-            itr->score += vertices[itr->verts[i]].score;
+        itr->score = scoreTable.score(cacheSize, itr->numActiveTris);
+
+    // The vertices in order of increasing valence, the parts of the
+    // mesh not reached yet are started from their vertex with the
+    // lowest valence, such as the corner of a grid.
+    std::vector<unsigned> startVerts(numVerts);
+    {
+        std::vector<unsigned> valenceStart(maxValenceScores + 1, 0);
+        for (unsigned v = 0; v < numVerts; ++v)
+            valenceStart[osg::minimum(vertices[v].numActiveTris, maxValenceScores - 1) + 1]++;
+        for (unsigned i = 1; i <= maxValenceScores; ++i)
+            valenceStart[i] += valenceStart[i - 1];
+        for (unsigned v = 0; v < numVerts; ++v)
+            startVerts[valenceStart[osg::minimum(vertices[v].numActiveTris, maxValenceScores - 1)]++] = v;
     }
+    std::vector<unsigned>::iterator nextStartVert = startVerts.begin();
+
+    std::vector<unsigned> cache, newCache;
+    cache.reserve(cacheSize + 3);
+    newCache.reserve(cacheSize + 3);
+    std::vector<unsigned> candidateTris;
+    std::vector<unsigned> recentVerts;
+
     // Add Triangles to the draw list until there are no more.
-    unsigned trisLeft = triangles.size();
-    vertDrawList.reserve(trisLeft * 3);
-    LRUCache cache(maxCacheSize);
-    while (trisLeft-- > 0)
-    {
-        Triangle* triToAdd = 0;
-        float bestScore = 0.0;
-        for (std::vector<unsigned>::const_iterator itr = cache.entries.begin(),
-                 end = cache.entries.end();
+    vertDrawList.clear();
+    vertDrawList.reserve(triIndices.size());
+    for (;;)
+    {
+        // Find the best triangle using the vertices in the cache.
+        int triToAdd = -1;
+        float bestScore = 0.0f;
+        for (std::vector<unsigned>::iterator itr = candidateTris.begin(), end = candidateTris.end();
              itr != end;
              ++itr)
         {
-            TriangleScore tscore =  computeTriScores(vertices[*itr], vertices,
-                                                     triangles, vertTriListStore);
-            if (tscore.second > bestScore)
+            float score = findTriangleScore(&triIndices[*itr * 3], vertices);
+            if (score > bestScore)
             {
-                bestScore = tscore.second;
-                triToAdd = &triangles[tscore.first];
+                bestScore = score;
+                triToAdd = *itr;
             }
         }
-        if (!triToAdd)
+
+        // Otherwise carry on from the most recently added vertex
+        // that still has triangles, or start a part of the mesh not
+        // reached yet.
+        if (triToAdd < 0)
         {
-            // The cache was empty, or all the triangles that use
-            // vertices in the cache have already been added.
-            OSG_DEBUG << "VertexCacheVisitor searching all triangles" << std::endl;
-            TriangleList::iterator maxItr
-                = std::max_element(triangles.begin(), triangles.end(),
-                              CompareTriangle());
-            triToAdd = &(*maxItr);
+            const Vertex* startVert = 0;
+            while (!startVert && !recentVerts.empty())
+            {
+                if (vertices[recentVerts.back()].numActiveTris > 0)
+                    startVert = &vertices[recentVerts.back()];
+                recentVerts.pop_back();
+            }
+            for (; !startVert && nextStartVert != startVerts.end(); ++nextStartVert)
+            {
+                if (vertices[*nextStartVert].numActiveTris > 0)
+                    startVert = &vertices[*nextStartVert];
+            }
+            if (!startVert)
+                break;
+            for (unsigned i = startVert->triList; i < startVert->triList + startVert->numActiveTris; ++i)
+            {
+                float score = findTriangleScore(&triIndices[vertTris[i] * 3], vertices);
+                if (triToAdd < 0 || score > bestScore)
+                {
+                    bestScore = score;
+                    triToAdd = vertTris[i];
+                }
+            }
         }
-        assert(triToAdd != 0 && triToAdd->score > 0.0);
-        // Add triangle vertices, and remove triangle from the
-        // vertices that use it.
-        triToAdd->score = -1.0f;
-        unsigned triToAddIdx = triToAdd - &triangles[0];
+
+        // Add the triangle's vertices to the front of the cache, and
+        // remove the triangle from the vertices that use it.
+        const unsigned* verts = &triIndices[triToAdd * 3];
+        newCache.clear();
         for (unsigned i = 0; i < 3; ++i)
         {
-            unsigned vertIdx = triToAdd->verts[i];
-            Vertex* vert = &vertices[vertIdx];
-            vertDrawList.push_back(vertIdx);
-            std::remove(vertTriListStore.begin() + vert->triList,
-                   vertTriListStore.begin() + vert->triList
-                   + vert->numActiveTris,
-                   triToAddIdx);
-            vert->numActiveTris--;
+            Vertex& vert = vertices[verts[i]];
+            vertDrawList.push_back(verts[i]);
+            newCache.push_back(verts[i]);
+            recentVerts.push_back(verts[i]);
+            unsigned* first = &vertTris[vert.triList];
+            std::remove(first, first + vert.numActiveTris--, static_cast<unsigned>(triToAdd));
         }
-        // Assume that the three oldest cache entries will get kicked
-        // out, so reset their scores and those of their
-        // triangles. Otherwise we'll "lose" them and not be able to
-        // change their scores.
-        if (cache.maxSize - cache.entries.size() < 3)
-        {
-            for (std::vector<unsigned>::iterator itr = cache.entries.end() - 3,
-                     end = cache.entries.end();
-                 itr != end;
-                ++itr)
-            {
-                vertices[*itr].cachePosition = -1;
-                vertices[*itr].score = findVertexScore(vertices[*itr]);
-            }
-            for (std::vector<unsigned>::iterator itr = cache.entries.end() - 3,
-                     end = cache.entries.end();
-                 itr != end;
-                ++itr)
-                computeTriScores(vertices[*itr], vertices, triangles,
-                                 vertTriListStore);
-        }
-        cache.addEntries(&triToAdd->verts[0], &triToAdd->verts[3]);
-        for (std::vector<unsigned>::const_iterator itr = cache.entries.begin(),
-                 end = cache.entries.end();
+        for (std::vector<unsigned>::iterator itr = cache.begin(), end = cache.end();
              itr != end;
              ++itr)
         {
-            unsigned vertIdx = *itr;
-            vertices[vertIdx].cachePosition = itr - cache.entries.begin();
-            vertices[vertIdx].score = findVertexScore(vertices[vertIdx]);
+            if (*itr != verts[0] && *itr != verts[1] && *itr != verts[2])
+                newCache.push_back(*itr);
+        }
+
+        // Update the scores of the vertices in the cache and those
+        // ejected from it, collecting the triangles using the
+        // vertices in the cache.
+        candidateTris.clear();
+        for (unsigned i = 0; i < newCache.size(); ++i)
+        {
+            Vertex& vert = vertices[newCache[i]];
+            vert.score = scoreTable.score(osg::minimum(i, cacheSize), vert.numActiveTris);
+            if (i < cacheSize)
+                candidateTris.insert(candidateTris.end(), vertTris.begin() + vert.triList,
+                                     vertTris.begin() + vert.triList + vert.numActiveTris);
         }
-     }
+        if (newCache.size() > cacheSize)
+            newCache.resize(cacheSize);
+        cache.swap(newCache);
+    }
+
+    if (_overdrawThreshold > 0.0f)
+    {
+        if (const Vec3Array* vec3Positions = dynamic_cast<const Vec3Array*>(geom.getVertexArray()))
+            reorderClustersForOverdraw(*vec3Positions, vertDrawList, cacheSize, _overdrawThreshold);
+        else if (const Vec3dArray* vec3dPositions = dynamic_cast<const Vec3dArray*>(geom.getVertexArray()))
+            reorderClustersForOverdraw(*vec3dPositions, vertDrawList, cacheSize, _overdrawThreshold);
+    }
 }
 
 void VertexCacheVisitor::optimizeVertices()
@@ -40,8 +40,12 @@
 #include <osgUtil/Statistics>
 #include <osgUtil/MeshOptimizers>
 
+#include <OpenThreads/Thread>
+#include <OpenThreads/Atomic>
+
 #include <typeinfo>
 #include <algorithm>
+#include <functional>
 #include <numeric>
 #include <sstream>
 
@@ -55,6 +59,250 @@ void Optimizer::reset()
 
 static osg::ApplicationUsageProxy Optimizer_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER \"<type> [<type>]\"","OFF | DEFAULT | FLATTEN_STATIC_TRANSFORMS | FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS | REMOVE_REDUNDANT_NODES | COMBINE_ADJACENT_LODS | SHARE_DUPLICATE_STATE | MERGE_GEOMETRY | MERGE_GEODES | SPATIALIZE_GROUPS  | COPY_SHARED_NODES | OPTIMIZE_TEXTURE_SETTINGS | REMOVE_LOADED_PROXY_NODES | TESSELLATE_GEOMETRY | CHECK_GEOMETRY |  FLATTEN_BILLBOARDS | TEXTURE_ATLAS_BUILDER | STATIC_OBJECT_DETECTION | INDEX_MESH | VERTEX_POSTTRANSFORM | VERTEX_PRETRANSFORM | BUFFER_OBJECT_SETTINGS");
 
+static osg::ApplicationUsageProxy Optimizer_e1(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER_THREADS <int>","Set the number of threads running the per Geometry optimizer passes, 0 uses the number of processors.");
+
+Optimizer::Optimizer():
+    _numThreads(1)
+{
+    const char* env = getenv("OSG_OPTIMIZER_THREADS");
+    if (env) _numThreads = atoi(env)>0 ? atoi(env) : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Parallel per Geometry passes - the geometries are collected and split into
+// groups that share no arrays, primitive sets or buffer objects, the groups
+// are then processed on several threads, each group in the serial order.
+////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+template<class Functor>
+void runTasks(Functor& functor, OpenThreads::Atomic& nextTask, unsigned int numTasks)
+{
+    for(unsigned int i=(++nextTask)-1; i<numTasks; i=(++nextTask)-1)
+    {
+        functor(i);
+    }
+}
+
+template<class Functor>
+class TaskThread : public OpenThreads::Thread
+{
+    public:
+
+        TaskThread(Functor& functor, OpenThreads::Atomic& nextTask, unsigned int numTasks):
+            _functor(functor),
+            _nextTask(nextTask),
+            _numTasks(numTasks) {}
+
+        virtual void run() { runTasks(_functor, _nextTask, _numTasks); }
+
+    protected:
+
+        Functor&                _functor;
+        OpenThreads::Atomic&    _nextTask;
+        unsigned int            _numTasks;
+};
+
+template<class Functor>
+void parallelFor(Functor& functor, unsigned int numTasks, unsigned int numThreads)
+{
+    OpenThreads::Atomic nextTask(0);
+
+    std::vector< TaskThread<Functor>* > threads;
+    for(unsigned int i=1; i<numThreads && i<numTasks; ++i)
+    {
+        TaskThread<Functor>* thread = new TaskThread<Functor>(functor, nextTask, numTasks);
+        threads.push_back(thread);
+        thread->start();
+    }
+
+    runTasks(functor, nextTask, numTasks);
+
+    for(typename std::vector< TaskThread<Functor>* >::iterator itr = threads.begin();
+        itr != threads.end();
+        ++itr)
+    {
+        (*itr)->join();
+        delete *itr;
+    }
+}
+
+typedef std::vector<osg::Geometry*> GeometryList;
+
+// Collect the geometries in the order the serial visitors first visit them.
+class CollectGeometryVisitor : public osg::NodeVisitor
+{
+    public:
+
+        CollectGeometryVisitor():
+            osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+        {
+            setNodeMaskOverride(0xffffffff);
+        }
+
+        virtual void apply(osg::Geometry& geometry)
+        {
+            if (_visited.insert(&geometry).second) _geometries.push_back(&geometry);
+        }
+
+        std::set<osg::Geometry*>    _visited;
+        GeometryList                _geometries;
+};
+
+// Objects of a geometry that may be shared with other geometries and so may be modified by the passes of both.
+void getSharedObjects(osg::Geometry& geometry, std::vector<const osg::Object*>& objects)
+{
+    osg::Geometry::ArrayList arrays;
+    geometry.getArrayList(arrays);
+    for(osg::Geometry::ArrayList::iterator itr = arrays.begin(); itr != arrays.end(); ++itr)
+    {
+        objects.push_back(itr->get());
+        if ((*itr)->getBufferObject()) objects.push_back((*itr)->getBufferObject());
+    }
+
+    osg::Geometry::PrimitiveSetList& primitives = geometry.getPrimitiveSetList();
+    for(osg::Geometry::PrimitiveSetList::iterator itr = primitives.begin(); itr != primitives.end(); ++itr)
+    {
+        objects.push_back(itr->get());
+        if ((*itr)->getBufferObject()) objects.push_back((*itr)->getBufferObject());
+    }
+}
+
+unsigned int findRoot(std::vector<unsigned int>& parents, unsigned int i)
+{
+    while(parents[i]!=i)
+    {
+        parents[i] = parents[parents[i]];
+        i = parents[i];
+    }
+    return i;
+}
+
+typedef std::vector<GeometryList> GeometryGroups;
+
+// Split the geometries into groups which share no objects, keeping the order of the geometries within each group,
+// the largest groups first so that they are started before the small ones.
+void groupGeometries(const GeometryList& geometries, GeometryGroups& groups)
+{
+    std::vector<unsigned int> parents(geometries.size());
+    for(unsigned int i=0; i<geometries.size(); ++i) parents[i] = i;
+
+    typedef std::map<const osg::Object*, unsigned int> ObjectMap;
+    ObjectMap objectMap;
+    std::vector<const osg::Object*> objects;
+    for(unsigned int i=0; i<geometries.size(); ++i)
+    {
+        objects.clear();
+        getSharedObjects(*geometries[i], objects);
+        for(std::vector<const osg::Object*>::iterator itr = objects.begin(); itr != objects.end(); ++itr)
+        {
+            std::pair<ObjectMap::iterator, bool> result = objectMap.insert(ObjectMap::value_type(*itr, i));
+            if (!result.second) parents[findRoot(parents, i)] = findRoot(parents, result.first->second);
+        }
+    }
+
+    typedef std::vector< std::pair<unsigned int, unsigned int> > GroupSizes;
+    GroupSizes groupSizes;
+    std::vector<unsigned int> groupIndices(geometries.size(), 0xffffffff);
+    GeometryGroups orderedGroups;
+    for(unsigned int i=0; i<geometries.size(); ++i)
+    {
+        unsigned int root = findRoot(parents, i);
+        if (groupIndices[root]==0xffffffff)
+        {
+            groupIndices[root] = orderedGroups.size();
+            orderedGroups.push_back(GeometryList());
+            groupSizes.push_back(GroupSizes::value_type(0, groupIndices[root]));
+        }
+
+        orderedGroups[groupIndices[root]].push_back(geometries[i]);
+
+        const osg::Array* vertices = geometries[i]->getVertexArray();
+        groupSizes[groupIndices[root]].first += vertices ? vertices->getNumElements() : 0;
+    }
+
+    std::stable_sort(groupSizes.begin(), groupSizes.end(), std::greater< GroupSizes::value_type >());
+
+    groups.clear();
+    groups.resize(groupSizes.size());
+    for(unsigned int i=0; i<groupSizes.size(); ++i)
+    {
+        groups[i].swap(orderedGroups[groupSizes[i].second]);
+    }
+}
+
+template<class Operation>
+struct GeometryGroupFunctor
+{
+    GeometryGroupFunctor(GeometryGroups& groups, Operation& operation):
+        _groups(groups),
+        _operation(operation) {}
+
+    void operator() (unsigned int i)
+    {
+        for(GeometryList::iterator itr = _groups[i].begin(); itr != _groups[i].end(); ++itr)
+        {
+            _operation(**itr);
+        }
+    }
+
+    GeometryGroups& _groups;
+    Operation&      _operation;
+};
+
+// Run operation on each of the geometries, splitting them between numThreads threads.
+template<class Operation>
+void runGeometryPass(const GeometryList& geometries, Operation& operation, unsigned int numThreads)
+{
+    GeometryGroups groups;
+    groupGeometries(geometries, groups);
+
+    // dirty the bounds up front so that the passes dirtying them don't dirty the shared parents of the geometries.
+    for(GeometryList::const_iterator itr = geometries.begin(); itr != geometries.end(); ++itr)
+    {
+        (*itr)->dirtyBound();
+    }
+
+    GeometryGroupFunctor<Operation> functor(groups, operation);
+    parallelFor(functor, groups.size(), numThreads);
+}
+
+GeometryList collectGeometries(osg::Node* node)
+{
+    CollectGeometryVisitor cgv;
+    node->accept(cgv);
+    return cgv._geometries;
+}
+
+GeometryList collectGeometries(GeometryCollector& collector)
+{
+    return GeometryList(collector.getGeometryList().begin(), collector.getGeometryList().end());
+}
+
+template<class Visitor, void (Visitor::*Method)(osg::Geometry&)>
+struct VisitorOperation
+{
+    VisitorOperation(Visitor& visitor) : _visitor(visitor) {}
+
+    void operator() (osg::Geometry& geometry) { (_visitor.*Method)(geometry); }
+
+    Visitor& _visitor;
+};
+
+void addPassTime(Optimizer::PassTimes& passTimes, const char* pass, osg::Timer_t& startTick)
+{
+    osg::Timer_t endTick = osg::Timer::instance()->tick();
+    passTimes.push_back(Optimizer::PassTimes::value_type(pass, osg::Timer::instance()->delta_s(startTick, endTick)));
+
+    OSG_INFO<<"Optimizer::optimize() "<<pass<<" took "<<passTimes.back().second*1000.0<<"ms"<<std::endl;
+
+    startTick = endTick;
+}
+
+}
+
 void Optimizer::optimize(osg::Node* node)
 {
     unsigned int options = 0;
@@ -154,10 +402,17 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
         stats.print(osg::notify(osg::NOTICE));
     }
 
+    unsigned int numThreads = _numThreads>0 ? _numThreads : static_cast<unsigned int>(OpenThreads::GetNumberOfProcessors());
+
+    _passTimes.clear();
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+
     if (options & STATIC_OBJECT_DETECTION)
     {
         StaticObjectDetectionVisitor sodv;
         node->accept(sodv);
+
+        addPassTime(_passTimes, "STATIC_OBJECT_DETECTION", startTick);
     }
 
     if (options & TESSELLATE_GEOMETRY)
@@ -166,6 +421,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
         TessellateVisitor tsv;
         node->accept(tsv);
+
+        addPassTime(_passTimes, "TESSELLATE_GEOMETRY", startTick);
     }
 
     if (options & REMOVE_LOADED_PROXY_NODES)
@@ -176,6 +433,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
         node->accept(rlpnv);
         rlpnv.removeRedundantNodes();
 
+        addPassTime(_passTimes, "REMOVE_LOADED_PROXY_NODES", startTick);
     }
 
     if (options & COMBINE_ADJACENT_LODS)
@@ -185,6 +443,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
         CombineLODsVisitor clv(this);
         node->accept(clv);
         clv.combineLODs();
+
+        addPassTime(_passTimes, "COMBINE_ADJACENT_LODS", startTick);
     }
 
     if (options & OPTIMIZE_TEXTURE_SETTINGS)
@@ -196,6 +456,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
                           false,1.0, // anisotropic filtering
                           this );
         node->accept(tv);
+
+        addPassTime(_passTimes, "OPTIMIZE_TEXTURE_SETTINGS", startTick);
     }
 
     if (options & SHARE_DUPLICATE_STATE)
@@ -209,6 +471,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
         StateVisitor osv(combineDynamicState, combineStaticState, combineUnspecifiedState, this);
         node->accept(osv);
         osv.optimize();
+
+        addPassTime(_passTimes, "SHARE_DUPLICATE_STATE", startTick);
     }
 
     if (options & TEXTURE_ATLAS_BUILDER)
@@ -228,6 +492,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
         StateVisitor osv(combineDynamicState, combineStaticState, combineUnspecifiedState, this);
         node->accept(osv);
         osv.optimize();
+
+        addPassTime(_passTimes, "TEXTURE_ATLAS_BUILDER", startTick);
     }
 
     if (options & COPY_SHARED_NODES)
@@ -237,6 +503,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
         CopySharedSubgraphsVisitor cssv(this);
         node->accept(cssv);
         cssv.copySharedNodes();
+
+        addPassTime(_passTimes, "COPY_SHARED_NODES", startTick);
     }
 
     if (options & FLATTEN_STATIC_TRANSFORMS)
@@ -258,6 +526,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
         CombineStaticTransformsVisitor cstv(this);
         node->accept(cstv);
         cstv.removeTransforms(node);
+
+        addPassTime(_passTimes, "FLATTEN_STATIC_TRANSFORMS", startTick);
     }
 
     if (options & FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS)
@@ -268,6 +538,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
         FlattenStaticTransformsDuplicatingSharedSubgraphsVisitor fstdssv(this);
         node->accept(fstdssv);
 
+        addPassTime(_passTimes, "FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS", startTick);
     }
 
     if (options & REMOVE_REDUNDANT_NODES)
@@ -282,20 +553,17 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
         node->accept(rrnv);
         rrnv.removeRedundantNodes();
 
+        addPassTime(_passTimes, "REMOVE_REDUNDANT_NODES", startTick);
     }
 
     if (options & MERGE_GEODES)
     {
         OSG_INFO<<"Optimizer::optimize() doing MERGE_GEODES"<<std::endl;
 
-        osg::Timer_t startTick = osg::Timer::instance()->tick();
-
         MergeGeodesVisitor visitor;
         node->accept(visitor);
 
-        osg::Timer_t endTick = osg::Timer::instance()->tick();
-
-        OSG_INFO<<"MERGE_GEODES took "<<osg::Timer::instance()->delta_s(startTick,endTick)<<std::endl;
+        addPassTime(_passTimes, "MERGE_GEODES", startTick);
     }
 
     if (options & MAKE_FAST_GEOMETRY)
@@ -303,22 +571,28 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
         OSG_INFO<<"Optimizer::optimize() doing MAKE_FAST_GEOMETRY"<<std::endl;
 
         MakeFastGeometryVisitor mgv(this);
-        node->accept(mgv);
+        if (numThreads>1)
+        {
+            VisitorOperation<MakeFastGeometryVisitor, &MakeFastGeometryVisitor::apply> operation(mgv);
+            runGeometryPass(collectGeometries(node), operation, numThreads);
+        }
+        else
+        {
+            node->accept(mgv);
+        }
+
+        addPassTime(_passTimes, "MAKE_FAST_GEOMETRY", startTick);
     }
 
     if (options & MERGE_GEOMETRY)
     {
         OSG_INFO<<"Optimizer::optimize() doing MERGE_GEOMETRY"<<std::endl;
 
-        osg::Timer_t startTick = osg::Timer::instance()->tick();
-
         MergeGeometryVisitor mgv(this);
         mgv.setTargetMaximumNumberOfVertices(10000);
         node->accept(mgv);
 
-        osg::Timer_t endTick = osg::Timer::instance()->tick();
-
-        OSG_INFO<<"MERGE_GEOMETRY took "<<osg::Timer::instance()->delta_s(startTick,endTick)<<std::endl;
+        addPassTime(_passTimes, "MERGE_GEOMETRY", startTick);
     }
 
 
@@ -327,6 +601,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
         FlattenBillboardVisitor fbv(this);
         node->accept(fbv);
         fbv.process();
+
+        addPassTime(_passTimes, "FLATTEN_BILLBOARDS", startTick);
     }
 
     if (options & SPATIALIZE_GROUPS)
@@ -336,6 +612,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
         SpatializeGroupsVisitor sv(this);
         node->accept(sv);
         sv.divide();
+
+        addPassTime(_passTimes, "SPATIALIZE_GROUPS", startTick);
     }
 
     if (options & INDEX_MESH)
@@ -343,7 +621,17 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
         OSG_INFO<<"Optimizer::optimize() doing INDEX_MESH"<<std::endl;
         IndexMeshVisitor imv(this);
         node->accept(imv);
-        imv.makeMesh();
+        if (numThreads>1)
+        {
+            VisitorOperation<IndexMeshVisitor, &IndexMeshVisitor::makeMesh> operation(imv);
+            runGeometryPass(collectGeometries(imv), operation, numThreads);
+        }
+        else
+        {
+            imv.makeMesh();
+        }
+
+        addPassTime(_passTimes, "INDEX_MESH", startTick);
     }
 
     if (options & VERTEX_POSTTRANSFORM)
@@ -351,7 +639,17 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
         OSG_INFO<<"Optimizer::optimize() doing VERTEX_POSTTRANSFORM"<<std::endl;
         VertexCacheVisitor vcv;
         node->accept(vcv);
-        vcv.optimizeVertices();
+        if (numThreads>1)
+        {
+            VisitorOperation<VertexCacheVisitor, &VertexCacheVisitor::optimizeVertices> operation(vcv);
+            runGeometryPass(collectGeometries(vcv), operation, numThreads);
+        }
+        else
+        {
+            vcv.optimizeVertices();
+        }
+
+        addPassTime(_passTimes, "VERTEX_POSTTRANSFORM", startTick);
     }
 
     if (options & VERTEX_PRETRANSFORM)
@@ -359,14 +657,34 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
         OSG_INFO<<"Optimizer::optimize() doing VERTEX_PRETRANSFORM"<<std::endl;
         VertexAccessOrderVisitor vaov;
         node->accept(vaov);
-        vaov.optimizeOrder();
+        if (numThreads>1)
+        {
+            VisitorOperation<VertexAccessOrderVisitor, &VertexAccessOrderVisitor::optimizeOrder> operation(vaov);
+            runGeometryPass(collectGeometries(vaov), operation, numThreads);
+        }
+        else
+        {
+            vaov.optimizeOrder();
+        }
+
+        addPassTime(_passTimes, "VERTEX_PRETRANSFORM", startTick);
     }
 
     if (options & BUFFER_OBJECT_SETTINGS)
     {
         OSG_INFO<<"Optimizer::optimize() doing BUFFER_OBJECT_SETTINGS"<<std::endl;
         BufferObjectVisitor bov(true, true, true, true, true, false);
-        node->accept(bov);
+        if (numThreads>1)
+        {
+            VisitorOperation<BufferObjectVisitor, &BufferObjectVisitor::apply> operation(bov);
+            runGeometryPass(collectGeometries(node), operation, numThreads);
+        }
+        else
+        {
+            node->accept(bov);
+        }
+
+        addPassTime(_passTimes, "BUFFER_OBJECT_SETTINGS", startTick);
     }
 
     if (osg::getNotifyLevel()>=osg::INFO)
@@ -4530,7 +4848,7 @@ void Optimizer::BufferObjectVisitor::apply(osg::Geometry& geometry)
 
     if (_changeVertexBufferObject)
     {
-        OSG_NOTICE<<"geometry.setUseVertexBufferObjects("<<_valueVertexBufferObject<<")"<<std::endl;
+        OSG_INFO<<"geometry.setUseVertexBufferObjects("<<_valueVertexBufferObject<<")"<<std::endl;
         geometry.setUseVertexBufferObjects(_valueVertexBufferObject);
     }
 #if 0
@@ -4542,7 +4860,7 @@ void Optimizer::BufferObjectVisitor::apply(osg::Geometry& geometry)
 #endif
     if (_changeDisplayList)
     {
-        OSG_NOTICE<<"geometry.setUseDisplayList("<<_valueDisplayList<<")"<<std::endl;
+        OSG_INFO<<"geometry.setUseDisplayList("<<_valueDisplayList<<")"<<std::endl;
         geometry.setUseDisplayList(_valueDisplayList);
     }
 }
@@ -22,6 +22,7 @@
 #include <osg/AlphaFunc>
 
 #include <algorithm>
+#include <typeinfo>
 
 using namespace osg;
 using namespace osgUtil;
@@ -142,6 +143,43 @@ RenderBin::SortMode RenderBin::getDefaultRenderBinSortMode()
     return s_defaultBinSortMode;
 }
 
+static bool s_radixSortMinimumNumLeavesInitialized = false;
+static unsigned int s_radixSortMinimumNumLeaves = 512;
+static osg::ApplicationUsageProxy RenderBin_e1(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_RADIX_SORT_MINIMUM_NUM_LEAVES <int>","Minimum number of leaves in a RenderBin for depth and traversal order sorting to use a radix sort, 0 disables the radix sort.");
+
+void RenderBin::setRadixSortMinimumNumLeaves(unsigned int numLeaves)
+{
+    s_radixSortMinimumNumLeavesInitialized = true;
+    s_radixSortMinimumNumLeaves = numLeaves;
+}
+
+unsigned int RenderBin::getRadixSortMinimumNumLeaves()
+{
+    if (!s_radixSortMinimumNumLeavesInitialized)
+    {
+        s_radixSortMinimumNumLeavesInitialized = true;
+
+        const char* str = getenv("OSG_RADIX_SORT_MINIMUM_NUM_LEAVES");
+        if (str) s_radixSortMinimumNumLeaves = atoi(str);
+    }
+
+    return s_radixSortMinimumNumLeaves;
+}
+
+static inline bool useRadixSort(unsigned int numLeaves)
+{
+    unsigned int minimumNumLeaves = RenderBin::getRadixSortMinimumNumLeaves();
+    return minimumNumLeaves>0 && numLeaves>=minimumNumLeaves;
+}
+
+// map a float onto an unsigned int such that the unsigned ints sort in the same order as the floats.
+static inline uint32_t floatToSortValue(float value)
+{
+    union { float f; uint32_t i; } bits;
+    bits.f = value;
+    return (bits.i & 0x80000000u) ? ~bits.i : (bits.i | 0x80000000u);
+}
+
 RenderBin::RenderBin()
 {
     _binNum = 0;
@@ -202,7 +240,17 @@ void RenderBin::reset()
 {
     _stateGraphList.clear();
     _renderLeafList.clear();
-    _bins.clear();
+
+    // keep hold of this frame's bins so that find_or_insert() can reuse them, and their leaf lists, next frame.
+    for(RenderBinList::iterator itr = _bins.begin();
+        itr!=_bins.end();
+        ++itr)
+    {
+        itr->second->reset();
+    }
+    _recycledBins.clear();
+    _recycledBins.swap(_bins);
+
     _sorted = false;
 }
 
@@ -305,6 +353,17 @@ void RenderBin::sortFrontToBack()
 {
     copyLeavesFromStateGraphListToRenderLeafList();
 
+    if (useRadixSort(_renderLeafList.size()))
+    {
+        _sortKeyList.resize(_renderLeafList.size());
+        for(unsigned int i=0; i<_renderLeafList.size(); ++i)
+        {
+            _sortKeyList[i] = (uint64_t(floatToSortValue(_renderLeafList[i]->_depth))<<32) | i;
+        }
+        radixSortRenderLeafList();
+        return;
+    }
+
     // now sort the list into ascending depth order.
     std::sort(_renderLeafList.begin(),_renderLeafList.end(),FrontToBackSortFunctor());
 
@@ -323,6 +382,18 @@ void RenderBin::sortBackToFront()
 {
     copyLeavesFromStateGraphListToRenderLeafList();
 
+    if (useRadixSort(_renderLeafList.size()))
+    {
+        // invert the sort value so that the ascending radix sort yields descending depth.
+        _sortKeyList.resize(_renderLeafList.size());
+        for(unsigned int i=0; i<_renderLeafList.size(); ++i)
+        {
+            _sortKeyList[i] = (uint64_t(~floatToSortValue(_renderLeafList[i]->_depth))<<32) | i;
+        }
+        radixSortRenderLeafList();
+        return;
+    }
+
     // now sort the list into ascending depth order.
     std::sort(_renderLeafList.begin(),_renderLeafList.end(),BackToFrontSortFunctor());
 
@@ -342,10 +413,77 @@ void RenderBin::sortTraversalOrder()
 {
     copyLeavesFromStateGraphListToRenderLeafList();
 
+    if (useRadixSort(_renderLeafList.size()))
+    {
+        _sortKeyList.resize(_renderLeafList.size());
+        for(unsigned int i=0; i<_renderLeafList.size(); ++i)
+        {
+            _sortKeyList[i] = (uint64_t(_renderLeafList[i]->_traversalOrderNumber)<<32) | i;
+        }
+        radixSortRenderLeafList();
+        return;
+    }
+
     // now sort the list into ascending depth order.
     std::sort(_renderLeafList.begin(),_renderLeafList.end(),TraversalOrderFunctor());
 }
 
+void RenderBin::radixSortRenderLeafList()
+{
+    const unsigned int numKeys = _sortKeyList.size();
+    if (numKeys==0) return;
+
+    _sortKeyScratchList.resize(numKeys);
+
+    // histogram all four bytes of the sort values in a single pass.
+    unsigned int counts[4][256];
+    memset(counts, 0, sizeof(counts));
+    for(unsigned int i=0; i<numKeys; ++i)
+    {
+        uint64_t key = _sortKeyList[i];
+        ++counts[0][(key>>32)&0xff];
+        ++counts[1][(key>>40)&0xff];
+        ++counts[2][(key>>48)&0xff];
+        ++counts[3][(key>>56)&0xff];
+    }
+
+    // least significant byte first, each pass is stable so equal sort values retain their leaf order.
+    uint64_t* src = &_sortKeyList.front();
+    uint64_t* dst = &_sortKeyScratchList.front();
+    for(unsigned int pass=0; pass<4; ++pass)
+    {
+        unsigned int shift = 32+pass*8;
+        unsigned int* count = counts[pass];
+
+        // skip the pass when all the keys have the same byte, such as the top bytes of traversal order numbers.
+        if (count[(src[0]>>shift)&0xff]==numKeys) continue;
+
+        unsigned int offset = 0;
+        for(unsigned int b=0; b<256; ++b)
+        {
+            unsigned int c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+
+        for(unsigned int i=0; i<numKeys; ++i)
+        {
+            uint64_t key = src[i];
+            dst[count[(key>>shift)&0xff]++] = key;
+        }
+
+        std::swap(src, dst);
+    }
+
+    // reorder the leaves using the leaf indices held in the lower 32 bits of the sorted keys.
+    _sortedRenderLeafList.resize(numKeys);
+    for(unsigned int i=0; i<numKeys; ++i)
+    {
+        _sortedRenderLeafList[i] = _renderLeafList[static_cast<uint32_t>(src[i])];
+    }
+    _renderLeafList.swap(_sortedRenderLeafList);
+}
+
 void RenderBin::copyLeavesFromStateGraphListToRenderLeafList()
 {
     _renderLeafList.clear();
@@ -395,6 +533,27 @@ RenderBin* RenderBin::find_or_insert(int binNum,const std::string& binName)
     RenderBinList::iterator itr = _bins.find(binNum);
     if (itr!=_bins.end()) return itr->second.get();
 
+    // reuse last frame's bin if it is still equivalent to a fresh copy of the prototype.
+    itr = _recycledBins.find(binNum);
+    if (itr!=_recycledBins.end())
+    {
+        RenderBin* rb = itr->second.get();
+        RenderBin* prototype = getRenderBinPrototype(binName);
+        if (prototype &&
+            typeid(*rb)==typeid(*prototype) &&
+            rb->_sortMode==prototype->_sortMode &&
+            rb->_sortCallback==prototype->_sortCallback &&
+            rb->_drawCallback==prototype->_drawCallback &&
+            rb->_stateset==prototype->_stateset)
+        {
+            rb->_parent = this;
+            rb->_stage = _stage;
+            _bins[binNum] = rb;
+            _recycledBins.erase(itr);
+            return rb;
+        }
+    }
+
     // create a rendering bin and insert into bin list.
     RenderBin* rb = RenderBin::createRenderBin(binName);
     if (rb)
@@ -419,6 +578,19 @@ RenderBin* RenderBin::find_or_insert(int binNum,const std::string& binName)
     return rb;
 }
 
+void RenderBin::reparent(RenderBin* parent)
+{
+    _parent = parent;
+    _stage = parent ? parent->getStage() : NULL;
+
+    for(RenderBinList::iterator itr = _bins.begin();
+        itr!=_bins.end();
+        ++itr)
+    {
+        itr->second->reparent(this);
+    }
+}
+
 void RenderBin::draw(osg::RenderInfo& renderInfo,RenderLeaf*& previous)
 {
     renderInfo.pushRenderBin(this);
@@ -14,6 +14,11 @@
 #include <osgUtil/StateGraph>
 #include <osg/Notify>
 
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+
+#include <vector>
+
 using namespace osg;
 using namespace osgUtil;
 
@@ -89,3 +94,115 @@ void RenderLeaf::render(osg::RenderInfo& renderInfo,RenderLeaf* previous)
 
     // OSG_NOTICE<<"RenderLeaf "<<_drawable->getName()<<" "<<_depth<<std::endl;
 }
+
+namespace
+{
+
+// Pool of fixed sized RenderLeaf slots allocated in contiguous blocks, freed slots are kept on a free list
+// for reuse rather than being returned to the heap.
+class RenderLeafArena
+{
+    public:
+
+        enum { NUM_RENDERLEAFS_PER_BLOCK = 256 };
+
+        RenderLeafArena():
+            _freeList(0),
+            _numLeaves(0) {}
+
+        void* allocate()
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+            if (!_freeList) allocateBlock();
+
+            FreeSlot* slot = _freeList;
+            _freeList = slot->_next;
+            ++_numLeaves;
+            return slot;
+        }
+
+        void deallocate(void* ptr)
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+            FreeSlot* slot = static_cast<FreeSlot*>(ptr);
+            slot->_next = _freeList;
+            _freeList = slot;
+            --_numLeaves;
+        }
+
+        unsigned int getSizeInBytes() const
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            return static_cast<unsigned int>(_blocks.size()*NUM_RENDERLEAFS_PER_BLOCK*sizeof(RenderLeaf));
+        }
+
+        unsigned int getNumLeaves() const
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            return _numLeaves;
+        }
+
+    protected:
+
+        struct FreeSlot
+        {
+            FreeSlot* _next;
+        };
+
+        void allocateBlock()
+        {
+            char* block = static_cast<char*>(::operator new(NUM_RENDERLEAFS_PER_BLOCK*sizeof(RenderLeaf)));
+            _blocks.push_back(block);
+
+            // thread the free list through the new block in ascending order so consecutive allocations are contiguous.
+            for(unsigned int i=NUM_RENDERLEAFS_PER_BLOCK; i>0; --i)
+            {
+                FreeSlot* slot = reinterpret_cast<FreeSlot*>(block+(i-1)*sizeof(RenderLeaf));
+                slot->_next = _freeList;
+                _freeList = slot;
+            }
+        }
+
+        mutable OpenThreads::Mutex  _mutex;
+        std::vector<char*>          _blocks;
+        FreeSlot*                   _freeList;
+        unsigned int                _numLeaves;
+};
+
+// The arena is intentionally never deleted as RenderLeaf's may be released during static destruction.
+RenderLeafArena* renderLeafArena()
+{
+    static RenderLeafArena* s_renderLeafArena = new RenderLeafArena;
+    return s_renderLeafArena;
+}
+
+}
+
+// Use a proxy to force the initialization of the RenderLeafArena during static initialization
+OSG_INIT_SINGLETON_PROXY(RenderLeafArenaSingletonProxy, renderLeafArena())
+
+void* RenderLeaf::operator new(std::size_t size)
+{
+    // subclasses of RenderLeaf don't fit in the arena's slots so fall back to the heap.
+    if (size!=sizeof(RenderLeaf)) return ::operator new(size);
+    return renderLeafArena()->allocate();
+}
+
+void RenderLeaf::operator delete(void* ptr, std::size_t size)
+{
+    if (!ptr) return;
+    if (size!=sizeof(RenderLeaf)) ::operator delete(ptr);
+    else renderLeafArena()->deallocate(ptr);
+}
+
+unsigned int RenderLeaf::getArenaSizeInBytes()
+{
+    return renderLeafArena()->getSizeInBytes();
+}
+
+unsigned int RenderLeaf::getNumArenaRenderLeaves()
+{
+    return renderLeafArena()->getNumLeaves();
+}
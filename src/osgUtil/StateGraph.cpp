@@ -26,6 +26,7 @@ void StateGraph::reset()
 
     _children.clear();
     _leaves.clear();
+    _spareStateGraphs.clear();
 }
 
 /** recursively clean the StateGraph of all its drawables, lights and depths.
@@ -46,20 +47,35 @@ void StateGraph::clean()
 
 }
 
-/** recursively prune the StateGraph of empty children.*/
-void StateGraph::prune()
+static void pruneStateGraph(StateGraph* sg, StateGraph::SpareStateGraphList& spareStateGraphs)
 {
     // call prune on all children.
-    ChildList::iterator citr=_children.begin();
-    while(citr!=_children.end())
+    StateGraph::ChildList::iterator citr=sg->_children.begin();
+    while(citr!=sg->_children.end())
     {
-        citr->second->prune();
+        pruneStateGraph(citr->second.get(), spareStateGraphs);
 
         if (citr->second->empty())
         {
-            ChildList::iterator ditr= citr++;
-            _children.erase(ditr);
+            // keep the empty child for reuse, releasing its references to scene graph data.
+            StateGraph* child = citr->second.get();
+            child->_parent = NULL;
+            child->_stateset = NULL;
+            child->_userData = NULL;
+            spareStateGraphs.push_back(child);
+
+            StateGraph::ChildList::iterator ditr= citr++;
+            sg->_children.erase(ditr);
         }
         else ++citr;
     }
 }
+
+/** recursively prune the StateGraph of empty children.*/
+void StateGraph::prune()
+{
+    StateGraph* root = this;
+    while(root->_parent) root = root->_parent;
+
+    pruneStateGraph(this, root->_spareStateGraphs);
+}
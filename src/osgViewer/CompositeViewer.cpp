@@ -1403,6 +1403,10 @@ void CompositeViewer::updateTraversal()
         ++sitr)
     {
         Scene* scene = *sitr;
+
+        // record the DatabasePager's request queue stats alongside the viewer stats.
+        if (scene->getDatabasePager()) scene->getDatabasePager()->setStats(getViewerStats());
+
         scene->updateSceneGraph(*_updateVisitor);
     }
 
@@ -632,6 +632,10 @@ static void collectSceneViewStats(unsigned int frameNumber, osgUtil::SceneView*
     stats->setAttribute(frameNumber, "Visible number of impostors", static_cast<double>(sceneStats.nimpostor));
     stats->setAttribute(frameNumber, "Number of ordered leaves", static_cast<double>(sceneStats.numOrderedLeaves));
 
+    // the RenderLeaf arena is shared by all views, once it has grown to the peak number of leaves it should remain constant.
+    stats->setAttribute(frameNumber, "RenderLeaf arena bytes", static_cast<double>(osgUtil::RenderLeaf::getArenaSizeInBytes()));
+    stats->setAttribute(frameNumber, "RenderLeaf arena leaves", static_cast<double>(osgUtil::RenderLeaf::getNumArenaRenderLeaves()));
+
     unsigned int totalNumPrimitiveSets = 0;
     const osgUtil::Statistics::PrimitiveValueMap& pvm = sceneStats.getPrimitiveValueMap();
     for(osgUtil::Statistics::PrimitiveValueMap::const_iterator pvm_itr = pvm.begin();
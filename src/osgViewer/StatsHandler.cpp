@@ -193,6 +193,7 @@ bool StatsHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdap
                             viewer->getViewerStats()->collectStats("frame_rate",false);
                             viewer->getViewerStats()->collectStats("event",false);
                             viewer->getViewerStats()->collectStats("update",false);
+                            viewer->getViewerStats()->collectStats("database_pager",false);
 
                             for(osgViewer::ViewerBase::Cameras::iterator itr = cameras.begin();
                                 itr != cameras.end();
@@ -239,6 +240,7 @@ bool StatsHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdap
 
                             viewer->getViewerStats()->collectStats("event",true);
                             viewer->getViewerStats()->collectStats("update",true);
+                            viewer->getViewerStats()->collectStats("database_pager",true);
 
                             for(osgViewer::ViewerBase::Cameras::iterator itr = cameras.begin();
                                 itr != cameras.end();
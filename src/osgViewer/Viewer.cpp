@@ -1149,6 +1149,9 @@ void Viewer::updateTraversal()
     _updateVisitor->setFrameStamp(getFrameStamp());
     _updateVisitor->setTraversalNumber(getFrameStamp()->getFrameNumber());
 
+    // record the DatabasePager's request queue stats alongside the viewer stats.
+    if (_scene->getDatabasePager()) _scene->getDatabasePager()->setStats(getViewerStats());
+
     _scene->updateSceneGraph(*_updateVisitor);
 
     // if we have a shared state manager prune any unused entries
@@ -1215,6 +1218,9 @@ void Viewer::updateTraversal()
 
     updateSlaves();
 
+    // request the tiles the camera is heading towards, now its view matrix is up to date.
+    if (_scene->getDatabasePager()) _scene->getDatabasePager()->prefetch(_scene->getSceneData(), _camera.get(), *getFrameStamp());
+
     if (getViewerStats() && getViewerStats()->collectStats("update"))
     {
         double endUpdateTraversal = osg::Timer::instance()->delta_s(_startTick, osg::Timer::instance()->tick());
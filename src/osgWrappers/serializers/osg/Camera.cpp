@@ -256,6 +256,7 @@ REGISTER_OBJECT_WRAPPER( Camera,
             ADD_BITFLAG_VALUE(LIGHT, osg::Camera::LIGHT);
             ADD_BITFLAG_VALUE(DRAW_BUFFER, osg::Camera::DRAW_BUFFER);
             ADD_BITFLAG_VALUE(READ_BUFFER, osg::Camera::READ_BUFFER);
+            ADD_BITFLAG_VALUE(NUM_CULL_THREADS, osg::Camera::NUM_CULL_THREADS);
             ADD_BITFLAG_VALUE(NO_VARIABLES, osg::Camera::NO_VARIABLES);
             /** ADD_BITFLAG_VALUE(ALL_VARIABLES, osg::Camera::ALL_VARIABLES);*/
         END_BITFLAGS_SERIALIZER();
@@ -0,0 +1,14 @@
+#include <osg/PointCloudNode>
+#include <osgDB/ObjectWrapper>
+#include <osgDB/InputStream>
+#include <osgDB/OutputStream>
+
+REGISTER_OBJECT_WRAPPER( PointCloudNode,
+                         new osg::PointCloudNode,
+                         osg::PointCloudNode,
+                         "osg::Object osg::Node osg::LOD osg::PagedLOD osg::PointCloudNode" )
+{
+    ADD_UINT_SERIALIZER( NumPoints, 0 );  // _numPoints
+    ADD_UINT_SERIALIZER( PointBudget, 1000000 );  // _pointBudget
+    ADD_FLOAT_SERIALIZER( PointSpacing, 2.0f );  // _pointSpacing
+}
@@ -10,6 +10,7 @@ USE_SERIALIZER_WRAPPER(osgAnimation_AnimationManagerBase)
 USE_SERIALIZER_WRAPPER(osgAnimation_BasicAnimationManager)
 USE_SERIALIZER_WRAPPER(osgAnimation_Bone)
 USE_SERIALIZER_WRAPPER(osgAnimation_MorphGeometry)
+USE_SERIALIZER_WRAPPER(osgAnimation_ParallelUpdateRigGeometry)
 USE_SERIALIZER_WRAPPER(osgAnimation_RigComputeBoundingBoxCallback)
 USE_SERIALIZER_WRAPPER(osgAnimation_RigGeometry)
 USE_SERIALIZER_WRAPPER(osgAnimation_RigTransform)
@@ -0,0 +1,15 @@
+#undef OBJECT_CAST
+#define OBJECT_CAST dynamic_cast
+
+#include <osgAnimation/RigGeometry>
+#include <osgDB/ObjectWrapper>
+#include <osgDB/InputStream>
+#include <osgDB/OutputStream>
+
+REGISTER_OBJECT_WRAPPER(osgAnimation_ParallelUpdateRigGeometry,
+                        new osgAnimation::ParallelUpdateRigGeometry,
+                        osgAnimation::ParallelUpdateRigGeometry,
+                        "osg::Object osg::Callback osg::NodeCallback osgAnimation::ParallelUpdateRigGeometry") {}
+
+#undef OBJECT_CAST
+#define OBJECT_CAST static_cast